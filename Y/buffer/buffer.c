@@ -124,6 +124,14 @@ buffer_get_cairo_surface (Buffer *self)
   return self->surface;
 }
 
+cairo_surface_t *
+buffer_get_source_surface (Buffer *self)
+{
+  if (self->c->get_source_surface != NULL)
+    return self->c->get_source_surface (self);
+  return self->surface;
+}
+
 uint32_t
 buffer_get_depth (cairo_format_t buffer_format)
 {
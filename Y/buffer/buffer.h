@@ -61,4 +61,7 @@ struct Painter * buffer_get_painter  (Buffer *);
 cairo_t * buffer_get_cairo_context  (Buffer *);
 cairo_surface_t * buffer_get_cairo_surface (Buffer *);
 
+/* the surface to use when drawing this buffer onto another */
+cairo_surface_t * buffer_get_source_surface (Buffer *);
+
 #endif
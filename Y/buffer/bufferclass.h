@@ -39,6 +39,9 @@ typedef struct
   void (*set_size)     (Buffer *, int w, int h);
   void (*begin_resize) (Buffer *, int w, int h);
   void (*end_resize)   (Buffer *);
+  /* optional; the surface to read from when the buffer is drawn
+   * elsewhere, if not the one painters draw on */
+  cairo_surface_t *(*get_source_surface) (Buffer *);
 } BufferClass;
 
 struct Buffer_t
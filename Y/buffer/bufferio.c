@@ -56,16 +56,11 @@ buffer_load_from_png (const char *filename)
   int height = cairo_image_surface_get_height(cairo_surface);
   
   //we draw the image onto a ARGB32 buffer
-  int btpp = 4;
-  int memblock = width*height*btpp;
+  ImageBuffer *cairoBuffer = image_buffer_create (CAIRO_FORMAT_ARGB32,
+						  width, height);
+  int memblock = image_buffer_get_stride_bytes (cairoBuffer) * height;
   Y_TRACE ("MEMBLOCK %d w %d h %d", memblock, width, height);
-  uint8_t *pixel_data = ymalloc(width*height*btpp);
-  memset (pixel_data, 0, memblock);	// Set all channels to black/transparant
-  ImageBuffer *cairoBuffer = image_buffer_create_from_data (CAIRO_FORMAT_ARGB32,
-							       width,
-							       height,
-							       btpp*width,
-							       pixel_data);
+  memset (image_buffer_get_pixel_data (cairoBuffer), 0, memblock);	// Set all channels to black/transparant
   cairo_t *cr = buffer_get_cairo_context ((Buffer *)cairoBuffer);
   cairo_set_source_surface (cr, cairo_surface, 0, 0);
   cairo_paint(cr);
@@ -25,6 +25,7 @@ struct ImageBuffer_t
   Buffer buffer;
   uint8_t *pixel_data;  //we need this because cairo doesn't have a conveneient way to get the actual pixeldata
   uint32_t stride_bytes;
+  bool owns_data;       //false if the pixel data was handed to us, see image_buffer_create_from_data
   int hblocksize;
   int vblocksize;
   bool resizing;
@@ -85,16 +86,20 @@ image_buffer_set_size (Buffer *self, int w, int h)
     int vblocks = 1 + self->height / buf->vblocksize;
     if (hblocks != new_hblocks || vblocks != new_vblocks)
     {
-      yfree (buf->pixel_data);
+      if (buf->owns_data)
+        yfree (buf->pixel_data);
       buf->stride_bytes = image_buffer_stride_bytes(self->format, new_hblocks * buf->hblocksize);
       buf->pixel_data = ymalloc (buf->stride_bytes * new_vblocks * buf->vblocksize);
+      buf->owns_data = true;
     }
   }
   else
   {
-    yfree (buf->pixel_data);
+    if (buf->owns_data)
+      yfree (buf->pixel_data);
     buf->stride_bytes = image_buffer_stride_bytes(self->format, w);
     buf->pixel_data = ymalloc (buf->stride_bytes * h);
+    buf->owns_data = true;
   }
 
   //memset (buf->pixel_data, 0, memblock);	// Set all channels to black/transparant
@@ -117,7 +122,7 @@ image_buffer_destroy (Buffer *self)
     {
       buffer_finalise (self);
       cairo_surface_destroy (self->surface);
-      if (buf->pixel_data)
+      if (buf->pixel_data && buf->owns_data)
         yfree(buf->pixel_data);
       yfree (buf);
     }
@@ -139,9 +144,11 @@ image_buffer_reallocate (Buffer *self, int new_w, int new_h)
 
   buffer_destroy_all_painters (self);
   cairo_surface_destroy (self->surface);
-  yfree (buf->pixel_data);
+  if (buf->owns_data)
+    yfree (buf->pixel_data);
 
   buf->pixel_data = p;
+  buf->owns_data = true;
   buf->stride_bytes = stride_bytes;
   self->surface = s;
 }
@@ -210,6 +217,7 @@ image_buffer_create (cairo_format_t format, uint w, uint h)
 /* Initialize something small so we can get rid of special cases in set_size...*/
   buf->stride_bytes = image_buffer_stride_bytes(format, 1);
   buf->pixel_data = ymalloc (buf->stride_bytes * 1);
+  buf->owns_data = true;
   buf->buffer.surface = cairo_image_surface_create_for_data (buf->pixel_data,
                     format, 1, 1, buf->stride_bytes);
   buffer_set_size (&buf->buffer, w, h);
@@ -220,6 +228,9 @@ image_buffer_create (cairo_format_t format, uint w, uint h)
 /**
  * Creates a new buffer from the data passed in.
  *
+ * The data is used in place and still belongs to the caller, who must
+ * keep it alive until the buffer has been destroyed.
+ *
  * -DN
  */
 ImageBuffer *
@@ -232,6 +243,7 @@ image_buffer_create_from_data (cairo_format_t format,
 
   buf->stride_bytes = stride_bytes;
   buf->pixel_data = data;
+  buf->owns_data = false;
   buf->buffer.surface = cairo_image_surface_create_for_data (buf->pixel_data,
                     format, w, h, buf->stride_bytes);
   buf->buffer.width = w;
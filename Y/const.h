@@ -11,12 +11,39 @@ enum YMessageOperation
   YMO_FIND_CLASS,
   YMO_INVOKE_CLASS_METHOD,
   YMO_INVOKE_INSTANCE_METHOD,
+  /* Resolves a method name to an id, which the reply carries in its id
+   * field; the invoke messages take either as their first value */
+  YMO_FIND_METHOD,
 };
 
 enum YUnixControlMessageType
   {
     ucmtNewChannel,
-    ucmtAuthenticate
+    ucmtAuthenticate,
+    /* Client to server: a uint32 id, and a descriptor in SCM_RIGHTS */
+    ucmtPassFileDescriptor
+  };
+
+/* Traffic logs written by "Y --record" and read by yreplay. The file
+ * starts with YRECORD_MAGIC and a uint32 YRECORD_VERSION; each record
+ * then has a uint64 time in microseconds since recording began, a
+ * uint32 client id, a uint8 event, a uint32 length and that many bytes
+ * of message body (without its length prefix). Everything is in
+ * network byte order.
+ */
+#define YRECORD_MAGIC "YREC"
+#define YRECORD_VERSION 1
+#define YRECORD_HEADER_SIZE 17
+
+enum YRecordEvent
+  {
+    /* no data */
+    yreConnect,
+    yreDisconnect,
+    /* a message body from the client */
+    yreInbound,
+    /* a message body to the client */
+    yreOutbound
   };
 
 #endif /* header guard */
@@ -22,6 +22,7 @@
 #include <Y/input/pointer.h>
 #include <Y/buffer/buffer.h>
 #include <Y/buffer/bufferio.h>
+#include <Y/main/control.h>
 #include <Y/util/yutil.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -29,6 +30,11 @@
 static int pointerX = 0, pointerY = 0;
 static struct Widget *pointerWidget = NULL;
 
+/* Where queued motion will leave the pointer */
+static bool pointerMotionPending = false;
+static bool pointerWorkRegistered = false;
+static int pendingX = 0, pendingY = 0;
+
 void
 pointerGrab (struct Widget *w)
 {
@@ -56,6 +62,50 @@ pointerMovePosition (int dx, int dy)
   pointerSetPosition (pointerX + dx, pointerY + dy);
 }
 
+static void
+pointerFlushMotion (void *data)
+{
+  if (pointerMotionPending)
+    pointerSetPosition (pendingX, pendingY);
+}
+
+static void
+pointerQueue (int x, int y)
+{
+  if (!pointerWorkRegistered)
+    {
+      controlRegisterWorkHandler (NULL, pointerFlushMotion);
+      pointerWorkRegistered = true;
+    }
+
+  /* constrained as it goes, so that moving back from an edge starts
+   * from the edge
+   */
+  screenConstrainPoint (&x, &y);
+  pendingX = x;
+  pendingY = y;
+  if (!pointerMotionPending)
+    {
+      pointerMotionPending = true;
+      controlWorkPending ();
+    }
+}
+
+void
+pointerQueuePosition (int x, int y)
+{
+  pointerQueue (x, y);
+}
+
+void
+pointerQueueMotion (int dx, int dy)
+{
+  if (pointerMotionPending)
+    pointerQueue (pendingX + dx, pendingY + dy);
+  else
+    pointerQueue (pointerX + dx, pointerY + dy);
+}
+
 void
 pointerSetPosition (int x, int y)
 {
@@ -64,12 +114,13 @@ pointerSetPosition (int x, int y)
   int py = y;
   int dx;
   int dy;
+  /* this supersedes anything queued */
+  pointerMotionPending = false;
   screenConstrainPoint (&px, &py);
   dx = px - pointerX;
   dy = py - pointerY;
   if (px == pointerX && py == pointerY)
     return;
-  screenInvalidateRectangle (rectangleCreate (pointerX, pointerY, 32, 32));
   pointerX = px;
   pointerY = py;
   if (pointerWidget != NULL)
@@ -80,7 +131,7 @@ pointerSetPosition (int x, int y)
   else
     w = screenGetRootWidget ();
 
-  screenInvalidateRectangle (rectangleCreate (pointerX, pointerY, 32, 32));
+  screenCursorMoved ();
 
   widget_pointer_motion (w, px, py, dx, dy);
 }
@@ -89,8 +140,12 @@ void
 pointerButtonChange (int button, int pressed)
 {
   struct Widget *w;
-  int x = pointerX;
-  int y = pointerY;
+  int x, y;
+
+  /* the button changed where the pointer had got to */
+  pointerFlushMotion (NULL);
+  x = pointerX;
+  y = pointerY;
 
   if (pointerWidget != NULL)
     {
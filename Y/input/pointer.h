@@ -30,6 +30,13 @@ void pointerGetPosition (int *xp, int *yp);
 void pointerSetPosition (int x, int y);
 void pointerMovePosition (int dx, int dy);
 
+/* Drivers report motion with these. Queued motion is coalesced into
+ * one update per main loop iteration, which is applied early in the
+ * next iteration, or straight away if a button changes first
+ */
+void pointerQueuePosition (int x, int y);
+void pointerQueueMotion (int dx, int dy);
+
 void pointerButtonChange (int button, int pressed);
 
 void pointerGrab (struct Widget *);
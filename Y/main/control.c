@@ -17,24 +17,43 @@
  */
 
 #include <Y/main/control.h>
+#include <Y/main/controlbackend.h>
 #include <Y/util/yutil.h>
 #include <Y/util/index.h>
-#include <Y/util/pqueue.h>
+#include <Y/util/timerwheel.h>
+#include <Y/util/perf.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <signal.h>
 #include <sys/time.h>
+#include <time.h>
 #include <assert.h>
 
 static int controlRunning = 1;
 
+/* Most ready descriptors handled in one iteration; any more will
+ * still be ready next time round
+ */
+#define CONTROL_MAX_EVENTS 64
+
+static const struct ControlBackend *backend = NULL;
+
 struct ControlFileDescriptor
 {
   int fd;
   int watchMask;
   void *userData;
   void (*callback)(int, int, void *);
+  bool urgent;
+  /* Set when unregistered during despatch; the backend may still have
+   * handed us this pointer, so it is freed at the end of the iteration
+   */
+  struct ControlFileDescriptor *nextDead;
 };
 
+static bool despatching = false;
+static struct ControlFileDescriptor *deadFileDescriptors = NULL;
+
 static int
 controlFileDescriptorsKeyFunction (const void *key_v, const void *obj_v)
 {
@@ -122,29 +141,10 @@ controlSignalHandlerSetDestructorFunction (void *obj_v)
 
 struct ControlTimedEvent
 {
-  struct timeval time;
-  int id;
   void *userData;
   void (*callback)(void *);
 };
 
-static int nextTimedEventID = 1;
-
-static int
-controlTimedEventsComparisonFunction (const void *obj1_v, const void *obj2_v)
-{
-  const struct ControlTimedEvent *obj1 = obj1_v;
-  const struct ControlTimedEvent *obj2 = obj2_v;
-  if (obj1 -> time.tv_sec == obj2 -> time.tv_sec)
-    {
-       return obj1 -> time.tv_usec - obj2 -> time.tv_usec;
-    }
-  else
-    {
-       return obj1 -> time.tv_sec - obj2 -> time.tv_sec;
-    }
-}
-
 static void
 controlTimedEventDestructorFunction (void *obj_v)
 {
@@ -152,7 +152,36 @@ controlTimedEventDestructorFunction (void *obj_v)
 }
 
 static struct Index *fileDescriptors, *signalHandlers;
-static struct PQueue *timedEvents; 
+static struct TimerWheel *timedEvents;
+
+struct ControlHandler
+{
+  void *userData;
+  void (*callback)(void *);
+  struct ControlHandler *next;
+};
+
+static struct ControlHandler *flushHandlers = NULL;
+static struct ControlHandler *workHandlers = NULL;
+
+/* Set when there is work waiting for the work handlers */
+static bool workPending = false;
+
+/* Timers are rounded up to a multiple of this many milliseconds, so
+ * that ones due at nearly the same time expire together
+ */
+static int timerSlack = 0;
+
+/* Milliseconds on the monotonic clock. Expiry times are rounded up,
+ * so that a timer never fires before its interval has passed
+ */
+static uint64_t
+controlNow (bool roundUp)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000 + (now.tv_nsec + (roundUp ? 999999 : 0)) / 1000000;
+}
 
 static void
 exitSignalHandler (int signo, void *userData)
@@ -170,7 +199,20 @@ controlInitialise (void)
                                  controlFileDescriptorsComparisonFunction);
   signalHandlers = indexCreate (controlSignalHandlerSetKeyFunction,
                                 controlSignalHandlerSetComparisonFunction);
-  timedEvents = pqueueCreate (controlTimedEventsComparisonFunction);
+  timedEvents = timerwheelCreate (controlNow (false));
+
+  backend = controlBackendFind (getenv ("YCONTROLBACKEND"));
+  if (backend == NULL)
+    {
+      Y_WARN ("Unknown control backend \"%s\", using the default", getenv ("YCONTROLBACKEND"));
+      backend = controlBackendFind (NULL);
+    }
+  if (!backend -> initialise ())
+    {
+      backend = &controlSelectBackend;
+      backend -> initialise ();
+    }
+  Y_TRACE ("Using %s control backend", backend -> name);
 
   /* Block all the signals, except the ones which we should not handle (fatal errors) */
   sigfillset(&block_mask);
@@ -205,24 +247,39 @@ controlRegisterFileDescriptor (int fd, int watchMask, void *userData,
   obj -> watchMask = watchMask;
   obj -> userData = userData;
   obj -> callback = callback;
+  obj -> urgent = false;
+  obj -> nextDead = NULL;
   indexAdd (fileDescriptors, obj);
+  if (!backend -> add (fd, watchMask, obj))
+    Y_ERROR ("The %s control backend cannot watch file descriptor %d", backend -> name, fd);
 }
 
 void
 controlChangeFileDescriptorMask (int fd, int watchMask)
 {
   struct ControlFileDescriptor *obj = indexFind (fileDescriptors, &fd);
-  if (obj != NULL)
+  if (obj != NULL && obj -> watchMask != watchMask)
     {
       obj -> watchMask = watchMask;
+      backend -> modify (fd, watchMask, obj);
     }
 }
 
 void
 controlUnregisterFileDescriptor (int fd)
 {
-  void *obj = indexRemove (fileDescriptors, &fd);
-  yfree (obj);
+  struct ControlFileDescriptor *obj = indexRemove (fileDescriptors, &fd);
+  if (obj == NULL)
+    return;
+  backend -> remove (fd);
+  if (despatching)
+    {
+      obj -> callback = NULL;
+      obj -> nextDead = deadFileDescriptors;
+      deadFileDescriptors = obj;
+    }
+  else
+    yfree (obj);
 }
 
 void
@@ -256,6 +313,79 @@ controlUnregisterSignalHandler (int signo, void *userData, void (*callback)(int
     }
 }
 
+void
+controlSetFileDescriptorUrgent (int fd, bool urgent)
+{
+  struct ControlFileDescriptor *obj = indexFind (fileDescriptors, &fd);
+  if (obj != NULL)
+    obj -> urgent = urgent;
+}
+
+static void
+controlHandlerAdd (struct ControlHandler **list, void *userData, void (*callback)(void *userData))
+{
+  assert(callback != NULL);
+  struct ControlHandler *obj = ymalloc (sizeof (*obj));
+  obj -> userData = userData;
+  obj -> callback = callback;
+  obj -> next = *list;
+  *list = obj;
+}
+
+static void
+controlHandlerRemove (struct ControlHandler **list, void *userData, void (*callback)(void *userData))
+{
+  for (struct ControlHandler **p = list; *p != NULL; p = &(*p) -> next)
+    if ((*p) -> userData == userData && (*p) -> callback == callback)
+      {
+        struct ControlHandler *obj = *p;
+        *p = obj -> next;
+        yfree (obj);
+        return;
+      }
+}
+
+static void
+controlHandlersDestroy (struct ControlHandler **list)
+{
+  while (*list != NULL)
+    {
+      struct ControlHandler *obj = *list;
+      *list = obj -> next;
+      yfree (obj);
+    }
+}
+
+void
+controlRegisterFlushHandler (void *userData, void (*callback)(void *userData))
+{
+  controlHandlerAdd (&flushHandlers, userData, callback);
+}
+
+void
+controlUnregisterFlushHandler (void *userData, void (*callback)(void *userData))
+{
+  controlHandlerRemove (&flushHandlers, userData, callback);
+}
+
+void
+controlRegisterWorkHandler (void *userData, void (*callback)(void *userData))
+{
+  controlHandlerAdd (&workHandlers, userData, callback);
+}
+
+void
+controlUnregisterWorkHandler (void *userData, void (*callback)(void *userData))
+{
+  controlHandlerRemove (&workHandlers, userData, callback);
+}
+
+void
+controlWorkPending (void)
+{
+  workPending = true;
+}
+
 static void
 signalHandlerIterator(const void *obj_v, void *set_v)
 {
@@ -298,97 +428,63 @@ int
 controlTimerDelay (int minIntervalSeconds, int minIntervalMilliseconds,
                    void *userData, void (*callback)(void *userData))
 {
-  struct timeval now;
   struct ControlTimedEvent *event;
+  uint64_t expiry;
 
   event = ymalloc (sizeof (struct ControlTimedEvent));
   event -> userData = userData;
   event -> callback = callback;
-  event -> id = nextTimedEventID ++;
-
-  gettimeofday (&now, NULL);
 
-  event -> time.tv_usec = (minIntervalMilliseconds * 1000 + now.tv_usec);
-  event -> time.tv_sec = minIntervalSeconds + now.tv_sec;
-  if (event -> time.tv_usec >= 1000000)
-    {
-      event -> time.tv_sec++;
-      event -> time.tv_usec -= 1000000;
-    }
+  expiry = controlNow (true) + (uint64_t)minIntervalSeconds * 1000 + minIntervalMilliseconds;
+  if (timerSlack > 1)
+    expiry = (expiry + timerSlack - 1) / timerSlack * timerSlack;
 
-  pqueueInsert (timedEvents, event); 
-
-  return event -> id;
+  return timerwheelAdd (timedEvents, expiry, event);
 }
 
-static int
-controlCancelTimerDelayTestFunction (void *timedEvent_v, void *id_v)
+void
+controlCancelTimerDelay (int id)
 {
-  int *id = id_v;
-  struct ControlTimedEvent *timedEvent = timedEvent_v;
-  if (timedEvent -> id == *id)
-    {
-      yfree(timedEvent);
-      return 1;
-    }
-  else
-    return 0;
+  yfree (timerwheelCancel (timedEvents, id));
 }
 
 void
-controlCancelTimerDelay (int id)
+controlSetTimerSlack (int milliseconds)
 {
-  pqueueRemove (timedEvents, &id, controlCancelTimerDelayTestFunction);  
+  timerSlack = milliseconds > 0 ? milliseconds : 0;
+}
+
+static void
+controlDespatchEvents (struct ControlEvent *events, int count, bool urgent)
+{
+  for (int i = 0; i < count; ++i)
+    {
+      struct ControlFileDescriptor *cfd = events[i].userData;
+      /* skip anything unregistered by an earlier callback */
+      if (cfd == NULL || cfd -> callback == NULL || cfd -> urgent != urgent)
+        continue;
+      int mask = events[i].causeMask & cfd -> watchMask;
+      if (mask)
+        cfd -> callback (cfd -> fd, mask, cfd -> userData);
+    }
 }
 
 static int
 controlIteration (void)
 {
   struct ControlTimedEvent *tev;
-  struct IndexIterator *iter;
+  struct ControlEvent events[CONTROL_MAX_EVENTS];
   struct timeval timeout;
-  int maxFd = 0;
+  uint64_t expiry;
   int retval;
-  fd_set fds[3];
-  FD_ZERO (&fds[0]); 
-  FD_ZERO (&fds[1]);  
-  FD_ZERO (&fds[2]);
-
-  iter = indexGetStartIterator (fileDescriptors);
-  while (indexiteratorHasValue (iter))
-    {
-      struct ControlFileDescriptor *cfd = indexiteratorGet (iter);
-      if (cfd -> watchMask & CONTROL_WATCH_READ)
-        FD_SET (cfd -> fd, &fds[0]);
-      if (cfd -> watchMask & CONTROL_WATCH_WRITE)
-        FD_SET (cfd -> fd, &fds[1]);
-      if (cfd -> watchMask & CONTROL_WATCH_EXCEPT)
-        FD_SET (cfd -> fd, &fds[2]);
-      indexiteratorNext (iter);
-    }
-
-  /* need to find maximum file descriptor */
-  indexiteratorPrevious (iter); /* back up one place */
-  {
-    struct ControlFileDescriptor *cfd = indexiteratorGet (iter);
-    if (cfd != NULL)
-      maxFd = cfd -> fd;
-  }
-  indexiteratorDestroy (iter);
 
   /* work out time to next poll or timer event */
-  tev = pqueuePeekNext (timedEvents);
-  if (tev)
+  if (timerwheelNextExpiry (timedEvents, &expiry))
     {
-      struct timeval now;
-      gettimeofday (&now, NULL);
-      timeout.tv_sec = tev -> time.tv_sec - now.tv_sec;
-      timeout.tv_usec = tev -> time.tv_usec - now.tv_usec;
-      if (timeout.tv_usec < 0)
-        {
-          timeout.tv_sec--;
-          timeout.tv_usec += 1000000;
-        }
+      uint64_t now = controlNow (false);
+      uint64_t delay = expiry > now ? expiry - now : 0;
+      timeout.tv_sec = delay / 1000;
+      timeout.tv_usec = (delay % 1000) * 1000;
     }
   else
     {
@@ -396,56 +492,55 @@ controlIteration (void)
       timeout.tv_usec = 0;
     }
 
-  /* select () */
-  if (timeout.tv_sec < 0 || (timeout.tv_sec == 0 && timeout.tv_usec == 0))
+  if (workPending)
+    {
+      /* just see what else is ready */
+      timeout.tv_sec = 0; timeout.tv_usec = 0;
+    }
+  else if (timeout.tv_sec == 0 && timeout.tv_usec == 0)
     {
       timeout.tv_sec = 0; timeout.tv_usec = 100; 
     }
+  workPending = false;
+
+  retval = backend -> wait (&timeout, events, CONTROL_MAX_EVENTS);
+  uint64_t start = perfNow ();
 
-  retval = select (maxFd + 1, &fds[0], &fds[1], &fds[2], &timeout);
+  /* despatch whatever woke us up, urgent descriptors first, with the
+   * work put off from earlier iterations before the rest */
+  despatching = true;
+  controlDespatchEvents (events, retval, true);
+  for (struct ControlHandler *h = workHandlers; h != NULL; h = h -> next)
+    h -> callback (h -> userData);
+  controlDespatchEvents (events, retval, false);
+  despatching = false;
 
-  /* despatch whatever woke us up */
-  if (retval > 0)
+  while (deadFileDescriptors != NULL)
     {
-      int i = 0;
-      for (i = 0; i <= maxFd; ++i)
-        {
-          int mask = 0;
-          if (FD_ISSET (i, &fds[0]))
-            mask |= CONTROL_WATCH_READ;
-          if (FD_ISSET (i, &fds[1]))
-            mask |= CONTROL_WATCH_WRITE;
-          if (FD_ISSET (i, &fds[2]))
-            mask |= CONTROL_WATCH_EXCEPT;
-          if (mask)
-            {
-              struct ControlFileDescriptor *cfd = indexFind (fileDescriptors, &i);
-              if (cfd)
-                cfd -> callback (i, mask, cfd -> userData);
-            }
-        }
+      struct ControlFileDescriptor *cfd = deadFileDescriptors;
+      deadFileDescriptors = cfd -> nextDead;
+      yfree (cfd);
     }
 
   /* call whatever timers have expired */
-  if ((tev = pqueuePeekNext (timedEvents)) != NULL)
-    {
-      struct timeval now;
-      gettimeofday (&now, NULL);
-      while (now.tv_sec > tev -> time.tv_sec
-             || (now.tv_sec == tev -> time.tv_sec
-                 && now.tv_usec > tev -> time.tv_usec))
-        {
-          tev = pqueueGetNext (timedEvents);
-          tev -> callback (tev -> userData);
-          yfree (tev);
-          tev = pqueuePeekNext (timedEvents);
-          if (tev == NULL)
-            break;
-        }
-    }
+  {
+    uint64_t now = controlNow (false);
+    while ((tev = timerwheelExpire (timedEvents, now)) != NULL)
+      {
+        tev -> callback (tev -> userData);
+        yfree (tev);
+      }
+  }
 
   controlPollSignals();
 
+  /* send whatever all that generated */
+  for (struct ControlHandler *h = flushHandlers; h != NULL; h = h -> next)
+    h -> callback (h -> userData);
+
+  perfCount (perfIterations, 1);
+  perfRecord (perfIterationTime, perfNow () - start);
+
   return controlRunning;
 }
 
@@ -467,7 +562,10 @@ controlFinalise (void)
 {
   indexDestroy (fileDescriptors, controlFileDescriptorsDestructorFunction);
   indexDestroy (signalHandlers, controlSignalHandlerSetDestructorFunction);
-  pqueueDestroy (timedEvents, controlTimedEventDestructorFunction);
+  timerwheelDestroy (timedEvents, controlTimedEventDestructorFunction);
+  controlHandlersDestroy (&flushHandlers);
+  controlHandlersDestroy (&workHandlers);
+  backend -> finalise ();
 }
 
 /* arch-tag: 902f698b-690f-44a7-a931-588a000282db
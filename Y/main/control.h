@@ -21,6 +21,8 @@
 
 #include <Y/y.h>
 
+#include <stdbool.h>
+
 void controlInitialise (void);
 
 #define CONTROL_WATCH_READ   (1<<1)
@@ -34,15 +36,41 @@ void controlChangeFileDescriptorMask (int fd, int watchMask);
 
 void controlUnregisterFileDescriptor (int fd);
 
+/* Urgent descriptors, such as input devices, are despatched before
+ * anything else in an iteration
+ */
+void controlSetFileDescriptorUrgent (int fd, bool urgent);
+
 int  controlTimerDelay (int minIntervalSeconds, int minIntervalMilliseconds,
                         void *userData, void (*callback)(void *userData));
 void controlCancelTimerDelay (int id);
 
+/* Let timers run up to this many milliseconds late, so that ones which
+ * are due close together are despatched in a single wakeup
+ */
+void controlSetTimerSlack (int milliseconds);
+
 void controlRegisterSignalHandler (int signo, void *userData,
                                    void (*callback)(int signo, void *userData));
 void controlUnregisterSignalHandler (int signo, void *userData,
                                      void (*callback)(int signo, void *userData));
 
+/* Flush handlers are called at the end of every iteration, before the
+ * loop waits again, so that output generated while despatching can be
+ * sent in one go. A handler must not unregister itself from the callback
+ */
+void controlRegisterFlushHandler (void *userData, void (*callback)(void *userData));
+void controlUnregisterFlushHandler (void *userData, void (*callback)(void *userData));
+
+/* Work handlers pick up work which was put off to keep an iteration
+ * short. They are called every iteration, after the urgent descriptors
+ * and before the others. Whoever puts work off calls
+ * controlWorkPending, so that the loop doesn't wait next time round
+ */
+void controlRegisterWorkHandler (void *userData, void (*callback)(void *userData));
+void controlUnregisterWorkHandler (void *userData, void (*callback)(void *userData));
+void controlWorkPending (void);
+
 /* Run the server ;-) */
 void controlRun (void);
 
@@ -0,0 +1,160 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Main loop dispatch benchmark
+ *
+ * Registers N idle socket pairs plus one chatty one, then bounces a
+ * byte through the chatty pair and measures the time from write() to
+ * the callback firing.
+ *
+ * Usage: control_bench [idle clients] [round trips]
+ * Set YCONTROLBACKEND=select to measure the fallback backend.
+ */
+
+#include <Y/main/control.h>
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+
+static int chattyFds[2];
+static struct timespec sent;
+static double *latencies;
+static int rounds, completed;
+
+static double
+elapsedMicroseconds (const struct timespec *from, const struct timespec *to)
+{
+  return (to -> tv_sec - from -> tv_sec) * 1e6 + (to -> tv_nsec - from -> tv_nsec) / 1e3;
+}
+
+static void
+chattySend (void)
+{
+  char c = 'Y';
+  clock_gettime (CLOCK_MONOTONIC, &sent);
+  if (write (chattyFds[1], &c, 1) != 1)
+    abort ();
+}
+
+static void
+chattyReady (int fd, int causeMask, void *userData)
+{
+  struct timespec now;
+  char c;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  if (read (fd, &c, 1) != 1)
+    abort ();
+  latencies[completed++] = elapsedMicroseconds (&sent, &now);
+  if (completed == rounds)
+    controlShutdownY ();
+  else
+    chattySend ();
+}
+
+static void
+idleReady (int fd, int causeMask, void *userData)
+{
+  /* Nobody ever writes to these */
+  abort ();
+}
+
+static int
+compareDoubles (const void *a_v, const void *b_v)
+{
+  const double *a = a_v, *b = b_v;
+  return (*a > *b) - (*a < *b);
+}
+
+int
+main (int argc, char **argv)
+{
+  int idle = argc > 1 ? atoi (argv[1]) : 500;
+  rounds = argc > 2 ? atoi (argv[2]) : 20000;
+
+  /* Each idle client costs two descriptors */
+  struct rlimit rl;
+  if (getrlimit (RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+      rl.rlim_cur = rl.rlim_max;
+      setrlimit (RLIMIT_NOFILE, &rl);
+    }
+
+  controlInitialise ();
+
+  int (*idleFds)[2] = ymalloc (sizeof (*idleFds) * idle);
+  for (int i = 0; i < idle; ++i)
+    {
+      if (socketpair (PF_UNIX, SOCK_STREAM, 0, idleFds[i]) == -1)
+        {
+          perror ("socketpair");
+          return 1;
+        }
+      controlRegisterFileDescriptor (idleFds[i][0], CONTROL_WATCH_READ, NULL, idleReady);
+    }
+
+  /* Register the chatty client last, so it has the highest descriptor */
+  if (socketpair (PF_UNIX, SOCK_STREAM, 0, chattyFds) == -1)
+    {
+      perror ("socketpair");
+      return 1;
+    }
+  controlRegisterFileDescriptor (chattyFds[0], CONTROL_WATCH_READ, NULL, chattyReady);
+
+  latencies = ymalloc (sizeof (double) * rounds);
+  completed = 0;
+
+  struct timespec start, end;
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  chattySend ();
+  controlRun ();
+  clock_gettime (CLOCK_MONOTONIC, &end);
+
+  qsort (latencies, rounds, sizeof (double), compareDoubles);
+  double total = elapsedMicroseconds (&start, &end);
+
+  printf ("backend %s, %d idle clients, %d round trips\n",
+          getenv ("YCONTROLBACKEND") ? getenv ("YCONTROLBACKEND") : "default", idle, rounds);
+  printf ("  dispatch latency: p50 %.2f us, p90 %.2f us, p99 %.2f us, max %.2f us\n",
+          latencies[rounds / 2], latencies[rounds * 9 / 10],
+          latencies[rounds * 99 / 100], latencies[rounds - 1]);
+  printf ("  %.0f iterations/s\n", rounds / (total / 1e6));
+
+  for (int i = 0; i < idle; ++i)
+    {
+      controlUnregisterFileDescriptor (idleFds[i][0]);
+      close (idleFds[i][0]);
+      close (idleFds[i][1]);
+    }
+  controlUnregisterFileDescriptor (chattyFds[0]);
+  close (chattyFds[0]);
+  close (chattyFds[1]);
+  controlFinalise ();
+  yfree (idleFds);
+  yfree (latencies);
+
+  return 0;
+}
+
+/* arch-tag: 1c7e52a9-0b3f-4d86-a2e4-93f5d6b08c17
+ */
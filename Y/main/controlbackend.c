@@ -0,0 +1,305 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/main/controlbackend.h>
+#include <Y/main/control.h>
+#include <Y/util/log.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/select.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+/* select() backend
+ *
+ * This is the portable fallback. The fd_sets are kept up to date as
+ * watches change rather than being rebuilt every iteration, but the
+ * kernel interface still forces a scan up to the highest descriptor.
+ */
+
+static fd_set selectWatch[3];
+static void *selectUserData[FD_SETSIZE];
+static int selectMaxFd = -1;
+
+static bool
+selectInitialise (void)
+{
+  FD_ZERO (&selectWatch[0]);
+  FD_ZERO (&selectWatch[1]);
+  FD_ZERO (&selectWatch[2]);
+  memset (selectUserData, 0, sizeof (selectUserData));
+  selectMaxFd = -1;
+  return true;
+}
+
+static void
+selectFinalise (void)
+{
+}
+
+static void
+selectModify (int fd, int watchMask, void *userData)
+{
+  if (fd < 0 || fd >= FD_SETSIZE)
+    return;
+
+  selectUserData[fd] = userData;
+
+  if (watchMask & CONTROL_WATCH_READ)
+    FD_SET (fd, &selectWatch[0]);
+  else
+    FD_CLR (fd, &selectWatch[0]);
+  if (watchMask & CONTROL_WATCH_WRITE)
+    FD_SET (fd, &selectWatch[1]);
+  else
+    FD_CLR (fd, &selectWatch[1]);
+  if (watchMask & CONTROL_WATCH_EXCEPT)
+    FD_SET (fd, &selectWatch[2]);
+  else
+    FD_CLR (fd, &selectWatch[2]);
+}
+
+static bool
+selectAdd (int fd, int watchMask, void *userData)
+{
+  if (fd < 0 || fd >= FD_SETSIZE)
+    {
+      Y_ERROR ("File descriptor %d is beyond FD_SETSIZE (%d)", fd, FD_SETSIZE);
+      return false;
+    }
+
+  selectModify (fd, watchMask, userData);
+  if (fd > selectMaxFd)
+    selectMaxFd = fd;
+  return true;
+}
+
+static void
+selectRemove (int fd)
+{
+  if (fd < 0 || fd >= FD_SETSIZE)
+    return;
+
+  selectModify (fd, 0, NULL);
+  while (selectMaxFd >= 0 && selectUserData[selectMaxFd] == NULL)
+    selectMaxFd--;
+}
+
+static int
+selectWait (const struct timeval *timeout, struct ControlEvent *events, int maxEvents)
+{
+  fd_set fds[3];
+  struct timeval tv = *timeout;
+  int count = 0;
+
+  memcpy (fds, selectWatch, sizeof (fds));
+
+  int retval = select (selectMaxFd + 1, &fds[0], &fds[1], &fds[2], &tv);
+  if (retval <= 0)
+    return retval;
+
+  for (int i = 0; i <= selectMaxFd && count < maxEvents && retval > 0; ++i)
+    {
+      int mask = 0;
+      if (FD_ISSET (i, &fds[0]))
+        mask |= CONTROL_WATCH_READ;
+      if (FD_ISSET (i, &fds[1]))
+        mask |= CONTROL_WATCH_WRITE;
+      if (FD_ISSET (i, &fds[2]))
+        mask |= CONTROL_WATCH_EXCEPT;
+      if (mask)
+        {
+          events[count].userData = selectUserData[i];
+          events[count].causeMask = mask;
+          count++;
+          retval--;
+        }
+    }
+
+  return count;
+}
+
+const struct ControlBackend controlSelectBackend =
+{
+  name: "select",
+  initialise: selectInitialise,
+  finalise: selectFinalise,
+  add: selectAdd,
+  modify: selectModify,
+  remove: selectRemove,
+  wait: selectWait
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+
+/* epoll() backend
+ *
+ * The kernel holds the interest list, so the cost of a wait depends
+ * only on the number of descriptors which are actually ready.
+ */
+
+static int epollFd = -1;
+
+static uint32_t
+epollEventsFromMask (int watchMask)
+{
+  uint32_t events = 0;
+  if (watchMask & CONTROL_WATCH_READ)
+    events |= EPOLLIN;
+  if (watchMask & CONTROL_WATCH_WRITE)
+    events |= EPOLLOUT;
+  if (watchMask & CONTROL_WATCH_EXCEPT)
+    events |= EPOLLPRI;
+  return events;
+}
+
+static bool
+epollInitialise (void)
+{
+  epollFd = epoll_create1 (EPOLL_CLOEXEC);
+  if (epollFd == -1)
+    {
+      Y_WARN ("epoll_create1 failed: %s", strerror (errno));
+      return false;
+    }
+  return true;
+}
+
+static void
+epollFinalise (void)
+{
+  if (epollFd != -1)
+    close (epollFd);
+  epollFd = -1;
+}
+
+static bool
+epollAdd (int fd, int watchMask, void *userData)
+{
+  /* epoll always reports hangups and errors, even when nothing is
+   * being watched, so a descriptor with an empty mask stays out of
+   * the interest list until it gets one
+   */
+  if (watchMask == 0)
+    return true;
+
+  struct epoll_event ev;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = epollEventsFromMask (watchMask);
+  ev.data.ptr = userData;
+  if (epoll_ctl (epollFd, EPOLL_CTL_ADD, fd, &ev) == -1)
+    {
+      Y_ERROR ("Failed to add file descriptor %d to epoll set: %s", fd, strerror (errno));
+      return false;
+    }
+  return true;
+}
+
+static void
+epollModify (int fd, int watchMask, void *userData)
+{
+  if (watchMask == 0)
+    {
+      epoll_ctl (epollFd, EPOLL_CTL_DEL, fd, NULL);
+      return;
+    }
+
+  struct epoll_event ev;
+  memset (&ev, 0, sizeof (ev));
+  ev.events = epollEventsFromMask (watchMask);
+  ev.data.ptr = userData;
+  if (epoll_ctl (epollFd, EPOLL_CTL_MOD, fd, &ev) == -1 && errno == ENOENT)
+    epollAdd (fd, watchMask, userData);
+}
+
+static void
+epollRemove (int fd)
+{
+  /* ENOENT is fine here; see epollAdd */
+  epoll_ctl (epollFd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+static int
+epollWait (const struct timeval *timeout, struct ControlEvent *events, int maxEvents)
+{
+  struct epoll_event ready[maxEvents];
+
+  /* Round up, so we never wake before a timer is due */
+  int timeoutMs = timeout->tv_sec * 1000 + (timeout->tv_usec + 999) / 1000;
+
+  int retval = epoll_wait (epollFd, ready, maxEvents, timeoutMs);
+  if (retval <= 0)
+    return retval;
+
+  for (int i = 0; i < retval; ++i)
+    {
+      int mask = 0;
+      if (ready[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        mask |= CONTROL_WATCH_READ;
+      if (ready[i].events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+        mask |= CONTROL_WATCH_WRITE;
+      if (ready[i].events & EPOLLPRI)
+        mask |= CONTROL_WATCH_EXCEPT;
+      events[i].userData = ready[i].data.ptr;
+      events[i].causeMask = mask;
+    }
+
+  return retval;
+}
+
+const struct ControlBackend controlEpollBackend =
+{
+  name: "epoll",
+  initialise: epollInitialise,
+  finalise: epollFinalise,
+  add: epollAdd,
+  modify: epollModify,
+  remove: epollRemove,
+  wait: epollWait
+};
+
+#endif /* HAVE_SYS_EPOLL_H */
+
+static const struct ControlBackend *controlBackends[] =
+{
+#ifdef HAVE_SYS_EPOLL_H
+  &controlEpollBackend,
+#endif
+  &controlSelectBackend,
+  NULL
+};
+
+const struct ControlBackend *
+controlBackendFind (const char *name)
+{
+  if (name == NULL)
+    return controlBackends[0];
+
+  for (int i = 0; controlBackends[i] != NULL; ++i)
+    if (strcmp (controlBackends[i] -> name, name) == 0)
+      return controlBackends[i];
+
+  return NULL;
+}
+
+/* arch-tag: 6a0f3d2e-5b71-4c8e-9e04-2f1d7c9b8a53
+ */
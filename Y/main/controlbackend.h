@@ -0,0 +1,68 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_MAIN_CONTROLBACKEND_H
+#define Y_MAIN_CONTROLBACKEND_H
+
+#include <Y/setup.h>
+
+#include <stdbool.h>
+#include <sys/time.h>
+
+/* A readiness report from a backend: the userData the descriptor was
+ * added with, and the CONTROL_WATCH_* conditions which woke it up.
+ * Backends may report conditions which were not asked for (a hangup
+ * is reported as both readable and writable); the caller masks them.
+ */
+struct ControlEvent
+{
+  void *userData;
+  int causeMask;
+};
+
+/* An event backend for the main loop. Registrations are persistent:
+ * add/modify/remove are only called when a watch changes, and wait
+ * returns just the descriptors which are ready.
+ */
+struct ControlBackend
+{
+  const char *name;
+  bool (*initialise) (void);
+  void (*finalise)   (void);
+  bool (*add)        (int fd, int watchMask, void *userData);
+  void (*modify)     (int fd, int watchMask, void *userData);
+  void (*remove)     (int fd);
+  /* Block for at most timeout, then fill in up to maxEvents ready
+   * descriptors. Returns the number filled in, or -1 on error.
+   */
+  int  (*wait)       (const struct timeval *timeout,
+                      struct ControlEvent *events, int maxEvents);
+};
+
+extern const struct ControlBackend controlSelectBackend;
+#ifdef HAVE_SYS_EPOLL_H
+extern const struct ControlBackend controlEpollBackend;
+#endif
+
+/* Look up a backend by name; NULL returns the platform default */
+const struct ControlBackend *controlBackendFind (const char *name);
+
+#endif /* Y_MAIN_CONTROLBACKEND_H */
+
+/* arch-tag: 803a1394-c449-40b5-971e-c159b93f28bd
+ */
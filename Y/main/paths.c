@@ -18,6 +18,9 @@
 
 #include <Y/y.h>
 #include <Y/main/paths.tab>
+#include <Y/util/yutil.h>
+#include <stdio.h>
+#include <string.h>
 
 const char * yModuleDir = PKGLIBDIR;
 
@@ -30,5 +33,24 @@ const char * yDataDir = DATADIR "/Y";
 const char * yImageDir = DATADIR "/Y/images";
 const char * yPointerImageDir = DATADIR "/Y/images/pointers";
 
+/* where files written at a client's request go, from dump:directory
+ * in the config file; without one, nothing is written */
+const char * yDumpDir = NULL;
+
+/* Clients name the files they want written, but don't get to choose
+ * where they go: only a plain file name is accepted, and it is put in
+ * yDumpDir. Returns NULL for anything else; the caller frees the path */
+char *
+yDumpPath (const char *name)
+{
+  if (yDumpDir == NULL || name[0] == '\0' || strchr (name, '/') != NULL
+      || strcmp (name, ".") == 0 || strcmp (name, "..") == 0)
+    return NULL;
+
+  char *path = ymalloc (strlen (yDumpDir) + strlen (name) + 2);
+  sprintf (path, "%s/%s", yDumpDir, name);
+  return path;
+}
+
 /* arch-tag: bc6ccd7c-cdff-43e5-a8bf-9d5f839098e2
  */
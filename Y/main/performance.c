@@ -0,0 +1,281 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/y.h>
+#include <Y/object/class.h>
+#include <Y/object/object_p.h>
+#include <Y/main/control.h>
+#include <Y/util/perf.h>
+#include <Y/trace/tracering.h>
+#include <Y/util/yutil.h>
+
+#include <string.h>
+
+/* The counters themselves live in Y/util/perf.c. The class methods
+ * read them; an instance is a monitor, which emits them in a "sample"
+ * signal every interval milliseconds until it is destroyed.
+ */
+
+struct Performance
+{
+  struct Object o;
+  int timerID;
+};
+
+static struct Object *performance_to_object (struct Performance *self);
+
+DEFINE_CLASS(Performance);
+#include "Performance.yc"
+
+/* SUPER
+ * Object
+ */
+
+/* PROPERTY
+ * interval :: uint32
+ */
+
+#define PERFORMANCE_DEFAULT_INTERVAL 1000
+
+static void performanceSchedule (struct Performance *self);
+
+void
+CLASS_INIT(struct Performance *this, VTable *vtable)
+{
+  SUPER_INIT(this, vtable);
+}
+
+static struct Object *
+performance_to_object (struct Performance *self)
+{
+  return &(self -> o);
+}
+
+/* Two values per counter, name and value, after reserve empty slots */
+static struct Tuple *
+performanceCounters (int reserve)
+{
+  struct Tuple *ret = tupleCreate (reserve + perfCounterCount * 2);
+  int i = reserve;
+  for (int c = 0; c < perfCounterCount; ++c)
+    {
+      ret->list[i++] = tb_string (perfCounterName (c));
+      ret->list[i++] = tb_uint32 (perfCounters[c]);
+    }
+  return ret;
+}
+
+/* METHOD
+ * counters :: () -> (...)
+ *
+ * Two values per counter: its name, and its value modulo 2^32
+ */
+struct Tuple *
+performanceCCounters (void)
+{
+  return performanceCounters (0);
+}
+
+/* METHOD
+ * histograms :: () -> (...)
+ *
+ * Seven values per histogram: name, samples, mean, 50th, 90th and
+ * 99th percentiles, and maximum. The percentiles are the tops of the
+ * power of two buckets they fall in
+ */
+struct Tuple *
+performanceCHistograms (void)
+{
+  struct Tuple *ret = tupleCreate (perfHistogramCount * 7);
+  int i = 0;
+  for (int h = 0; h < perfHistogramCount; ++h)
+    {
+      const struct PerfHistogramData *data = &perfHistograms[h];
+      ret->list[i++] = tb_string (perfHistogramName (h));
+      ret->list[i++] = tb_uint32 (data -> count);
+      ret->list[i++] = tb_uint32 (data -> count ? data -> sum / data -> count : 0);
+      ret->list[i++] = tb_uint32 (perfQuantile (data, 0.5));
+      ret->list[i++] = tb_uint32 (perfQuantile (data, 0.9));
+      ret->list[i++] = tb_uint32 (perfQuantile (data, 0.99));
+      ret->list[i++] = tb_uint32 (data -> max);
+    }
+  return ret;
+}
+
+/* METHOD
+ * buckets :: (string) -> (...)
+ *
+ * The raw bucket counts of the named histogram; bucket 0 counts
+ * zeros, and bucket n values from 2^(n-1) to 2^n - 1
+ */
+struct Tuple *
+performanceCBuckets (const struct Tuple *args)
+{
+  int h = perfFindHistogram (args->list[0].string.data);
+  if (h < 0)
+    return tupleBuildError (tb_string ("Unknown histogram"));
+
+  struct Tuple *ret = tupleCreate (PERF_BUCKETS);
+  for (int b = 0; b < PERF_BUCKETS; ++b)
+    ret->list[b] = tb_uint32 (perfHistograms[h].buckets[b]);
+  return ret;
+}
+
+/* METHOD
+ * classes :: () -> (...)
+ *
+ * Two values per class which has had methods called on it: its name
+ * and the number of calls
+ */
+struct Tuple *
+performanceCClasses (void)
+{
+  int limit = perfCallsLimit ();
+  int count = 0;
+  for (int id = 0; id < limit; ++id)
+    if (perfGetCalls (id) > 0 && classFindByID (id) != NULL)
+      count++;
+
+  struct Tuple *ret = tupleCreate (count * 2);
+  int i = 0;
+  for (int id = 0; id < limit; ++id)
+    {
+      const struct Class *c;
+      if (perfGetCalls (id) == 0 || (c = classFindByID (id)) == NULL)
+        continue;
+      ret->list[i++] = tb_string (classGetName (c));
+      ret->list[i++] = tb_uint32 (perfGetCalls (id));
+    }
+  return ret;
+}
+
+/* METHOD
+ * reset :: () -> ()
+ */
+void
+performanceCReset (void)
+{
+  perfReset ();
+}
+
+/* METHOD
+ * traceStart :: (uint32) -> ()
+ *
+ * Starts recording trace events into rings of the given number of
+ * records per thread (0 for the default), emptying them first
+ */
+void
+performanceCTraceStart (const struct Tuple *args)
+{
+  traceRingStart (args->list[0].uint32);
+}
+
+/* METHOD
+ * traceStop :: () -> ()
+ */
+void
+performanceCTraceStop (void)
+{
+  traceRingStop ();
+}
+
+/* METHOD
+ * traceDump :: (string) -> ()
+ *
+ * Writes what is in the trace rings to a file on the server's side,
+ * as Chrome trace JSON. The name is a plain file name, which goes in
+ * the configured dump directory
+ */
+struct Tuple *
+performanceCTraceDump (const struct Tuple *args)
+{
+  char *path = yDumpPath (args->list[0].string.data);
+  bool ok;
+
+  if (path == NULL)
+    return tupleBuildError (tb_string ("Not a file name in the dump directory"));
+  ok = traceRingDump (path);
+  yfree (path);
+  if (!ok)
+    return tupleBuildError (tb_string ("Could not write the trace"));
+  return NULL;
+}
+
+static void
+performanceTick (void *self_v)
+{
+  struct Performance *self = self_v;
+  struct Tuple *args = performanceCounters (1);
+
+  /* the signal carries the same values as the counters method */
+  args->list[0] = tb_string ("sample");
+  self -> timerID = -1;
+  objectEmitSignal_ (performance_to_object (self), "sample", args);
+  performanceSchedule (self);
+}
+
+static void
+performanceSchedule (struct Performance *self)
+{
+  uint32_t interval = safeGetProperty (self, interval, PERFORMANCE_DEFAULT_INTERVAL);
+
+  if (self -> timerID >= 0)
+    controlCancelTimerDelay (self -> timerID);
+  self -> timerID = -1;
+  if (interval > 0)
+    self -> timerID = controlTimerDelay (interval / 1000, interval % 1000,
+                                         self, performanceTick);
+}
+
+/* PROPERTY HOOK
+ * interval
+ */
+static void
+performanceIntervalSet (struct Performance *self)
+{
+  performanceSchedule (self);
+}
+
+/* METHOD
+ * Performance :: () -> (object)
+ */
+static struct Object *
+performanceInstantiate (void)
+{
+  struct Performance *self = ymalloc (sizeof (struct Performance));
+  objectInitialise (&(self -> o), CLASS(Performance));
+  CLASS_INIT(self, NULL);
+  self -> timerID = -1;
+  performanceSchedule (self);
+  return performance_to_object (self);
+}
+
+/* METHOD
+ * DESTROY :: () -> ()
+ */
+static void
+performanceDestroy (struct Performance *self)
+{
+  if (self -> timerID >= 0)
+    controlCancelTimerDelay (self -> timerID);
+  objectFinalise (performance_to_object (self));
+  yfree (self);
+}
+
+/* arch-tag: 7b3f0d92-e15a-4c68-9a27-c84d6e1f5b30
+ */
@@ -28,6 +28,7 @@
 #include <Y/util/log.h>
 #include <Y/util/llist.h>
 #include <Y/util/rbtree.h>
+#include <Y/util/perf.h>
 
 #include <Y/main/control.h>
 
@@ -37,6 +38,7 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -47,6 +49,21 @@
 static char *socket_path = NULL;
 static int listen_fd = -1;
 
+/* Stop reading from a client once this much output is waiting for
+ * it, and start again when it has drained to the low water mark
+ */
+#define UNIX_SENDQ_HIGH_WATER (1024 * 1024)
+#define UNIX_SENDQ_LOW_WATER (UNIX_SENDQ_HIGH_WATER / 2)
+
+/* Most dbuffer elements handed to one sendmsg() */
+#define UNIX_SEND_IOV_MAX 64
+
+/* Most descriptors a client may have passed us but not yet used */
+#define UNIX_MAX_PASSED_FDS 16
+
+/* Channels with output queued since the last flush */
+static struct llist *pendingChannels = NULL;
+
 struct unixControlMessage
 {
   enum YUnixControlMessageType type;
@@ -54,6 +71,12 @@ struct unixControlMessage
   uint32_t id;
 };
 
+struct unixPassedFileDescriptor
+{
+  uint32_t id;
+  int fd;
+};
+
 struct unixClient
 {
   struct Client client;
@@ -65,6 +88,9 @@ struct unixClient
   struct rbtree *channels;
   uint32_t next_channel;
   struct llist *control_queue;
+  struct llist *passed_fds;
+  /* Set while the client has a backlog of messages */
+  bool inputHeld;
 };
 
 struct unixChannel
@@ -73,17 +99,30 @@ struct unixChannel
   int fd;
   struct unixClient *client;
   struct dbuffer *sendq;
+  bool registered;
+  bool flushPending;
+  bool throttled;
 };
 
 static void unixClose (struct Client *c);
 static void unixWriteData (struct Client *self_c, uint32_t channel_id, const char *data, size_t len);
+static struct dbuffer *unixGetSendQueue (struct Client *self_c, uint32_t channel_id);
+static void unixSendQueued (struct Client *self_c, uint32_t channel_id);
+static size_t unixPendingBytes (struct Client *self_c);
+static int unixTakeFileDescriptor (struct Client *self_c, uint32_t id);
 static bool unixNewChannel (struct Client *self_c, uint32_t *channel_id);
+static void unixHoldInput (struct Client *self_c, bool hold);
 
 struct ClientClass unixClientClass =
 {
   name: "Unix Domain Socket Client",
   newChannel: unixNewChannel,
   writeData: unixWriteData,
+  getSendQueue: unixGetSendQueue,
+  sendQueued: unixSendQueued,
+  pendingBytes: unixPendingBytes,
+  takeFileDescriptor: unixTakeFileDescriptor,
+  holdInput: unixHoldInput,
   close: unixClose
 };
 
@@ -102,6 +141,9 @@ unixChannelCreate(struct unixClient *self, uint32_t id, int fd)
   channel->fd = fd;
   channel->client = self;
   channel->sendq = new_dbuffer();
+  channel->registered = false;
+  channel->flushPending = false;
+  channel->throttled = false;
   return channel;
 }
 
@@ -126,6 +168,8 @@ unixChannelDestroy(struct unixChannel *channel)
 {
   if (!channel)
     return;
+  if (channel->flushPending)
+    llist_delete_data(pendingChannels, channel);
   controlUnregisterFileDescriptor(channel->fd);
   close(channel->fd);
   free_dbuffer(channel->sendq);
@@ -153,6 +197,7 @@ unixControlMessageDestroy(struct unixControlMessage *msg)
       close(msg->fd);
       break;
     case ucmtAuthenticate:
+    case ucmtPassFileDescriptor:
       break;
     }
   yfree(msg);
@@ -169,6 +214,8 @@ unixNewChannel(struct Client *self_c, uint32_t *channel_id)
   int ret = socketpair(PF_UNIX, SOCK_STREAM, 0, sv);
   if (ret == 0)
     {
+      /* Output is flushed from the main loop, which mustn't block */
+      fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
       rbtree_insert(self->channels, unixChannelCreate(self, id, sv[0]));
       llist_add_tail(self->control_queue, unixControlMessageNewChannel(id, sv[1]));
       *channel_id = id;
@@ -189,8 +236,8 @@ unixFindChannel(struct unixClient *self, uint32_t id)
   return channel;
 }
 
-static void
-unixWriteData (struct Client *self_c, uint32_t channel_id, const char *data, size_t len)
+static struct dbuffer *
+unixGetSendQueue (struct Client *self_c, uint32_t channel_id)
 {
   struct unixClient *self = castBack (self_c);
   assert(self->authenticated);
@@ -198,11 +245,86 @@ unixWriteData (struct Client *self_c, uint32_t channel_id, const char *data, siz
   struct unixChannel *channel = unixFindChannel(self, channel_id);
   assert(channel);
 
-  dbuffer_add(channel->sendq, data, len);
+  return channel->sendq;
+}
 
-  if (dbuffer_len(channel->sendq) > 0)
-    controlChangeFileDescriptorMask (channel->fd,
-                                     CONTROL_WATCH_WRITE | CONTROL_WATCH_READ );
+/* Input is wanted unless the client isn't keeping up with its output,
+ * or we aren't keeping up with its input; writability only while there
+ * is output that couldn't go out at once
+ */
+static void
+unixChannelUpdateMask (struct unixChannel *channel)
+{
+  size_t pending = dbuffer_len(channel->sendq);
+
+  if (!channel->throttled && pending > UNIX_SENDQ_HIGH_WATER)
+    {
+      Y_TRACE ("Client %d is %lu bytes behind, no longer reading from it",
+               clientGetID(&channel->client->client), (long unsigned int)pending);
+      channel->throttled = true;
+    }
+  else if (channel->throttled && pending <= UNIX_SENDQ_LOW_WATER)
+    channel->throttled = false;
+
+  if (!channel->registered)
+    return;
+
+  int mask = channel->throttled || channel->client->inputHeld ? 0 : CONTROL_WATCH_READ;
+  if (pending > 0 && !channel->flushPending)
+    mask |= CONTROL_WATCH_WRITE;
+  controlChangeFileDescriptorMask (channel->fd, mask);
+}
+
+static void
+unixSendQueued (struct Client *self_c, uint32_t channel_id)
+{
+  struct unixClient *self = castBack (self_c);
+  struct unixChannel *channel = unixFindChannel(self, channel_id);
+  assert(channel);
+
+  if (dbuffer_len(channel->sendq) == 0)
+    return;
+
+  /* Nothing is written until the end of the loop iteration, so a burst
+   * of messages goes out in one system call
+   */
+  if (!channel->flushPending)
+    {
+      channel->flushPending = true;
+      llist_add_tail(pendingChannels, channel);
+    }
+
+  if (!channel->throttled && dbuffer_len(channel->sendq) > UNIX_SENDQ_HIGH_WATER)
+    unixChannelUpdateMask(channel);
+}
+
+static size_t
+unixPendingBytes (struct Client *self_c)
+{
+  struct unixClient *self = castBack (self_c);
+  size_t pending = 0;
+  for (struct rbtree_node *n = rbtree_head(self->channels); n; n = rbtree_node_next(n))
+    {
+      struct unixChannel *channel = rbtree_node_data(n);
+      pending += dbuffer_len(channel->sendq);
+    }
+  return pending;
+}
+
+static void
+unixHoldInput (struct Client *self_c, bool hold)
+{
+  struct unixClient *self = castBack (self_c);
+  self->inputHeld = hold;
+  for (struct rbtree_node *n = rbtree_head(self->channels); n; n = rbtree_node_next(n))
+    unixChannelUpdateMask(rbtree_node_data(n));
+}
+
+static void
+unixWriteData (struct Client *self_c, uint32_t channel_id, const char *data, size_t len)
+{
+  dbuffer_add(unixGetSendQueue(self_c, channel_id), data, len);
+  unixSendQueued(self_c, channel_id);
 }
 
 static void
@@ -211,6 +333,7 @@ doChannelRead(struct unixClient *self, struct unixChannel *channel)
   char buf[4096];
 
   ssize_t ret = read(channel->fd, buf, sizeof(buf));
+  perfCount (perfReads, 1);
   if (ret < 0)
     {
       int e = errno;
@@ -228,30 +351,67 @@ doChannelRead(struct unixClient *self, struct unixChannel *channel)
       return;
     }
 
+  perfCount (perfBytesIn, ret);
   clientReadData(&self->client, channel->id, buf, ret);
 }
 
 static void
 doChannelWrite(struct unixClient *self, struct unixChannel *channel)
 {
-  char buf[4096];
-  size_t len = dbuffer_get(channel->sendq, buf, sizeof(buf));
+  self->client.stats.flushes++;
 
-  ssize_t ret = write(channel->fd, buf, len);
-  if (ret < 0)
+  while (dbuffer_len(channel->sendq) > 0)
     {
-      int e = errno;
-      if (e == EINTR || e == EAGAIN)
-        return;
-      Y_TRACE ("Write error from client %d: %s", clientGetID(&self->client), strerror(e));
-      clientClose (&(self -> client));
-      return;
+      struct iovec iov[UNIX_SEND_IOV_MAX];
+      struct msghdr msg;
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = iov;
+      msg.msg_iovlen = dbuffer_iovec(channel->sendq, iov, UNIX_SEND_IOV_MAX);
+
+      size_t len = 0;
+      for (size_t i = 0; i < msg.msg_iovlen; i++)
+        len += iov[i].iov_len;
+
+      ssize_t ret = sendmsg(channel->fd, &msg, MSG_NOSIGNAL);
+      self->client.stats.syscalls++;
+      perfCount (perfWrites, 1);
+      if (ret < 0)
+        {
+          int e = errno;
+          if (e == EINTR)
+            continue;
+          if (e == EAGAIN)
+            break;
+          Y_TRACE ("Write error from client %d: %s", clientGetID(&self->client), strerror(e));
+          clientClose (&(self -> client));
+          return;
+        }
+
+      dbuffer_remove(channel->sendq, ret);
+      perfCount (perfBytesOut, ret);
+
+      /* The socket is full; wait until it drains */
+      if ((size_t)ret < len)
+        break;
     }
 
-  dbuffer_remove(channel->sendq, ret);
+  unixChannelUpdateMask(channel);
+}
 
-  if (dbuffer_len(channel->sendq) == 0)
-    controlChangeFileDescriptorMask (channel->fd, CONTROL_WATCH_READ);
+static void
+unixFlush (void *data)
+{
+  struct llist_node *n;
+  while ((n = llist_head(pendingChannels)) != NULL)
+    {
+      struct unixChannel *channel = llist_node_data(n);
+      llist_node_delete(n);
+      channel->flushPending = false;
+      /* This may close the client, taking any of its other channels
+       * off the list too
+       */
+      doChannelWrite(channel->client, channel);
+    }
 }
 
 static void
@@ -267,36 +427,99 @@ unixChannelReady (int fd, int causeMask, void *data_v)
 }
 
 static void
-doControlRead(struct unixClient *self)
+unixPassedFileDescriptorDestroy(struct unixPassedFileDescriptor *passed)
+{
+  close(passed->fd);
+  yfree(passed);
+}
+
+/* Returns the first descriptor passed with a control message, or -1,
+ * closing any others
+ */
+static int
+unixControlMessageFileDescriptor(struct msghdr *msg)
+{
+  int fd = -1;
+  for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg))
+    {
+      if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+        continue;
+      int *fds = (int *)CMSG_DATA(cmsg);
+      size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+      for (size_t i = 0; i < count; i++)
+        {
+          if (fd == -1)
+            fd = fds[i];
+          else
+            close(fds[i]);
+        }
+    }
+  return fd;
+}
+
+/* Handles one control message; returns false if there wasn't one */
+static bool
+doControlRead(struct unixClient *self, int flags)
 {
   uint32_t msg_len;
   uint32_t msg_type;
   char buf[4096];
   struct iovec iov[] = {{&msg_len, sizeof(msg_len)}, {&msg_type, sizeof(msg_type)}, {buf, sizeof(buf)}};
-  char cmsgbuf[CMSG_SPACE(sizeof(struct ucred))];
+  char cmsgbuf[CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(int))];
   struct msghdr msg = {NULL, 0,
                        iov, 3,
                        cmsgbuf, sizeof(cmsgbuf),
                        0};
-  ssize_t len = recvmsg(self->control_fd, &msg, 0);
+  ssize_t len = recvmsg(self->control_fd, &msg, flags | MSG_CMSG_CLOEXEC);
   if (len == -1)
     {
       if (errno == EINTR || errno == EAGAIN)
-        return;
+        return false;
       Y_TRACE ("Read error from client %d: %s", clientGetID(&self->client), strerror(errno));
       clientClose (&(self -> client));
-      return;
+      return false;
     }
   else if (len == 0)
     {
       Y_TRACE ("Connection closed by client %d", clientGetID(&self->client));
       clientClose (&(self -> client));
-      return;
+      return false;
     }
 
   enum YUnixControlMessageType type = msg_type;
+
+  int passed_fd = unixControlMessageFileDescriptor(&msg);
+  if (passed_fd != -1 && type != ucmtPassFileDescriptor)
+    {
+      close(passed_fd);
+      passed_fd = -1;
+    }
+
   switch(type)
     {
+    case ucmtPassFileDescriptor:
+      {
+        uint32_t id;
+        if (!self->authenticated || msg_len != sizeof(id) || passed_fd == -1)
+          {
+            Y_TRACE ("Malformed 'pass file descriptor' control message from client %d, discarding", clientGetID(&self->client));
+            if (passed_fd != -1)
+              close(passed_fd);
+            break;
+          }
+        if (llist_length(self->passed_fds) >= UNIX_MAX_PASSED_FDS)
+          {
+            Y_TRACE ("Client %d has passed too many unused file descriptors, discarding", clientGetID(&self->client));
+            close(passed_fd);
+            break;
+          }
+        memcpy(&id, buf, sizeof(id));
+        struct unixPassedFileDescriptor *passed = ymalloc(sizeof(*passed));
+        passed->id = id;
+        passed->fd = passed_fd;
+        llist_add_tail(self->passed_fds, passed);
+        break;
+      }
     case ucmtNewChannel:
       Y_TRACE ("Bogus 'new channel' control message from client %d, discarding", clientGetID(&self->client));
       break;
@@ -306,6 +529,7 @@ doControlRead(struct unixClient *self)
           {
             Y_TRACE ("Malformed 'authenticate' control message from client %d, dropping connection", clientGetID(&self->client));
             clientClose(&self->client);
+            return false;
           }
 
         struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
@@ -313,7 +537,7 @@ doControlRead(struct unixClient *self)
           {
             Y_TRACE ("Invalid 'authenticate' control message from client %d, dropping connection", clientGetID(&self->client));
             clientClose(&self->client);
-            return;
+            return false;
           }
         struct ucred *creds = (struct ucred *)CMSG_DATA(cmsg);
         self->uid = creds->uid;
@@ -328,7 +552,7 @@ doControlRead(struct unixClient *self)
               {
                 Y_TRACE ("Failed to create primary channel for client %d, dropping connection", clientGetID(&self->client));
                 clientClose(&self->client);
-                return;
+                return false;
               }
             assert(channel == 0);
           }
@@ -339,6 +563,36 @@ doControlRead(struct unixClient *self)
       Y_TRACE ("Unrecognised control message type %d from client %d, discarding", type, clientGetID(&self->client));
       break;
     }
+
+  return true;
+}
+
+static int
+unixTakeFileDescriptor (struct Client *self_c, uint32_t id)
+{
+  struct unixClient *self = castBack (self_c);
+
+  /* Clients pass the descriptor before sending the request which uses
+   * it, but the two arrive on different sockets, so it may still be
+   * sitting unread on the control socket
+   */
+  do
+    {
+      for (struct llist_node *n = llist_head(self->passed_fds); n; n = llist_node_next(n))
+        {
+          struct unixPassedFileDescriptor *passed = llist_node_data(n);
+          if (passed->id == id)
+            {
+              int fd = passed->fd;
+              llist_node_delete(n);
+              yfree(passed);
+              return fd;
+            }
+        }
+    }
+  while (!self->client.closePending && doControlRead(self, MSG_DONTWAIT));
+
+  return -1;
 }
 
 static void
@@ -398,12 +652,15 @@ doControlWrite(struct unixClient *self)
 
             controlRegisterFileDescriptor (channel->fd, CONTROL_WATCH_READ,
                                            channel, unixChannelReady);
+            channel->registered = true;
+            unixChannelUpdateMask(channel);
 
             /* Note that this closes the local copy of the remote fd */
             unixControlMessageDestroy(ucmsg);
             break;
           }
         case ucmtAuthenticate:
+        case ucmtPassFileDescriptor:
           abort();
         }
     }
@@ -418,7 +675,7 @@ unixControlReady (int fd, int causeMask, void *data_v)
   struct unixClient *self = data_v;
   assert(self->control_fd == fd);
   if (causeMask & CONTROL_WATCH_READ)
-    doControlRead(self);
+    doControlRead(self, 0);
   if (causeMask & CONTROL_WATCH_WRITE)
     doControlWrite(self);
 }
@@ -451,8 +708,11 @@ unixSocketReady (int fd, int causeMask, void *data_v)
   newClient -> channels = new_rbtree(unixChannelKey, unixChannelCmp);
   newClient -> next_channel = 0;
   newClient -> control_queue = new_llist();
+  newClient -> passed_fds = new_llist();
+  newClient -> inputHeld = false;
 
   newClient -> client.c = &unixClientClass;
+  perfCount (perfConnections, 1);
 
   clientRegister (&(newClient -> client));
 
@@ -465,6 +725,7 @@ unixClose (struct Client *self_c)
 {
   struct unixClient *self = castBack (self_c);
   llist_destroy(self->control_queue, unixControlMessageDestroy);
+  llist_destroy(self->passed_fds, unixPassedFileDescriptorDestroy);
   rbtree_destroy(self->channels, unixChannelDestroy);
   controlUnregisterFileDescriptor (self->control_fd);
   close (self->control_fd);
@@ -533,11 +794,17 @@ unixInitialise (void)
   
   controlRegisterFileDescriptor (listen_fd, CONTROL_WATCH_READ,
                                  NULL, unixSocketReady);
+
+  pendingChannels = new_llist();
+  controlRegisterFlushHandler (NULL, unixFlush);
 }
 
 void
 unixFinalise (void)
 {
+  controlUnregisterFlushHandler (NULL, unixFlush);
+  free_llist (pendingChannels);
+  pendingChannels = NULL;
   unlink (socket_path);
   yfree (socket_path);
 }
@@ -40,17 +40,23 @@
 #include <Y/text/utf8.h>
 #include <Y/util/yutil.h>
 #include <Y/util/dbuffer.h>
+#include <Y/util/perf.h>
+#include <Y/trace/tracering.h>
 #include <Y/message/client.h>
+#include <Y/message/record.h>
 
 #include <Y/widget/window.h>
 
 static char *configFile = NULL;
+static char *recordLog = NULL;
+static char *dumpDir = NULL;
 static struct Config *serverConfig = NULL;
 
 static void
 final (void)
 {
   clientFinalise ();
+  recordStop ();
   moduleFinalise ();
   ykbFinalise ();
   classFinalise ();
@@ -58,9 +64,13 @@ final (void)
   screenFinalise ();
   unixFinalise ();
   controlFinalise ();
+  perfFinalise ();
+  traceRingFinalise ();
+  objectTableFinalise ();
   configDestroy(serverConfig);
   utf8Finalise ();
   yfree(configFile);
+  yfree(dumpDir);
   dbuffer_cleanup();
   ylogClose ();
 }
@@ -70,6 +80,7 @@ enum long_option_enum
     lo_config,
     lo_no_detach,
     lo_emit_pid,
+    lo_record,
     lo_version,
     lo_license,
     lo_help,
@@ -81,11 +92,41 @@ static struct option const longopts[] =
     [lo_config] = {"config", required_argument, NULL, 0},
     [lo_no_detach] = {"no-detach", no_argument, NULL, 0},
     [lo_emit_pid] = {"emit-pid", no_argument, NULL, 0},
+    [lo_record] = {"record", required_argument, NULL, 0},
     [lo_version] = {"version", no_argument, NULL, 0},
     [lo_help] = {"help", no_argument, NULL, 0},
     [lo_last] = {NULL, no_argument, NULL, 0}
   };
 
+static void
+configureTimerSlack (void)
+{
+  struct TupleType slackType = {.count = 1, .list = (enum Type []) {t_uint32}};
+  struct Tuple *slackTuple = configGet(serverConfig, "control", "timerslack", &slackType);
+
+  if (!slackTuple)
+    return;
+
+  controlSetTimerSlack(slackTuple->list[0].uint32);
+  tupleDestroy(slackTuple);
+}
+
+static void
+configureDumpDir (void)
+{
+  struct TupleType dirType = {.count = 1, .list = (enum Type []) {t_string}};
+  struct Tuple *dirTuple = configGet(serverConfig, "dump", "directory", &dirType);
+
+  if (!dirTuple)
+    return;
+
+  if (dirTuple->error)
+    Y_WARN("Error retrieving dump:directory from config file: %s", dirTuple->list[0].string.data);
+  else
+    yDumpDir = dumpDir = ystrdup(dirTuple->list[0].string.data);
+  tupleDestroy(dirTuple);
+}
+
 static inline void
 show_usage(void)
 {
@@ -93,6 +134,7 @@ show_usage(void)
   fprintf(stderr, "  --config file     use a different config file\n");
   fprintf(stderr, "  --no-detach       do not detach from teh controlling terminal\n");
   fprintf(stderr, "  --emit-pid        when detaching, emit the pid of the server on stdout\n");
+  fprintf(stderr, "  --record file     log all client traffic to file, for yreplay\n");
   fprintf(stderr, "\n");
   fprintf(stderr, "  --version         display version information and exit\n");
   fprintf(stderr, "  --help            display this message and exit\n");
@@ -167,6 +209,9 @@ main (int argc, char **argv)
         case lo_emit_pid:
           emit_pid = true;
           break;
+        case lo_record:
+          recordLog = optarg;
+          break;
         case lo_version:
           show_version();
           break;
@@ -245,11 +290,15 @@ main (int argc, char **argv)
   serverConfig = configRead (configFile);;
 
   controlInitialise ();
+  configureTimerSlack ();
+  configureDumpDir ();
   unixInitialise ();
   screenInitialise ();
   fontInitialise (serverConfig);
   classInitialise ();
   clientInitialise ();
+  if (recordLog)
+    recordStart (recordLog);
   ykbInitialise (serverConfig);
   moduleInitialise (serverConfig);
 
@@ -19,16 +19,37 @@
 #include <Y/message/client.h>
 #include <Y/message/client_p.h>
 #include <Y/message/message.h>
+#include <Y/message/wire.h>
+#include <Y/message/record.h>
+#include <Y/trace/tracering.h>
 #include <Y/util/index.h>
+#include <Y/util/llist.h>
+#include <Y/util/perf.h>
 #include <Y/util/yutil.h>
+#include <Y/main/control.h>
 
 #include <Y/object/class.h>
+#include <Y/object/object_p.h>
 
 #include <stdlib.h>
 #include <unistd.h>
 #include <netinet/in.h>
 #include <assert.h>
 
+DEFINE_CLASS(Client);
+#include "Client.yc"
+
+/* Scratch buffers bigger than this are given back after use, so one
+ * big upload doesn't pin the memory for the life of the client
+ */
+#define CLIENT_SCRATCH_KEEP 65536
+
+/* Most messages, and microseconds, one client's messages may have in
+ * an iteration; once either is used up the rest wait for its next turn
+ */
+#define CLIENT_DESPATCH_MESSAGES 64
+#define CLIENT_DESPATCH_MICROSECONDS 2000
+
 struct SignalSubscription
 {
   char *name;
@@ -39,6 +60,11 @@ static struct Client *currentClient = NULL;
 static struct Index *clients = NULL;
 static int clientNextID = 1;
 
+/* Backlogged clients, in the order they get their turns */
+static struct llist *backlog = NULL;
+
+static void clientDespatchBacklog (void *data);
+
 int
 clientKeyFunction (const void *key_v, const void *obj_v)
 {
@@ -90,9 +116,16 @@ static void
 clientDestructorFunction (void *obj)
 {
   struct Client *c = obj;
-  indexDestroy (c -> objects, (void(*)(void*))objectDestroy);
+  /* Destroying one object may take others of the client's with it */
+  while (c -> objects != NULL)
+    {
+      struct Object *o = c -> objects;
+      clientRemoveObject (c, o);
+      objectDestroy (o);
+    }
   indexDestroy (c -> signals, signalsubscriptionDestructorFunction);
   free_dbuffer(c -> recvq);
+  yfree(c -> scratch);
   c -> c -> close (c);
 }
 
@@ -101,11 +134,16 @@ clientInitialise (void)
 {
   clients = indexCreate (clientKeyFunction, clientComparisonFunction);
   clientNextID = 1;
+  backlog = new_llist ();
+  controlRegisterWorkHandler (NULL, clientDespatchBacklog);
 }
 
 void
 clientFinalise (void)
 {
+  controlUnregisterWorkHandler (NULL, clientDespatchBacklog);
+  free_llist(backlog);
+  backlog = NULL;
   indexDestroy(clients, clientDestructorFunction);
 }
 
@@ -114,16 +152,34 @@ clientRegister (struct Client *c)
 {
   Y_TRACE ("Registering client with ID: %d", clientNextID);
   c -> id = clientNextID ++;
-  c -> objects = indexCreate (objectKeyFunction, objectComparisonFunction);
+  c -> objects = NULL;
   c -> signals = indexCreate (signalsubscriptionComparisonFunction, signalsubscriptionComparisonFunction);
   c -> recvq = new_dbuffer();
+  c -> scratch = NULL;
+  c -> scratchSize = 0;
+  c -> despatching = false;
+  c -> closePending = false;
+  c -> backlogged = false;
+  memset (&c -> stats, 0, sizeof (c -> stats));
   indexAdd (clients, c);
+  recordClientOpened (c -> id);
 }
 
 void
 clientClose (struct Client *c)
 {
+  if (c->despatching)
+    {
+      /* clientReadData will finish the job */
+      c->closePending = true;
+      return;
+    }
+
   Y_TRACE ("Closing client %d", c->id);
+  recordClientClosed (c->id);
+
+  if (c->backlogged)
+    llist_delete_data(backlog, c);
 
   struct IndexIterator *i;
   for (i = indexGetStartIterator (c->signals); indexiteratorHasValue(i); indexiteratorNext(i))
@@ -159,21 +215,55 @@ clientSendMessage (struct Client *c, struct Message *m)
   if (c == NULL)
     return;
 
-  char *buf;
-  size_t len;
   //printMessage (m, 0); //to watch messages pass by -- or for debugging
-  messageToString(m, &buf, &len);
-  uint32_t nlen = htonl(len);
-  c -> c -> writeData (c, 0, (char *)&nlen, sizeof(nlen));
-  c -> c -> writeData (c, 0, buf, len);
-  yfree(buf);
+  struct dbuffer *sendq = c -> c -> getSendQueue (c, 0);
+  messageEncodeToDbuffer (m, sendq);
+  recordOutbound (c -> id, m);
+  c -> stats.messagesQueued++;
+  c -> c -> sendQueued (c, 0);
 }
 
 void
-clientReadData (struct Client *c, uint32_t channel_id, const char *data, size_t len)
+clientSendSharedMessage (struct Client *c, struct Message *m, struct dbuffer_shared *packet)
 {
-  assert(channel_id == 0);
-  dbuffer_add(c->recvq, data, len);
+  if (c == NULL)
+    return;
+
+  struct dbuffer *sendq = c -> c -> getSendQueue (c, 0);
+  messageAddShared (packet, c -> id, sendq);
+  m -> to = c -> id;
+  recordOutbound (c -> id, m);
+  c -> stats.messagesQueued++;
+  c -> c -> sendQueued (c, 0);
+}
+
+int
+clientTakeFileDescriptor (struct Client *c, uint32_t id)
+{
+  if (c == NULL || c -> c -> takeFileDescriptor == NULL)
+    return -1;
+  return c -> c -> takeFileDescriptor (c, id);
+}
+
+/* True if there is a whole packet at the front of recvq */
+static bool
+clientPacketQueued (struct Client *c)
+{
+  uint32_t packet_len;
+  if (dbuffer_len(c->recvq) < sizeof(packet_len))
+    return false;
+  dbuffer_get(c->recvq, (char *)&packet_len, sizeof(packet_len));
+  return dbuffer_len(c->recvq) >= sizeof(packet_len) + ntohl(packet_len);
+}
+
+/* Despatches the client's queued messages until they run out or its
+ * share of the iteration is used up; returns false if it was closed
+ */
+static bool
+clientDespatchQueued (struct Client *c)
+{
+  uint64_t start = perfNow ();
+  int despatched = 0;
 
   uint32_t packet_len;
   while (dbuffer_len(c->recvq) >= sizeof(packet_len))
@@ -181,15 +271,71 @@ clientReadData (struct Client *c, uint32_t channel_id, const char *data, size_t
       dbuffer_get(c->recvq, (char *)&packet_len, sizeof(packet_len));
       packet_len = ntohl(packet_len);
 
-      if (dbuffer_len(c->recvq) < (sizeof(packet_len) + packet_len))
+      size_t total = sizeof(packet_len) + packet_len;
+      if (dbuffer_len(c->recvq) < total)
         break;
 
-      char buf[packet_len];
-      dbuffer_remove(c->recvq, sizeof(packet_len));
-      dbuffer_extract(c->recvq, buf, packet_len);
+      if (despatched == CLIENT_DESPATCH_MESSAGES ||
+          (despatched > 0 && perfNow () - start >= CLIENT_DESPATCH_MICROSECONDS))
+        break;
+      despatched++;
+
+      /* Decode straight out of the receive queue when the packet sits
+       * in one piece; otherwise gather it into the scratch buffer. The
+       * decoder may borrow the byte after the packet, so in the first
+       * case it is saved and put back once the message is finished.
+       */
+      char *packet = dbuffer_head(c->recvq, total);
+      bool gathered = (packet == NULL);
+      char saved = '\0';
+      if (!gathered)
+        {
+          packet += sizeof(packet_len);
+          saved = packet[packet_len];
+        }
+      else
+        {
+          if (c->scratchSize < total + 1)
+            {
+              yfree(c->scratch);
+              c->scratchSize = total + 1;
+              c->scratch = ymalloc(c->scratchSize);
+            }
+          dbuffer_extract(c->recvq, c->scratch, total);
+          packet = c->scratch + sizeof(packet_len);
+        }
+
+      /* before decoding, which may write into the packet */
+      recordInbound(c->id, packet, packet_len);
 
-      struct Message *m;
-      if (!messageFromString(buf, packet_len, &m))
+      struct Message *m = messageCreate(0);
+      bool ok = messageDecode(packet, packet_len, m);
+      if (ok)
+        {
+          //printMessage (m, 1); //to watch the messages pass by -- or for debugging
+          c->despatching = true;
+          messageDespatch(c, m);
+          c->despatching = false;
+        }
+      else
+        messageDestroy(m);
+
+      if (gathered)
+        {
+          if (c->scratchSize > CLIENT_SCRATCH_KEEP)
+            {
+              yfree(c->scratch);
+              c->scratch = NULL;
+              c->scratchSize = 0;
+            }
+        }
+      else
+        {
+          packet[packet_len] = saved;
+          dbuffer_remove(c->recvq, total);
+        }
+
+      if (!ok)
         {
           /* Protocol error */
           /* FIXME: this causes re-entrancy problems in the IPC
@@ -197,28 +343,112 @@ clientReadData (struct Client *c, uint32_t channel_id, const char *data, size_t
            */
           Y_TRACE ("Protocol error from client %d (packet_len == %lu)", c->id, (long unsigned int)packet_len);
           clientClose(c);
-          return;
+          return false;
+        }
+      if (c->closePending)
+        {
+          clientClose(c);
+          return false;
         }
-      //printMessage (m, 1); //to watch the messages pass by -- or for debugging
-      messageDespatch(c, m);
+    }
+  return true;
+}
+
+/* Puts the rest of the client's messages off until its next turn */
+static void
+clientDefer (struct Client *c)
+{
+  if (!c->backlogged)
+    {
+      c->backlogged = true;
+      c->backlogSince = perfNow ();
+      if (c->c->holdInput != NULL)
+        c->c->holdInput (c, true);
+    }
+  llist_add_tail(backlog, c);
+  c->stats.deferrals++;
+  controlWorkPending ();
+}
+
+static void
+clientCaughtUp (struct Client *c)
+{
+  uint64_t lag = perfNow () - c->backlogSince;
+  if (lag > c->stats.maxLagMicroseconds)
+    c->stats.maxLagMicroseconds = MIN(lag, UINT32_MAX);
+  c->backlogged = false;
+  if (c->c->holdInput != NULL)
+    c->c->holdInput (c, false);
+}
+
+/* The work handler: each client which was backlogged at the start
+ * gets one more share, and goes to the back if it still isn't done
+ */
+static void
+clientDespatchBacklog (void *data)
+{
+  for (uint32_t turns = llist_length(backlog); turns > 0; turns--)
+    {
+      struct llist_node *n = llist_head(backlog);
+      if (n == NULL)
+        break;
+      struct Client *c = llist_node_data(n);
+      llist_node_delete(n);
+
+      /* the client is off the list while it has its turn, so closing
+       * it mustn't go looking for it there
+       */
+      c->backlogged = false;
+      if (!clientDespatchQueued(c))
+        continue;
+      c->backlogged = true;
+
+      if (clientPacketQueued(c))
+        clientDefer(c);
+      else
+        clientCaughtUp(c);
     }
 }
 
+void
+clientReadData (struct Client *c, uint32_t channel_id, const char *data, size_t len)
+{
+  assert(channel_id == 0);
+  dbuffer_add(c->recvq, data, len);
+
+  /* a backlogged client waits for its turn */
+  if (c->backlogged)
+    return;
+  if (clientDespatchQueued(c) && clientPacketQueued(c))
+    clientDefer(c);
+}
+
 void
 clientAddObject (struct Client *c, struct Object *o)
 {
   if (c == NULL)
     return;
-  Y_TRACE ("Adding object %d [%s] to client %d",
-          objectGetID (o), classGetName (objectClass (o)), c->id);
-  indexAdd (c -> objects, o);
+  TRACE_INSTANT (treObjectAdded, c->id, objectGetID (o));
+  o -> clientPrev = NULL;
+  o -> clientNext = c -> objects;
+  if (c -> objects != NULL)
+    c -> objects -> clientPrev = o;
+  c -> objects = o;
 }
 
 void
 clientRemoveObject (struct Client *c, struct Object *o)
 {
-  int oid = objectGetID (o);
-  indexRemove (c -> objects, &oid);
+  /* it may have been taken off already, as the client is closed */
+  if (o -> clientPrev == NULL && c -> objects != o)
+    return;
+  if (o -> clientPrev != NULL)
+    o -> clientPrev -> clientNext = o -> clientNext;
+  else
+    c -> objects = o -> clientNext;
+  if (o -> clientNext != NULL)
+    o -> clientNext -> clientPrev = o -> clientPrev;
+  o -> clientPrev = o -> clientNext = NULL;
 }
 
 void
@@ -227,8 +457,7 @@ clientSubscribedSignal (struct Client *c, struct Object *o, const char *name)
   /* We don't need to know about signals for objects belonging to us;
    * they will be destroyed when the connection is torn down anyway
    */
-  uint32_t oid = objectGetID(o);
-  if (indexFind(c->objects, &oid))
+  if (o->client == c)
     return;
 
   struct SignalSubscription *sub = ymalloc(sizeof(*sub));
@@ -265,5 +494,34 @@ setCurrentClient (struct Client *client)
   currentClient = client;
 }
 
+/* METHOD
+ * statistics :: () -> (...)
+ *
+ * Seven values per client: id, messages queued, bytes pending,
+ * flushes, system calls, iterations which ended with its messages
+ * still waiting, and the most microseconds it has taken to catch up
+ */
+struct Tuple *
+clientCStatistics (const struct Tuple *args)
+{
+  struct Tuple *ret = tupleCreate(indexCount(clients) * 7);
+  int i = 0;
+  struct IndexIterator *iter = indexGetStartIterator (clients);
+  while (indexiteratorHasValue (iter))
+    {
+      struct Client *c = indexiteratorGet (iter);
+      ret->list[i++] = tb_uint32(c -> id);
+      ret->list[i++] = tb_uint32(c -> stats.messagesQueued);
+      ret->list[i++] = tb_uint32(c -> c -> pendingBytes (c));
+      ret->list[i++] = tb_uint32(c -> stats.flushes);
+      ret->list[i++] = tb_uint32(c -> stats.syscalls);
+      ret->list[i++] = tb_uint32(c -> stats.deferrals);
+      ret->list[i++] = tb_uint32(c -> stats.maxLagMicroseconds);
+      indexiteratorNext (iter);
+    }
+  indexiteratorDestroy (iter);
+  return ret;
+}
+
 /* arch-tag: 8eb95cd6-369e-4879-961a-45aaef4d33c7
  */
@@ -50,6 +50,19 @@ void           clientUnsubscribedSignal (struct Client *, struct Object *, const
 
 void           clientSendMessage (struct Client *, struct Message *);
 
+/* Send m, already encoded into packet by messageEncodeShared(), with
+ * this client in its to field. The packet is shared with the client's
+ * queue rather than copied
+ */
+struct dbuffer_shared;
+void           clientSendSharedMessage (struct Client *, struct Message *m,
+                                        struct dbuffer_shared *packet);
+
+/* Claim a file descriptor the client has passed us under this id;
+ * returns -1 if there isn't one. The caller must close it
+ */
+int            clientTakeFileDescriptor (struct Client *, uint32_t id);
+
 #endif /* header guard */
 
 /* arch-tag: 7a621d95-8378-4d45-8caf-4fd02a1188d7
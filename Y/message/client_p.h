@@ -26,13 +26,45 @@
 
 #include <sys/types.h>
 
+/* Output counters, for spotting clients which are falling behind */
+struct ClientStatistics
+{
+  uint32_t messagesQueued;
+  /* times the transport tried to empty its queues, and the system
+   * calls it took
+   */
+  uint32_t flushes;
+  uint32_t syscalls;
+  /* iterations which ended with its messages still waiting, and the
+   * longest it has taken to catch up once it fell behind
+   */
+  uint32_t deferrals;
+  uint32_t maxLagMicroseconds;
+};
+
 struct Client
 {
   const struct ClientClass *c;
   int id;
-  struct Index *objects;
+  /* linked through the objects' clientPrev and clientNext */
+  struct Object *objects;
   struct Index *signals;
   struct dbuffer *recvq;
+  /* Packets which straddle recvq's elements are gathered here */
+  char *scratch;
+  size_t scratchSize;
+  /* Set while messages decoded from recvq are being despatched; a
+   * close requested meanwhile is put off until they are finished with
+   */
+  bool despatching;
+  bool closePending;
+  /* Set while it has used its share of an iteration with messages
+   * left in recvq; they are despatched in turn with other clients'
+   * over the following iterations, and its input is held meanwhile
+   */
+  bool backlogged;
+  uint64_t backlogSince;
+  struct ClientStatistics stats;
 };
 
 struct ClientClass
@@ -40,6 +72,17 @@ struct ClientClass
   const char *name;
   bool (*newChannel)  (struct Client *self, uint32_t *channel_id);
   void (*writeData)   (struct Client *self, uint32_t channel_id, const char *data, size_t len);
+  /* Outgoing messages are encoded straight onto the channel's queue,
+   * then sendQueued is called to get it moving
+   */
+  struct dbuffer *(*getSendQueue) (struct Client *self, uint32_t channel_id);
+  void (*sendQueued)  (struct Client *self, uint32_t channel_id);
+  /* Bytes queued on all channels but not yet sent */
+  size_t (*pendingBytes) (struct Client *self);
+  /* May be NULL if the transport can't pass descriptors */
+  int  (*takeFileDescriptor) (struct Client *self, uint32_t id);
+  /* Stop or start reading from the client; may be NULL */
+  void (*holdInput)   (struct Client *self, bool hold);
   void (*close)       (struct Client *self);
 };
 
@@ -19,11 +19,14 @@
 #include <Y/message/message.h>
 #include <Y/message/tuple.h>
 #include <Y/message/client.h>
+#include <Y/message/wire.h>
 #include <Y/const.h>
 #include <Y/object/class.h>
 #include <Y/object/object.h>
 #include <Y/util/yutil.h>
 #include <Y/util/log.h>
+#include <Y/util/perf.h>
+#include <Y/trace/tracering.h>
 #include <string.h>
 #include <sys/types.h>
 #include <assert.h>
@@ -76,57 +79,14 @@ messageToString (const struct Message *m, char **str, size_t *slen)
       return;
     }
 
-  uint32_t packet_len;
-
-  *slen = 0;
-  *slen += sizeof(m->seq);
-  *slen += sizeof(m->to);
-  *slen += sizeof(m->from);
-  *slen += sizeof(m->op);
-  *slen += sizeof(m->id);
-  *slen += sizeof(m->meta);
-  *slen += sizeof(m->tuple->count);
-  if (m->tuple)
-    for (uint32_t i = 0; i < m->tuple->count; i++)
-      {
-        size_t value_len;
-        valueToString(&m->tuple->list[i], NULL, &value_len);
-        *slen += sizeof(uint32_t);
-        *slen += value_len;
-      }
+  *slen = messageEncodedLength(m);
 
   if (!str)
     return;
 
   *str = ymalloc(*slen);
 
-  char *p = *str;
-
-  uint32_t seq = htonl(m->seq);
-  ADD_SCALAR(p, seq);
-  uint32_t to = htonl(m->to);
-  ADD_SCALAR(p, to);
-  uint32_t from = htonl(m->from);
-  ADD_SCALAR(p, from);
-  uint32_t op = htonl(m->op);
-  ADD_SCALAR(p, op);
-  uint32_t id = htonl(m->id);
-  ADD_SCALAR(p, id);
-  uint32_t meta = htonl(m->meta);
-  ADD_SCALAR(p, meta);
-  uint32_t value_count = htonl(m->tuple ? m->tuple->count : 0);
-  ADD_SCALAR(p, value_count);
-  if (m->tuple)
-    for (uint32_t i = 0; i < m->tuple->count; i++)
-      {
-        char *value_str;
-        size_t value_len;
-        valueToString(&m->tuple->list[i], &value_str, &value_len);
-        uint32_t len = htonl(value_len);
-        ADD_SCALAR(p, len);
-        ADD_DATA(p, value_str, value_len);
-        yfree(value_str);
-      }
+  char *p = messageEncode(m, *str);
 
   assert(p == (*str + *slen));
 }
@@ -141,114 +101,26 @@ messageFromString (const char *str, size_t slen, struct Message **m)
       return 0;
     }
 
-  struct Message tmp;
-
-  const char *p = str;
-  size_t l = slen;
-
-  if (!GET_SCALAR(p, l, tmp.seq))
-    {
-      Y_TRACE ("Failed to parse message (too short for seq)");
-      return false;
-    }
-  if (!GET_SCALAR(p, l, tmp.to))
-    {
-      Y_TRACE ("Failed to parse message (too short for to)");
-      return false;
-    }
-  if (!GET_SCALAR(p, l, tmp.from))
-    {
-      Y_TRACE ("Failed to parse message (too short for from)");
-      return false;
-    }
-  if (!GET_SCALAR(p, l, tmp.op))
-    {
-      Y_TRACE ("Failed to parse message (too short for op)");
-      return false;
-    }
-  if (!GET_SCALAR(p, l, tmp.id))
-    {
-      Y_TRACE ("Failed to parse message (too short for id)");
-      return false;
-    }
-  if (!GET_SCALAR(p, l, tmp.meta))
-    {
-      Y_TRACE ("Failed to parse message (too short for meta)");
-      return false;
-    }
-  uint32_t nvalue_count;
-  if (!GET_SCALAR(p, l, nvalue_count))
-    {
-      Y_TRACE ("Failed to parse message (too short for nvalue_count)");
-      return false;
-    }
-
-  /* This part is a little less obvious */
-  uint32_t value_count = ntohl(nvalue_count);
-  size_t value_len[value_count];
-  const char *value_data[value_count];
-  for (uint32_t i = 0; i < value_count; i++)
-    {
-      /* Get the length of the value, and record it for when we parse
-       * properly later
-       */
-      uint32_t nmlen;
-      if (!GET_SCALAR(p, l, nmlen))
-        {
-          Y_TRACE ("Failed to parse message (too short for nmlen, i == %lu)", (long unsigned int)i);
-          return false;
-        }
-      value_len[i] = ntohl(nmlen);
-      /* Record the pointer */
-      value_data[i] = p;
-      /* Check that we have that much data available */
-      if (!SKIP_DATA(p, l, value_len[i]))
-        {
-          Y_TRACE ("Failed to parse message (too short for member data, i == %lu)", (long unsigned int)i);
-          return false;
-        }
-      /* And check that the value is parseable */
-      if (!valueFromString(value_data[i], value_len[i], NULL))
-        {
-          Y_TRACE ("Failed to parse message (failed to parse value, i == %lu)", (long unsigned int)i);
-          return false;
-        }
-    }
-
-  if (l != 0)
-    {
-      Y_TRACE ("Failed to parse message (%lu bytes left over at end)", (long unsigned int)l);
-      return false;
-    }
-
-  if (!m)
-    return true;
-
-  *m = messageCreate(ntohl(tmp.op));
-  (*m)->seq = ntohl(tmp.seq);
-  (*m)->to = ntohl(tmp.to);
-  (*m)->from = ntohl(tmp.from);
-  (*m)->id = ntohl(tmp.id);
-  (*m)->meta = ntohl(tmp.meta);
-  (*m)->tuple = tupleCreate(value_count);
-
-  /* Now, we use those two arrays we built earlier (of pointer/length
-   * pairs) to actually parse the tuple
+  /* Decode a private copy in place, then give the message its own
+   * copies of the strings
    */
-  for (uint32_t i = 0; i < value_count; i++)
-    {
-      struct Value *value;
-      if (!valueFromString(value_data[i], value_len[i], &value))
-        /* This is impossible (because it worked earlier), and we've
-         * already committed to allocating, so abort
-         */
-        abort();
-      /* And copy it into the message */
-      memcpy(&((*m)->tuple->list[i]), value, sizeof(*value));
-      yfree(value);
+  char *copy = ymalloc(slen + 1);
+  memcpy(copy, str, slen);
+
+  struct Message *tmp = messageCreate(0);
+  bool ok = messageDecode(copy, slen, tmp);
+  if (ok && m)
+    {
+      struct Tuple *t = tupleDup(tmp->tuple);
+      tupleDestroy(tmp->tuple);
+      tmp->tuple = t;
+      *m = tmp;
+      tmp = NULL;
     }
 
-  return true;
+  messageDestroy(tmp);
+  yfree(copy);
+  return ok;
 }
 
 static void
@@ -277,9 +149,9 @@ messageDespatchFindClass (const struct Client *clientFrom, const struct Message
 }
 
 static void
-messageDespatchInvokeClassMethod (struct Client *clientFrom, const struct Message *m)
+messageDespatchFindMethod (const struct Client *clientFrom, const struct Message *m)
 {
-  if (m->tuple->count < 1)
+  if (m->tuple->count != 1)
     {
       messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Type mismatch"));
       return;
@@ -290,19 +162,53 @@ messageDespatchInvokeClassMethod (struct Client *clientFrom, const struct Messag
       return;
     }
 
+  uint32_t method = classMethodID (m->tuple->list[0].string.data);
+  if (method != 0)
+    {
+      struct Message *rm = messageBuildReply(clientFrom, m);
+      rm->id = method;
+      messageDespatch(NULL, rm);
+    }
+  else
+    messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Method not found"));
+}
+
+/* The method is named by its first value, either as a string or as an
+ * id from YMO_FIND_METHOD */
+static bool
+messageMethodNamed (const struct Message *m)
+{
+  return m->tuple->count >= 1
+    && (m->tuple->list[0].type == t_string || m->tuple->list[0].type == t_uint32);
+}
+
+static void
+messageDespatchInvokeClassMethod (struct Client *clientFrom, const struct Message *m)
+{
+  if (!messageMethodNamed (m))
+    {
+      messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Type mismatch"));
+      return;
+    }
+
   struct Class *class = classFindByID(m->id);
   if (!class)
     {
       messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Class not found"));
       return;
     }
+  perfCountCall (classGetID (class));
 
   const struct Tuple args =
     {
       .count = m->tuple->count - 1,
       .list = m->tuple->list + 1
     };
-  struct Tuple *t = classInvokeClassMethod (class, clientFrom, m->tuple->list[0].string.data, &args);
+  struct Tuple *t;
+  if (m->tuple->list[0].type == t_uint32)
+    t = classInvokeClassMethodByID (class, clientFrom, m->tuple->list[0].uint32, &args);
+  else
+    t = classInvokeClassMethod (class, clientFrom, m->tuple->list[0].string.data, &args);
   /* Only send a response if one was requested (but always send errors) */
   if (m->meta && (!t || !t->error))
     {
@@ -321,12 +227,7 @@ messageDespatchInvokeClassMethod (struct Client *clientFrom, const struct Messag
 static void
 messageDespatchInvokeInstanceMethod (struct Client *clientFrom, const struct Message *m)
 {
-  if (m->tuple->count < 1)
-    {
-      messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Type mismatch"));
-      return;
-    }
-  else if (m->tuple->list[0].type != t_string)
+  if (!messageMethodNamed (m))
     {
       messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Type mismatch"));
       return;
@@ -338,13 +239,18 @@ messageDespatchInvokeInstanceMethod (struct Client *clientFrom, const struct Mes
       messageDespatch(NULL, messageBuildReplyError(clientFrom, m, "Object not found"));
       return;
     }
+  perfCountCall (classGetID (objectClass (object)));
 
   const struct Tuple args =
     {
       .count = m->tuple->count - 1,
       .list = m->tuple->list + 1
     };
-  struct Tuple *t = classInvokeInstanceMethod (object, clientFrom, m->tuple->list[0].string.data, &args);
+  struct Tuple *t;
+  if (m->tuple->list[0].type == t_uint32)
+    t = classInvokeInstanceMethodByID (object, clientFrom, m->tuple->list[0].uint32, &args);
+  else
+    t = classInvokeInstanceMethod (object, clientFrom, m->tuple->list[0].string.data, &args);
   /* Only send a response if one was requested (but always send errors) */
   if (m->meta && (!t || !t->error))
     {
@@ -399,6 +305,9 @@ messageDoDespatch (struct Client *clientFrom, struct Message *m)
     case YMO_INVOKE_INSTANCE_METHOD:
       messageDespatchInvokeInstanceMethod (clientFrom, m);
       return;
+    case YMO_FIND_METHOD:
+      messageDespatchFindMethod (clientFrom, m);
+      return;
     case YMO_QUIT:
       Y_TRACE ("YMO_QUIT from client %d", clientGetID(clientFrom));
       clientClose (clientFrom);
@@ -421,10 +330,20 @@ void
 messageDespatch (struct Client *clientFrom, struct Message *m)
 {
   struct Client *oldClient = getCurrentClient();
+  /* only messages from clients are timed; the rest are replies and
+   * events generated while handling those */
+  uint64_t start = clientFrom ? perfNow () : 0;
+  TRACE_SPAN (treDespatch, m->op, m->id);
   setCurrentClient(clientFrom);
   messageDoDespatch (clientFrom, m);
   messageDestroy (m);
   setCurrentClient(oldClient);
+  perfCount (perfMessages, 1);
+  if (clientFrom)
+    {
+      perfCount (perfClientMessages, 1);
+      perfRecord (perfDespatchTime, perfNow () - start);
+    }
 }
 
 /*
@@ -455,6 +374,9 @@ printMessage (const struct Message *m, bool incoming)
     case YMO_INVOKE_INSTANCE_METHOD:
       Y_TRACE ( "OP: Invoke Instance Method" );
       break;
+    case YMO_FIND_METHOD:
+      Y_TRACE ("OP: FindMethod" );
+      break;
     case YMO_QUIT:
       Y_TRACE ("OP: Quit");
       break;
@@ -0,0 +1,239 @@
+/************************************************************************
+ *   Copyright (C) Andrew Suffield <asuffield@debian.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Message encoding benchmark
+ *
+ * Encodes typical outgoing messages onto a dbuffer, the way
+ * clientSendMessage does, and reports throughput and allocations per
+ * message for the old two-pass messageToString path and for the
+ * direct encoder.
+ *
+ * Usage: message_bench [iterations]
+ */
+
+#include <Y/message/message.h>
+#include <Y/message/wire.h>
+#include <Y/message/tuple.h>
+#include <Y/util/dbuffer.h>
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/* This benchmark supplies its own allocator, so it can count calls */
+static unsigned long allocations = 0;
+
+void *
+ymalloc (size_t n)
+{
+  allocations++;
+  void *p = malloc (n);
+  if (!p)
+    abort ();
+  return p;
+}
+
+void *
+ycalloc (size_t n, size_t el_size)
+{
+  void *p = ymalloc (n * el_size);
+  memset (p, 0, n * el_size);
+  return p;
+}
+
+void
+yfree (void *p)
+{
+  free (p);
+}
+
+char *
+ystrdup (const char *s)
+{
+  if (!s)
+    return NULL;
+  char *r = ymalloc (strlen (s) + 1);
+  strcpy (r, s);
+  return r;
+}
+
+/* The messages here never carry objects */
+uint32_t
+objectGetID (const struct Object *o)
+{
+  return 0;
+}
+
+struct Object *
+objectFind (uint32_t oid)
+{
+  return NULL;
+}
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/* This is how messageToString and clientSendMessage used to work:
+ * each value serialised twice into temporary strings, then the packet
+ * built in a fresh buffer and written with two separate calls
+ */
+static void
+encodeOld (const struct Message *m, struct dbuffer *out)
+{
+  size_t len = 7 * sizeof(uint32_t);
+  for (uint32_t i = 0; i < m->tuple->count; i++)
+    {
+      size_t value_len;
+      valueToString(&m->tuple->list[i], NULL, &value_len);
+      len += sizeof(uint32_t) + value_len;
+    }
+
+  char *buf = ymalloc (len);
+  char *p = buf;
+  uint32_t header[7] = { htonl(m->seq), htonl(m->to), htonl(m->from), htonl(m->op),
+                         htonl(m->id), htonl(m->meta), htonl(m->tuple->count) };
+  memcpy (p, header, sizeof (header));
+  p += sizeof (header);
+  for (uint32_t i = 0; i < m->tuple->count; i++)
+    {
+      char *value_str;
+      size_t value_len;
+      valueToString(&m->tuple->list[i], &value_str, &value_len);
+      uint32_t nvalue_len = htonl(value_len);
+      memcpy (p, &nvalue_len, sizeof (nvalue_len));
+      p += sizeof (nvalue_len);
+      memcpy (p, value_str, value_len);
+      p += value_len;
+      yfree (value_str);
+    }
+
+  uint32_t nlen = htonl (len);
+  dbuffer_add (out, (char *)&nlen, sizeof (nlen));
+  dbuffer_add (out, buf, len);
+  yfree (buf);
+}
+
+static void
+encodeNew (const struct Message *m, struct dbuffer *out)
+{
+  messageEncodeToDbuffer (m, out);
+}
+
+static void
+run (const char *name, const struct Message *m, int iterations)
+{
+  struct { const char *name; void (*encode) (const struct Message *, struct dbuffer *); } paths[] =
+    {
+      { "two-pass", encodeOld },
+      { "direct", encodeNew }
+    };
+
+  /* Both paths must produce the same bytes */
+  struct dbuffer *check[2] = { new_dbuffer (), new_dbuffer () };
+  paths[0].encode (m, check[0]);
+  paths[1].encode (m, check[1]);
+  size_t len = dbuffer_len (check[0]);
+  if (len != dbuffer_len (check[1]))
+    abort ();
+  char *a = malloc (len), *b = malloc (len);
+  dbuffer_get (check[0], a, len);
+  dbuffer_get (check[1], b, len);
+  if (memcmp (a, b, len) != 0)
+    abort ();
+  free (a);
+  free (b);
+  free_dbuffer (check[0]);
+  free_dbuffer (check[1]);
+
+  for (int p = 0; p < 2; ++p)
+    {
+      struct dbuffer *out = new_dbuffer ();
+      size_t bytes = 0;
+
+      /* Warm up the dbuffer element pool */
+      paths[p].encode (m, out);
+      dbuffer_remove (out, dbuffer_len (out));
+
+      unsigned long before = allocations;
+      double start = now ();
+      for (int i = 0; i < iterations; ++i)
+        {
+          paths[p].encode (m, out);
+          bytes += dbuffer_len (out);
+          dbuffer_remove (out, dbuffer_len (out));
+        }
+      double elapsed = now () - start;
+
+      printf ("%-12s %-16s %8.1f MB/s %10.0f msgs/s %6.2f allocs/msg\n",
+              name, paths[p].name, bytes / elapsed / 1e6, iterations / elapsed,
+              (double)(allocations - before) / iterations);
+      free_dbuffer (out);
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 20000;
+
+  /* A signal event, as objectEmitSignal sends them */
+  struct Message *event = &(struct Message){ .op = YMO_EVENT };
+  event->to = 7;
+  event->id = 42;
+  event->tuple = tupleBuild (tb_string ("pointerMotion"), tb_int32 (100), tb_int32 (200), tb_uint32 (1));
+
+  /* A small method reply */
+  struct Message *reply = &(struct Message){ .op = YMO_INVOKE_INSTANCE_METHOD };
+  reply->to = 7;
+  reply->seq = 1234;
+  reply->tuple = tupleBuild (tb_uint32 (99));
+
+  /* A canvas drawLines call with 1000 segments */
+  struct Message *lines = &(struct Message){ .op = YMO_INVOKE_INSTANCE_METHOD };
+  lines->to = 7;
+  lines->tuple = tupleCreate (1 + 4000);
+  lines->tuple->list[0] = tb_string ("drawLines");
+  for (uint32_t i = 0; i < 1000; ++i)
+    {
+      lines->tuple->list[1 + i * 4 + 0] = tb_uint32 (i);
+      lines->tuple->list[1 + i * 4 + 1] = tb_uint32 (i * 2);
+      lines->tuple->list[1 + i * 4 + 2] = tb_int32 (10);
+      lines->tuple->list[1 + i * 4 + 3] = tb_int32 (-10);
+    }
+
+  run ("event", event, iterations);
+  run ("reply", reply, iterations);
+  run ("drawLines", lines, iterations / 20);
+
+  tupleDestroy (event->tuple);
+  tupleDestroy (reply->tuple);
+  tupleDestroy (lines->tuple);
+  dbuffer_cleanup ();
+  return 0;
+}
+
+/* arch-tag: 8f3c1d6a-52e0-47b9-a9d4-1e6b7c0f2d83
+ */
@@ -0,0 +1,152 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/message/record.h>
+#include <Y/message/wire.h>
+#include <Y/util/yutil.h>
+#include <Y/const.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/* Records are gathered in stdio's buffer, so the log costs a write()
+ * every this many bytes rather than one per message
+ */
+#define RECORD_BUFFER_SIZE 65536
+
+static FILE *recordFile = NULL;
+static struct timespec recordEpoch;
+
+/* outgoing messages are encoded here; it only ever grows */
+static char *recordScratch = NULL;
+static size_t recordScratchSize = 0;
+
+bool
+recordStart (const char *filename)
+{
+  uint32_t version = htonl(YRECORD_VERSION);
+
+  recordStop ();
+
+  recordFile = fopen (filename, "wb");
+  if (recordFile == NULL)
+    {
+      Y_ERROR ("Could not open record log %s: %s", filename, strerror (errno));
+      return false;
+    }
+  setvbuf (recordFile, NULL, _IOFBF, RECORD_BUFFER_SIZE);
+  fwrite (YRECORD_MAGIC, 1, 4, recordFile);
+  fwrite (&version, sizeof(version), 1, recordFile);
+  clock_gettime (CLOCK_MONOTONIC, &recordEpoch);
+  Y_INFO ("Recording client traffic to %s", filename);
+  return true;
+}
+
+void
+recordStop (void)
+{
+  if (recordFile == NULL)
+    return;
+  if (fclose (recordFile) != 0)
+    Y_ERROR ("Record log was not written completely: %s", strerror (errno));
+  recordFile = NULL;
+  yfree (recordScratch);
+  recordScratch = NULL;
+  recordScratchSize = 0;
+}
+
+bool
+recordIsActive (void)
+{
+  return recordFile != NULL;
+}
+
+static void
+recordWrite (int client_id, enum YRecordEvent event, const char *data, size_t len)
+{
+  struct timespec now;
+  char header[YRECORD_HEADER_SIZE];
+  char *p = header;
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  uint64_t elapsed = (uint64_t)(now.tv_sec - recordEpoch.tv_sec) * 1000000
+    + (now.tv_nsec - recordEpoch.tv_nsec) / 1000;
+
+  uint32_t time_hi = htonl(elapsed >> 32);
+  uint32_t time_lo = htonl(elapsed & 0xFFFFFFFF);
+  uint32_t id = htonl(client_id);
+  uint32_t length = htonl(len);
+  memcpy (p, &time_hi, 4); p += 4;
+  memcpy (p, &time_lo, 4); p += 4;
+  memcpy (p, &id, 4); p += 4;
+  *p++ = event;
+  memcpy (p, &length, 4);
+
+  fwrite (header, 1, sizeof(header), recordFile);
+  if (len > 0)
+    fwrite (data, 1, len, recordFile);
+  if (ferror (recordFile))
+    {
+      Y_ERROR ("Failed to write the record log, recording stopped");
+      recordStop ();
+    }
+}
+
+void
+recordClientOpened (int client_id)
+{
+  if (recordFile != NULL)
+    recordWrite (client_id, yreConnect, NULL, 0);
+}
+
+void
+recordClientClosed (int client_id)
+{
+  if (recordFile != NULL)
+    recordWrite (client_id, yreDisconnect, NULL, 0);
+}
+
+void
+recordInbound (int client_id, const char *body, size_t len)
+{
+  if (recordFile != NULL)
+    recordWrite (client_id, yreInbound, body, len);
+}
+
+void
+recordOutbound (int client_id, const struct Message *m)
+{
+  if (recordFile == NULL)
+    return;
+
+  size_t len = messageEncodedLength (m);
+  if (recordScratchSize < len)
+    {
+      yfree (recordScratch);
+      recordScratchSize = len;
+      recordScratch = ymalloc (recordScratchSize);
+    }
+  messageEncode (m, recordScratch);
+  recordWrite (client_id, yreOutbound, recordScratch, len);
+}
+
+/* arch-tag: 2a9c4e71-5b83-4d06-8f1e-c3a7d9e6b504
+ */
@@ -0,0 +1,57 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_MESSAGE_RECORD_H
+#define Y_MESSAGE_RECORD_H
+
+#include <Y/message/message.h>
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ *  Records every client's traffic to a log which yreplay can play
+ *  back against a server; the format is described in Y/const.h.
+ *
+ *  While no log is open each call costs one test, so the hooks can
+ *  stay in the message paths.
+ */
+
+/* starts logging to filename, replacing any log already open;
+ * returns false if it can't be created */
+bool recordStart (const char *filename);
+
+/* flushes and closes the log, if there is one */
+void recordStop (void);
+
+bool recordIsActive (void);
+
+void recordClientOpened (int client_id);
+void recordClientClosed (int client_id);
+
+/* a message body of len bytes, as it arrived from the client */
+void recordInbound (int client_id, const char *body, size_t len);
+
+/* a message being sent to the client; it is only encoded when a log
+ * is open */
+void recordOutbound (int client_id, const struct Message *m);
+
+#endif /* header guard */
+
+/* arch-tag: 6f2d8a14-c0b7-4e59-93a1-d7e54b0c2f86
+ */
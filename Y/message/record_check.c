@@ -0,0 +1,175 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/message/record.h>
+#include <Y/message/wire.h>
+#include <Y/message/tuple.h>
+#include <Y/util/yutil.h>
+#include <Y/const.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <netinet/in.h>
+
+const char *checkName;
+const char *checkModule;
+
+/* The messages here never carry objects */
+uint32_t
+objectGetID (const struct Object *o)
+{
+  return 0;
+}
+
+struct Object *
+objectFind (uint32_t oid)
+{
+  return NULL;
+}
+
+struct record_check_Record
+{
+  uint64_t time;
+  uint32_t client;
+  int event;
+  uint32_t len;
+  char data[256];
+};
+
+static bool
+record_check_read (FILE *f, struct record_check_Record *r)
+{
+  unsigned char header[YRECORD_HEADER_SIZE];
+  uint32_t time_hi, time_lo, client, len;
+
+  if (fread (header, 1, sizeof(header), f) != sizeof(header))
+    return false;
+  memcpy (&time_hi, header, 4);
+  memcpy (&time_lo, header + 4, 4);
+  memcpy (&client, header + 8, 4);
+  memcpy (&len, header + 13, 4);
+  r->time = ((uint64_t)ntohl(time_hi) << 32) | ntohl(time_lo);
+  r->client = ntohl(client);
+  r->event = header[12];
+  r->len = ntohl(len);
+  if (r->len > sizeof(r->data))
+    return false;
+  return fread (r->data, 1, r->len, f) == r->len;
+}
+
+static int
+record_check_functionality (void)
+{
+  char filename[] = "/tmp/record_checkXXXXXX";
+  struct record_check_Record r;
+  char magic[4];
+  uint32_t version;
+  uint64_t last;
+  FILE *f;
+
+  checkModule = "functionality";
+
+  int fd = mkstemp (filename);
+  CHECK_THAT ( fd >= 0 );
+  close (fd);
+
+  /* Nothing is written, or encoded, without a log */
+  CHECK_THAT ( !recordIsActive () );
+  recordInbound (1, "ignored", 7);
+
+  CHECK_THAT ( recordStart (filename) );
+  CHECK_THAT ( recordIsActive () );
+
+  struct Message *m = &(struct Message){ .op = YMO_INVOKE_CLASS_METHOD,
+                                         .seq = 42, .to = 7 };
+  m->tuple = tupleBuild (tb_string ("statistics"), tb_uint32 (3));
+  size_t mlen = messageEncodedLength (m);
+  char encoded[mlen];
+  messageEncode (m, encoded);
+
+  recordClientOpened (1);
+  recordClientOpened (2);
+  recordInbound (1, "\1\2\3\4", 4);
+  recordOutbound (2, m);
+  recordClientClosed (1);
+  recordStop ();
+  CHECK_THAT ( !recordIsActive () );
+
+  /* and after stopping, nothing more */
+  recordClientClosed (2);
+
+  f = fopen (filename, "rb");
+  CHECK_THAT ( f != NULL );
+  CHECK_THAT ( fread (magic, 1, 4, f) == 4 );
+  CHECK_THAT ( memcmp (magic, YRECORD_MAGIC, 4) == 0 );
+  CHECK_THAT ( fread (&version, sizeof(version), 1, f) == 1 );
+  CHECK_THAT ( ntohl(version) == YRECORD_VERSION );
+
+  CHECK_THAT ( record_check_read (f, &r) );
+  CHECK_THAT ( r.client == 1 && r.event == yreConnect && r.len == 0 );
+  last = r.time;
+
+  CHECK_THAT ( record_check_read (f, &r) );
+  CHECK_THAT ( r.client == 2 && r.event == yreConnect && r.len == 0 );
+  CHECK_THAT ( r.time >= last );
+  last = r.time;
+
+  CHECK_THAT ( record_check_read (f, &r) );
+  CHECK_THAT ( r.client == 1 && r.event == yreInbound );
+  CHECK_THAT ( r.len == 4 && memcmp (r.data, "\1\2\3\4", 4) == 0 );
+  CHECK_THAT ( r.time >= last );
+  last = r.time;
+
+  /* outgoing messages are logged as their wire body */
+  CHECK_THAT ( record_check_read (f, &r) );
+  CHECK_THAT ( r.client == 2 && r.event == yreOutbound );
+  CHECK_THAT ( r.len == mlen && memcmp (r.data, encoded, mlen) == 0 );
+  CHECK_THAT ( r.time >= last );
+
+  CHECK_THAT ( record_check_read (f, &r) );
+  CHECK_THAT ( r.client == 1 && r.event == yreDisconnect && r.len == 0 );
+
+  CHECK_THAT ( !record_check_read (f, &r) );
+  CHECK_THAT ( feof (f) );
+  fclose (f);
+
+  /* A log which can't be created leaves recording off */
+  CHECK_THAT ( !recordStart ("/nonexistent/directory/log") );
+  CHECK_THAT ( !recordIsActive () );
+
+  tupleDestroy (m->tuple);
+  unlink (filename);
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "Record";
+  failed = record_check_functionality () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 9c4b1e37-a2d6-4f80-b5c9-1e8f3a7d6042
+ */
@@ -99,6 +99,7 @@ tupleCreate (uint32_t count)
 {
   struct Tuple *t = ymalloc (sizeof (*t));
   t->error = false;
+  t->borrowed = false;
   t->count = count;
   if (count > 0)
     {
@@ -116,6 +117,7 @@ tupleDup (const struct Tuple *from)
 {
   struct Tuple *t = ymalloc (sizeof (*t));
   t->error = from->error;
+  t->borrowed = false;
   t->count = from->count;
   if (from->count > 0)
     {
@@ -161,7 +163,7 @@ tupleDestroy (struct Tuple *t)
   if (t == NULL)
     return;
 
-  for (uint32_t i = 0; i < t->count; i++)
+  for (uint32_t i = 0; i < t->count && !t->borrowed; i++)
     switch((enum Type)t->list[i].type)
       {
       case t_string:
@@ -229,41 +231,26 @@ tupleBuildFromConst_(struct Value *list[])
   return t;
 }
 
-void
-valueToString (const struct Value *m, char **str, size_t *slen)
+size_t
+valueEncodedLength (const struct Value *m)
 {
-  if (!m)
-    {
-      if (str)
-        *str = NULL;
-      *slen = 0;
-      return;
-    }
-
-  *slen = 0;
-  *slen += sizeof(m->type);
   switch((enum Type)m->type)
     {
     case t_string:
-      *slen += m->string.len;
-      break;
+      return sizeof(m->type) + m->string.len;
     case t_object:
     case t_uint32:
-      *slen += sizeof(m->uint32);
-      break;
+      return sizeof(m->type) + sizeof(m->uint32);
     case t_int32:
-      *slen += sizeof(m->int32);
-      break;
+      return sizeof(m->type) + sizeof(m->int32);
     default:
       abort();
     }
+}
 
-  if (!str)
-    return;
-
-  *str = ymalloc(*slen);
-  char *p = *str;
-
+char *
+valueEncode (const struct Value *m, char *p)
+{
   uint32_t type;
   switch((enum Type)m->type)
     {
@@ -309,6 +296,28 @@ valueToString (const struct Value *m, char **str, size_t *slen)
       abort();
     }
 
+  return p;
+}
+
+void
+valueToString (const struct Value *m, char **str, size_t *slen)
+{
+  if (!m)
+    {
+      if (str)
+        *str = NULL;
+      *slen = 0;
+      return;
+    }
+
+  *slen = valueEncodedLength(m);
+
+  if (!str)
+    return;
+
+  *str = ymalloc(*slen);
+  char *p = valueEncode(m, *str);
+
   assert(p == (*str + *slen));
 }
 
@@ -742,6 +751,72 @@ tupleMatchType(const struct Tuple *t, const struct MethodTypes *types)
   return fallback;
 }
 
+static bool
+tupleSignatureAccepts(uint32_t type, char code)
+{
+  switch (code)
+    {
+    case 's':
+      return type == t_string;
+    case 'u':
+      return type == t_uint32;
+    case 'i':
+      return type == t_int32;
+    case 'o':
+      return type == t_object;
+    case 'a':
+      /* as tupleStaticCast, any only takes a real value */
+      return type == t_string || type == t_uint32 || type == t_int32 || type == t_object;
+    default:
+      /* yclpp doesn't write anything else */
+      abort();
+    }
+}
+
+bool
+tupleMatchSignature(const struct Tuple *t, const char *signature)
+{
+  if (!t)
+    return false;
+
+  uint32_t i;
+  for (i = 0; signature[i] != '\0'; i++)
+    {
+      /* A list matches everything else */
+      if (signature[i] == '*')
+        return true;
+      if (i >= t->count || !tupleSignatureAccepts(t->list[i].type, signature[i]))
+        return false;
+    }
+  return i == t->count;
+}
+
+bool
+tupleResolveSignature(const struct Tuple *t, const char *signature, struct Value *out)
+{
+  if (!t)
+    return false;
+
+  uint32_t i;
+  for (i = 0; signature[i] != '\0'; i++)
+    {
+      assert(signature[i] != '*');
+      if (i >= t->count)
+        return false;
+      out[i] = t->list[i];
+      if (signature[i] == 'o' && out[i].type == t_uint32)
+        {
+          out[i].type = t_object;
+          out[i].obj = objectFind(t->list[i].uint32);
+          if (!out[i].obj)
+            return false;
+        }
+      else if (!tupleSignatureAccepts(out[i].type, signature[i]))
+        return false;
+    }
+  return i == t->count;
+}
+
 struct Tuple *
 tupleStaticCast(const struct Tuple *t, const struct TupleType *type)
 {
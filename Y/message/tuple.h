@@ -64,6 +64,10 @@ struct Value
 struct Tuple
 {
   bool error;
+  /* The string data belongs to someone else (typically a receive
+   * buffer), so tupleDestroy leaves it alone
+   */
+  bool borrowed;
   uint32_t count;
   struct Value *list;
 };
@@ -92,6 +96,11 @@ struct Tuple *tupleDup(const struct Tuple *t);
 void tupleDestroy(struct Tuple *);
 
 void valueToString (const struct Value *m, char **str, size_t *len);
+/* Encode without allocating: valueEncode writes exactly
+ * valueEncodedLength() bytes at p and returns the end
+ */
+size_t valueEncodedLength (const struct Value *m);
+char *valueEncode (const struct Value *m, char *p);
 bool valueFromString (const char *str, size_t len, struct Value **m);
 
 struct Value *valueCreate(void);
@@ -100,6 +109,20 @@ void valueDestroy(struct Value *v);
 
 const struct MethodType *tupleMatchType(const struct Tuple *, const struct MethodTypes *);
 struct Tuple *tupleStaticCast(const struct Tuple *, const struct TupleType *);
+
+/* Signatures as yclpp compiles them: a string with one code per value,
+ * s, u, i, o or a for string, uint32, int32, object and any, and a
+ * final * if a list takes whatever follows.
+ *
+ * tupleMatchSignature says whether a tuple's values already have those
+ * types, so it could be used as it is without tupleStaticCast. A NULL
+ * tuple never matches. tupleResolveSignature also accepts object ids
+ * where objects are wanted; it copies the values into out, with the
+ * objects looked up, and the strings still belonging to the tuple. It
+ * doesn't take lists, so out needs as many values as the signature.
+ */
+bool tupleMatchSignature(const struct Tuple *, const char *signature);
+bool tupleResolveSignature(const struct Tuple *, const char *signature, struct Value *out);
 bool valueStaticCast(const struct Value *v, struct Value *out, enum Type t);
 
 struct Tuple *tupleBuild_(const struct Value *);
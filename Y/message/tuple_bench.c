@@ -0,0 +1,131 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Method argument matching benchmark
+ *
+ * Matches the arguments of typical method calls against their
+ * signatures, as the wrappers yclpp generates do on every call: first
+ * with tupleMatchType and tupleStaticCast, then with the compiled
+ * signatures, which don't need a new tuple when the types are right.
+ *
+ * Usage: tuple_bench [iterations]
+ */
+
+#include <Y/message/tuple.h>
+#include <Y/object/object.h>
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static struct Object *tuple_bench_object = (struct Object *)&tuple_bench_object;
+
+uint32_t
+objectGetID (const struct Object *o)
+{
+  return 1;
+}
+
+struct Object *
+objectFind (uint32_t oid)
+{
+  return oid == 1 ? tuple_bench_object : NULL;
+}
+
+struct TupleBenchCase
+{
+  const char *name;
+  struct Tuple args;
+  struct TupleType type;
+  const char *signature;
+};
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  int iterations = argc > 1 ? atoi (argv[1]) : 2000000;
+  char label[] = "label";
+  struct TupleBenchCase cases[] =
+    {
+      {"(uint32, uint32)",
+       {.count = 2, .list = (struct Value []){tb_uint32 (10), tb_uint32 (20)}},
+       {.count = 2, .list = (enum Type []){t_uint32, t_uint32, t_undef}},
+       "uu"},
+      {"(uint32, string)",
+       {.count = 2, .list = (struct Value []){tb_uint32 (10),
+                                              {.type = t_string, {.string = {.len = 5, .data = label}}}}},
+       {.count = 2, .list = (enum Type []){t_uint32, t_string, t_undef}},
+       "us"},
+      {"(object, uint32)",
+       {.count = 2, .list = (struct Value []){tb_uint32 (1), tb_uint32 (3)}},
+       {.count = 2, .list = (enum Type []){t_object, t_uint32, t_undef}},
+       "ou"},
+    };
+  int failures = 0;
+
+  printf ("%d iterations\n", iterations);
+  for (size_t c = 0; c < sizeof (cases) / sizeof (cases[0]); ++c)
+    {
+      struct TupleBenchCase *bc = &cases[c];
+      struct MethodTypes types =
+        {
+          .count = 1,
+          .list = (struct MethodType []){{.args = &bc->type}, {NULL, NULL, NULL}}
+        };
+
+      double start = now ();
+      for (int i = 0; i < iterations; ++i)
+        {
+          const struct MethodType *type = tupleMatchType (&bc->args, &types);
+          struct Tuple *cast = type ? tupleStaticCast (&bc->args, type->args) : NULL;
+          if (!cast)
+            failures++;
+          tupleDestroy (cast);
+        }
+      double cast = now () - start;
+
+      start = now ();
+      for (int i = 0; i < iterations; ++i)
+        {
+          struct Value values[2];
+          if (!tupleMatchSignature (&bc->args, bc->signature)
+              && !tupleResolveSignature (&bc->args, bc->signature, values))
+            failures++;
+        }
+      double compiled = now () - start;
+
+      printf ("  %-18s tupleMatchType+cast %7.1f ns   signature %7.1f ns\n",
+              bc->name, cast * 1e9 / iterations, compiled * 1e9 / iterations);
+    }
+
+  if (failures)
+    printf ("  (%d calls didn't match!)\n", failures);
+  return failures != 0;
+}
+
+/* arch-tag: 9d3c7e15-b2f8-4a61-8e04-c5a1f7d29b83
+ */
@@ -0,0 +1,129 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/message/tuple.h>
+#include <Y/object/object.h>
+#include <Y/util/yutil.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+const char *checkName;
+const char *checkModule;
+
+/* Objects 1 to 3 exist */
+static struct Object *tuple_check_objects[4] =
+  { NULL, (struct Object *)0x1000, (struct Object *)0x2000, (struct Object *)0x3000 };
+
+uint32_t
+objectGetID (const struct Object *o)
+{
+  for (uint32_t i = 1; i < 4; i++)
+    if (tuple_check_objects[i] == o)
+      return i;
+  return 0;
+}
+
+struct Object *
+objectFind (uint32_t oid)
+{
+  return oid < 4 ? tuple_check_objects[oid] : NULL;
+}
+
+static int
+tuple_check_signatures (void)
+{
+  checkModule = "signatures";
+
+  char hi[] = "hi";
+  struct Value values[] =
+    {
+      tb_uint32 (2),
+      {.type = t_string, {.string = {.len = 2, .data = hi}}},
+      tb_int32 (-1),
+      tb_object (tuple_check_objects[3]),
+    };
+  struct Tuple t = {.count = 4, .list = values};
+  struct Tuple empty = {.count = 0, .list = NULL};
+
+  /* Types have to be exactly those asked for */
+  CHECK_THAT ( tupleMatchSignature (&t, "usio") );
+  CHECK_THAT ( tupleMatchSignature (&t, "aaaa") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "isio") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "ouio") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "usiu") );
+
+  /* with exactly as many values, unless a list takes the rest */
+  CHECK_THAT ( !tupleMatchSignature (&t, "usi") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "usioo") );
+  CHECK_THAT ( tupleMatchSignature (&t, "us*") );
+  CHECK_THAT ( tupleMatchSignature (&t, "*") );
+  CHECK_THAT ( tupleMatchSignature (&t, "usio*") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "usioa*") );
+  CHECK_THAT ( tupleMatchSignature (&empty, "") );
+  CHECK_THAT ( tupleMatchSignature (&empty, "*") );
+  CHECK_THAT ( !tupleMatchSignature (&empty, "a") );
+  CHECK_THAT ( !tupleMatchSignature (&t, "") );
+
+  /* and no tuple has to be made into an empty one first */
+  CHECK_THAT ( !tupleMatchSignature (NULL, "") );
+
+  /* Anything that tupleMatchSignature takes needs no cast */
+  struct TupleType type = {.count = 4, .list = (enum Type []){t_uint32, t_string, t_int32, t_object}};
+  struct Tuple *cast = tupleStaticCast (&t, &type);
+  CHECK_THAT ( cast != NULL && cast->count == 4 );
+  for (uint32_t i = 0; i < 4; i++)
+    CHECK_THAT ( cast->list[i].type == values[i].type );
+  tupleDestroy (cast);
+
+  /* Object ids are looked up, and only where objects are wanted */
+  struct Value out[4];
+  CHECK_THAT ( tupleResolveSignature (&t, "osio", out) );
+  CHECK_THAT ( out[0].type == t_object && out[0].obj == tuple_check_objects[2] );
+  CHECK_THAT ( out[1].type == t_string && out[1].string.data == values[1].string.data );
+  CHECK_THAT ( out[3].type == t_object && out[3].obj == tuple_check_objects[3] );
+  CHECK_THAT ( values[0].type == t_uint32 );
+  CHECK_THAT ( tupleResolveSignature (&t, "usio", out) );
+  CHECK_THAT ( out[0].type == t_uint32 );
+  CHECK_THAT ( !tupleResolveSignature (&t, "osoo", out) );
+  CHECK_THAT ( !tupleResolveSignature (&t, "osi", out) );
+  CHECK_THAT ( !tupleResolveSignature (NULL, "o", out) );
+
+  /* and ids of objects which don't exist don't resolve */
+  values[0].uint32 = 7;
+  CHECK_THAT ( !tupleResolveSignature (&t, "osio", out) );
+  values[0].uint32 = 0;
+  CHECK_THAT ( !tupleResolveSignature (&t, "osio", out) );
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "Tuple";
+  failed = tuple_check_signatures () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 4b9e2d71-c6a3-48f5-9d17-e3a80f5b2c64
+ */
@@ -0,0 +1,295 @@
+/************************************************************************
+ *   Copyright (C) Andrew Suffield <asuffield@debian.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/message/wire.h>
+#include <Y/message/tuple.h>
+#include <Y/util/dbuffer.h>
+#include <Y/util/log.h>
+
+#include <string.h>
+#include <assert.h>
+#include <netinet/in.h>
+
+#include "parse_support.h"
+
+/* Header fields: seq, to, from, op, id, meta, value count */
+#define WIRE_HEADER_LENGTH (7 * sizeof(uint32_t))
+
+/* Small items are gathered here and copied into the dbuffer in
+ * chunks; anything bigger than half of it goes across directly
+ */
+#define WIRE_STAGE_SIZE 512
+
+struct WireWriter
+{
+  struct dbuffer *out;
+  char *p;
+  char stage[WIRE_STAGE_SIZE];
+};
+
+static inline void
+wireFlush (struct WireWriter *w)
+{
+  dbuffer_add(w->out, w->stage, w->p - w->stage);
+  w->p = w->stage;
+}
+
+static inline char *
+wireReserve (struct WireWriter *w, size_t len)
+{
+  if (w->p + len > w->stage + WIRE_STAGE_SIZE)
+    wireFlush(w);
+  return w->p;
+}
+
+static inline void
+wireAddUint32 (struct WireWriter *w, uint32_t v)
+{
+  uint32_t nv = htonl(v);
+  char *p = wireReserve(w, sizeof(nv));
+  ADD_SCALAR(p, nv);
+  w->p = p;
+}
+
+static void
+wireAddValue (struct WireWriter *w, const struct Value *v)
+{
+  size_t len = valueEncodedLength(v);
+  wireAddUint32(w, len);
+
+  if (v->type == t_string && len > WIRE_STAGE_SIZE / 2)
+    {
+      /* The type, then the string data straight from the value */
+      wireAddUint32(w, t_string);
+      wireFlush(w);
+      dbuffer_add(w->out, v->string.data, v->string.len);
+      return;
+    }
+
+  char *p = wireReserve(w, len);
+  w->p = valueEncode(v, p);
+}
+
+size_t
+messageEncodedLength (const struct Message *m)
+{
+  size_t len = WIRE_HEADER_LENGTH;
+  if (m->tuple)
+    for (uint32_t i = 0; i < m->tuple->count; i++)
+      len += sizeof(uint32_t) + valueEncodedLength(&m->tuple->list[i]);
+  return len;
+}
+
+char *
+messageEncode (const struct Message *m, char *p)
+{
+  uint32_t seq = htonl(m->seq);
+  ADD_SCALAR(p, seq);
+  uint32_t to = htonl(m->to);
+  ADD_SCALAR(p, to);
+  uint32_t from = htonl(m->from);
+  ADD_SCALAR(p, from);
+  uint32_t op = htonl(m->op);
+  ADD_SCALAR(p, op);
+  uint32_t id = htonl(m->id);
+  ADD_SCALAR(p, id);
+  uint32_t meta = htonl(m->meta);
+  ADD_SCALAR(p, meta);
+  uint32_t value_count = htonl(m->tuple ? m->tuple->count : 0);
+  ADD_SCALAR(p, value_count);
+  if (m->tuple)
+    for (uint32_t i = 0; i < m->tuple->count; i++)
+      {
+        char *start = p + sizeof(uint32_t);
+        char *end = valueEncode(&m->tuple->list[i], start);
+        uint32_t len = htonl(end - start);
+        ADD_SCALAR(p, len);
+        p = end;
+      }
+  return p;
+}
+
+void
+messageEncodeToDbuffer (const struct Message *m, struct dbuffer *out)
+{
+  struct WireWriter w;
+  w.out = out;
+  w.p = w.stage;
+
+  wireAddUint32(&w, messageEncodedLength(m));
+  wireAddUint32(&w, m->seq);
+  wireAddUint32(&w, m->to);
+  wireAddUint32(&w, m->from);
+  wireAddUint32(&w, m->op);
+  wireAddUint32(&w, m->id);
+  wireAddUint32(&w, m->meta);
+  wireAddUint32(&w, m->tuple ? m->tuple->count : 0);
+  if (m->tuple)
+    for (uint32_t i = 0; i < m->tuple->count; i++)
+      wireAddValue(&w, &m->tuple->list[i]);
+
+  wireFlush(&w);
+}
+
+struct dbuffer_shared *
+messageEncodeShared (const struct Message *m)
+{
+  size_t len = messageEncodedLength(m);
+  struct dbuffer_shared *packet = new_dbuffer_shared(sizeof(uint32_t) + len);
+  char *p = dbuffer_shared_data(packet);
+
+  uint32_t nlen = htonl(len);
+  ADD_SCALAR(p, nlen);
+  p = messageEncode(m, p);
+  assert(p == dbuffer_shared_data(packet) + dbuffer_shared_len(packet));
+  return packet;
+}
+
+void
+messageAddShared (struct dbuffer_shared *packet, uint32_t to, struct dbuffer *out)
+{
+  /* The length prefix and the header are copied, with the to field
+   * (after the prefix and seq) rewritten; the values are shared
+   */
+  char header[sizeof(uint32_t) + WIRE_HEADER_LENGTH];
+  memcpy(header, dbuffer_shared_data(packet), sizeof(header));
+  uint32_t nto = htonl(to);
+  memcpy(header + 2 * sizeof(uint32_t), &nto, sizeof(nto));
+
+  dbuffer_add(out, header, sizeof(header));
+  dbuffer_add_shared(out, packet, sizeof(header), dbuffer_shared_len(packet) - sizeof(header));
+}
+
+static bool
+wireDecodeValue (char *p, size_t l, struct Value *v)
+{
+  uint32_t ntype, type;
+  if (!GET_SCALAR(p, l, ntype))
+    return false;
+
+  type = ntohl(ntype);
+  switch(type)
+    {
+    case t_string:
+      v->string.len = l;
+      v->string.data = p;
+      v->type = t_string;
+      return true;
+    case t_uint32:
+      {
+        uint32_t uint32;
+        if (!GET_SCALAR(p, l, uint32) || l != 0)
+          return false;
+        v->uint32 = ntohl(uint32);
+        v->type = t_uint32;
+        return true;
+      }
+    case t_int32:
+      {
+        int32_t int32;
+        if (!GET_SCALAR(p, l, int32) || l != 0)
+          return false;
+        v->int32 = ntohl(int32);
+        v->type = t_int32;
+        return true;
+      }
+    default:
+      return false;
+    }
+}
+
+bool
+messageDecode (char *p, size_t l, struct Message *m)
+{
+  uint32_t header[7];
+  for (int i = 0; i < 7; i++)
+    {
+      if (!GET_SCALAR(p, l, header[i]))
+        {
+          Y_TRACE ("Failed to parse message (too short for header)");
+          return false;
+        }
+      header[i] = ntohl(header[i]);
+    }
+
+  /* Every value takes at least a length and a type, so don't let a
+   * bogus count make us allocate more than the packet could hold
+   */
+  uint32_t value_count = header[6];
+  if (value_count > l / (2 * sizeof(uint32_t)))
+    {
+      Y_TRACE ("Failed to parse message (%lu values can't fit in %lu bytes)",
+               (long unsigned int)value_count, (long unsigned int)l);
+      return false;
+    }
+
+  struct Tuple *t = tupleCreate(value_count);
+  t->borrowed = true;
+
+  for (uint32_t i = 0; i < value_count; i++)
+    {
+      uint32_t nmlen;
+      if (!GET_SCALAR(p, l, nmlen))
+        {
+          Y_TRACE ("Failed to parse message (too short for nmlen, i == %lu)", (long unsigned int)i);
+          tupleDestroy(t);
+          return false;
+        }
+      size_t mlen = ntohl(nmlen);
+      char *value = p;
+      if (!SKIP_DATA(p, l, mlen))
+        {
+          Y_TRACE ("Failed to parse message (too short for member data, i == %lu)", (long unsigned int)i);
+          tupleDestroy(t);
+          return false;
+        }
+      if (!wireDecodeValue(value, mlen, &t->list[i]))
+        {
+          Y_TRACE ("Failed to parse message (failed to parse value, i == %lu)", (long unsigned int)i);
+          tupleDestroy(t);
+          return false;
+        }
+    }
+
+  if (l != 0)
+    {
+      Y_TRACE ("Failed to parse message (%lu bytes left over at end)", (long unsigned int)l);
+      tupleDestroy(t);
+      return false;
+    }
+
+  /* Only now that every length has been read can the byte following
+   * each string be overwritten to terminate it
+   */
+  for (uint32_t i = 0; i < value_count; i++)
+    if (t->list[i].type == t_string)
+      t->list[i].string.data[t->list[i].string.len] = '\0';
+
+  m->seq = header[0];
+  m->to = header[1];
+  m->from = header[2];
+  m->op = header[3];
+  m->id = header[4];
+  m->meta = header[5];
+  tupleDestroy(m->tuple);
+  m->tuple = t;
+  return true;
+}
+
+/* arch-tag: e0c5a7f1-3b29-4d8e-b614-92f8d0a3c7e5
+ */
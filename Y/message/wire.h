@@ -0,0 +1,67 @@
+/************************************************************************
+ *   Copyright (C) Andrew Suffield <asuffield@debian.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_MESSAGE_WIRE_H
+#define Y_MESSAGE_WIRE_H
+
+#include <Y/message/message.h>
+#include <Y/util/dbuffer.h>
+
+#include <sys/types.h>
+
+/* The wire form of a message is a 32-bit length prefix followed by
+ * the header fields and the values, each with its own length prefix,
+ * all in network byte order.
+ */
+
+/* Length of the message body, not counting the length prefix */
+size_t messageEncodedLength (const struct Message *m);
+
+/* Write the body at p, which must have room for
+ * messageEncodedLength() bytes, and return the end
+ */
+char  *messageEncode (const struct Message *m, char *p);
+
+/* Append the length prefix and body straight onto a dbuffer, without
+ * any intermediate allocation
+ */
+void   messageEncodeToDbuffer (const struct Message *m, struct dbuffer *out);
+
+/* Encode the length prefix and body once, for sending the same
+ * message to several clients with messageAddShared()
+ */
+struct dbuffer_shared *messageEncodeShared (const struct Message *m);
+
+/* Append a message encoded by messageEncodeShared() to a dbuffer,
+ * addressed to the given client; only the header is copied
+ */
+void   messageAddShared (struct dbuffer_shared *packet, uint32_t to, struct dbuffer *out);
+
+/* Decode a message body of len bytes in place into m. String values
+ * point straight into the buffer rather than being copied (the tuple
+ * is marked as borrowed), so the buffer must outlive the message;
+ * p[len] must be writable, since it may be used to NUL terminate the
+ * last string. Returns false, leaving m alone, if the body is
+ * malformed.
+ */
+bool   messageDecode (char *p, size_t len, struct Message *m);
+
+#endif
+
+/* arch-tag: 4b7e9c20-a1d5-4f63-9e82-6c0b3d5f71a8
+ */
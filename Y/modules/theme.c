@@ -276,6 +276,26 @@ void themeWindowResize (struct Window *w)
     }
 }
 
+/* Only the theme which paints the window knows what it paints, so a
+ * theme further down the stack is never asked
+ */
+void
+themeWindowGetOpaqueRegion (struct Window *w, struct Region *region)
+{
+  struct Theme *current = topTheme;
+
+  while (current != NULL)
+    {
+      if (current -> windowPaint != NULL)
+        {
+          if (current -> windowGetOpaqueRegion != NULL)
+            current -> windowGetOpaqueRegion (w, region);
+          return;
+        }
+      current = current -> nextTheme;
+    }
+}
+
 
 /* arch-tag: 95fe2cbe-4eb4-40f1-91ac-077f990e1e5a
  */
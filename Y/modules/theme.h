@@ -42,6 +42,7 @@ int  themeWindowPointerButton  (struct Window *, int32_t, int32_t, uint32_t, boo
 void themeWindowReconfigure    (struct Window *, int32_t *, int32_t *, int32_t *, int32_t *,
                                 int32_t *, int32_t *);
 void themeWindowResize         (struct Window *);
+void themeWindowGetOpaqueRegion (struct Window *, struct Region *);
 
 /*
  * New theme elements
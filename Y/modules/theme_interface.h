@@ -82,6 +82,11 @@ struct Theme
   void (*windowReconfigure)   (struct Window *, int32_t *, int32_t *, int32_t *, int32_t *,
                                int32_t *, int32_t *);
   void (*windowResize)        (struct Window *);
+  /* adds to the region the part of the window (in window co-ordinates)
+   * which windowPaint is sure to cover with opaque pixels, so whatever
+   * is underneath needn't be drawn
+   */
+  void (*windowGetOpaqueRegion) (struct Window *, struct Region *);
 
   /*
    * Here are the new theme elements
@@ -25,6 +25,7 @@
 #include <Y/screen/renderer.h>
 #include <Y/util/llist.h>
 #include <Y/util/rectangle.h>
+#include <Y/util/region.h>
 #include <stdint.h>
 
 struct VideoResolution
@@ -47,6 +48,9 @@ struct VideoDriver
 
   void (*beginUpdates)       (struct VideoDriver *);
   void (*endUpdates)         (struct VideoDriver *);
+  /* optional; called after beginUpdates with everything the update
+   * will draw, so endUpdates can present just that */
+  void (*setUpdateRegion)    (struct VideoDriver *, const struct Region *);
 
   void (*drawPixel)          (struct VideoDriver *, uint32_t, int, int);
   void (*drawRectangle)      (struct VideoDriver *, uint32_t, int, int, int, int);
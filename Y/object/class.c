@@ -21,6 +21,7 @@
 #include <Y/object/object_p.h>
 #include <Y/util/yutil.h>
 #include <Y/util/index.h>
+#include <Y/util/yhash.h>
 #include <string.h>
 #include <assert.h>
 
@@ -29,6 +30,63 @@ static struct Index *classIDIndex = NULL;
 static int classNextID = 1;
 static bool preinitDone = false;
 
+/* Method and property names are interned to small ids, handed out
+ * densely from 1, so that each class can keep its methods and
+ * properties, inherited ones included, in arrays indexed by id. A
+ * table is rebuilt the first time it is used after any class has
+ * gained a method or property, which only happens while classes and
+ * modules are being set up.
+ */
+struct NameTable
+{
+  YHashTable *table;
+  char **names;
+  uint32_t count;
+  uint32_t size;
+};
+
+static struct NameTable methodNames = { NULL, NULL, 1, 0 };
+static struct NameTable propertyNames = { NULL, NULL, 1, 0 };
+static uint32_t methodGeneration = 1;
+static uint32_t propertyGeneration = 1;
+
+struct MethodTable
+{
+  uint32_t generation;
+  uint32_t size;
+  const struct Method **list;
+};
+
+/* Each property a class has gets a slot in its objects' arrays of
+ * values: its own properties first, in name order, then whatever each
+ * superclass adds. Objects may already exist when a table is rebuilt,
+ * because a module has given a superclass another property, so a
+ * rebuild keeps every slot it had and puts new properties after them;
+ * layouts only ever grow */
+struct PropertySlot
+{
+  const struct Property *p;
+  int slot;
+};
+
+struct PropertyTable
+{
+  uint32_t generation;
+  uint32_t size;
+  uint32_t slots;
+  struct PropertySlot *list;
+};
+
+/* The flattened tables are caches, filled in the first time a class
+ * is searched. They hang off the class rather than sit in it, so that
+ * looking in a const class can still fill them */
+struct ClassTables
+{
+  struct MethodTable classTable;
+  struct MethodTable instanceTable;
+  struct PropertyTable propertyTable;
+};
+
 struct Class
 {
   char *name;
@@ -39,12 +97,14 @@ struct Class
   struct Index *classMethods;
   struct Index *instanceMethods;
   struct Index *properties;
+  struct ClassTables *tables;
   VTable *vtable; //virtual table 
 };
 
 struct Method
 {
   char *name;
+  uint32_t id;
   /* Precisely one of these fields will be NULL and the other will be used */
   ClassMethod *classFunc;
   InstanceMethod *instanceFunc;
@@ -53,8 +113,10 @@ struct Method
 struct Property
 {
   char *name;
+  uint32_t id;
   enum Type type;
   PropertyHook *hook;
+  const struct Class *owner;
 };
 
 
@@ -170,9 +232,229 @@ classDestructorFunction (void *obj_v)
   indexDestroy(c->classMethods, methodDestructorFunction);
   indexDestroy(c->instanceMethods, methodDestructorFunction);
   indexDestroy(c->properties, propertyDestructorFunction);
+  yfree(c->tables->classTable.list);
+  yfree(c->tables->instanceTable.list);
+  yfree(c->tables->propertyTable.list);
+  yfree(c->tables);
   yfree(c);
 }
 
+static uint32_t
+nameTableFind (const struct NameTable *names, const char *name)
+{
+  if (names->table == NULL)
+    return 0;
+  void *id = y_hash_table_lookup (names->table, name);
+  return (uintptr_t)id;
+}
+
+static const char *
+nameTableName (const struct NameTable *names, uint32_t id)
+{
+  if (id == 0 || id >= names->count)
+    return NULL;
+  return names->names[id];
+}
+
+static uint32_t
+nameTableIntern (struct NameTable *names, const char *name)
+{
+  uint32_t id = nameTableFind (names, name);
+  if (id != 0)
+    return id;
+
+  if (names->table == NULL)
+    names->table = y_hash_table_new (y_str_hash, y_str_equal);
+  if (names->count >= names->size)
+    {
+      uint32_t newSize = MAX(64, names->size * 2);
+      char **newNames = ycalloc (newSize, sizeof (names->names[0]));
+      if (names->names != NULL)
+        memcpy (newNames, names->names, names->size * sizeof (names->names[0]));
+      yfree (names->names);
+      names->names = newNames;
+      names->size = newSize;
+    }
+  id = names->count++;
+  names->names[id] = ystrdup (name);
+  y_hash_table_insert (names->table, names->names[id], (ypointer)(uintptr_t)id);
+  return id;
+}
+
+static void
+nameTableClear (struct NameTable *names)
+{
+  if (names->table != NULL)
+    y_hash_table_destroy (names->table);
+  for (uint32_t id = 1; id < names->count; id++)
+    yfree (names->names[id]);
+  yfree (names->names);
+  names->table = NULL;
+  names->names = NULL;
+  names->count = 1;
+  names->size = 0;
+}
+
+uint32_t
+classMethodID (const char *name)
+{
+  return nameTableFind (&methodNames, name);
+}
+
+const char *
+classMethodName (uint32_t id)
+{
+  return nameTableName (&methodNames, id);
+}
+
+uint32_t
+classPropertyID (const char *name)
+{
+  return nameTableFind (&propertyNames, name);
+}
+
+const char *
+classPropertyName (uint32_t id)
+{
+  return nameTableName (&propertyNames, id);
+}
+
+static void
+methodTableMeasure (const void *obj_v, void *size_v)
+{
+  const struct Method *m = obj_v;
+  uint32_t *size = size_v;
+  *size = MAX(*size, m->id + 1);
+}
+
+static void
+methodTableFill (const void *obj_v, void *table_v)
+{
+  const struct Method *m = obj_v;
+  struct MethodTable *table = table_v;
+  table->list[m->id] = m;
+}
+
+/*
+ * Flattens a class's methods and everything it inherits into one
+ * table. The class's own methods win, then each superclass's table in
+ * turn fills whatever is still empty, which is the order the old
+ * recursive search looked in
+ */
+static const struct MethodTable *
+classMethodTable (const struct Class *c, bool instance)
+{
+  struct MethodTable *table = instance ? &c->tables->instanceTable : &c->tables->classTable;
+  struct Index *own = instance ? c->instanceMethods : c->classMethods;
+  if (table->generation == methodGeneration)
+    return table;
+
+  uint32_t size = 0;
+  indexIterate (own, &size, methodTableMeasure);
+  for (uint32_t s = 0; s < c->superCount && c->superList; s++)
+    size = MAX(size, classMethodTable (c->superList[s], instance)->size);
+
+  yfree (table->list);
+  table->list = ycalloc (size ? size : 1, sizeof (table->list[0]));
+  table->size = size;
+  indexIterate (own, table, methodTableFill);
+  for (uint32_t s = 0; s < c->superCount && c->superList; s++)
+    {
+      /* already rebuilt above */
+      const struct MethodTable *super = classMethodTable (c->superList[s], instance);
+      for (uint32_t id = 1; id < super->size; id++)
+        if (table->list[id] == NULL)
+          table->list[id] = super->list[id];
+    }
+  table->generation = methodGeneration;
+  return table;
+}
+
+static const struct Method *
+classFindMethodByID (const struct Class *c, uint32_t id, bool instance)
+{
+  const struct MethodTable *table = classMethodTable (c, instance);
+  if (id >= table->size)
+    return NULL;
+  return table->list[id];
+}
+
+static void
+propertyTableMeasure (const void *obj_v, void *size_v)
+{
+  const struct Property *p = obj_v;
+  uint32_t *size = size_v;
+  *size = MAX(*size, p->id + 1);
+}
+
+struct PropertyTableBuild
+{
+  struct PropertyTable *table;
+  /* the table before this rebuild */
+  struct PropertySlot *old;
+  uint32_t oldSize;
+};
+
+static void
+propertyTableAssign (struct PropertyTableBuild *build, uint32_t id, const struct Property *p)
+{
+  struct PropertyTable *table = build->table;
+  table->list[id].p = p;
+  if (id < build->oldSize && build->old[id].p != NULL)
+    table->list[id].slot = build->old[id].slot;
+  else
+    table->list[id].slot = table->slots++;
+}
+
+static void
+propertyTableFill (const void *obj_v, void *build_v)
+{
+  const struct Property *p = obj_v;
+  propertyTableAssign (build_v, p->id, p);
+}
+
+/*
+ * As classMethodTable, but each property also gets a slot: the one it
+ * had before, or else the next free one
+ */
+static const struct PropertyTable *
+classPropertyTable (const struct Class *c)
+{
+  struct PropertyTable *table = &c->tables->propertyTable;
+  if (table->generation == propertyGeneration)
+    return table;
+
+  uint32_t size = 0;
+  indexIterate (c->properties, &size, propertyTableMeasure);
+  for (uint32_t s = 0; s < c->superCount && c->superList; s++)
+    size = MAX(size, classPropertyTable (c->superList[s])->size);
+
+  /* properties are never taken away, so the table never shrinks */
+  struct PropertyTableBuild build = { table, table->list, table->size };
+  table->list = ycalloc (size ? size : 1, sizeof (table->list[0]));
+  table->size = size;
+  indexIterate (c->properties, &build, propertyTableFill);
+  for (uint32_t s = 0; s < c->superCount && c->superList; s++)
+    {
+      const struct PropertyTable *super = classPropertyTable (c->superList[s]);
+      for (uint32_t id = 1; id < super->size; id++)
+        if (table->list[id].p == NULL && super->list[id].p != NULL)
+          propertyTableAssign (&build, id, super->list[id].p);
+    }
+  yfree (build.old);
+  table->generation = propertyGeneration;
+  return table;
+}
+
+static const struct PropertySlot *
+classFindPropertyByID (const struct Class *c, uint32_t id)
+{
+  const struct PropertyTable *table = classPropertyTable (c);
+  if (id >= table->size || table->list[id].p == NULL)
+    return NULL;
+  return &table->list[id];
+}
+
 static void
 classPreInitialise(void)
 {
@@ -197,6 +479,9 @@ classSetup(struct Class *c)
       /* This will have to be revisited later */
       assert(c->superList[i]);
     }
+  /* the tables built before now didn't know the superclasses */
+  methodGeneration++;
+  propertyGeneration++;
 }
 
 void
@@ -222,6 +507,8 @@ classFinalise (void)
 {
   indexDestroy (classNameIndex, NULL);
   indexDestroy (classIDIndex, classDestructorFunction);
+  nameTableClear (&methodNames);
+  nameTableClear (&propertyNames);
 }
 
 const char *
@@ -236,63 +523,54 @@ classGetID (const struct Class *c)
   return c -> id;
 }
 
-static int
-classCompareMethod (const void *key_v, const void *memb_v)
-{
-  const char *key = key_v;
-  const struct Method *memb = memb_v;
-  return strcmp (key, memb->name);
-}
-
-static const struct Method *
-classFindClassMethod (const struct Class *c, const char *method)
+struct Tuple *
+classInvokeClassMethodByID (const struct Class *c, struct Client *from, uint32_t method,
+                            const struct Tuple *args)
 {
-  const struct Method *m = indexFind(c->classMethods, method);
+  const struct Method *m = classFindMethodByID(c, method, false);
 
   if (m)
-    return m;
-
-  for (uint32_t i = 0; i < c->superCount; i++)
-    {
-      m = classFindClassMethod(c->superList[i], method);
-      if (m)
-        return m;
-    }
-
-  return NULL;
+    return m->classFunc(from, args);
+  else if (classMethodName(method))
+    return tupleBuildError(tb_string("Class method not found"), tb_string(classGetName(c)),
+                           tb_string(classMethodName(method)));
+  else
+    return tupleBuildError(tb_string("Class method not found"), tb_string(classGetName(c)),
+                           tb_uint32(method));
 }
 
 struct Tuple *
 classInvokeClassMethod (const struct Class *c, struct Client *from, const char *method,
                         const struct Tuple *args)
 {
-  const struct Method *m = classFindClassMethod(c, method);
+  uint32_t id = classMethodID(method);
 
-  if (m)
-    return m->classFunc(from, args);
+  if (id)
+    return classInvokeClassMethodByID(c, from, id, args);
   else
     return tupleBuildError(tb_string("Class method not found"), tb_string(classGetName(c)), tb_string(method));
 }
 
 /*
- * Finds an instance method by name
+ * Invokes an instance method by its interned id
  */
-static const struct Method *
-classFindInstanceMethod (const struct Class *c, const char *method)
+struct Tuple *
+classInvokeInstanceMethodByID (struct Object *o, struct Client *from, uint32_t method,
+                               const struct Tuple *args)
 {
-  const struct Method *m = indexFind(c->instanceMethods, method);
-
+  const struct Method *m = classFindMethodByID(objectClass(o), method, true);
   if (m)
-    return m;
-
-  for (uint32_t i = 0; i < c->superCount; i++)
-    {
-      m = classFindInstanceMethod(c->superList[i], method);
-      if (m)
-        return m;
-    }
-
-  return NULL;
+    return m->instanceFunc(o, from, args);
+  else if (classMethodName(method))
+    return tupleBuildError(tb_string("Instance method not found"),
+                           tb_string(classGetName(objectClass(o))),
+                           tb_string(classMethodName(method)),
+                           tb_uint32(objectGetID(o)));
+  else
+    return tupleBuildError(tb_string("Instance method not found"),
+                           tb_string(classGetName(objectClass(o))),
+                           tb_uint32(method),
+                           tb_uint32(objectGetID(o)));
 }
 
 /*
@@ -302,9 +580,9 @@ struct Tuple *
 classInvokeInstanceMethod (struct Object *o, struct Client *from, const char *method,
                            const struct Tuple *args)
 {
-  const struct Method *m = classFindInstanceMethod(objectClass(o), method);
-  if (m)
-    return m->instanceFunc(o, from, args);
+  uint32_t id = classMethodID(method);
+  if (id)
+    return classInvokeInstanceMethodByID(o, from, id, args);
   else
     return tupleBuildError(tb_string("Instance method not found"),
                            tb_string(classGetName(objectClass(o))),
@@ -371,6 +649,7 @@ classCreate(const char *name, uint32_t superc, const char **superv)
   c->classMethods = indexCreate (methodKeyFunction, methodComparisonFunction);
   c->instanceMethods = indexCreate (methodKeyFunction, methodComparisonFunction);
   c->properties = indexCreate(propertyKeyFunction, propertyComparisonFunction);
+  c->tables = ycalloc(1, sizeof(*c->tables));
   c->id = classNextID++;
   indexAdd (classNameIndex, c);
   indexAdd (classIDIndex, c);
@@ -386,8 +665,11 @@ classAddInstanceMethod(struct Class *class, const char *name, InstanceMethod *me
   assert(method);
   struct Method *m = ymalloc(sizeof(*m));
   m->name = ystrdup(name);
+  m->id = nameTableIntern(&methodNames, name);
+  m->classFunc = NULL;
   m->instanceFunc = method;
   indexAdd (class->instanceMethods, m);
+  methodGeneration++;
 }
 
 void
@@ -398,11 +680,14 @@ classAddClassMethod(struct Class *class, const char *name, ClassMethod *method)
   assert(method);
   struct Method *m = ymalloc(sizeof(*m));
   m->name = ystrdup(name);
+  m->id = nameTableIntern(&methodNames, name);
   m->classFunc = method;
+  m->instanceFunc = NULL;
   indexAdd (class->classMethods, m);
+  methodGeneration++;
 }
 
-void
+uint32_t
 classAddProperty(struct Class *class, const char *name, enum Type type, PropertyHook *hook)
 {
   assert(class);
@@ -410,9 +695,13 @@ classAddProperty(struct Class *class, const char *name, enum Type type, Property
 
   struct Property *p = ymalloc(sizeof(*p));
   p->name = ystrdup(name);
+  p->id = nameTableIntern(&propertyNames, name);
   p->type = type;
   p->hook = hook;
+  p->owner = class;
   indexAdd (class->properties, p);
+  propertyGeneration++;
+  return p->id;
 }
 
 /*
@@ -425,21 +714,29 @@ classAddProperty(struct Class *class, const char *name, enum Type type, Property
 const struct Class *
 classGetPropertyClass (const struct Class *base, const char *name, enum Type *type)
 {
-  *type = classGetProperty (base, name);
-  const struct Class *c;
-    
-  /* this type didn't come back as undef so the property belongs to this class */
-  if (*type != t_undef)
-    return base;
-
-  /* ...else check the super classes */
-  for (uint32_t i = 0; i < base->superCount; i++)
+  const struct PropertySlot *s = classFindPropertyByID (base, classPropertyID (name));
+  if (!s)
     {
-      c = classGetPropertyClass(base->superList[i], name, type);
-      if (c) 
-        return c;
+      *type = t_undef;
+      return NULL;
     }
-  return NULL;
+  *type = s->p->type;
+  return s->p->owner;
+}
+
+int
+classPropertySlot (const struct Class *c, uint32_t property, enum Type *type)
+{
+  const struct PropertySlot *s = classFindPropertyByID (c, property);
+  if (type)
+    *type = s ? s->p->type : t_undef;
+  return s ? s->slot : -1;
+}
+
+uint32_t
+classPropertySlotCount (const struct Class *c)
+{
+  return classPropertyTable (c)->slots;
 }
 
 enum Type
@@ -477,9 +774,19 @@ classCallClassPropertyHook (const struct Class *c,
 void
 classCallPropertyHook(struct Object *o, const char *name, const struct Value *old, const struct Value *new)
 {
-  enum Type type;
-  const struct Class *c = classGetPropertyClass (objectClass(o), name, &type);
-  classCallClassPropertyHook (c, o, name, old, new);
+  classCallPropertyHookByID (o, classPropertyID (name), old, new);
+}
+
+/*
+ * Calls the hook of whichever class the object gets the property from
+ */
+void
+classCallPropertyHookByID (struct Object *o, uint32_t property,
+                           const struct Value *old, const struct Value *new)
+{
+  const struct PropertySlot *s = classFindPropertyByID (objectClass(o), property);
+  if (s && s->p->hook)
+    (*s->p->hook)(o, old, new);
 }
 
 /* arch-tag: 8c8cb7e2-7d3d-4178-82cc-ab6db357bc36
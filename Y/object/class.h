@@ -51,7 +51,8 @@ void classAddClassMethod(struct Class *class, const char *name, ClassMethod *met
 
 typedef void PropertyHook(struct Object *obj, const struct Value *old, const struct Value *new);
 
-void classAddProperty(struct Class *class, const char *name, enum Type, PropertyHook *);
+/* returns the property's interned id */
+uint32_t classAddProperty(struct Class *class, const char *name, enum Type, PropertyHook *);
 
 const struct Class *classGetPropertyClass (const struct Class *base, const char *name, enum Type *type);//added by DN
 
@@ -62,6 +63,17 @@ void classCallClassPropertyHook (const struct Class *c, struct Object *o,
 				const char *name, const struct Value *old, 
 				const struct Value *new); //add by DN
 
+/* Property names are interned like method names. Each property a
+ * class has, inherited ones included, has a slot in the array of
+ * values its objects keep; classPropertySlot returns -1 (and t_undef)
+ * if the class has no such property */
+uint32_t    classPropertyID   (const char *name);
+const char *classPropertyName (uint32_t id);
+int         classPropertySlot (const struct Class *, uint32_t property, enum Type *type);
+uint32_t    classPropertySlotCount (const struct Class *);
+void classCallPropertyHookByID (struct Object *o, uint32_t property,
+                                const struct Value *old, const struct Value *new);
+
 const char *classGetName      (const struct Class *);
 int         classGetID        (const struct Class *);
 
@@ -70,6 +82,16 @@ struct Tuple *classInvokeClassMethod (const struct Class *, struct Client *,
 struct Tuple *classInvokeInstanceMethod (struct Object *, struct Client *,
                                          const char *method, const struct Tuple *);
 
+/* Method names are interned to ids shared by all classes; 0 means no
+ * class has a method of that name */
+uint32_t    classMethodID     (const char *name);
+const char *classMethodName   (uint32_t id);
+
+struct Tuple *classInvokeClassMethodByID (const struct Class *, struct Client *,
+                                          uint32_t method, const struct Tuple *);
+struct Tuple *classInvokeInstanceMethodByID (struct Object *, struct Client *,
+                                             uint32_t method, const struct Tuple *);
+
 struct Class *classFindByName (const char *name);
 struct Class *classFindByID   (int id);
 
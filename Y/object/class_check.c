@@ -0,0 +1,279 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/object/class.h>
+#include <Y/message/tuple.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+const char *checkName;
+const char *checkModule;
+
+/* Just enough of an object to call methods on */
+struct Object
+{
+  struct Class *c;
+};
+
+const struct Class *
+objectClass (const struct Object *o)
+{
+  return o -> c;
+}
+
+uint32_t
+objectGetID (const struct Object *o)
+{
+  return 0;
+}
+
+struct Object *
+objectFind (uint32_t oid)
+{
+  return NULL;
+}
+
+static const char *class_check_called;
+
+#define CLASS_CHECK_METHOD(N)                                           \
+  static struct Tuple *                                                 \
+  class_check_ ## N (struct Object *o, struct Client *from,             \
+                     const struct Tuple *args)                          \
+  {                                                                     \
+    class_check_called = #N;                                            \
+    return NULL;                                                        \
+  }
+
+CLASS_CHECK_METHOD(objectA)
+CLASS_CHECK_METHOD(objectB)
+CLASS_CHECK_METHOD(widgetB)
+CLASS_CHECK_METHOD(widgetC)
+CLASS_CHECK_METHOD(mixinC)
+CLASS_CHECK_METHOD(mixinD)
+CLASS_CHECK_METHOD(buttonE)
+CLASS_CHECK_METHOD(objectLate)
+
+static const char *class_check_hooked;
+
+#define CLASS_CHECK_HOOK(N)                                             \
+  static void                                                           \
+  class_check_ ## N ## Hook (struct Object *o, const struct Value *old, \
+                             const struct Value *new)                   \
+  {                                                                     \
+    class_check_hooked = #N;                                            \
+  }
+
+CLASS_CHECK_HOOK(objectSize)
+CLASS_CHECK_HOOK(widgetSize)
+
+/* whether the slots of a class's properties are distinct and dense */
+static bool
+class_check_slots (struct Class *c, const char **names, int count)
+{
+  bool seen[count];
+  memset (seen, 0, sizeof (seen));
+  if (classPropertySlotCount (c) != (uint32_t)count)
+    return false;
+  for (int i = 0; i < count; i++)
+    {
+      int slot = classPropertySlot (c, classPropertyID (names[i]), NULL);
+      if (slot < 0 || slot >= count || seen[slot])
+        return false;
+      seen[slot] = true;
+    }
+  return true;
+}
+
+static struct Tuple *
+class_check_create (struct Client *from, const struct Tuple *args)
+{
+  class_check_called = "create";
+  return NULL;
+}
+
+/* which method a name reaches on an object of class c, if any */
+static const char *
+class_check_call (struct Class *c, const char *name)
+{
+  struct Object o = { c };
+  class_check_called = NULL;
+  struct Tuple *t = classInvokeInstanceMethod (&o, NULL, name, NULL);
+  if (t != NULL)
+    {
+      CHECK_THAT ( t->error );
+      tupleDestroy (t);
+      return NULL;
+    }
+
+  /* by id, it must get to the same place */
+  const char *byName = class_check_called;
+  class_check_called = NULL;
+  t = classInvokeInstanceMethodByID (&o, NULL, classMethodID (name), NULL);
+  CHECK_THAT ( t == NULL );
+  CHECK_THAT ( class_check_called == byName );
+  return byName;
+}
+
+static int
+class_check_functionality (void)
+{
+  checkModule = "functionality";
+
+  /* Classes register themselves before classInitialise, in any order */
+  const char *objectSupers[] = {};
+  const char *widgetSupers[] = {"Object"};
+  const char *buttonSupers[] = {"Widget", "Mixin"};
+  struct Class *button = classCreate ("Button", 2, buttonSupers);
+  struct Class *object = classCreate ("Object", 0, objectSupers);
+  struct Class *widget = classCreate ("Widget", 1, widgetSupers);
+  struct Class *mixin = classCreate ("Mixin", 0, objectSupers);
+
+  classAddInstanceMethod (object, "a", class_check_objectA);
+  classAddInstanceMethod (object, "b", class_check_objectB);
+  classAddInstanceMethod (widget, "b", class_check_widgetB);
+  classAddInstanceMethod (widget, "c", class_check_widgetC);
+  classAddInstanceMethod (mixin, "c", class_check_mixinC);
+  classAddInstanceMethod (mixin, "d", class_check_mixinD);
+  classAddInstanceMethod (button, "e", class_check_buttonE);
+  classAddClassMethod (widget, "Widget", class_check_create);
+  uint32_t size = classAddProperty (object, "size", t_uint32, class_check_objectSizeHook);
+  classAddProperty (object, "name", t_string, NULL);
+  CHECK_THAT ( classAddProperty (widget, "size", t_int32, class_check_widgetSizeHook) == size );
+  classAddProperty (widget, "text", t_string, NULL);
+  classAddProperty (mixin, "pressed", t_uint32, NULL);
+  classInitialise ();
+
+  /* A class's own methods first, then each superclass in turn */
+  CHECK_THAT ( strcmp (class_check_call (button, "e"), "buttonE") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (button, "b"), "widgetB") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (button, "c"), "widgetC") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (button, "d"), "mixinD") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (button, "a"), "objectA") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (widget, "b"), "widgetB") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (object, "b"), "objectB") == 0 );
+  CHECK_THAT ( class_check_call (object, "c") == NULL );
+  CHECK_THAT ( class_check_call (button, "nonexistent") == NULL );
+
+  /* Names are shared between classes */
+  CHECK_THAT ( classMethodID ("c") != 0 );
+  CHECK_THAT ( classMethodID ("nonexistent") == 0 );
+  CHECK_THAT ( strcmp (classMethodName (classMethodID ("c")), "c") == 0 );
+  CHECK_THAT ( classMethodName (0) == NULL );
+  CHECK_THAT ( classMethodName (100000) == NULL );
+
+  /* Unknown ids are errors, not crashes */
+  struct Object o = { button };
+  struct Tuple *t = classInvokeInstanceMethodByID (&o, NULL, 100000, NULL);
+  CHECK_THAT ( t != NULL && t->error );
+  tupleDestroy (t);
+
+  /* Class methods are kept apart from instance methods */
+  class_check_called = NULL;
+  t = classInvokeClassMethod (button, NULL, "Widget", NULL);
+  CHECK_THAT ( t == NULL && strcmp (class_check_called, "create") == 0 );
+  t = classInvokeClassMethod (button, NULL, "b", NULL);
+  CHECK_THAT ( t != NULL && t->error );
+  tupleDestroy (t);
+  CHECK_THAT ( class_check_call (button, "Widget") == NULL );
+
+  /* Properties get a slot each, inherited ones included, and the
+   * class's own declaration of one wins */
+  const char *buttonProperties[] = {"size", "name", "text", "pressed"};
+  const char *objectProperties[] = {"size", "name"};
+  CHECK_THAT ( class_check_slots (button, buttonProperties, 4) );
+  CHECK_THAT ( class_check_slots (object, objectProperties, 2) );
+  CHECK_THAT ( class_check_slots (mixin, buttonProperties + 3, 1) );
+  enum Type type;
+  CHECK_THAT ( classGetPropertyClass (button, "size", &type) == widget && type == t_int32 );
+  CHECK_THAT ( classGetPropertyClass (button, "name", &type) == object && type == t_string );
+  CHECK_THAT ( classGetPropertyClass (button, "pressed", &type) == mixin && type == t_uint32 );
+  CHECK_THAT ( classGetPropertyClass (object, "text", &type) == NULL && type == t_undef );
+  CHECK_THAT ( classGetPropertyClass (button, "nonexistent", &type) == NULL && type == t_undef );
+  CHECK_THAT ( classPropertySlot (object, classPropertyID ("text"), &type) == -1 && type == t_undef );
+  CHECK_THAT ( classPropertySlot (object, 100000, NULL) == -1 );
+  CHECK_THAT ( classPropertyID ("nonexistent") == 0 );
+  CHECK_THAT ( strcmp (classPropertyName (size), "size") == 0 );
+  CHECK_THAT ( classMethodID ("size") == 0 );
+
+  /* and the hook of the class it came from */
+  class_check_hooked = NULL;
+  classCallPropertyHookByID (&o, size, NULL, NULL);
+  CHECK_THAT ( strcmp (class_check_hooked, "widgetSize") == 0 );
+  struct Object plain = { object };
+  classCallPropertyHook (&plain, "size", NULL, NULL);
+  CHECK_THAT ( strcmp (class_check_hooked, "objectSize") == 0 );
+  class_check_hooked = NULL;
+  classCallPropertyHook (&plain, "text", NULL, NULL);
+  CHECK_THAT ( class_check_hooked == NULL );
+
+  /* Methods added later reach subclasses whose tables are built */
+  classAddInstanceMethod (object, "late", class_check_objectLate);
+  CHECK_THAT ( strcmp (class_check_call (button, "late"), "objectLate") == 0 );
+
+  /* as do classes loaded later */
+  const char *pluginSupers[] = {"Button"};
+  struct Class *plugin = classCreate ("Plugin", 1, pluginSupers);
+  CHECK_THAT ( strcmp (class_check_call (plugin, "d"), "mixinD") == 0 );
+  CHECK_THAT ( strcmp (class_check_call (plugin, "late"), "objectLate") == 0 );
+  CHECK_THAT ( class_check_slots (plugin, buttonProperties, 4) );
+
+  /* and rebuilding a table doesn't move the slots objects use */
+  int slots[4];
+  for (int i = 0; i < 4; i++)
+    slots[i] = classPropertySlot (button, classPropertyID (buttonProperties[i]), NULL);
+  classAddProperty (plugin, "extra", t_uint32, NULL);
+  for (int i = 0; i < 4; i++)
+    CHECK_THAT ( classPropertySlot (button, classPropertyID (buttonProperties[i]), NULL) == slots[i] );
+  CHECK_THAT ( classPropertySlotCount (plugin) == 5 );
+
+  /* even when a superclass gains a property, which comes after the
+   * rest; "alpha" sorts before all of them */
+  int pluginSlots[5];
+  const char *pluginProperties[] = {"size", "name", "text", "pressed", "extra"};
+  for (int i = 0; i < 5; i++)
+    pluginSlots[i] = classPropertySlot (plugin, classPropertyID (pluginProperties[i]), NULL);
+  classAddProperty (object, "alpha", t_uint32, NULL);
+  for (int i = 0; i < 4; i++)
+    CHECK_THAT ( classPropertySlot (button, classPropertyID (buttonProperties[i]), NULL) == slots[i] );
+  for (int i = 0; i < 5; i++)
+    CHECK_THAT ( classPropertySlot (plugin, classPropertyID (pluginProperties[i]), NULL) == pluginSlots[i] );
+  CHECK_THAT ( classPropertySlot (button, classPropertyID ("alpha"), NULL) == 4 );
+  CHECK_THAT ( classPropertySlot (plugin, classPropertyID ("alpha"), NULL) == 5 );
+  CHECK_THAT ( classPropertySlotCount (button) == 5 );
+  const char *objectLateProperties[] = {"size", "name", "alpha"};
+  CHECK_THAT ( class_check_slots (object, objectLateProperties, 3) );
+
+  classFinalise ();
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "Class";
+  failed = class_check_functionality () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 2f64b8a1-93d7-4c5e-b0a6-7e18d24c9f53
+ */
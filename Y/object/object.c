@@ -18,27 +18,26 @@
 
 #include <Y/y.h>
 #include <Y/message/client_p.h>
+#include <Y/message/wire.h>
 #include <Y/object/object_p.h>
 #include <Y/const.h>
 #include <Y/object/class.h>
 #include <Y/util/yutil.h>
+#include <Y/util/perf.h>
+#include <Y/util/slottable.h>
 #include <stdlib.h>
 #include <string.h>
 
-struct PropertyValue
-{
-  char *name;
-  struct Value *v;
-};
-
 struct Signal
 {
   char *name;
   struct Index *clients;
 };
 
-static uint32_t objectNextID = 1;
-static struct Index *objectIndex = NULL;
+/* Kept until the server exits, even when it is empty: a new table
+ * would start its slots' generations again, and hand out ids which
+ * clients may still hold for objects long gone */
+static struct SlotTable *objectTable = NULL;
 
 DEFINE_CLASS(Object);
 #include "Object.yc"
@@ -77,31 +76,6 @@ objectComparisonFunction (const void *obj1_v, const void *obj2_v)
     return 1; 
 }
 
-static int
-propertyKeyFunction (const void *key_v, const void *obj_v)
-{
-  const char *key = key_v;
-  const struct PropertyValue *obj = obj_v;
-  return strcmp (key, obj -> name);
-}
-
-static int
-propertyComparisonFunction (const void *obj1_v, const void *obj2_v)
-{
-  const struct PropertyValue *obj1 = obj1_v;
-  const struct PropertyValue *obj2 = obj2_v;
-  return strcmp (obj1 -> name, obj2 -> name);
-}
-
-static void
-propertyDestructorFunction (void *obj)
-{
-  struct PropertyValue *prop = obj;
-  valueDestroy(prop->v);
-  yfree(prop->name);
-  yfree(prop);
-}
-
 static int
 signalKeyFunction (const void *key_v, const void *obj_v)
 {
@@ -136,31 +110,35 @@ stringComparisonFunction (const void *str1, const void *str2)
 void
 objectInitialise (struct Object *o, struct Class *c)
 {
-  o -> oid = objectNextID++;
+  if (objectTable == NULL)
+    objectTable = slottableCreate ();
+  o -> oid = slottableAdd (objectTable, o);
   o -> c = c;
   o -> client = getCurrentClient();
-  o -> properties = indexCreate (propertyKeyFunction,
-                                 propertyComparisonFunction);
+  o -> clientPrev = o -> clientNext = NULL;
+  o -> properties = NULL;
+  o -> propertyCount = 0;
   o -> signals = indexCreate (signalKeyFunction, signalComparisonFunction);
-  if (objectIndex == NULL)
-    objectIndex = indexCreate (objectKeyFunction, objectComparisonFunction);
-  indexAdd (objectIndex, o);
   clientAddObject(getCurrentClient(), o);
 }
 
 void
 objectFinalise (struct Object *o)
 {
-  indexRemove (objectIndex, &(o -> oid)); 
-  indexDestroy (o -> properties, propertyDestructorFunction); 
+  slottableRemove (objectTable, o -> oid);
+  for (uint32_t i = 0; i < o -> propertyCount; ++i)
+    valueDestroy (o -> properties[i]);
+  yfree (o -> properties);
   indexDestroy (o -> signals, signalDestructorFunction);
   if (o->client != NULL)
     clientRemoveObject (o -> client, o);
-  if (indexCount (objectIndex) == 0)
-    {
-      indexDestroy (objectIndex, NULL);
-      objectIndex = NULL;
-    }
+}
+
+void
+objectTableFinalise (void)
+{
+  slottableDestroy (objectTable, NULL);
+  objectTable = NULL;
 }
 
 uint32_t
@@ -178,29 +156,34 @@ objectClass (const struct Object *o)
 struct Object *
 objectFind (uint32_t oid)
 {
-  struct Object *obj = indexFind (objectIndex, &oid);
-  return obj;
+  return slottableFind (objectTable, oid);
 }
 
 void
 objectEmitSignal_(struct Object *o, const char *name, struct Tuple *args)
 {
   struct Signal *sig = indexFind (o->signals, name);
-  if (!sig)
-    return;
+  if (!sig || indexCount (sig->clients) == 0)
+    {
+      tupleDestroy(args);
+      return;
+    }
+
+  /* The event is encoded once, and each subscriber's queue gets its
+   * own header pointing at the same values */
+  struct Message *m = messageCreate(YMO_EVENT);
+  m->id = o->oid;
+  m->tuple = args;
+  struct dbuffer_shared *packet = messageEncodeShared (m);
 
   struct IndexIterator *i;
   for (i = indexGetStartIterator (sig->clients); indexiteratorHasValue(i); indexiteratorNext(i))
-    {
-      struct Client *client = indexiteratorGet(i);
-      struct Message *m = messageCreate(YMO_EVENT);
-      m->to = clientGetID(client);
-      m->id = o->oid;
-      m->tuple = tupleDup(args);
-      messageDespatch (NULL, m);
-    }
+    clientSendSharedMessage (indexiteratorGet(i), m, packet);
   indexiteratorDestroy(i);
-  tupleDestroy(args);
+  perfCount (perfMessages, indexCount (sig->clients));
+
+  dbuffer_shared_unref (packet);
+  messageDestroy (m);
 }
 
 bool
@@ -242,76 +225,97 @@ objectUnsubscribeSignal (struct Client *c, struct Object *o, const char *name)
 }
 
 const struct Value *
-objectGetProperty (struct Object *o, const char *name)
+objectGetPropertyByID (struct Object *o, uint32_t property)
 {
-  struct PropertyValue *p = indexFind (o->properties, name);
-  if (!p)
+  int slot = classPropertySlot (o->c, property, NULL);
+  if (slot < 0 || (uint32_t)slot >= o->propertyCount)
     return NULL;
-  return p->v;
+  return o->properties[slot];
+}
+
+const struct Value *
+objectGetProperty (struct Object *o, const char *name)
+{
+  return objectGetPropertyByID (o, classPropertyID (name));
 }
 
-/*
- * sets the given property when the Class and Type are already known.
- * (saves some cycles by not searching again)
- * -DN
- */
 bool
-objectSetPropertyClass(const struct Class *c, struct Object *o, 
-			const char *name, enum Type type, const struct Value *v_in)
+objectSetPropertyByID (struct Object *o, uint32_t property, const struct Value *v_in)
 {
-  if (type == t_undef)
+  enum Type type;
+  int slot = classPropertySlot (o->c, property, &type);
+  if (slot < 0)
     {
       /* No such property */
-      Y_TRACE ( "Property [%s] not found.", name );
+      Y_TRACE ( "Property [%s] not found.", classPropertyName (property) ?: "?" );
       return false;
     }
-  
+
+  struct Value *old = (uint32_t)slot < o->propertyCount ? o->properties[slot] : NULL;
+
   /* NULL or t_undef means "unset" */
   if (!v_in || v_in->type == t_undef)
     {
-      struct PropertyValue *p = indexRemove (o->properties, name);
-      classCallPropertyHook(o, name, p->v, NULL);
-      propertyDestructorFunction(p);
+      if (!old)
+        return true;
+      o->properties[slot] = NULL;
+      classCallPropertyHookByID(o, property, old, NULL);
+      valueDestroy(old);
       return true;
     }
 
   /* valueStaticCast needs a writeable copy of the value to work on */
   struct Value *v = valueDup(v_in);
   if (!valueStaticCast(v, v, type))
-    return false;
+    {
+      valueDestroy(v);
+      return false;
+    }
 
-  /* Now, is the property already set? */
-  struct PropertyValue *p = indexFind (o->properties, name);
-  struct Value *old = NULL;
-  if (!p)
+  /* The array is only made, or grown, when something is stored */
+  if ((uint32_t)slot >= o->propertyCount)
     {
-      /* No, need to create one */
-      p = ymalloc(sizeof(*p));
-      p->name = ystrdup(name);
-      indexAdd(o->properties, p);
+      uint32_t count = MAX(classPropertySlotCount (o->c), (uint32_t)slot + 1);
+      struct Value **properties = ycalloc (count, sizeof (properties[0]));
+      if (o->properties != NULL)
+        memcpy (properties, o->properties, o->propertyCount * sizeof (properties[0]));
+      yfree (o->properties);
+      o->properties = properties;
+      o->propertyCount = count;
     }
-  else
-    old = p->v;
 
   /* Store the value */
-  p->v = v;
-  classCallClassPropertyHook(c, o, name, v, old);
+  o->properties[slot] = v;
+  classCallPropertyHookByID(o, property, old, v);
   valueDestroy(old);
   return true;
 }
 
+/*
+ * sets the given property when the Class and Type are already known.
+ * The class's table knows both already, so this is only kept for
+ * the callers which have them to hand
+ */
+bool
+objectSetPropertyClass(const struct Class *c, struct Object *o, 
+			const char *name, enum Type type, const struct Value *v_in)
+{
+  if (type == t_undef)
+    {
+      /* No such property */
+      Y_TRACE ( "Property [%s] not found.", name );
+      return false;
+    }
+  return objectSetPropertyByID (o, classPropertyID (name), v_in);
+}
+
 /*
  * Sets the given property
  */
 bool
 objectSetProperty(struct Object *o, const char *name, const struct Value *v_in)
 {
-
-  //first we should find which class the property belongs to (in case property is inherited)..
-  enum Type type;
-  const struct Class *c = classGetPropertyClass(objectClass(o), name, &type);
-
-  return objectSetPropertyClass(c, o, name, type, v_in);  
+  return objectSetPropertyByID(o, classPropertyID(name), v_in);
 }
 
 void
@@ -42,6 +42,10 @@ bool objectSetPropertyClass(const struct Class *c, struct Object *o,
 			const char *name, enum Type type, const struct Value *v_in); //added by DN
 bool objectSetProperty(struct Object *, const char *, const struct Value *);
 
+/* As above, by interned property id (see classPropertyID) */
+const struct Value *objectGetPropertyByID (struct Object *, uint32_t property);
+bool objectSetPropertyByID (struct Object *, uint32_t property, const struct Value *);
+
 void         objectEmitSignal_(struct Object *, const char *, struct Tuple *);
 #define      objectEmitSignal(obj, name, ...) \
   objectEmitSignal_(obj, name, tupleBuild(tb_string(name), ##__VA_ARGS__))
@@ -51,6 +55,9 @@ void         objectUnsubscribeSignal (struct Client *, struct Object *, const ch
 
 void         objectDestroy (struct Object *);
 
+/* frees what finds objects by id; only for when the server exits */
+void         objectTableFinalise (void);
+
 #endif
 
 /* arch-tag: 0fed6be1-efef-42f0-9cc8-e016a4fd181f
@@ -28,8 +28,12 @@ struct Object
 {
   uint32_t oid;
   struct Client *client;
+  /* the rest of the objects belonging to client */
+  struct Object *clientPrev, *clientNext;
   struct Class *c;
-  struct Index *properties;
+  /* values of properties, by the class's slot for them; NULL if unset */
+  struct Value **properties;
+  uint32_t propertyCount;
   struct Index *signals;
 };
 
@@ -41,7 +41,7 @@ cairo_renderer_render_buffer (Renderer *self_r, Buffer *buffer,
 {
   CairoRenderer *self = (CairoRenderer *)self_r;
   cairo_set_operator (self->cairo_context, CAIRO_OPERATOR_OVER);
-  cairo_set_source_surface (self->cairo_context, buffer_get_cairo_surface (buffer), x, y);
+  cairo_set_source_surface (self->cairo_context, buffer_get_source_surface (buffer), x, y);
   cairo_rectangle (self->cairo_context, x+xo, y+yo, rw, rh);
   cairo_fill (self->cairo_context);
 }
@@ -52,7 +52,7 @@ cairo_renderer_copy_buffer (Renderer *self_r, Buffer *buffer,
 {
   CairoRenderer *self = (CairoRenderer *)self_r;
   cairo_set_operator (self->cairo_context, CAIRO_OPERATOR_SOURCE);
-  cairo_set_source_surface (self->cairo_context, buffer_get_cairo_surface (buffer), x, y);
+  cairo_set_source_surface (self->cairo_context, buffer_get_source_surface (buffer), x, y);
   cairo_rectangle (self->cairo_context, x+xo, y+yo, rw, rh);
   cairo_fill (self->cairo_context);
 }
@@ -69,6 +69,35 @@ cairo_renderer_draw_filled_rectangle (Renderer *self_r, uint32_t colour,
   cairo_fill (self->cairo_context);
 }
 
+static void
+cairo_renderer_set_clip_region (Renderer *self_r, const struct Region *region)
+{
+  CairoRenderer *self = (CairoRenderer *)self_r;
+  const struct Rectangle *rects;
+  int count;
+
+  rects = regionGetRectangles (region, &count);
+  cairo_reset_clip (self->cairo_context);
+  cairo_new_path (self->cairo_context);
+  for (int i = 0; i < count; ++i)
+    cairo_rectangle (self->cairo_context,
+                     rects[i].x, rects[i].y, rects[i].w, rects[i].h);
+  cairo_clip (self->cairo_context);
+}
+
+static void
+cairo_renderer_save_buffer (Renderer *self_r, Buffer *buffer, int x, int y)
+{
+  CairoRenderer *self = (CairoRenderer *)self_r;
+  cairo_surface_t *target = cairo_get_target (self->cairo_context);
+  cairo_t *cr = buffer_get_cairo_context (buffer);
+  cairo_surface_flush (target);
+  cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface (cr, target, -x, -y);
+  cairo_paint (cr);
+  cairo_destroy (cr);
+}
+
 static void
 cairo_renderer_complete (Renderer *self_r)
 {
@@ -81,7 +110,9 @@ static RendererClass cairo_renderer_class =
     destroy:               cairo_renderer_destroy,
     render_buffer:         cairo_renderer_render_buffer,
     copy_buffer:           cairo_renderer_copy_buffer,
-    draw_filled_rectangle: cairo_renderer_draw_filled_rectangle
+    draw_filled_rectangle: cairo_renderer_draw_filled_rectangle,
+    set_clip_region:       cairo_renderer_set_clip_region,
+    save_buffer:           cairo_renderer_save_buffer
 };
 
 CairoRenderer *
@@ -76,6 +76,7 @@ renderer_initialise (Renderer *self)
 {
   self -> regions = new_llist ();
   self -> options = indexCreate (rendererOptionKeyFunction, rendererOptionComparisonFunction);
+  self -> clipRegion = NULL;
 }
 
 void
@@ -121,10 +122,41 @@ renderer_enter (Renderer *self, const struct Rectangle *rect,
            return 0;
          }
     }
+  if (reg -> clip.w <= 0 || reg -> clip.h <= 0
+      || (self -> clipRegion != NULL
+          && !regionOverlapsRectangle (self -> clipRegion, &(reg -> clip))))
+    {
+      yfree (reg);
+      return 0;
+    }
   llist_add_head (self -> regions, reg);
   return 1;
 }
 
+void
+renderer_set_clip_region (Renderer *self, const struct Region *region)
+{
+  if (self == NULL)
+    return;
+  self -> clipRegion = region;
+  if (region != NULL && self -> c -> set_clip_region != NULL)
+    self -> c -> set_clip_region (self, region);
+}
+
+const struct Region *
+renderer_get_clip_region (Renderer *self)
+{
+  return self != NULL ? self -> clipRegion : NULL;
+}
+
+void
+renderer_get_origin (Renderer *self, int *x, int *y)
+{
+  RenderRegion *reg = self != NULL ? llist_node_data (llist_head (self -> regions)) : NULL;
+  *x = reg != NULL ? reg -> translateX : 0;
+  *y = reg != NULL ? reg -> translateY : 0;
+}
+
 void
 renderer_leave (Renderer *self)
 {
@@ -140,68 +172,131 @@ renderer_leave (Renderer *self)
     }
 }
 
+/* Works out the device rectangle of the given size at (x, y) in the
+ * current co-ordinates, and the part of it inside the entered
+ * rectangles. Returns false if nothing is visible.
+ */
+static bool
+rendererPlace (Renderer *self, int x, int y, int w, int h,
+               struct Rectangle *placed, struct Rectangle *visible)
+{
+  RenderRegion *reg = llist_node_data (llist_head (self->regions));
+  placed -> x = x;
+  placed -> y = y;
+  placed -> w = w;
+  placed -> h = h;
+  *visible = *placed;
+  if (reg != NULL)
+    {
+      placed -> x += reg -> translateX;
+      placed -> y += reg -> translateY;
+      if (!rectangleIntersect (visible, placed, &(reg -> clip)))
+        return false;
+    }
+  return visible -> w > 0 && visible -> h > 0;
+}
+
+/* Returns the number of clip rectangles drawing has to be split over,
+ * or 0 if the visible rectangle can be drawn in one go
+ */
+static int
+rendererClipCount (Renderer *self, const struct Rectangle **rects)
+{
+  int count;
+  if (self -> clipRegion == NULL || self -> c -> set_clip_region != NULL)
+    return 0;
+  *rects = regionGetRectangles (self -> clipRegion, &count);
+  return count;
+}
+
+static inline bool
+rendererClipPart (const struct Rectangle *visible, const struct Rectangle *clip,
+                  struct Rectangle *part)
+{
+  if (!rectangleIntersect (part, visible, clip))
+    return false;
+  return part -> w > 0 && part -> h > 0;
+}
+
+static void
+rendererBlit (Renderer *self,
+              void (*blit) (Renderer *, Buffer *, int, int, int, int, int, int),
+              Buffer *buffer, int x, int y)
+{
+  struct Rectangle r, visible, part;
+  const struct Rectangle *rects;
+  int w, h, count;
+
+  if (blit == NULL)
+    return;
+  buffer_get_size (buffer, &w, &h);
+  if (!rendererPlace (self, x, y, w, h, &r, &visible))
+    return;
+
+  count = rendererClipCount (self, &rects);
+  if (count == 0)
+    {
+      blit (self, buffer, r.x, r.y,
+            visible.x - r.x, visible.y - r.y, visible.w, visible.h);
+      return;
+    }
+  for (int i = 0; i < count; ++i)
+    if (rendererClipPart (&visible, &rects[i], &part))
+      blit (self, buffer, r.x, r.y,
+            part.x - r.x, part.y - r.y, part.w, part.h);
+}
+
 void
 renderer_render_buffer (Renderer *self, Buffer *buffer,
                       int x, int y)
 {
-  struct Rectangle r = { x, y, 0, 0 };
-  struct Rectangle r2;
-  buffer_get_size (buffer, &r.w, &r.h);
   if (self != NULL)
-    {
-      RenderRegion *reg = llist_node_data (llist_head (self->regions));
-      if (reg != NULL)
-        {
-          r.x += reg->translateX;
-          r.y += reg->translateY;
-          if (!rectangleIntersect (&r2, &r, &(reg -> clip)))
-            return;
-        }
-      if (self->c->render_buffer != NULL)
-        self->c->render_buffer (self, buffer, r.x, r.y,
-               r2.x-r.x, r2.y-r.y, r2.w, r2.h);
-    }
+    rendererBlit (self, self -> c -> render_buffer, buffer, x, y);
 }
 
 void
 renderer_copy_buffer (Renderer *self, Buffer *buffer,
                         int x, int y)
 {
-  struct Rectangle r = { x, y, 0, 0 };
-  struct Rectangle r2;
-  buffer_get_size (buffer, &r.w, &r.h);
   if (self != NULL)
-  {
-    RenderRegion *reg = llist_node_data (llist_head (self->regions));
-    if (reg != NULL)
-    {
-      r.x += reg->translateX;
-      r.y += reg->translateY;
-      if (!rectangleIntersect (&r2, &r, &(reg -> clip)))
-        return;
-    }
-    if (self->c->render_buffer != NULL)
-      self->c->copy_buffer (self, buffer, r.x, r.y,
-                              r2.x-r.x, r2.y-r.y, r2.w, r2.h);
-  }
+    rendererBlit (self, self -> c -> copy_buffer, buffer, x, y);
+}
+
+bool
+renderer_save_buffer (Renderer *self, Buffer *buffer, int x, int y)
+{
+  int dx, dy;
+  if (self == NULL || self -> c -> save_buffer == NULL)
+    return false;
+  renderer_get_origin (self, &dx, &dy);
+  self -> c -> save_buffer (self, buffer, x + dx, y + dy);
+  return true;
 }
 
 void
 renderer_draw_filled_rectangle (Renderer *self, uint32_t colour,
                              int x, int y, int w, int h)
 {
-  struct Rectangle r = { x, y, w, h };
-  if (self != NULL)
+  struct Rectangle r, visible, part;
+  const struct Rectangle *rects;
+  int count;
+
+  if (self == NULL)
+    return;
+  if (!rendererPlace (self, x, y, w, h, &r, &visible))
+    return;
+
+  count = rendererClipCount (self, &rects);
+  if (count == 0)
     {
-      RenderRegion *reg = llist_node_data (llist_head (self->regions));
-      if (reg != NULL)
-        {
-          r.x += reg -> translateX;
-          r.y += reg -> translateY;
-          rectangleIntersect (&r, &r, &(reg -> clip));
-        }
-      self -> c -> draw_filled_rectangle (self, colour, r.x, r.y, r.w, r.h);
+      self -> c -> draw_filled_rectangle (self, colour, visible.x, visible.y,
+                                          visible.w, visible.h);
+      return;
     }
+  for (int i = 0; i < count; ++i)
+    if (rendererClipPart (&visible, &rects[i], &part))
+      self -> c -> draw_filled_rectangle (self, colour, part.x, part.y,
+                                          part.w, part.h);
 }
 
 void
@@ -24,6 +24,7 @@ typedef struct Renderer_t Renderer;
 
 #include <Y/y.h>
 #include <Y/util/rectangle.h>
+#include <Y/util/region.h>
 #include <Y/buffer/buffer.h>
 #include <stdint.h>
 
@@ -55,6 +56,27 @@ void renderer_destroy (Renderer *);
 int renderer_enter (Renderer *, const struct Rectangle *rect,
                    int dx, int dy);
 
+/* Restrict all drawing to REGION, in device co-ordinates, as well as
+ * to the entered rectangles; entering a rectangle which misses the
+ * region fails, so whole subtrees of widgets can be skipped. This lets
+ * one pass over the widget tree repaint any number of damaged areas.
+ * The region is not copied and must outlive the renderer (or be
+ * replaced by another call first). Each call replaces the previous
+ * clip region, so it can be narrowed for part of the tree and then
+ * restored.
+ */
+void renderer_set_clip_region (Renderer *, const struct Region *region);
+
+/* Returns the clip region, or NULL if drawing is only limited by the
+ * entered rectangles.
+ */
+const struct Region *renderer_get_clip_region (Renderer *);
+
+/* Stores the device co-ordinates of the current origin, i.e. the sum
+ * of the translations of the entered regions.
+ */
+void renderer_get_origin (Renderer *, int *x, int *y);
+
 /* Leave the last region enterered.
  */
 void renderer_leave (Renderer *);
@@ -68,6 +90,13 @@ void renderer_render_buffer (Renderer *, Buffer *, int x, int y);
  */
 void renderer_copy_buffer (Renderer *, Buffer *, int x, int y);
 
+/* \brief Copy what has been drawn at the given co-ordinates into the
+ * buffer; the reverse of renderer_copy_buffer, ignoring the entered
+ * rectangles and the clip region. Returns false if the renderer can't
+ * read back what it has drawn.
+ */
+bool renderer_save_buffer (Renderer *, Buffer *, int x, int y);
+
 /* Draw a rectangle filled with a solid colour, COLOUR. The rectangle should
  * placed with the upper-left corner at the device independent co-ordinates
  * (X,Y), and be W by H in size.
@@ -22,6 +22,7 @@
 #include <Y/screen/renderer.h>
 #include <Y/util/llist.h>
 #include <Y/util/index.h>
+#include <Y/util/region.h>
 
 /* This defines the internal characteristics of an ABSTRACT Renderer */
 
@@ -36,6 +37,13 @@ typedef struct
                          int, int, int, int);
   void (*draw_filled_rectangle) (Renderer *, uint32_t,
                                int, int, int, int);
+  /* Optional: clip all further drawing to the region, replacing any
+   * earlier clip region. Without it, drawing is split up by the
+   * rectangles of the region instead.
+   */
+  void (*set_clip_region) (Renderer *, const struct Region *);
+  /* Optional: copy the device pixels at (x, y) into the buffer */
+  void (*save_buffer) (Renderer *, Buffer *, int, int);
 } RendererClass;
 
 struct Renderer_t
@@ -43,6 +51,7 @@ struct Renderer_t
   RendererClass *c;
   struct llist *regions;
   struct Index *options;
+  const struct Region *clipRegion;
 };
 
 void renderer_initialise (Renderer *);
@@ -136,6 +136,37 @@ viewportCCall (const struct Tuple *args)
   return viewportCall (vp, &vargs);
 }
 
+/* METHOD
+ * statistics :: () -> (...)
+ *
+ * Six values per viewport: id, frames drawn, rectangles damaged in
+ * the last frame, and the last, longest and mean frame times in
+ * microseconds
+ */
+struct Tuple *
+viewportCStatistics (void)
+{
+  struct Tuple *ret = tupleCreate(indexCount(viewports) * 6);
+  int i = 0;
+  struct IndexIterator *iter = indexGetStartIterator (viewports);
+  while (indexiteratorHasValue (iter))
+    {
+      struct Viewport *vp = indexiteratorGet (iter);
+      const struct ViewportStatistics *stats = viewportGetStatistics (vp);
+      ret->list[i++] = tb_uint32(viewportGetID (vp));
+      ret->list[i++] = tb_uint32(stats->frames);
+      ret->list[i++] = tb_uint32(stats->lastRectangles);
+      ret->list[i++] = tb_uint32(stats->lastMicroseconds);
+      ret->list[i++] = tb_uint32(stats->maxMicroseconds);
+      ret->list[i++] = tb_uint32(stats->frames
+                                 ? stats->totalMicroseconds / stats->frames : 0);
+      indexiteratorNext (iter);
+    }
+  indexiteratorDestroy (iter);
+  assert(i == indexCount(viewports) * 6);
+  return ret;
+}
+
 void
 screenInitialise ()
 {
@@ -235,6 +266,20 @@ screenInvalidateRectangle (struct Rectangle *r)
   rectangleDestroy (r);
 }
 
+void
+screenCursorMoved ()
+{
+  struct IndexIterator *iterator;
+
+  iterator = indexGetStartIterator (viewports);
+  while (indexiteratorHasValue (iterator))
+    {
+      viewportCursorMoved (indexiteratorGet (iterator));
+      indexiteratorNext (iterator);
+    }
+  indexiteratorDestroy (iterator);
+}
+
 void
 screenViewportsChanged ()
 {
@@ -299,7 +344,7 @@ screenRender (Renderer *renderer)
    *    renderer in ZOrder.
    * 3. Paint/Render the Overlay Widgets onto the Renderer
    *    in ZOrder.
-   * 3. Paint the mouse pointer onto the renderer.
+   * The mouse pointer is drawn over all this by the viewport.
    */
 #if 0
   struct Painter *painter= rendererGetPainter (renderer, rect);
@@ -322,11 +367,6 @@ screenRender (Renderer *renderer)
                                    screenRectangle->x, screenRectangle->y,
                                    screenRectangle->w, screenRectangle->h);
     }
-
-  if (renderer_get_option(renderer, "hardware pointer") == NULL)
-    {
-      pointerRender (renderer);
-    }
 }
 
 Buffer *
@@ -37,6 +37,7 @@ void           screenSetRootWidget (struct Widget *);
 struct Widget *screenGetRootWidget (void);
 
 void           screenInvalidateRectangle (struct Rectangle *);
+void           screenCursorMoved (void);
 
 void           screenViewportsChanged (void);
 
@@ -18,21 +18,39 @@
 
 #include <Y/screen/viewport.h>
 #include <Y/screen/screen.h>
+#include <Y/input/pointer.h>
+#include <Y/buffer/imagebuffer.h>
 #include <Y/main/control.h>
 #include <Y/util/llist.h>
+#include <Y/util/region.h>
+#include <Y/util/perf.h>
+#include <Y/trace/tracering.h>
 #include <Y/util/yutil.h>
 
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 struct Viewport
 {
   int id;
   struct VideoDriver *video;
-  struct llist *invalidRectangles;
+  struct Region invalid;
+  struct Region painting;
   int updateEventID;
   int x, y, w, h;
+  struct ViewportStatistics stats;
+  /* The software cursor is drawn over each frame once the widgets are
+   * rendered, keeping what it covers in cursorUnder, so that moving it
+   * only needs that put back rather than the widgets rendered again.
+   * If the renderer can't read back, cursorUnder is NULL and the
+   * widgets under it are rendered instead
+   */
+  Buffer *cursorUnder;
+  struct Rectangle cursorRect;
+  bool cursorShown;
+  bool cursorMoved;
 };
 
 static int nextViewportID = 0;
@@ -43,7 +61,8 @@ viewportCreate (struct VideoDriver *video)
   struct Viewport *self = ymalloc (sizeof (struct Viewport));
   self -> id = nextViewportID++;
   self -> video = video;
-  self -> invalidRectangles = new_llist ();
+  regionInitialise (&self -> invalid);
+  regionInitialise (&self -> painting);
   self -> x = 0;
   self -> y = 0;
   video -> getPixelDimensions (video, &(self -> w), &(self -> h)); 
@@ -52,6 +71,11 @@ viewportCreate (struct VideoDriver *video)
   if (self -> h <= 0)
     self -> h = 600;
   self -> updateEventID = 0;
+  memset (&self -> stats, 0, sizeof (self -> stats));
+  self -> cursorUnder = NULL;
+  memset (&self -> cursorRect, 0, sizeof (self -> cursorRect));
+  self -> cursorShown = false;
+  self -> cursorMoved = true;
 
 #if 0
   if (video -> setPointer)
@@ -67,7 +91,10 @@ viewportCreate (struct VideoDriver *video)
 void
 viewportDestroy (struct Viewport *self)
 {
-  llist_destroy (self->invalidRectangles, rectangleDestroy);
+  regionFinalise (&self -> invalid);
+  regionFinalise (&self -> painting);
+  if (self -> cursorUnder != NULL)
+    buffer_destroy (self -> cursorUnder);
   yfree (self);
 }
 
@@ -88,10 +115,9 @@ viewportGetRectangle (struct Viewport *self)
   return rect;
 }
 
-void
-viewportInvalidateRectangle (struct Viewport *self, const struct Rectangle *r)
+static void
+viewportScheduleUpdate (struct Viewport *self)
 {
-  llist_add_tail (self->invalidRectangles, rectangleDuplicate (r));
   if (self -> updateEventID == 0)
     {
       self -> updateEventID =
@@ -99,6 +125,78 @@ viewportInvalidateRectangle (struct Viewport *self, const struct Rectangle *r)
     }
 }
 
+void
+viewportInvalidateRectangle (struct Viewport *self, const struct Rectangle *r)
+{
+  regionUnionRectangle (&self -> invalid, r);
+  viewportScheduleUpdate (self);
+}
+
+void
+viewportCursorMoved (struct Viewport *self)
+{
+  self -> cursorMoved = true;
+  viewportScheduleUpdate (self);
+}
+
+/* Where the cursor sprite goes now */
+static void
+viewportCursorPlace (struct Rectangle *rect)
+{
+  pointerGetPosition (&rect -> x, &rect -> y);
+  buffer_get_size (pointerGetCurrentImage (), &rect -> w, &rect -> h);
+}
+
+/* Takes the cursor off the screen before anything is drawn under it */
+static void
+viewportCursorHide (struct Viewport *self)
+{
+  if (!self -> cursorShown)
+    return;
+  self -> cursorShown = false;
+
+  if (self -> cursorUnder == NULL)
+    {
+      regionUnionRectangle (&self -> painting, &self -> cursorRect);
+      return;
+    }
+  Renderer *renderer = self -> video -> getRenderer (self -> video, &self -> cursorRect);
+  renderer_copy_buffer (renderer, self -> cursorUnder,
+                        self -> cursorRect.x, self -> cursorRect.y);
+  renderer_complete (renderer);
+  renderer_destroy (renderer);
+}
+
+static void
+viewportCursorShow (struct Viewport *self)
+{
+  Renderer *renderer = self -> video -> getRenderer (self -> video, &self -> cursorRect);
+  if (renderer_get_option (renderer, "hardware pointer") == NULL)
+    {
+      int w = 0, h = 0;
+      if (self -> cursorUnder != NULL)
+        buffer_get_size (self -> cursorUnder, &w, &h);
+      if (w != self -> cursorRect.w || h != self -> cursorRect.h)
+        {
+          if (self -> cursorUnder != NULL)
+            buffer_destroy (self -> cursorUnder);
+          self -> cursorUnder = (Buffer *)image_buffer_create (CAIRO_FORMAT_ARGB32,
+                                                               self -> cursorRect.w,
+                                                               self -> cursorRect.h);
+        }
+      if (!renderer_save_buffer (renderer, self -> cursorUnder,
+                                 self -> cursorRect.x, self -> cursorRect.y))
+        {
+          buffer_destroy (self -> cursorUnder);
+          self -> cursorUnder = NULL;
+        }
+      pointerRender (renderer);
+      self -> cursorShown = true;
+    }
+  renderer_complete (renderer);
+  renderer_destroy (renderer);
+}
+
 void
 viewportSetSize (struct Viewport *self, int w, int h)
 {
@@ -147,45 +245,109 @@ viewportSetResolution (struct Viewport *self, const char *name)
 void
 viewportUpdate (struct Viewport *self)
 {
-  struct Rectangle *viewportRectangle = viewportGetRectangle (self);
+  struct Rectangle viewportRectangle = { self -> x, self -> y, self -> w, self -> h };
+  struct Region damage;
+  struct timespec start, end;
+  uint64_t elapsed, area = 0;
+  int count;
+
+  self -> updateEventID = 0;
+
+  /* Swap the damage out, so anything invalidated while we render is
+   * collected for the next update rather than disturbing this one
+   */
+  damage = self -> painting;
+  self -> painting = self -> invalid;
+  self -> invalid = damage;
+  regionClear (&self -> invalid);
 
-  if (llist_length (self -> invalidRectangles) == 0)
+  regionIntersectRectangle (&self -> painting, &viewportRectangle);
+
+  /* the cursor is redrawn if it moved, or if anything is drawn under it */
+  bool cursor = self -> cursorMoved
+    || (self -> cursorShown && regionOverlapsRectangle (&self -> painting, &self -> cursorRect));
+  self -> cursorMoved = false;
+  if (regionIsEmpty (&self -> painting) && !cursor)
     return;
 
-  rectanglelistUnionOverlaps (self -> invalidRectangles);
+  clock_gettime (CLOCK_MONOTONIC, &start);
+  regionGetRectangles (&self -> painting, &count);
+  TRACE_BEGIN (treRender, self -> id, count);
 
   self -> video -> beginUpdates (self -> video);
 
-  /* for each rectangle in the collection */
-  for (struct llist_node *node = llist_head (self->invalidRectangles);
-       node != NULL;
-       node = llist_node_next (node))
+  struct Rectangle oldCursor = self -> cursorRect;
+  bool oldShown = self -> cursorShown;
+  if (cursor)
     {
-      /* compute the intersected rectangle */
-      struct Rectangle *invalid = llist_node_data (node);
-      struct Rectangle *visible = ymalloc (sizeof (struct Rectangle));
-      if (rectangleIntersect (visible, invalid, viewportRectangle))
+      viewportCursorHide (self);
+      viewportCursorPlace (&self -> cursorRect);
+      regionIntersectRectangle (&self -> painting, &viewportRectangle);
+    }
+
+  if (self -> video -> setUpdateRegion != NULL)
+    {
+      if (cursor)
         {
-          /* create a renderer (visitor) and pass it over the widget structure
-           */
-          Renderer *renderer =
-                  self -> video -> getRenderer (self -> video, visible);
-          screenRender (renderer);
-          renderer_complete (renderer);
-          renderer_destroy (renderer);
+          struct Region update;
+          regionInitialise (&update);
+          regionCopy (&update, &self -> painting);
+          if (oldShown)
+            regionUnionRectangle (&update, &oldCursor);
+          regionUnionRectangle (&update, &self -> cursorRect);
+          self -> video -> setUpdateRegion (self -> video, &update);
+          regionFinalise (&update);
         }
-      rectangleDestroy (visible);
+      else
+        self -> video -> setUpdateRegion (self -> video, &self -> painting);
+    }
+
+  if (!regionIsEmpty (&self -> painting))
+    {
+      /* create a renderer (visitor) covering the whole damaged region,
+       * and pass it over the widget structure once
+       */
+      Renderer *renderer =
+              self -> video -> getRenderer (self -> video,
+                                            regionGetExtents (&self -> painting));
+      renderer_set_clip_region (renderer, &self -> painting);
+      screenRender (renderer);
+      renderer_complete (renderer);
+      renderer_destroy (renderer);
     }
 
-  rectangleDestroy (viewportRectangle);
+  if (cursor)
+    viewportCursorShow (self);
 
+  TRACE_BEGIN (trePresent, self -> id, 0);
   self -> video -> endUpdates (self -> video);
+  TRACE_END (trePresent);
+  TRACE_END (treRender);
 
-  llist_destroy (self->invalidRectangles, rectangleDestroy);
-  self -> invalidRectangles = new_llist ();
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  elapsed = (uint64_t)(end.tv_sec - start.tv_sec) * 1000000
+    + (end.tv_nsec - start.tv_nsec) / 1000;
+  const struct Rectangle *rects = regionGetRectangles (&self -> painting, &count);
+  for (int i = 0; i < count; ++i)
+    area += (uint64_t)rects[i].w * rects[i].h;
+  perfCount (perfFrames, 1);
+  perfCount (perfDamagePixels, area);
+  perfRecord (perfFrameTime, elapsed);
+  perfRecord (perfFrameArea, area);
+  self -> stats.frames++;
+  self -> stats.totalMicroseconds += elapsed;
+  self -> stats.lastMicroseconds = elapsed;
+  if (elapsed > self -> stats.maxMicroseconds)
+    self -> stats.maxMicroseconds = elapsed;
+  self -> stats.lastRectangles = count;
 
-  self -> updateEventID = 0;
+  regionClear (&self -> painting);
+}
 
+const struct ViewportStatistics *
+viewportGetStatistics (const struct Viewport *self)
+{
+  return &self -> stats;
 }
 
 struct VideoDriver *
@@ -24,6 +24,7 @@ struct Viewport;
 #include <Y/modules/videodriver_interface.h>
 #include <Y/util/llist.h>
 #include <Y/util/rectangle.h>
+#include <inttypes.h>
 
 /*
  * A Viewport is the concept of a view onto the abstract display.
@@ -33,6 +34,16 @@ struct Viewport;
  * video driver, which is the object that does the actual work.
  */
 
+/* Frame timings, in microseconds of wall time spent in viewportUpdate */
+struct ViewportStatistics
+{
+  uint32_t frames;
+  uint64_t totalMicroseconds;
+  uint32_t lastMicroseconds;
+  uint32_t maxMicroseconds;
+  uint32_t lastRectangles;    /* damaged rectangles in the last frame */
+};
+
 /* Create a new Viewport object that is referred to by DRIVER. */
 struct Viewport  *viewportCreate (struct VideoDriver *driver);
 
@@ -62,11 +73,18 @@ struct Rectangle *viewportGetRectangle (struct Viewport *);
 void              viewportInvalidateRectangle (struct Viewport *,
                                                const struct Rectangle *);
 
+/* The pointer has moved; the cursor is redrawn at the next update,
+ * without anything under it being rendered again */
+void              viewportCursorMoved (struct Viewport *);
+
 void              viewportSetSize (struct Viewport *, int, int);
 
 /* Cause the viewport to update itself. */ 
 void              viewportUpdate (struct Viewport *);
 
+const struct ViewportStatistics *
+                  viewportGetStatistics (const struct Viewport *);
+
 struct Tuple *    viewportCall (struct Viewport *, const struct Tuple *);
 
 #endif
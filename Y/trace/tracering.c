@@ -0,0 +1,229 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/trace/tracering.h>
+#include <Y/util/yutil.h>
+#include <Y/util/log.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#define TRACE_RING_DEFAULT_RECORDS 65536
+
+struct TraceRecord
+{
+  uint64_t time;                /* nanoseconds, CLOCK_MONOTONIC */
+  uint32_t a, b;
+  uint16_t event;
+  char phase;
+};
+
+struct TraceRing
+{
+  struct TraceRing *next;
+  pid_t tid;
+  uint64_t head;                /* records ever written */
+  uint64_t mask;
+  struct TraceRecord records[];
+};
+
+struct TraceRingEventInfo
+{
+  const char *name;
+  const char *a;
+  const char *b;
+};
+
+static const struct TraceRingEventInfo traceRingEvents[treEventCount] =
+  {
+    [treDespatch]    = {"despatch", "op", "id"},
+    [treLayout]      = {"layout", "object", NULL},
+    [trePaint]       = {"paint", "object", NULL},
+    [treRender]      = {"render", "viewport", "rectangles"},
+    [trePresent]     = {"present", "viewport", NULL},
+    [treObjectAdded] = {"objectAdded", "client", "object"},
+  };
+
+bool traceRingActive = false;
+
+/* The list of rings is only touched when a thread records for the
+ * first time, and when starting, dumping or finalising */
+static pthread_mutex_t traceRingMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct TraceRing *traceRings = NULL;
+static size_t traceRingRecords = TRACE_RING_DEFAULT_RECORDS;
+
+static __thread struct TraceRing *traceRingLocal = NULL;
+
+static struct TraceRing *
+traceRingCreate (void)
+{
+  struct TraceRing *ring =
+    ymalloc (sizeof (struct TraceRing) + traceRingRecords * sizeof (struct TraceRecord));
+  ring -> tid = syscall (SYS_gettid);
+  ring -> head = 0;
+  ring -> mask = traceRingRecords - 1;
+
+  pthread_mutex_lock (&traceRingMutex);
+  ring -> next = traceRings;
+  traceRings = ring;
+  pthread_mutex_unlock (&traceRingMutex);
+  return ring;
+}
+
+void
+traceRingRecord_ (enum TraceRingEvent event, char phase, uint32_t a, uint32_t b)
+{
+  struct TraceRing *ring = traceRingLocal;
+  struct timespec now;
+
+  if (ring == NULL)
+    ring = traceRingLocal = traceRingCreate ();
+
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  struct TraceRecord *r = &ring -> records[ring -> head & ring -> mask];
+  r -> time = (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+  r -> event = event;
+  r -> phase = phase;
+  r -> a = a;
+  r -> b = b;
+  ring -> head++;
+}
+
+int
+traceRingSpanBegin_ (enum TraceRingEvent event, uint32_t a, uint32_t b)
+{
+  traceRingRecord_ (event, 'B', a, b);
+  return event;
+}
+
+void
+traceRingSpanEnd_ (int *event)
+{
+  if (*event >= 0)
+    traceRingRecord_ (*event, 'E', 0, 0);
+}
+
+void
+traceRingStart (size_t records)
+{
+  size_t size = 1;
+
+  if (records == 0)
+    records = TRACE_RING_DEFAULT_RECORDS;
+  while (size < records)
+    size <<= 1;
+
+  pthread_mutex_lock (&traceRingMutex);
+  traceRingRecords = size;
+  for (struct TraceRing *ring = traceRings; ring != NULL; ring = ring -> next)
+    ring -> head = 0;
+  pthread_mutex_unlock (&traceRingMutex);
+
+  traceRingActive = true;
+  Y_INFO ("Tracing into rings of %lu records", (unsigned long)size);
+}
+
+void
+traceRingStop (void)
+{
+  traceRingActive = false;
+}
+
+static void
+traceRingDumpRecord (FILE *f, pid_t pid, pid_t tid, const struct TraceRecord *r,
+                     bool *first)
+{
+  const struct TraceRingEventInfo *info = &traceRingEvents[r -> event];
+
+  fprintf (f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRIu64 ".%03u,"
+           "\"pid\":%d,\"tid\":%d",
+           *first ? "" : ",", info -> name, r -> phase,
+           r -> time / 1000, (unsigned int)(r -> time % 1000), (int)pid, (int)tid);
+  *first = false;
+
+  /* instants are only drawn on their own thread */
+  if (r -> phase == 'i')
+    fputs (",\"s\":\"t\"", f);
+  if (r -> phase != 'E' && info -> a != NULL)
+    {
+      fprintf (f, ",\"args\":{\"%s\":%u", info -> a, r -> a);
+      if (info -> b != NULL)
+        fprintf (f, ",\"%s\":%u", info -> b, r -> b);
+      fputc ('}', f);
+    }
+  fputc ('}', f);
+}
+
+bool
+traceRingDump (const char *filename)
+{
+  FILE *f = fopen (filename, "w");
+  pid_t pid = getpid ();
+  bool first = true;
+
+  if (f == NULL)
+    {
+      Y_ERROR ("Could not open trace dump %s: %s", filename, strerror (errno));
+      return false;
+    }
+
+  fputs ("{\"traceEvents\":[", f);
+
+  /* Other threads may still be writing; records they overwrite while
+   * this runs can come out garbled, but the server's own can't */
+  pthread_mutex_lock (&traceRingMutex);
+  for (struct TraceRing *ring = traceRings; ring != NULL; ring = ring -> next)
+    {
+      uint64_t head = ring -> head;
+      uint64_t start = head > ring -> mask + 1 ? head - (ring -> mask + 1) : 0;
+      for (uint64_t i = start; i < head; ++i)
+        traceRingDumpRecord (f, pid, ring -> tid, &ring -> records[i & ring -> mask], &first);
+    }
+  pthread_mutex_unlock (&traceRingMutex);
+
+  fputs ("\n],\"displayTimeUnit\":\"ms\"}\n", f);
+  if (fclose (f) != 0)
+    {
+      Y_ERROR ("Trace dump %s was not written completely: %s", filename, strerror (errno));
+      return false;
+    }
+  return true;
+}
+
+void
+traceRingFinalise (void)
+{
+  traceRingActive = false;
+  pthread_mutex_lock (&traceRingMutex);
+  while (traceRings != NULL)
+    {
+      struct TraceRing *ring = traceRings;
+      traceRings = ring -> next;
+      yfree (ring);
+    }
+  pthread_mutex_unlock (&traceRingMutex);
+  traceRingLocal = NULL;
+}
+
+/* arch-tag: 8a5c2e93-f7d1-4b06-a3e8-51c9d0b7f246
+ */
@@ -0,0 +1,88 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_TRACE_TRACERING_H
+#define Y_TRACE_TRACERING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <inttypes.h>
+
+/*
+ *  A binary event tracer which is cheap enough to leave compiled in.
+ *
+ *  Each thread records into a ring of fixed size records: an event id,
+ *  a timestamp and two raw arguments, with nothing formatted until the
+ *  rings are dumped as Chrome trace JSON (chrome://tracing, or
+ *  Perfetto). When the ring is full the oldest records are lost, so a
+ *  dump shows the last stretch of activity.
+ *
+ *  While tracing is stopped each trace point costs one test.
+ */
+
+enum TraceRingEvent
+  {
+    treDespatch,         /* span: a message; op, object or class id */
+    treLayout,           /* span: a widget laying itself out; object id */
+    trePaint,            /* span: a widget painting; object id */
+    treRender,           /* span: a viewport update; viewport id, rectangles */
+    trePresent,          /* span: a driver showing a frame; viewport id */
+    treObjectAdded,      /* instant: client id, object id */
+    treEventCount
+  };
+
+extern bool traceRingActive;
+
+/* starts (or restarts) tracing, emptying the rings. records is the
+ * size of each thread's ring, rounded up to a power of two; it only
+ * applies to rings not yet created, and 0 picks the default */
+void traceRingStart (size_t records);
+
+void traceRingStop (void);
+
+/* writes everything still in the rings to filename as Chrome trace
+ * JSON; returns false if the file can't be written */
+bool traceRingDump (const char *filename);
+
+/* frees the rings; no thread may be tracing */
+void traceRingFinalise (void);
+
+void traceRingRecord_ (enum TraceRingEvent, char phase, uint32_t a, uint32_t b);
+
+#define TRACE_BEGIN(E, A, B)                                            \
+  do { if (traceRingActive) traceRingRecord_ ((E), 'B', (A), (B)); } while (0)
+#define TRACE_END(E)                                                    \
+  do { if (traceRingActive) traceRingRecord_ ((E), 'E', 0, 0); } while (0)
+#define TRACE_INSTANT(E, A, B)                                          \
+  do { if (traceRingActive) traceRingRecord_ ((E), 'i', (A), (B)); } while (0)
+
+/* A span lasting until the end of the enclosing block, however it is
+ * left. An end is only recorded if the beginning was */
+int  traceRingSpanBegin_ (enum TraceRingEvent, uint32_t a, uint32_t b);
+void traceRingSpanEnd_ (int *event);
+
+#define TRACE_SPAN_VAR_(L) traceRingSpan_ ## L
+#define TRACE_SPAN_VAR(L) TRACE_SPAN_VAR_(L)
+#define TRACE_SPAN(E, A, B)                                             \
+  int TRACE_SPAN_VAR(__LINE__) __attribute__((cleanup (traceRingSpanEnd_))) = \
+    traceRingActive ? traceRingSpanBegin_ ((E), (A), (B)) : -1
+
+#endif /* header guard */
+
+/* arch-tag: 3d8b6f41-c2a7-49e0-8f15-b7e42a9d0c63
+ */
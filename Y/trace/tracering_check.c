@@ -0,0 +1,157 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/trace/tracering.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+const char *checkName;
+const char *checkModule;
+
+/* reads the whole dump into a string */
+static char *
+tracering_check_dump (void)
+{
+  char filename[] = "/tmp/tracering_checkXXXXXX";
+  static char contents[65536];
+
+  int fd = mkstemp (filename);
+  if (fd < 0)
+    return NULL;
+  close (fd);
+
+  if (!traceRingDump (filename))
+    return NULL;
+
+  FILE *f = fopen (filename, "r");
+  size_t len = fread (contents, 1, sizeof(contents) - 1, f);
+  contents[len] = '\0';
+  fclose (f);
+  unlink (filename);
+  return contents;
+}
+
+static int
+tracering_check_count (const char *haystack, const char *needle)
+{
+  int n = 0;
+  for (const char *p = strstr (haystack, needle); p; p = strstr (p + 1, needle))
+    n++;
+  return n;
+}
+
+static void
+tracering_check_nested (void)
+{
+  TRACE_SPAN (treDespatch, 3, 42);
+  {
+    TRACE_SPAN (trePaint, 7, 0);
+    TRACE_INSTANT (treObjectAdded, 1, 7);
+  }
+}
+
+static void *
+tracering_check_thread (void *data)
+{
+  TRACE_INSTANT (treObjectAdded, 2, 99);
+  return NULL;
+}
+
+static int
+tracering_check_functionality (void)
+{
+  char *dump;
+
+  checkModule = "functionality";
+
+  /* Nothing is recorded while stopped */
+  tracering_check_nested ();
+  traceRingStart (16);
+  dump = tracering_check_dump ();
+  CHECK_THAT ( dump != NULL );
+  CHECK_THAT ( strstr (dump, "\"traceEvents\"") != NULL );
+  CHECK_THAT ( strstr (dump, "\"name\"") == NULL );
+
+  /* Spans end in the reverse order they began, as their blocks do */
+  tracering_check_nested ();
+  dump = tracering_check_dump ();
+  CHECK_THAT ( tracering_check_count (dump, "\"name\"") == 5 );
+  const char *b1 = strstr (dump, "{\"name\":\"despatch\",\"ph\":\"B\"");
+  const char *b2 = strstr (dump, "{\"name\":\"paint\",\"ph\":\"B\"");
+  const char *i1 = strstr (dump, "{\"name\":\"objectAdded\",\"ph\":\"i\"");
+  const char *e2 = strstr (dump, "{\"name\":\"paint\",\"ph\":\"E\"");
+  const char *e1 = strstr (dump, "{\"name\":\"despatch\",\"ph\":\"E\"");
+  CHECK_THAT ( b1 && b2 && i1 && e2 && e1 );
+  CHECK_THAT ( b1 < b2 && b2 < i1 && i1 < e2 && e2 < e1 );
+  CHECK_THAT ( strstr (dump, "\"args\":{\"op\":3,\"id\":42}") != NULL );
+  CHECK_THAT ( strstr (dump, "\"args\":{\"client\":1,\"object\":7}") != NULL );
+
+  /* A full ring keeps only the newest records */
+  traceRingStart (16);
+  for (uint32_t i = 0; i < 40; ++i)
+    TRACE_INSTANT (treObjectAdded, 0, i);
+  dump = tracering_check_dump ();
+  CHECK_THAT ( tracering_check_count (dump, "\"name\"") == 16 );
+  CHECK_THAT ( strstr (dump, "\"object\":23}") == NULL );
+  CHECK_THAT ( strstr (dump, "\"object\":24}") != NULL );
+  CHECK_THAT ( strstr (dump, "\"object\":39}") != NULL );
+
+  /* Other threads get rings of their own */
+  traceRingStart (16);
+  pthread_t thread;
+  pthread_create (&thread, NULL, tracering_check_thread, NULL);
+  pthread_join (thread, NULL);
+  TRACE_INSTANT (treObjectAdded, 1, 1);
+  dump = tracering_check_dump ();
+  CHECK_THAT ( tracering_check_count (dump, "\"name\"") == 2 );
+  CHECK_THAT ( strstr (dump, "\"object\":99}") != NULL );
+
+  /* and a span begun while stopped doesn't end once started */
+  traceRingStop ();
+  {
+    TRACE_SPAN (treLayout, 1, 0);
+    traceRingStart (16);
+  }
+  dump = tracering_check_dump ();
+  CHECK_THAT ( strstr (dump, "\"name\"") == NULL );
+
+  CHECK_THAT ( !traceRingDump ("/nonexistent/directory/trace") );
+
+  traceRingFinalise ();
+  CHECK_THAT ( !traceRingActive );
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "TraceRing";
+  failed = tracering_check_functionality () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 6e1f9d27-a4b8-43c5-9072-d3b58e6a1c94
+ */
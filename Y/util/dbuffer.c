@@ -34,12 +34,28 @@
 #define DBUFFER_ELEMENT_SIZE 4000
 /* Free some buffers when we have this many free */
 #define DBUFFER_ELEMENTS_FREE_THRESHOLD 100
+/* Shared runs shorter than this are copied instead; an element to
+ * point at them would cost more than the copy */
+#define DBUFFER_SHARE_MIN 256
 
+struct dbuffer_shared
+{
+  unsigned int refs;
+  size_t len;
+  char data[];
+};
+
+/* An element either holds its bytes in data, or points into a shared
+ * block and has no data of its own. A shared element is never the
+ * tail, so buf->end always points into one of the former
+ */
 struct dbuffer_element
 {
   struct dbuffer_element *next;
   size_t space, len;
-  char data[DBUFFER_ELEMENT_SIZE];
+  char *base;
+  struct dbuffer_shared *shared;
+  char data[];
 };
 
 static int free_elements = 0, allocated_elements = 0;
@@ -50,7 +66,7 @@ allocate_element(void)
 {
   if (free_elements == 0)
     {
-      struct dbuffer_element *new = ymalloc(sizeof(struct dbuffer_element));
+      struct dbuffer_element *new = ymalloc(sizeof(struct dbuffer_element) + DBUFFER_ELEMENT_SIZE);
       new->next = free_element_list;
       free_element_list = new;
       free_elements++;
@@ -65,12 +81,20 @@ allocate_element(void)
   e->space = DBUFFER_ELEMENT_SIZE;
   e->len = 0;
   e->next = NULL;
+  e->base = &e->data[0];
+  e->shared = NULL;
   return e;
 }
 
 static void
 free_element(struct dbuffer_element *e)
 {
+  if (e->shared)
+    {
+      dbuffer_shared_unref(e->shared);
+      yfree(e);
+      return;
+    }
   e->next = free_element_list;
   free_element_list = e;
   free_elements++;
@@ -109,7 +133,7 @@ new_dbuffer(void)
   buf->len = 0;
   buf->space = DBUFFER_ELEMENT_SIZE;
   buf->head = buf->tail = allocate_element();
-  buf->start = buf->end = &buf->head->data[0];
+  buf->start = buf->end = buf->head->base;
   return buf;
 }
 
@@ -184,11 +208,114 @@ dbuffer_add(struct dbuffer *buf, const char *data, size_t len)
 	{
 	  e = e->next;
           assert(e != NULL);
-	  buf->end = &e->data[0];
+	  buf->end = e->base;
 	}
     }
 }
 
+/** \brief Allocate a block of bytes for sharing between dbuffers
+ * \param len size of the block
+ * \return the block, holding one reference
+ */
+struct dbuffer_shared *
+new_dbuffer_shared(size_t len)
+{
+  struct dbuffer_shared *shared = ymalloc(sizeof(struct dbuffer_shared) + len);
+  shared->refs = 1;
+  shared->len = len;
+  return shared;
+}
+
+char *
+dbuffer_shared_data(struct dbuffer_shared *shared)
+{
+  return shared->data;
+}
+
+size_t
+dbuffer_shared_len(const struct dbuffer_shared *shared)
+{
+  return shared->len;
+}
+
+/** \brief Drop a reference to a shared block, freeing it with the last */
+void
+dbuffer_shared_unref(struct dbuffer_shared *shared)
+{
+  if (shared && --shared->refs == 0)
+    yfree(shared);
+}
+
+/** \brief Append part of a shared block to a dbuffer
+ * \param buf the target buffer
+ * \param shared the block
+ * \param offset where in the block the bytes start
+ * \param len number of bytes to add
+ *
+ * \par
+ * The buffer takes a reference to the block and points at its bytes
+ * rather than copying them, so the block must not change while any
+ * buffer refers to it. Short runs are simply copied.
+ */
+void
+dbuffer_add_shared(struct dbuffer *buf, struct dbuffer_shared *shared,
+                   size_t offset, size_t len)
+{
+  if (!buf || !shared || !len)
+    return;
+  assert(offset + len <= shared->len);
+  if (len < DBUFFER_SHARE_MIN)
+    {
+      dbuffer_add(buf, shared->data + offset, len);
+      return;
+    }
+
+  struct dbuffer_element *s = ymalloc(sizeof(struct dbuffer_element));
+  s->space = 0;
+  s->len = len;
+  s->base = shared->data + offset;
+  s->shared = shared;
+  shared->refs++;
+
+  /* The element buf->end points into is the first with any space */
+  struct dbuffer_element *prev = NULL, *w = buf->head;
+  while (w->space == 0)
+    {
+      prev = w;
+      w = w->next;
+    }
+
+  if (w->len == 0)
+    {
+      /* Nothing written there yet, so it can simply follow */
+      s->next = w;
+      if (prev)
+        prev->next = s;
+      else
+        {
+          buf->head = s;
+          buf->start = s->base;
+        }
+    }
+  else
+    {
+      /* The rest of w's space is given up, and writing carries on in
+       * the next element */
+      buf->space -= w->space;
+      w->space = 0;
+      if (w->next == NULL)
+        {
+          w->next = allocate_element();
+          buf->tail = w->next;
+          buf->space += DBUFFER_ELEMENT_SIZE;
+        }
+      s->next = w->next;
+      w->next = s;
+      buf->end = s->next->base;
+    }
+  buf->len += len;
+}
+
 /** \brief Read data from a dbuffer
  * \param buf the source buffer
  * \param data pointer to where the data should be copied
@@ -221,7 +348,7 @@ dbuffer_get(const struct dbuffer *buf, char *data, size_t len)
       data += l;
       len -= l;
       e = e->next;
-      p = &e->data[0];
+      p = e ? e->base : NULL;
       read += l;
     }
   return read;
@@ -257,9 +384,9 @@ dbuffer_remove(struct dbuffer *buf, size_t len)
 	  else
 	    {
 	      assert(buf->len == 0);
-	      buf->end = &buf->head->data[0];
+	      buf->end = buf->head->base;
 	    }
-	  buf->start = &buf->head->data[0];
+	  buf->start = buf->head->base;
 	}
     }
   return removed;
@@ -309,14 +436,75 @@ dbuffer_extract(struct dbuffer *buf, char *data, size_t len)
 	  else
 	    {
 	      assert(buf->len == 0);
-	      buf->end = &buf->head->data[0];
+	      buf->end = buf->head->base;
 	    }
-	  buf->start = &buf->head->data[0];
+	  buf->start = buf->head->base;
 	}
     }
   return extracted;
 }
 
+/** \brief Look at the start of a dbuffer in place
+ * \param buf the source buffer
+ * \param len number of bytes wanted
+ * \return pointer to the first \c len bytes, or NULL
+ *
+ * \par
+ * Returns a pointer straight into the buffer's storage if the first
+ * \c len bytes are all held in the first element, and the element
+ * has room for at least one byte beyond them; otherwise NULL, and
+ * the caller will have to copy them out with dbuffer_get().
+ *
+ * \par
+ * The caller may modify the bytes, and may temporarily overwrite the
+ * byte after them (which will be either unused space or the start of
+ * the next data), provided it puts it back before the buffer is used
+ * again.
+ */
+char *
+dbuffer_head(struct dbuffer *buf, size_t len)
+{
+  if (!buf || len > buf->len || len > buf->head->len || buf->head->shared)
+    return NULL;
+  if (buf->start + len >= &buf->head->data[DBUFFER_ELEMENT_SIZE])
+    return NULL;
+  return buf->start;
+}
+
+/** \brief Describe the contents of a dbuffer for scatter/gather I/O
+ * \param buf the source buffer
+ * \param iov array to fill in
+ * \param max number of entries in \c iov
+ * \return number of entries used
+ *
+ * \par
+ * Fills in \c iov with the location of each contiguous run of bytes
+ * from the start of the buffer, so that the buffer can be written out
+ * with a single writev() without copying. If there are more than
+ * \c max runs, only the first \c max are described.
+ *
+ * \par
+ * The entries point into the buffer, so they are only valid until it
+ * is next modified.
+ */
+int
+dbuffer_iovec(const struct dbuffer *buf, struct iovec *iov, int max)
+{
+  int n = 0;
+  const struct dbuffer_element *e;
+  if (!buf || !iov)
+    return 0;
+  e = buf->head;
+  while (n < max && e && e->len > 0)
+    {
+      iov[n].iov_base = (e == buf->head) ? buf->start : e->base;
+      iov[n].iov_len = e->len;
+      n++;
+      e = e->next;
+    }
+  return n;
+}
+
 /** \brief Locate the first occurance of a character in a dbuffer
  * \param buf dbuffer to search
  * \param c character to search for
@@ -340,7 +528,7 @@ dbuffer_find_char(const struct dbuffer *buf, int c)
       if (e == buf->head)
 	start = buf->start;
       else
-	start = e->data;
+	start = e->base;
       if ((p = memchr(start, c, e->len)))
 	{
 	  pos += p - start;
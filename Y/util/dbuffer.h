@@ -22,6 +22,7 @@ struct dbuffer;
 #define Y_UTIL_DBUFFER_H
 
 #include <sys/types.h>
+#include <sys/uio.h>
 
 /** \file dbuffer.h
  * \brief Data buffers (struct dbuffer)
@@ -38,6 +39,11 @@ struct dbuffer;
 
 struct dbuffer_element;
 
+/** \brief Reference counted block of bytes which several dbuffers can
+ * point into instead of each holding a copy
+ */
+struct dbuffer_shared;
+
 /** \brief Opaque dbuffer struct
  * \internal
  * Stores pointers that describe the dbuffer (the actual data is kept
@@ -84,12 +90,30 @@ extern void free_dbuffer(struct dbuffer *);
 
 /* Append the given byte string to the buffer */
 extern void dbuffer_add(struct dbuffer *, const char *, size_t);
+extern struct dbuffer_shared *new_dbuffer_shared(size_t) __attribute__((malloc));
+extern char *dbuffer_shared_data(struct dbuffer_shared *);
+extern size_t dbuffer_shared_len(const struct dbuffer_shared *);
+extern void dbuffer_shared_unref(struct dbuffer_shared *);
+
+/* Append len bytes of the shared block from offset, by reference */
+extern void dbuffer_add_shared(struct dbuffer *, struct dbuffer_shared *, size_t offset, size_t len);
 /* Read the given number of bytes from the start of the buffer */
 extern size_t dbuffer_get(const struct dbuffer *, char *, size_t);
 /* Remove the given number of bytes from the start of the buffer */
 extern size_t dbuffer_remove(struct dbuffer *, size_t);
 /* Read and remove in one pass */
 extern size_t dbuffer_extract(struct dbuffer *, char *, size_t);
+/* Return a pointer to the first bytes of the buffer if they are
+ * stored contiguously, with room for at least one more byte after
+ * them, or NULL if not. The bytes may be modified in place, and the
+ * byte after them may be overwritten as long as it is restored before
+ * the buffer is next used
+ */
+extern char *dbuffer_head(struct dbuffer *, size_t);
+/* Describe the start of the buffer with up to max iovecs, for writev();
+ * returns the number used
+ */
+extern int dbuffer_iovec(const struct dbuffer *, struct iovec *, int);
 /* Find the offset of the first occurance of this character, return -1 if not found */
 extern ssize_t dbuffer_find_char(const struct dbuffer *, int);
 
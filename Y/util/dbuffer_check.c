@@ -0,0 +1,184 @@
+/************************************************************************
+ *   Copyright (C) Andrew Suffield <asuffield@debian.org>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/util/dbuffer.h>
+#include <Y/util/yutil.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+const char *checkName;
+const char *checkModule;
+
+#define DBUFFER_CHECK_MODEL_SIZE (1 << 20)
+#define DBUFFER_CHECK_ROUNDS 20000
+
+/* What the buffer should hold, kept flat */
+static char dbuffer_check_model[DBUFFER_CHECK_MODEL_SIZE];
+static size_t dbuffer_check_modelLen;
+
+static int
+dbuffer_check_same (struct dbuffer *buf)
+{
+  static char contents[DBUFFER_CHECK_MODEL_SIZE];
+
+  CHECK_THAT ( dbuffer_len (buf) == dbuffer_check_modelLen );
+  CHECK_THAT ( dbuffer_get (buf, contents, sizeof (contents)) == dbuffer_check_modelLen );
+  CHECK_THAT ( memcmp (contents, dbuffer_check_model, dbuffer_check_modelLen) == 0 );
+
+  /* The iovecs describe the same bytes, in order */
+  struct iovec iov[64];
+  int n = dbuffer_iovec (buf, iov, 64);
+  size_t at = 0;
+  for (int i = 0; i < n; ++i)
+    {
+      CHECK_THAT ( iov[i].iov_len > 0 );
+      CHECK_THAT ( memcmp (iov[i].iov_base, dbuffer_check_model + at, iov[i].iov_len) == 0 );
+      at += iov[i].iov_len;
+    }
+  CHECK_THAT ( n == 64 || at == dbuffer_check_modelLen );
+  return 0;
+}
+
+static void
+dbuffer_check_fill (char *p, size_t len, unsigned int seed)
+{
+  for (size_t i = 0; i < len; ++i)
+    p[i] = (char)(seed + i * 7);
+}
+
+static int
+dbuffer_check_shared (void)
+{
+  checkModule = "shared";
+
+  struct dbuffer *a = new_dbuffer ();
+  struct dbuffer *b = new_dbuffer ();
+  struct dbuffer_shared *block = new_dbuffer_shared (10000);
+  dbuffer_check_fill (dbuffer_shared_data (block), 10000, 1);
+
+  /* Two buffers can hold the same block, around bytes of their own */
+  dbuffer_add (a, "head", 4);
+  dbuffer_add_shared (a, block, 100, 5000);
+  dbuffer_add (a, "tail", 4);
+  dbuffer_add_shared (b, block, 0, 10000);
+  dbuffer_shared_unref (block);
+
+  dbuffer_check_modelLen = 0;
+  memcpy (dbuffer_check_model, "head", 4);
+  dbuffer_check_fill (dbuffer_check_model + 4, 5000, 1 + 100 * 7);
+  memcpy (dbuffer_check_model + 5004, "tail", 4);
+  dbuffer_check_modelLen = 5008;
+  CHECK_THAT ( dbuffer_check_same (a) == 0 );
+  CHECK_THAT ( dbuffer_find_char (a, 'l') ==
+               (char *)memchr (dbuffer_check_model, 'l', 5008) - dbuffer_check_model );
+
+  /* The shared bytes can't be handed out for changing in place */
+  dbuffer_remove (a, 4);
+  CHECK_THAT ( dbuffer_head (a, 16) == NULL );
+  dbuffer_remove (a, 5000);
+  CHECK_THAT ( dbuffer_head (a, 4) != NULL );
+
+  /* Releasing one holder leaves the other intact */
+  free_dbuffer (a);
+  dbuffer_check_fill (dbuffer_check_model, 10000, 1);
+  dbuffer_check_modelLen = 10000;
+  CHECK_THAT ( dbuffer_check_same (b) == 0 );
+  free_dbuffer (b);
+
+  return 0;
+}
+
+static int
+dbuffer_check_random (void)
+{
+  checkModule = "random";
+
+  struct dbuffer *buf = new_dbuffer ();
+  struct dbuffer_shared *block = new_dbuffer_shared (6000);
+  dbuffer_check_fill (dbuffer_shared_data (block), 6000, 3);
+  char data[6000];
+  dbuffer_check_modelLen = 0;
+
+  srand (1);
+  for (int round = 0; round < DBUFFER_CHECK_ROUNDS; ++round)
+    {
+      size_t len = rand () % 6000;
+      switch (rand () % 4)
+        {
+        case 0:
+          if (dbuffer_check_modelLen + len > DBUFFER_CHECK_MODEL_SIZE)
+            break;
+          dbuffer_check_fill (data, len, round);
+          dbuffer_add (buf, data, len);
+          memcpy (dbuffer_check_model + dbuffer_check_modelLen, data, len);
+          dbuffer_check_modelLen += len;
+          break;
+        case 1:
+          {
+            size_t offset = rand () % (6000 - len + 1);
+            if (dbuffer_check_modelLen + len > DBUFFER_CHECK_MODEL_SIZE)
+              break;
+            dbuffer_add_shared (buf, block, offset, len);
+            memcpy (dbuffer_check_model + dbuffer_check_modelLen,
+                    dbuffer_shared_data (block) + offset, len);
+            dbuffer_check_modelLen += len;
+            break;
+          }
+        case 2:
+          len = MIN(len, dbuffer_check_modelLen);
+          CHECK_THAT ( dbuffer_remove (buf, len) == len );
+          memmove (dbuffer_check_model, dbuffer_check_model + len,
+                   dbuffer_check_modelLen - len);
+          dbuffer_check_modelLen -= len;
+          break;
+        case 3:
+          len = MIN(len, dbuffer_check_modelLen);
+          CHECK_THAT ( dbuffer_extract (buf, data, len) == len );
+          CHECK_THAT ( memcmp (data, dbuffer_check_model, len) == 0 );
+          memmove (dbuffer_check_model, dbuffer_check_model + len,
+                   dbuffer_check_modelLen - len);
+          dbuffer_check_modelLen -= len;
+          break;
+        }
+      if (round % 100 == 0)
+        CHECK_THAT ( dbuffer_check_same (buf) == 0 );
+    }
+
+  CHECK_THAT ( dbuffer_check_same (buf) == 0 );
+  free_dbuffer (buf);
+  dbuffer_shared_unref (block);
+  dbuffer_cleanup ();
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "DBuffer";
+  failed = dbuffer_check_shared () ? 1 : failed;
+  failed = dbuffer_check_random () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 5c0e8d73-b2a4-4f19-9e67-d13a8f4b2c06
+ */
@@ -0,0 +1,160 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/util/perf.h>
+#include <Y/util/yutil.h>
+
+#include <string.h>
+#include <time.h>
+
+uint64_t perfCounters[perfCounterCount];
+struct PerfHistogramData perfHistograms[perfHistogramCount];
+
+/* method calls, indexed by class id; class ids are handed out densely
+ * from 1, so this stays small */
+static uint64_t *perfCalls = NULL;
+static int perfCallsSize = 0;
+
+static const char *perfCounterNames[perfCounterCount] =
+  {
+    [perfIterations]     = "iterations",
+    [perfMessages]       = "messages",
+    [perfClientMessages] = "clientMessages",
+    [perfBytesIn]        = "bytesIn",
+    [perfBytesOut]       = "bytesOut",
+    [perfReads]          = "reads",
+    [perfWrites]         = "writes",
+    [perfConnections]    = "connections",
+    [perfFrames]         = "frames",
+    [perfDamagePixels]   = "damagePixels",
+  };
+
+static const char *perfHistogramNames[perfHistogramCount] =
+  {
+    [perfFrameTime]     = "frameTime",
+    [perfFrameArea]     = "frameArea",
+    [perfDespatchTime]  = "despatchTime",
+    [perfIterationTime] = "iterationTime",
+  };
+
+uint64_t
+perfNow (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+void
+perfCountCall (int classID)
+{
+  if (classID < 0)
+    return;
+  if (classID >= perfCallsSize)
+    {
+      int newSize = MAX(32, perfCallsSize * 2);
+      while (newSize <= classID)
+        newSize *= 2;
+      uint64_t *newCalls = ycalloc (newSize, sizeof (uint64_t));
+      if (perfCalls != NULL)
+        memcpy (newCalls, perfCalls, perfCallsSize * sizeof (uint64_t));
+      yfree (perfCalls);
+      perfCalls = newCalls;
+      perfCallsSize = newSize;
+    }
+  perfCalls[classID]++;
+}
+
+uint64_t
+perfGetCalls (int classID)
+{
+  if (classID < 0 || classID >= perfCallsSize)
+    return 0;
+  return perfCalls[classID];
+}
+
+int
+perfCallsLimit (void)
+{
+  return perfCallsSize;
+}
+
+const char *
+perfCounterName (enum PerfCounter c)
+{
+  return perfCounterNames[c];
+}
+
+const char *
+perfHistogramName (enum PerfHistogram h)
+{
+  return perfHistogramNames[h];
+}
+
+int
+perfFindHistogram (const char *name)
+{
+  for (int h = 0; h < perfHistogramCount; ++h)
+    if (strcmp (perfHistogramNames[h], name) == 0)
+      return h;
+  return -1;
+}
+
+uint64_t
+perfQuantile (const struct PerfHistogramData *data, double p)
+{
+  if (data -> count == 0)
+    return 0;
+
+  uint64_t rank = (uint64_t)(p * (data -> count - 1)) + 1;
+  uint64_t seen = 0;
+  for (int bucket = 0; bucket < PERF_BUCKETS; ++bucket)
+    {
+      seen += data -> buckets[bucket];
+      if (seen >= rank)
+        {
+          /* the top of the bucket, but never beyond what was seen;
+           * the last bucket has no top, so only the maximum will do */
+          if (bucket == PERF_BUCKETS - 1)
+            return data -> max;
+          uint64_t top = bucket ? ((uint64_t)1 << bucket) - 1 : 0;
+          return MIN(top, data -> max);
+        }
+    }
+  return data -> max;
+}
+
+void
+perfReset (void)
+{
+  memset (perfCounters, 0, sizeof (perfCounters));
+  memset (perfHistograms, 0, sizeof (perfHistograms));
+  if (perfCalls != NULL)
+    memset (perfCalls, 0, perfCallsSize * sizeof (uint64_t));
+}
+
+void
+perfFinalise (void)
+{
+  yfree (perfCalls);
+  perfCalls = NULL;
+  perfCallsSize = 0;
+}
+
+/* arch-tag: e4a82c6d-91f5-4b37-8d0e-2f6b9c4a7183
+ */
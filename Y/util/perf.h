@@ -0,0 +1,122 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_UTIL_PERF_H
+#define Y_UTIL_PERF_H
+
+#include <inttypes.h>
+
+/*
+ *  Server-wide performance counters and histograms, which the
+ *  Performance class hands out to clients.
+ *
+ *  Only the server thread writes them, so updating one is a plain
+ *  add with no lock; they are cheap enough to leave in the hot paths.
+ */
+
+enum PerfCounter
+  {
+    perfIterations,      /* passes round the main loop */
+    perfMessages,        /* messages despatched, from anywhere */
+    perfClientMessages,  /* messages despatched on behalf of clients */
+    perfBytesIn,         /* read from client channels */
+    perfBytesOut,        /* written to client channels */
+    perfReads,           /* read() calls on client channels */
+    perfWrites,          /* sendmsg() calls on client channels */
+    perfConnections,     /* clients accepted */
+    perfFrames,          /* viewport updates which drew something */
+    perfDamagePixels,    /* area redrawn by those updates */
+    perfCounterCount
+  };
+
+enum PerfHistogram
+  {
+    perfFrameTime,       /* microseconds to draw one viewport update */
+    perfFrameArea,       /* pixels redrawn by one viewport update */
+    perfDespatchTime,    /* microseconds to handle one client message */
+    perfIterationTime,   /* microseconds of work in one main loop pass */
+    perfHistogramCount
+  };
+
+/* Bucket 0 counts zeros, and bucket n values in [2^(n-1), 2^n); the
+ * last bucket takes everything bigger as well
+ */
+#define PERF_BUCKETS 32
+
+struct PerfHistogramData
+{
+  uint64_t count;
+  uint64_t sum;
+  uint64_t max;
+  uint64_t buckets[PERF_BUCKETS];
+};
+
+extern uint64_t perfCounters[perfCounterCount];
+extern struct PerfHistogramData perfHistograms[perfHistogramCount];
+
+static inline void
+perfCount (enum PerfCounter c, uint64_t n)
+{
+  perfCounters[c] += n;
+}
+
+static inline void
+perfRecord (enum PerfHistogram h, uint64_t value)
+{
+  struct PerfHistogramData *data = &perfHistograms[h];
+  int bucket = value ? 64 - __builtin_clzll (value) : 0;
+  if (bucket >= PERF_BUCKETS)
+    bucket = PERF_BUCKETS - 1;
+  data -> buckets[bucket]++;
+  data -> count++;
+  data -> sum += value;
+  if (value > data -> max)
+    data -> max = value;
+}
+
+/* CLOCK_MONOTONIC in microseconds */
+uint64_t    perfNow (void);
+
+/* counts one method call on the class with this id */
+void        perfCountCall (int classID);
+
+/* calls counted for a class id, or 0 for one never called */
+uint64_t    perfGetCalls (int classID);
+
+/* one more than the largest class id perfGetCalls knows about */
+int         perfCallsLimit (void);
+
+const char *perfCounterName (enum PerfCounter);
+const char *perfHistogramName (enum PerfHistogram);
+
+/* returns -1 for an unknown name */
+int         perfFindHistogram (const char *name);
+
+/* an upper bound on the pth quantile (0 <= p <= 1) of a histogram,
+ * from its buckets */
+uint64_t    perfQuantile (const struct PerfHistogramData *, double p);
+
+/* zeroes everything */
+void        perfReset (void);
+
+void        perfFinalise (void);
+
+#endif /* header guard */
+
+/* arch-tag: 5c1e9a07-3b6d-4f82-a4d0-8e27b1f6c953
+ */
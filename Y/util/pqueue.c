@@ -19,153 +19,271 @@
 #include <Y/util/pqueue.h>
 #include <Y/util/yutil.h>
 
-struct PQueueNode
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#define PQ_ARITY 4
+
+/* Handles are the slot index in the low bits and a generation count
+ * in the high bits, as for timer ids
+ */
+#define PQ_INDEX_BITS 20
+#define PQ_INDEX_MASK ((1 << PQ_INDEX_BITS) - 1)
+#define PQ_MAX_GENERATION ((1 << (31 - PQ_INDEX_BITS)) - 1)
+
+#define PQ_NONE UINT32_MAX
+
+/* What the heap itself holds; the sequence number keeps objects of
+ * equal priority in the order they were inserted
+ */
+struct PQueueEntry
 {
-  struct PQueueNode *next;
   void *obj;
+  uint64_t sequence;
+  uint32_t slot;
+};
+
+/* Where each handle's object is in the heap */
+struct PQueueSlot
+{
+  uint32_t position;            /* or the next free slot */
+  uint16_t generation;
+  bool inUse;
 };
 
 struct PQueue
 {
-  struct PQueueNode *first, *last;
   int (*comparisonFunction)(const void *obj1, const void *obj2);
-  int length;
+  struct PQueueEntry *heap;
+  uint32_t length;
+  uint32_t heapAllocated;
+  struct PQueueSlot *slots;
+  uint32_t slotsAllocated;
+  uint32_t freeList;
+  uint64_t nextSequence;
 };
 
 struct PQueue *
 pqueueCreate (int (*comparisonFunction)(const void *obj1, const void *obj2))
 {
   struct PQueue *self = ymalloc (sizeof (struct PQueue));
-  self -> first = NULL;
-  self -> last = NULL;
-  self -> length = 0;
   self -> comparisonFunction = comparisonFunction;
+  self -> heap = NULL;
+  self -> length = 0;
+  self -> heapAllocated = 0;
+  self -> slots = NULL;
+  self -> slotsAllocated = 0;
+  self -> freeList = PQ_NONE;
+  self -> nextSequence = 0;
   return self;
 }
 
 void
 pqueueDestroy (struct PQueue *self, void (*destructorFunction)(void *obj))
 {
-  struct PQueueNode *current = self -> first;
-  while (current != NULL)
-    {
-      struct PQueueNode *next = current -> next;
-      if (destructorFunction)
-        destructorFunction (current -> obj);
-      yfree (current);
-      current = next;
-    }
+  if (destructorFunction)
+    for (uint32_t i = 0; i < self -> length; ++i)
+      destructorFunction (self -> heap[i].obj);
+  yfree (self -> heap);
+  yfree (self -> slots);
   yfree (self);
 }
 
-void
-pqueueInsert (struct PQueue *self, void *obj)
+static inline bool
+pqueueBefore (const struct PQueue *self, const struct PQueueEntry *a,
+              const struct PQueueEntry *b)
 {
-  int cmp;
-  struct PQueueNode *node, *current;
-
-  node = ymalloc (sizeof (struct PQueueNode));
-  node -> obj = obj;
+  int cmp = self -> comparisonFunction (a -> obj, b -> obj);
+  if (cmp != 0)
+    return cmp < 0;
+  return a -> sequence < b -> sequence;
+}
 
-  self -> length++;
+static inline void
+pqueuePut (struct PQueue *self, uint32_t position, const struct PQueueEntry *e)
+{
+  self -> heap[position] = *e;
+  self -> slots[e -> slot].position = position;
+}
 
-  /* is it the only node */
-  if (self -> first == NULL)
+static void
+pqueueSiftUp (struct PQueue *self, uint32_t position)
+{
+  struct PQueueEntry e = self -> heap[position];
+  while (position > 0)
     {
-      self -> first = node;
-      self -> last = node;
-      node -> next = NULL;
-      return;
+      uint32_t parent = (position - 1) / PQ_ARITY;
+      if (!pqueueBefore (self, &e, &self -> heap[parent]))
+        break;
+      pqueuePut (self, position, &self -> heap[parent]);
+      position = parent;
     }
+  pqueuePut (self, position, &e);
+}
 
-  /* does it belong at the end? */
-  cmp = self -> comparisonFunction (obj, self -> last -> obj);
-  if (cmp >= 0)
+static void
+pqueueSiftDown (struct PQueue *self, uint32_t position)
+{
+  struct PQueueEntry e = self -> heap[position];
+  for (;;)
     {
-      self -> last -> next = node;
-      self -> last = node;
-      node -> next = NULL;
-      return;
+      uint32_t first = position * PQ_ARITY + 1;
+      if (first >= self -> length)
+        break;
+      uint32_t last = MIN(first + PQ_ARITY, self -> length);
+      uint32_t best = first;
+      for (uint32_t child = first + 1; child < last; ++child)
+        if (pqueueBefore (self, &self -> heap[child], &self -> heap[best]))
+          best = child;
+      if (!pqueueBefore (self, &self -> heap[best], &e))
+        break;
+      pqueuePut (self, position, &self -> heap[best]);
+      position = best;
     }
- 
-  /* does it belong at the beginning? */ 
-  cmp = self -> comparisonFunction (obj, self -> first -> obj);
-  if (cmp < 0)
+  pqueuePut (self, position, &e);
+}
+
+static uint32_t
+pqueueAllocateSlot (struct PQueue *self)
+{
+  if (self -> freeList == PQ_NONE)
     {
-      node -> next = self -> first;
-      self -> first = node;
-      return;
+      uint32_t oldSize = self -> slotsAllocated;
+      uint32_t newSize = oldSize ? oldSize * 2 : 64;
+      assert (newSize <= PQ_INDEX_MASK + 1);
+      struct PQueueSlot *slots = ymalloc (sizeof (struct PQueueSlot) * newSize);
+      if (oldSize)
+        memcpy (slots, self -> slots, sizeof (struct PQueueSlot) * oldSize);
+      yfree (self -> slots);
+      self -> slots = slots;
+      self -> slotsAllocated = newSize;
+
+      /* Thread the new slots onto the free list, lowest first */
+      for (uint32_t i = newSize; i > oldSize; --i)
+        {
+          slots[i - 1].inUse = false;
+          slots[i - 1].generation = 1;
+          slots[i - 1].position = self -> freeList;
+          self -> freeList = i - 1;
+        }
     }
 
-  /* find which node it belongs after */
-  current = self -> first;
-  while (current -> next != NULL)
+  uint32_t slot = self -> freeList;
+  self -> freeList = self -> slots[slot].position;
+  self -> slots[slot].inUse = true;
+  return slot;
+}
+
+static void
+pqueueFreeSlot (struct PQueue *self, uint32_t slot)
+{
+  struct PQueueSlot *s = &self -> slots[slot];
+  s -> inUse = false;
+  s -> generation = s -> generation == PQ_MAX_GENERATION ? 1 : s -> generation + 1;
+  s -> position = self -> freeList;
+  self -> freeList = slot;
+}
+
+int
+pqueueInsert (struct PQueue *self, void *obj)
+{
+  if (self -> length == self -> heapAllocated)
     {
-      cmp = self -> comparisonFunction (obj, current -> next -> obj);
-      if (cmp < 0)
-        break;
-      current = current -> next;
+      self -> heapAllocated = self -> heapAllocated ? self -> heapAllocated * 2 : 64;
+      struct PQueueEntry *heap = ymalloc (sizeof (struct PQueueEntry) * self -> heapAllocated);
+      if (self -> length)
+        memcpy (heap, self -> heap, sizeof (struct PQueueEntry) * self -> length);
+      yfree (self -> heap);
+      self -> heap = heap;
     }
 
-  node -> next = current -> next;
-  current -> next = node;
-  return;
+  uint32_t slot = pqueueAllocateSlot (self);
+  struct PQueueEntry e = { obj, self -> nextSequence++, slot };
+  self -> heap[self -> length++] = e;
+  pqueueSiftUp (self, self -> length - 1);
 
+  return (self -> slots[slot].generation << PQ_INDEX_BITS) | slot;
+}
+
+/* Takes the entry at position out of the heap */
+static void *
+pqueueTake (struct PQueue *self, uint32_t position)
+{
+  void *obj = self -> heap[position].obj;
+  pqueueFreeSlot (self, self -> heap[position].slot);
+
+  self -> length--;
+  if (position < self -> length)
+    {
+      /* the last entry fills the hole, and may belong either way */
+      pqueuePut (self, position, &self -> heap[self -> length]);
+      if (position > 0
+          && pqueueBefore (self, &self -> heap[position],
+                           &self -> heap[(position - 1) / PQ_ARITY]))
+        pqueueSiftUp (self, position);
+      else
+        pqueueSiftDown (self, position);
+    }
+  return obj;
 }
 
 void *
 pqueueGetNext (struct PQueue *self)
 {
-  struct PQueueNode *first;
-  void *obj;
-
-  first = self -> first;
-  if (first == NULL)
+  if (self -> length == 0)
     return NULL;
-
-  self -> length --;
-  self -> first = first -> next;
-  if (self -> first == NULL)
-    self -> last = NULL;
-
-  obj = first -> obj;
-  yfree (first);
-  return obj; 
+  return pqueueTake (self, 0);
 }
 
 void *
 pqueuePeekNext (const struct PQueue *self)
 {
-  if (self -> first == NULL)
+  if (self -> length == 0)
+    return NULL;
+  return self -> heap[0].obj;
+}
+
+void *
+pqueueCancel (struct PQueue *self, int handle)
+{
+  if (handle <= 0)
+    return NULL;
+
+  uint32_t slot = handle & PQ_INDEX_MASK;
+  uint16_t generation = handle >> PQ_INDEX_BITS;
+  if (slot >= self -> slotsAllocated)
     return NULL;
-  return self -> first -> obj;
+
+  struct PQueueSlot *s = &self -> slots[slot];
+  if (!s -> inUse || s -> generation != generation)
+    return NULL;
+
+  return pqueueTake (self, s -> position);
 }
 
 void
 pqueueRemove (struct PQueue *self, void *userData, int (*testFunction)(void *obj, void *data))
 {
-  struct PQueueNode *previous = NULL;
-  struct PQueueNode *current = self -> first;
-  while (current != NULL)
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < self -> length; ++i)
     {
-      struct PQueueNode *next = current -> next;
-      if (testFunction (current->obj, userData) != 0)
-        {
-          if (previous == NULL)
-              self -> first = next;
-          else
-              previous -> next = next;
-          yfree (current);
-          current = next;
-          if (current == NULL)
-            self -> last = previous;
-        }
+      if (testFunction (self -> heap[i].obj, userData) != 0)
+        pqueueFreeSlot (self, self -> heap[i].slot);
       else
-        {
-          previous = current;
-          current = next;
-        }
+        self -> heap[kept++] = self -> heap[i];
     }
+  if (kept == self -> length)
+    return;
+
+  /* put the survivors back in order, bottom up */
+  self -> length = kept;
+  for (uint32_t i = 0; i < kept; ++i)
+    self -> slots[self -> heap[i].slot].position = i;
+  for (uint32_t i = kept / PQ_ARITY + 1; i > 0; --i)
+    if (i - 1 < kept)
+      pqueueSiftDown (self, i - 1);
 }
 
 int
@@ -21,18 +21,49 @@
 
 struct PQueue;
 
+/*
+ *  A priority queue, kept as a 4-ary heap in an array.
+ *
+ *  Inserting, taking the next object and cancelling are O(log n), and
+ *  no memory is allocated per insert once the arrays have grown. Each
+ *  object is identified by a positive handle which stays unique until
+ *  its slot has been reused many times over, so cancelling an object
+ *  which has already left the queue is harmless. Objects which compare
+ *  equal come out in the order they went in.
+ *
+ *   comparisonFunction:  a function whose return value is:
+ *                             < 0    iff  obj1 comes out before obj2
+ *                             = 0    iff  they are of equal priority
+ *                             > 0    iff  obj1 comes out after obj2
+ */
 struct PQueue *pqueueCreate (int (*comparisonFunction)(const void *obj1, const void *obj2));
 
+/*
+ *  Destroys a queue
+ *   destructorFunction:  if non-null, this is called on all objects
+ *                        still queued
+ */
 void          pqueueDestroy (struct PQueue *,
                              void (*destructorFunction)(void *obj));
 
-void          pqueueInsert (struct PQueue *, void *obj);
+/* queues obj, and returns its handle */
+int           pqueueInsert (struct PQueue *, void *obj);
 
+/* removes and returns the first object, or NULL if the queue is empty */
 void *        pqueueGetNext (struct PQueue *);
 void *        pqueuePeekNext (const struct PQueue *);
 
 int           pqueueLength (const struct PQueue *);
 
+/* removes an object by its handle; returns it, or NULL if the handle
+ * is unknown or the object has already left the queue. DOES NOT
+ * free() THE OBJECT
+ */
+void *        pqueueCancel (struct PQueue *, int handle);
+
+/* removes every object for which testFunction returns non-zero; this
+ * has to look at them all, so is O(n). DOES NOT free() THE OBJECTS
+ */
 void          pqueueRemove (struct PQueue *, void *userData, int (*testFunction)(void *obj, void *data));
 
 #endif
@@ -110,6 +110,226 @@ pqueue_check_functionality (void)
     
 }
 
+#define HANDLES_NUM_CHECK 300
+
+static int
+pqueue_check_handles (void)
+{
+  struct PQueue *pqueue;
+  struct pqueue_check_Functionality objs[HANDLES_NUM_CHECK];
+  struct pqueue_check_Functionality *obj;
+  int handles[HANDLES_NUM_CHECK];
+  int i;
+  long int last;
+
+  checkModule = "handles";
+
+  pqueue = pqueueCreate (pqueue_check_functionality_comparisonFunction);
+  for (i=0; i<HANDLES_NUM_CHECK; ++i)
+    {
+      objs[i].priority = random () % 50;
+      objs[i].checkCode = i;
+      handles[i] = pqueueInsert (pqueue, &objs[i]);
+      CHECK_THAT ( handles[i] > 0 );
+    }
+
+  /* cancel every third one */
+  for (i=0; i<HANDLES_NUM_CHECK; i+=3)
+    CHECK_THAT ( pqueueCancel (pqueue, handles[i]) == &objs[i] );
+  CHECK_THAT ( pqueueLength (pqueue) == HANDLES_NUM_CHECK - HANDLES_NUM_CHECK / 3 );
+
+  /* a handle only works once */
+  CHECK_THAT ( pqueueCancel (pqueue, handles[0]) == NULL );
+  CHECK_THAT ( pqueueCancel (pqueue, 0) == NULL );
+  CHECK_THAT ( pqueueCancel (pqueue, -1) == NULL );
+
+  /* the rest come out in order, equal priorities in the order they
+   * went in */
+  last = -1;
+  int lastCode = -1;
+  while ((obj = pqueueGetNext (pqueue)) != NULL)
+    {
+      CHECK_THAT ( obj -> checkCode % 3 != 0 );
+      CHECK_THAT ( last <= obj -> priority );
+      if (last == obj -> priority)
+        CHECK_THAT ( lastCode < obj -> checkCode );
+      last = obj -> priority;
+      lastCode = obj -> checkCode;
+    }
+  CHECK_THAT ( pqueueLength (pqueue) == 0 );
+
+  /* handles of objects which have come out are stale, even once their
+   * slots are reused */
+  for (i=0; i<HANDLES_NUM_CHECK; ++i)
+    pqueueInsert (pqueue, &objs[i]);
+  for (i=1; i<HANDLES_NUM_CHECK; i+=3)
+    CHECK_THAT ( pqueueCancel (pqueue, handles[i]) == NULL );
+  CHECK_THAT ( pqueueLength (pqueue) == HANDLES_NUM_CHECK );
+
+  pqueueDestroy (pqueue, NULL);
+  return 0;
+}
+
+static int
+pqueue_check_remove_test (void *obj_v, void *data)
+{
+  struct pqueue_check_Functionality *obj = obj_v;
+  return obj -> checkCode % 2 == 0;
+}
+
+static int
+pqueue_check_remove (void)
+{
+  struct PQueue *pqueue;
+  struct pqueue_check_Functionality objs[HANDLES_NUM_CHECK];
+  struct pqueue_check_Functionality *obj;
+  int handles[HANDLES_NUM_CHECK];
+  int i;
+  long int last;
+
+  checkModule = "remove";
+
+  pqueue = pqueueCreate (pqueue_check_functionality_comparisonFunction);
+  for (i=0; i<HANDLES_NUM_CHECK; ++i)
+    {
+      objs[i].priority = random ();
+      objs[i].checkCode = i;
+      handles[i] = pqueueInsert (pqueue, &objs[i]);
+    }
+
+  pqueueRemove (pqueue, NULL, pqueue_check_remove_test);
+  CHECK_THAT ( pqueueLength (pqueue) == HANDLES_NUM_CHECK / 2 );
+
+  /* the survivors' handles still work */
+  CHECK_THAT ( pqueueCancel (pqueue, handles[0]) == NULL );
+  CHECK_THAT ( pqueueCancel (pqueue, handles[1]) == &objs[1] );
+
+  last = -1;
+  while ((obj = pqueueGetNext (pqueue)) != NULL)
+    {
+      CHECK_THAT ( obj -> checkCode % 2 == 1 && obj -> checkCode != 1 );
+      CHECK_THAT ( last <= obj -> priority );
+      last = obj -> priority;
+    }
+
+  pqueueDestroy (pqueue, NULL);
+  return 0;
+}
+
+/* The sorted list the heap replaced, for comparison */
+struct pqueue_check_ListNode
+{
+  struct pqueue_check_ListNode *next;
+  void *obj;
+};
+
+static void
+pqueue_check_list_insert (struct pqueue_check_ListNode **first, void *obj)
+{
+  struct pqueue_check_ListNode *node = ymalloc (sizeof (*node));
+  node -> obj = obj;
+  while (*first != NULL
+         && pqueue_check_functionality_comparisonFunction (obj, (*first) -> obj) >= 0)
+    first = &(*first) -> next;
+  node -> next = *first;
+  *first = node;
+}
+
+static void *
+pqueue_check_list_remove (struct pqueue_check_ListNode **first, void *obj)
+{
+  for (; *first != NULL; first = &(*first) -> next)
+    if ((*first) -> obj == obj)
+      {
+        struct pqueue_check_ListNode *node = *first;
+        *first = node -> next;
+        yfree (node);
+        return obj;
+      }
+  return NULL;
+}
+
+static double
+pqueue_check_now (void)
+{
+  struct timespec now;
+  clock_gettime (CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/* Something like the timers' pattern: a steady number pending, each
+ * round inserting one, cancelling an older one and taking the next
+ */
+#define THROUGHPUT_PENDING 1000
+#define THROUGHPUT_ROUNDS 20000
+
+static int
+pqueue_check_throughput (void)
+{
+  static struct pqueue_check_Functionality objs[THROUGHPUT_PENDING * 2];
+  static int handles[THROUGHPUT_PENDING * 2];
+  struct pqueue_check_ListNode *list = NULL;
+  struct PQueue *pqueue;
+  double start, heapTime, listTime;
+  long int clock;
+  int i, n = THROUGHPUT_PENDING * 2;
+
+  checkModule = "throughput";
+
+  pqueue = pqueueCreate (pqueue_check_functionality_comparisonFunction);
+  for (i=0; i<n; ++i)
+    objs[i].checkCode = i;
+
+  start = pqueue_check_now ();
+  clock = 0;
+  for (i=0; i<THROUGHPUT_PENDING; ++i)
+    {
+      objs[i].priority = random () % 1000;
+      handles[i] = pqueueInsert (pqueue, &objs[i]);
+    }
+  for (i=0; i<THROUGHPUT_ROUNDS; ++i)
+    {
+      struct pqueue_check_Functionality *obj = &objs[(i + THROUGHPUT_PENDING) % n];
+      obj -> priority = clock + random () % 1000;
+      handles[obj -> checkCode] = pqueueInsert (pqueue, obj);
+      pqueueCancel (pqueue, handles[(i + THROUGHPUT_PENDING / 2) % n]);
+      obj = pqueueGetNext (pqueue);
+      if (obj != NULL)
+        clock = obj -> priority;
+    }
+  heapTime = pqueue_check_now () - start;
+  pqueueDestroy (pqueue, NULL);
+
+  start = pqueue_check_now ();
+  clock = 0;
+  for (i=0; i<THROUGHPUT_PENDING; ++i)
+    {
+      objs[i].priority = random () % 1000;
+      pqueue_check_list_insert (&list, &objs[i]);
+    }
+  for (i=0; i<THROUGHPUT_ROUNDS; ++i)
+    {
+      struct pqueue_check_Functionality *obj = &objs[(i + THROUGHPUT_PENDING) % n];
+      obj -> priority = clock + random () % 1000;
+      pqueue_check_list_insert (&list, obj);
+      pqueue_check_list_remove (&list, &objs[(i + THROUGHPUT_PENDING / 2) % n]);
+      if (list != NULL)
+        {
+          clock = ((struct pqueue_check_Functionality *)list -> obj) -> priority;
+          pqueue_check_list_remove (&list, list -> obj);
+        }
+    }
+  listTime = pqueue_check_now () - start;
+  while (list != NULL)
+    pqueue_check_list_remove (&list, list -> obj);
+
+  printf ("%s: %d rounds with %d pending: heap %.0f/s, sorted list %.0f/s\n",
+          checkName, THROUGHPUT_ROUNDS, THROUGHPUT_PENDING,
+          THROUGHPUT_ROUNDS / heapTime, THROUGHPUT_ROUNDS / listTime);
+
+  return 0;
+}
+
 
 int
 main (int argc, char **argv)
@@ -117,6 +337,9 @@ main (int argc, char **argv)
   int failed = 0;
   checkName = "PQueue";
   failed = pqueue_check_functionality () ? 1 : failed;
+  failed = pqueue_check_handles ()       ? 1 : failed;
+  failed = pqueue_check_remove ()        ? 1 : failed;
+  failed = pqueue_check_throughput ()    ? 1 : failed;
   return failed;
 }
 
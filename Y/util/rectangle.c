@@ -83,32 +83,6 @@ rectangleIntersect (struct Rectangle *dest,
   return (mw >= x && mh >= y);
 }
 
-void
-rectanglelistUnionOverlaps (struct llist *self)
-{
-  for (struct llist_node *node = llist_head (self);
-       node != NULL;
-       node = llist_node_next (node))
-    {
-      struct Rectangle *rect0 = llist_node_data (node);
-      struct llist_node *other = llist_node_next (node);
-      while (other != NULL)
-        {
-          struct Rectangle *rect1 = llist_node_data (other);
-          if (rectangleIntersect (NULL, rect0, rect1))
-            {
-              struct llist_node *other_next = llist_node_next (other);
-              rectangleUnion (rect0, rect0, rect1);
-              llist_node_delete (other);
-              yfree (rect1);
-              other = other_next; 
-            }
-          else
-            other = llist_node_next (other);
-        }
-    }
-}
-
 struct llist *
 rectanglelistIntersectWith (struct llist *src1, struct llist *src2)
 {
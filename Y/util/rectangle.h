@@ -47,9 +47,6 @@ bool rectangleUnion     (struct Rectangle *dest,
 bool rectangleIntersect (struct Rectangle *dest,
                         const struct Rectangle *src1, const struct Rectangle *src2);
 
-/* unions rectangles if they overlap */
-void  rectanglelistUnionOverlaps (struct llist *);
-
 /* get a list of intersecting rectangles */
 struct llist *rectanglelistIntersectWith (struct llist *src1, struct llist *src);
 
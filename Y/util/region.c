@@ -0,0 +1,502 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/util/region.h>
+#include <Y/util/yutil.h>
+
+#include <string.h>
+
+enum RegionOp
+{
+  REGION_UNION,
+  REGION_INTERSECT,
+  REGION_SUBTRACT
+};
+
+/* Results are built here and then swapped with the destination's
+ * storage, so in the steady state no operation allocates
+ */
+struct RegionBuilder
+{
+  struct Rectangle *rects;
+  int count;
+  int allocated;
+  int bands;
+  int prevBand;
+  int curBand;
+};
+
+static struct Rectangle *regionScratch = NULL;
+static int regionScratchAllocated = 0;
+
+static void
+regionReserve (struct Rectangle **rects, int *allocated, int count, int needed)
+{
+  if (needed <= *allocated)
+    return;
+  int newSize = *allocated ? *allocated : 16;
+  while (newSize < needed)
+    newSize *= 2;
+  struct Rectangle *newRects = ymalloc (sizeof (struct Rectangle) * newSize);
+  if (count)
+    memcpy (newRects, *rects, sizeof (struct Rectangle) * count);
+  yfree (*rects);
+  *rects = newRects;
+  *allocated = newSize;
+}
+
+void
+regionInitialise (struct Region *self)
+{
+  self -> rects = NULL;
+  self -> count = 0;
+  self -> allocated = 0;
+  self -> bands = 0;
+  self -> maxBands = REGION_DEFAULT_MAX_BANDS;
+  memset (&self -> extents, 0, sizeof (self -> extents));
+}
+
+void
+regionFinalise (struct Region *self)
+{
+  yfree (self -> rects);
+  self -> rects = NULL;
+  self -> count = 0;
+  self -> allocated = 0;
+}
+
+void
+regionClear (struct Region *self)
+{
+  self -> count = 0;
+  self -> bands = 0;
+  memset (&self -> extents, 0, sizeof (self -> extents));
+}
+
+void
+regionSetMaxBands (struct Region *self, int maxBands)
+{
+  self -> maxBands = maxBands;
+}
+
+bool
+regionIsEmpty (const struct Region *self)
+{
+  return self -> count == 0;
+}
+
+const struct Rectangle *
+regionGetExtents (const struct Region *self)
+{
+  return &self -> extents;
+}
+
+const struct Rectangle *
+regionGetRectangles (const struct Region *self, int *count)
+{
+  *count = self -> count;
+  return self -> rects;
+}
+
+static void
+regionSetRectangle (struct Region *self, const struct Rectangle *r)
+{
+  regionReserve (&self -> rects, &self -> allocated, 0, 1);
+  self -> rects[0] = *r;
+  self -> count = 1;
+  self -> bands = 1;
+  self -> extents = *r;
+}
+
+void
+regionCopy (struct Region *dest, const struct Region *src)
+{
+  if (dest == src)
+    return;
+  regionReserve (&dest -> rects, &dest -> allocated, 0, src -> count);
+  if (src -> count)
+    memcpy (dest -> rects, src -> rects, sizeof (struct Rectangle) * src -> count);
+  dest -> count = src -> count;
+  dest -> bands = src -> bands;
+  dest -> extents = src -> extents;
+}
+
+static inline bool
+regionRectangleIsEmpty (const struct Rectangle *r)
+{
+  return r -> w <= 0 || r -> h <= 0;
+}
+
+/* true if the two rectangles share at least one pixel */
+static inline bool
+regionExtentsOverlap (const struct Rectangle *a, const struct Rectangle *b)
+{
+  return a -> x < b -> x + b -> w && b -> x < a -> x + a -> w
+    && a -> y < b -> y + b -> h && b -> y < a -> y + a -> h;
+}
+
+static inline bool
+regionExtentsContain (const struct Rectangle *outer, const struct Rectangle *inner)
+{
+  return outer -> x <= inner -> x && outer -> y <= inner -> y
+    && outer -> x + outer -> w >= inner -> x + inner -> w
+    && outer -> y + outer -> h >= inner -> y + inner -> h;
+}
+
+/* returns the index one past the end of the band starting at i */
+static inline int
+regionBandEnd (const struct Region *self, int i)
+{
+  int32_t y = self -> rects[i].y;
+  int j = i + 1;
+  while (j < self -> count && self -> rects[j].y == y)
+    ++j;
+  return j;
+}
+
+static inline void
+regionBuilderAdd (struct RegionBuilder *b, int32_t x1, int32_t x2, int32_t y1, int32_t y2)
+{
+  if (b -> count == b -> allocated)
+    regionReserve (&b -> rects, &b -> allocated, b -> count, b -> count + 1);
+  struct Rectangle *r = &b -> rects[b -> count++];
+  r -> x = x1;
+  r -> y = y1;
+  r -> w = x2 - x1;
+  r -> h = y2 - y1;
+}
+
+/* Finishes the band being built, merging it into the previous one if
+ * that ends where this starts and has the same rectangles
+ */
+static void
+regionBuilderEndBand (struct RegionBuilder *b)
+{
+  int n = b -> count - b -> curBand;
+  if (n == 0)
+    return;
+
+  if (b -> prevBand >= 0 && b -> curBand - b -> prevBand == n)
+    {
+      struct Rectangle *prev = &b -> rects[b -> prevBand];
+      struct Rectangle *cur = &b -> rects[b -> curBand];
+      bool same = prev[0].y + prev[0].h == cur[0].y;
+      for (int i = 0; same && i < n; ++i)
+        same = prev[i].x == cur[i].x && prev[i].w == cur[i].w;
+      if (same)
+        {
+          for (int i = 0; i < n; ++i)
+            prev[i].h += cur[0].h;
+          b -> count = b -> curBand;
+          return;
+        }
+    }
+
+  b -> prevBand = b -> curBand;
+  b -> bands++;
+}
+
+static inline bool
+regionOpInside (enum RegionOp op, bool inA, bool inB)
+{
+  switch (op)
+    {
+    case REGION_UNION:
+      return inA || inB;
+    case REGION_INTERSECT:
+      return inA && inB;
+    case REGION_SUBTRACT:
+      return inA && !inB;
+    }
+  return false;
+}
+
+/* Sweeps across the spans of one band of each operand, either of
+ * which may be empty, and emits the spans of the result
+ */
+static void
+regionCombineBand (struct RegionBuilder *b, enum RegionOp op,
+                   int32_t y1, int32_t y2,
+                   const struct Rectangle *a, int na,
+                   const struct Rectangle *c, int nc)
+{
+  int i = 0, j = 0;
+  bool inA = false, inC = false, inside = false;
+  int32_t start = 0;
+
+  b -> curBand = b -> count;
+
+  while (i < na || j < nc)
+    {
+      int32_t xa = i < na ? (inA ? a[i].x + a[i].w : a[i].x) : INT32_MAX;
+      int32_t xc = j < nc ? (inC ? c[j].x + c[j].w : c[j].x) : INT32_MAX;
+      int32_t x = MIN (xa, xc);
+      if (xa == x)
+        {
+          if (inA)
+            ++i;
+          inA = !inA;
+        }
+      if (xc == x)
+        {
+          if (inC)
+            ++j;
+          inC = !inC;
+        }
+      bool now = regionOpInside (op, inA, inC);
+      if (now && !inside)
+        start = x;
+      else if (!now && inside)
+        regionBuilderAdd (b, start, x, y1, y2);
+      inside = now;
+    }
+
+  regionBuilderEndBand (b);
+}
+
+static void
+regionFinish (struct Region *dest, struct RegionBuilder *b)
+{
+  /* Swap storage with the destination, which is safe even when the
+   * destination was one of the operands since we're done reading them
+   */
+  regionScratch = dest -> rects;
+  regionScratchAllocated = dest -> allocated;
+  dest -> rects = b -> rects;
+  dest -> allocated = b -> allocated;
+  dest -> count = b -> count;
+  dest -> bands = b -> bands;
+
+  if (dest -> count == 0)
+    {
+      memset (&dest -> extents, 0, sizeof (dest -> extents));
+      return;
+    }
+
+  int32_t x1 = INT32_MAX, x2 = INT32_MIN;
+  for (int i = 0; i < dest -> count; ++i)
+    {
+      x1 = MIN (x1, dest -> rects[i].x);
+      x2 = MAX (x2, dest -> rects[i].x + dest -> rects[i].w);
+    }
+  const struct Rectangle *last = &dest -> rects[dest -> count - 1];
+  dest -> extents.x = x1;
+  dest -> extents.y = dest -> rects[0].y;
+  dest -> extents.w = x2 - x1;
+  dest -> extents.h = last -> y + last -> h - dest -> rects[0].y;
+
+  if (dest -> maxBands > 0 && dest -> bands > dest -> maxBands)
+    {
+      struct Rectangle extents = dest -> extents;
+      regionSetRectangle (dest, &extents);
+    }
+}
+
+static void
+regionOp (struct Region *dest, const struct Region *a, const struct Region *c,
+          enum RegionOp op)
+{
+  struct RegionBuilder b =
+    {
+      rects: regionScratch,
+      count: 0,
+      allocated: regionScratchAllocated,
+      bands: 0,
+      prevBand: -1,
+      curBand: 0
+    };
+  regionScratch = NULL;
+  regionScratchAllocated = 0;
+
+  int ia = 0, ic = 0;
+  int32_t y = INT32_MIN;
+
+  while (ia < a -> count || ic < c -> count)
+    {
+      if (op == REGION_INTERSECT && (ia >= a -> count || ic >= c -> count))
+        break;
+      if (op == REGION_SUBTRACT && ia >= a -> count)
+        break;
+
+      int32_t aTop = INT32_MAX, aBottom = INT32_MAX;
+      int32_t cTop = INT32_MAX, cBottom = INT32_MAX;
+      int ea = ia, ec = ic;
+      if (ia < a -> count)
+        {
+          ea = regionBandEnd (a, ia);
+          aTop = a -> rects[ia].y;
+          aBottom = aTop + a -> rects[ia].h;
+        }
+      if (ic < c -> count)
+        {
+          ec = regionBandEnd (c, ic);
+          cTop = c -> rects[ic].y;
+          cBottom = cTop + c -> rects[ic].h;
+        }
+
+      /* Skip the gap where neither operand has anything */
+      if (y < aTop && y < cTop)
+        y = MIN (aTop, cTop);
+
+      bool inA = aTop <= y;
+      bool inC = cTop <= y;
+      int32_t yEnd = MIN (inA ? aBottom : aTop, inC ? cBottom : cTop);
+
+      regionCombineBand (&b, op, y, yEnd,
+                         inA ? &a -> rects[ia] : NULL, inA ? ea - ia : 0,
+                         inC ? &c -> rects[ic] : NULL, inC ? ec - ic : 0);
+
+      y = yEnd;
+      if (inA && aBottom <= y)
+        ia = ea;
+      if (inC && cBottom <= y)
+        ic = ec;
+    }
+
+  regionFinish (dest, &b);
+}
+
+void
+regionUnion (struct Region *dest,
+             const struct Region *src1, const struct Region *src2)
+{
+  if (src1 -> count == 0)
+    regionCopy (dest, src2);
+  else if (src2 -> count == 0)
+    regionCopy (dest, src1);
+  else if (src1 -> count == 1 && regionExtentsContain (&src1 -> extents, &src2 -> extents))
+    regionCopy (dest, src1);
+  else if (src2 -> count == 1 && regionExtentsContain (&src2 -> extents, &src1 -> extents))
+    regionCopy (dest, src2);
+  else
+    regionOp (dest, src1, src2, REGION_UNION);
+}
+
+void
+regionIntersect (struct Region *dest,
+                 const struct Region *src1, const struct Region *src2)
+{
+  if (src1 -> count == 0 || src2 -> count == 0
+      || !regionExtentsOverlap (&src1 -> extents, &src2 -> extents))
+    regionClear (dest);
+  else if (src2 -> count == 1 && regionExtentsContain (&src2 -> extents, &src1 -> extents))
+    regionCopy (dest, src1);
+  else if (src1 -> count == 1 && regionExtentsContain (&src1 -> extents, &src2 -> extents))
+    regionCopy (dest, src2);
+  else
+    regionOp (dest, src1, src2, REGION_INTERSECT);
+}
+
+void
+regionSubtract (struct Region *dest,
+                const struct Region *src1, const struct Region *src2)
+{
+  if (src1 -> count == 0)
+    regionClear (dest);
+  else if (src2 -> count == 0
+           || !regionExtentsOverlap (&src1 -> extents, &src2 -> extents))
+    regionCopy (dest, src1);
+  else
+    regionOp (dest, src1, src2, REGION_SUBTRACT);
+}
+
+/* makes a one rectangle region without allocating: the rectangle is
+ * copied into extents, which doubles as the region's only rect */
+static inline void
+regionFromRectangle (struct Region *self, const struct Rectangle *r)
+{
+  self -> extents = *r;
+  self -> rects = &self -> extents;
+  self -> count = 1;
+  self -> allocated = 0;
+  self -> bands = 1;
+  self -> maxBands = 0;
+}
+
+void
+regionUnionRectangle (struct Region *self, const struct Rectangle *r)
+{
+  if (regionRectangleIsEmpty (r))
+    return;
+  if (self -> count == 0)
+    {
+      regionSetRectangle (self, r);
+      return;
+    }
+  struct Region other;
+  regionFromRectangle (&other, r);
+  regionUnion (self, self, &other);
+}
+
+void
+regionIntersectRectangle (struct Region *self, const struct Rectangle *r)
+{
+  if (regionRectangleIsEmpty (r))
+    {
+      regionClear (self);
+      return;
+    }
+  struct Region other;
+  regionFromRectangle (&other, r);
+  regionIntersect (self, self, &other);
+}
+
+void
+regionSubtractRectangle (struct Region *self, const struct Rectangle *r)
+{
+  if (regionRectangleIsEmpty (r))
+    return;
+  struct Region other;
+  regionFromRectangle (&other, r);
+  regionSubtract (self, self, &other);
+}
+
+void
+regionTranslate (struct Region *self, int32_t dx, int32_t dy)
+{
+  for (int i = 0; i < self -> count; ++i)
+    {
+      self -> rects[i].x += dx;
+      self -> rects[i].y += dy;
+    }
+  if (self -> count)
+    {
+      self -> extents.x += dx;
+      self -> extents.y += dy;
+    }
+}
+
+bool
+regionOverlapsRectangle (const struct Region *self, const struct Rectangle *r)
+{
+  if (self -> count == 0 || regionRectangleIsEmpty (r)
+      || !regionExtentsOverlap (&self -> extents, r))
+    return false;
+  for (int i = 0; i < self -> count; ++i)
+    {
+      const struct Rectangle *rect = &self -> rects[i];
+      if (rect -> y >= r -> y + r -> h)
+        break;
+      if (regionExtentsOverlap (rect, r))
+        return true;
+    }
+  return false;
+}
+
+/* arch-tag: 1c84e7a3-5d20-4b96-a3f8-7e9b0d26c415
+ */
@@ -0,0 +1,97 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_UTIL_REGION_H
+#define Y_UTIL_REGION_H
+
+#include <Y/util/rectangle.h>
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/*
+ *  A set of pixels, stored as y-x banded rectangles.
+ *
+ *  The area is cut into horizontal bands; every rectangle in a band has
+ *  the same y and h, and within a band the rectangles are sorted by x
+ *  and neither overlap nor touch. Vertically adjacent bands with the
+ *  same rectangles are merged, so each area has exactly one
+ *  representation.
+ *
+ *  Regions are usually embedded in another structure and live as long
+ *  as it does; the rectangle storage is kept across regionClear so that
+ *  repeated damage tracking doesn't go back to the allocator.
+ *
+ *  To keep operations cheap, a region with more than maxBands bands is
+ *  collapsed to its bounding box. That only ever makes it bigger, which
+ *  is the safe direction for damage.
+ */
+struct Region
+{
+  struct Rectangle *rects;
+  int count;
+  int allocated;
+  int bands;
+  int maxBands;
+  struct Rectangle extents;
+};
+
+#define REGION_DEFAULT_MAX_BANDS 32
+
+void regionInitialise (struct Region *);
+void regionFinalise   (struct Region *);
+
+/* empties the region, keeping its storage */
+void regionClear      (struct Region *);
+
+/* sets the band limit; 0 means unlimited */
+void regionSetMaxBands (struct Region *, int maxBands);
+
+bool regionIsEmpty    (const struct Region *);
+
+/* returns the bounding box, which is all zero for an empty region */
+const struct Rectangle *regionGetExtents (const struct Region *);
+
+/* returns the rectangles in band order, storing their number in *count */
+const struct Rectangle *regionGetRectangles (const struct Region *, int *count);
+
+void regionCopy       (struct Region *dest, const struct Region *src);
+
+/* dest may equal src1 or src2, e.g.
+ *         regionUnion (r1, r1, r2)  <->  r1 = r1 U r2 */
+void regionUnion      (struct Region *dest,
+                       const struct Region *src1, const struct Region *src2);
+void regionIntersect  (struct Region *dest,
+                       const struct Region *src1, const struct Region *src2);
+void regionSubtract   (struct Region *dest,
+                       const struct Region *src1, const struct Region *src2);
+
+/* the same, with a single rectangle as the second operand */
+void regionUnionRectangle     (struct Region *, const struct Rectangle *);
+void regionIntersectRectangle (struct Region *, const struct Rectangle *);
+void regionSubtractRectangle  (struct Region *, const struct Rectangle *);
+
+void regionTranslate  (struct Region *, int32_t dx, int32_t dy);
+
+/* returns true if the rectangle shares at least one pixel with the region */
+bool regionOverlapsRectangle (const struct Region *, const struct Rectangle *);
+
+#endif
+
+/* arch-tag: 6f0b2d8e-93c4-4a17-b5e1-2c7a9d0e4f53
+ */
@@ -0,0 +1,300 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/util/region.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+const char *checkName;
+const char *checkModule;
+
+#define GRID 48
+#define RANDOM_NUM_CHECK 3000
+
+/* A region and the same area as a plain bitmap, to check against */
+struct region_check_Pair
+{
+  struct Region region;
+  bool pixels[GRID][GRID];
+};
+
+static void
+region_check_paint (bool pixels[GRID][GRID], const struct Rectangle *r, int op)
+{
+  for (int y = 0; y < GRID; ++y)
+    for (int x = 0; x < GRID; ++x)
+      {
+        bool in = x >= r->x && x < r->x + r->w && y >= r->y && y < r->y + r->h;
+        switch (op)
+          {
+          case 0: pixels[y][x] = pixels[y][x] || in; break;
+          case 1: pixels[y][x] = pixels[y][x] && in; break;
+          case 2: pixels[y][x] = pixels[y][x] && !in; break;
+          }
+      }
+}
+
+/* checks the banding invariants and that the region covers exactly
+ * the pixels given
+ */
+static int
+region_check_matches (const struct Region *region, bool pixels[GRID][GRID])
+{
+  bool seen[GRID][GRID];
+  int count;
+  const struct Rectangle *rects = regionGetRectangles (region, &count);
+
+  memset (seen, 0, sizeof (seen));
+
+  for (int i = 0; i < count; ++i)
+    {
+      const struct Rectangle *r = &rects[i];
+      CHECK_THAT ( r->w > 0 && r->h > 0 );
+      if (i > 0)
+        {
+          const struct Rectangle *p = &rects[i - 1];
+          if (p->y == r->y)
+            {
+              /* Same band: same height, sorted, not touching */
+              CHECK_THAT ( p->h == r->h );
+              CHECK_THAT ( p->x + p->w < r->x );
+            }
+          else
+            CHECK_THAT ( p->y + p->h <= r->y );
+        }
+      for (int y = r->y; y < r->y + r->h; ++y)
+        for (int x = r->x; x < r->x + r->w; ++x)
+          {
+            CHECK_THAT ( x >= 0 && x < GRID && y >= 0 && y < GRID );
+            CHECK_THAT ( !seen[y][x] );
+            seen[y][x] = true;
+          }
+    }
+
+  for (int y = 0; y < GRID; ++y)
+    for (int x = 0; x < GRID; ++x)
+      CHECK_THAT ( seen[y][x] == pixels[y][x] );
+
+  return 0;
+}
+
+static void
+region_check_random_rectangle (struct Rectangle *r)
+{
+  r->x = random () % GRID;
+  r->y = random () % GRID;
+  r->w = random () % (GRID - r->x + 1);
+  r->h = random () % (GRID - r->y + 1);
+}
+
+static int
+region_check_functionality (void)
+{
+  struct Region region, other;
+  struct Rectangle r;
+  int count;
+
+  checkModule = "functionality";
+
+  regionInitialise (&region);
+  regionInitialise (&other);
+
+  CHECK_THAT ( regionIsEmpty (&region) );
+
+  /* Two small diagonal rectangles stay two rectangles */
+  r = (struct Rectangle){ 0, 0, 10, 10 };
+  regionUnionRectangle (&region, &r);
+  r = (struct Rectangle){ 100, 100, 10, 10 };
+  regionUnionRectangle (&region, &r);
+  regionGetRectangles (&region, &count);
+  CHECK_THAT ( count == 2 );
+  CHECK_THAT ( regionGetExtents (&region)->w == 110 );
+  CHECK_THAT ( regionGetExtents (&region)->h == 110 );
+
+  /* Side by side rectangles merge */
+  regionClear (&region);
+  r = (struct Rectangle){ 0, 0, 10, 10 };
+  regionUnionRectangle (&region, &r);
+  r = (struct Rectangle){ 10, 0, 10, 10 };
+  regionUnionRectangle (&region, &r);
+  r = (struct Rectangle){ 0, 10, 20, 5 };
+  regionUnionRectangle (&region, &r);
+  const struct Rectangle *rects = regionGetRectangles (&region, &count);
+  CHECK_THAT ( count == 1 );
+  CHECK_THAT ( rects[0].x == 0 && rects[0].y == 0 );
+  CHECK_THAT ( rects[0].w == 20 && rects[0].h == 15 );
+
+  /* Punching a hole gives four pieces in three bands */
+  r = (struct Rectangle){ 5, 5, 5, 5 };
+  regionSubtractRectangle (&region, &r);
+  regionGetRectangles (&region, &count);
+  CHECK_THAT ( count == 4 );
+
+  r = (struct Rectangle){ 5, 5, 5, 5 };
+  regionIntersectRectangle (&region, &r);
+  CHECK_THAT ( regionIsEmpty (&region) );
+
+  /* Past the band limit, the region becomes its bounding box */
+  regionClear (&region);
+  regionSetMaxBands (&region, 4);
+  for (int i = 0; i < 5; ++i)
+    {
+      r = (struct Rectangle){ i * 2, i * 2, 1, 1 };
+      regionUnionRectangle (&region, &r);
+    }
+  rects = regionGetRectangles (&region, &count);
+  CHECK_THAT ( count == 1 );
+  CHECK_THAT ( rects[0].x == 0 && rects[0].y == 0 );
+  CHECK_THAT ( rects[0].w == 9 && rects[0].h == 9 );
+
+  regionTranslate (&region, 3, -2);
+  CHECK_THAT ( regionGetExtents (&region)->x == 3 );
+  CHECK_THAT ( regionGetExtents (&region)->y == -2 );
+
+  regionFinalise (&region);
+  regionFinalise (&other);
+
+  return 0;
+}
+
+static int
+region_check_random (void)
+{
+  struct region_check_Pair a, b;
+  struct Region result;
+  bool expected[GRID][GRID];
+  struct Rectangle r;
+
+  checkModule = "random";
+
+  srandom (time (NULL));
+
+  regionInitialise (&a.region);
+  regionInitialise (&b.region);
+  regionInitialise (&result);
+  regionSetMaxBands (&a.region, 0);
+  regionSetMaxBands (&b.region, 0);
+  regionSetMaxBands (&result, 0);
+  memset (a.pixels, 0, sizeof (a.pixels));
+  memset (b.pixels, 0, sizeof (b.pixels));
+
+  for (int i = 0; i < RANDOM_NUM_CHECK; ++i)
+    {
+      struct region_check_Pair *p = (random () % 2) ? &a : &b;
+      int op = random () % 5;
+      region_check_random_rectangle (&r);
+
+      switch (op)
+        {
+        case 0:
+        case 1:
+          regionUnionRectangle (&p->region, &r);
+          region_check_paint (p->pixels, &r, 0);
+          break;
+        case 2:
+          regionSubtractRectangle (&p->region, &r);
+          region_check_paint (p->pixels, &r, 2);
+          break;
+        case 3:
+          /* Keep the regions from shrinking away to nothing */
+          if (random () % 4 == 0)
+            {
+              regionIntersectRectangle (&p->region, &r);
+              region_check_paint (p->pixels, &r, 1);
+            }
+          break;
+        case 4:
+          if (random () % 8 == 0)
+            {
+              regionClear (&p->region);
+              memset (p->pixels, 0, sizeof (p->pixels));
+            }
+          break;
+        }
+      CHECK_THAT ( region_check_matches (&p->region, p->pixels) == 0 );
+
+      region_check_random_rectangle (&r);
+      bool overlaps = false;
+      for (int y = r.y; y < r.y + r.h; ++y)
+        for (int x = r.x; x < r.x + r.w; ++x)
+          overlaps = overlaps || p->pixels[y][x];
+      CHECK_THAT ( regionOverlapsRectangle (&p->region, &r) == overlaps );
+
+      /* Region against region, into a third region */
+      regionUnion (&result, &a.region, &b.region);
+      for (int y = 0; y < GRID; ++y)
+        for (int x = 0; x < GRID; ++x)
+          expected[y][x] = a.pixels[y][x] || b.pixels[y][x];
+      CHECK_THAT ( region_check_matches (&result, expected) == 0 );
+
+      regionIntersect (&result, &a.region, &b.region);
+      for (int y = 0; y < GRID; ++y)
+        for (int x = 0; x < GRID; ++x)
+          expected[y][x] = a.pixels[y][x] && b.pixels[y][x];
+      CHECK_THAT ( region_check_matches (&result, expected) == 0 );
+
+      regionSubtract (&result, &a.region, &b.region);
+      for (int y = 0; y < GRID; ++y)
+        for (int x = 0; x < GRID; ++x)
+          expected[y][x] = a.pixels[y][x] && !b.pixels[y][x];
+      CHECK_THAT ( region_check_matches (&result, expected) == 0 );
+
+      /* A limited copy must still cover everything */
+      regionCopy (&result, &a.region);
+      regionSetMaxBands (&result, 2);
+      regionUnionRectangle (&result, &r);
+      int count;
+      const struct Rectangle *rects = regionGetRectangles (&result, &count);
+      for (int y = 0; y < GRID; ++y)
+        for (int x = 0; x < GRID; ++x)
+          if (a.pixels[y][x])
+            {
+              bool covered = false;
+              for (int j = 0; j < count && !covered; ++j)
+                covered = x >= rects[j].x && x < rects[j].x + rects[j].w
+                  && y >= rects[j].y && y < rects[j].y + rects[j].h;
+              CHECK_THAT ( covered );
+            }
+      regionSetMaxBands (&result, 0);
+    }
+
+  regionFinalise (&a.region);
+  regionFinalise (&b.region);
+  regionFinalise (&result);
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "Region";
+  failed = region_check_functionality () ? 1 : failed;
+  failed = region_check_random () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 8e3a6f19-0c4d-47b2-9d5e-b1f27c08a6d4
+ */
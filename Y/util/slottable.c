@@ -0,0 +1,147 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/util/slottable.h>
+#include <Y/util/yutil.h>
+
+#include <string.h>
+#include <assert.h>
+
+/* Ids are the slot in the low bits and a generation count in the high
+ * bits; generations start at 1, so no id is ever 0
+ */
+#define ST_SLOT_BITS 20
+#define ST_SLOT_MASK ((1 << ST_SLOT_BITS) - 1)
+#define ST_MAX_GENERATION ((1 << (32 - ST_SLOT_BITS)) - 1)
+
+#define ST_NONE UINT32_MAX
+
+struct SlotTableEntry
+{
+  void *obj;
+  /* the id of the object in this slot, or 0 if it is free */
+  uint32_t id;
+  uint16_t generation;
+  uint32_t next;
+};
+
+struct SlotTable
+{
+  struct SlotTableEntry *entries;
+  uint32_t entriesAllocated;
+  uint32_t freeList;
+  int count;
+};
+
+struct SlotTable *
+slottableCreate (void)
+{
+  struct SlotTable *self = ymalloc (sizeof (struct SlotTable));
+  self -> entries = NULL;
+  self -> entriesAllocated = 0;
+  self -> freeList = ST_NONE;
+  self -> count = 0;
+  return self;
+}
+
+void
+slottableDestroy (struct SlotTable *self, void (*destructorFunction)(void *obj))
+{
+  if (self == NULL)
+    return;
+  if (destructorFunction != NULL)
+    for (uint32_t slot = 0; slot < self -> entriesAllocated; ++slot)
+      if (self -> entries[slot].id != 0)
+        destructorFunction (self -> entries[slot].obj);
+  yfree (self -> entries);
+  yfree (self);
+}
+
+uint32_t
+slottableAdd (struct SlotTable *self, void *obj)
+{
+  assert (obj != NULL);
+  if (self -> freeList == ST_NONE)
+    {
+      uint32_t oldSize = self -> entriesAllocated;
+      uint32_t newSize = oldSize ? oldSize * 2 : 256;
+      assert (newSize <= ST_SLOT_MASK + 1);
+      struct SlotTableEntry *entries = ymalloc (sizeof (struct SlotTableEntry) * newSize);
+      if (oldSize)
+        memcpy (entries, self -> entries, sizeof (struct SlotTableEntry) * oldSize);
+      yfree (self -> entries);
+      self -> entries = entries;
+      self -> entriesAllocated = newSize;
+
+      /* Thread the new entries onto the free list, lowest first */
+      for (uint32_t i = newSize; i > oldSize; --i)
+        {
+          entries[i - 1].obj = NULL;
+          entries[i - 1].id = 0;
+          entries[i - 1].generation = 1;
+          entries[i - 1].next = self -> freeList;
+          self -> freeList = i - 1;
+        }
+    }
+
+  uint32_t slot = self -> freeList;
+  struct SlotTableEntry *e = &self -> entries[slot];
+  self -> freeList = e -> next;
+  e -> obj = obj;
+  e -> id = ((uint32_t)e -> generation << ST_SLOT_BITS) | slot;
+  self -> count++;
+  return e -> id;
+}
+
+void *
+slottableFind (const struct SlotTable *self, uint32_t id)
+{
+  uint32_t slot = id & ST_SLOT_MASK;
+  if (self == NULL || slot >= self -> entriesAllocated)
+    return NULL;
+  /* a free slot's id is 0, which is never asked for successfully */
+  const struct SlotTableEntry *e = &self -> entries[slot];
+  return e -> id == id && id != 0 ? e -> obj : NULL;
+}
+
+void *
+slottableRemove (struct SlotTable *self, uint32_t id)
+{
+  void *obj = slottableFind (self, id);
+  if (obj == NULL)
+    return NULL;
+
+  uint32_t slot = id & ST_SLOT_MASK;
+  struct SlotTableEntry *e = &self -> entries[slot];
+  e -> obj = NULL;
+  e -> id = 0;
+  e -> generation = e -> generation == ST_MAX_GENERATION ? 1 : e -> generation + 1;
+  e -> next = self -> freeList;
+  self -> freeList = slot;
+  self -> count--;
+  return obj;
+}
+
+int
+slottableCount (const struct SlotTable *self)
+{
+  return self -> count;
+}
+
+/* arch-tag: 6b2e0f84-c3d9-4a17-92e5-f1a8d7c05b3e
+ */
@@ -0,0 +1,61 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_UTIL_SLOTTABLE_H
+#define Y_UTIL_SLOTTABLE_H
+
+#include <inttypes.h>
+
+/*
+ *  An array of objects, each identified by a nonzero uint32_t id made
+ *  of its slot in the low bits and the slot's generation in the high
+ *  bits. Finding an object is a bounds check and a compare; freed
+ *  slots are reused, most recently freed first, and an id stays
+ *  unique until its slot has been reused thousands of times, so
+ *  looking up an object which has gone away just finds nothing.
+ */
+struct SlotTable;
+
+struct SlotTable *slottableCreate  (void);
+
+/*
+ *  Destroys a table
+ *   destructorFunction:  if non-null, this is called on all objects
+ *                        still in it
+ */
+void              slottableDestroy (struct SlotTable *,
+                                    void (*destructorFunction)(void *obj));
+
+/* adds obj, which must not be NULL, and returns its id */
+uint32_t          slottableAdd     (struct SlotTable *, void *obj);
+
+/* returns the object with the given id, or NULL */
+void *            slottableFind    (const struct SlotTable *, uint32_t id);
+
+/* removes an object; returns it, or NULL if the id is unknown.
+ * DOES NOT free() THE OBJECT
+ */
+void *            slottableRemove  (struct SlotTable *, uint32_t id);
+
+/* returns the number of objects in the table */
+int               slottableCount   (const struct SlotTable *);
+
+#endif
+
+/* arch-tag: 9d41c7a2-6e08-4b3f-a5d1-28f0c4e7b963
+ */
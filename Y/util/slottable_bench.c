@@ -0,0 +1,152 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Object table benchmark
+ *
+ * Keeps a number of live objects, as the server does for its clients'
+ * widgets, and reports the cost of finding one by id (as every
+ * inbound message does) and of creating and destroying one: first
+ * with an Index keyed on a counter, as objectIndex used to be, then
+ * with a SlotTable. The Index verifies the whole tree on every add and
+ * remove, so just filling it with 100000 objects takes over a minute:
+ * it only ever holds up to INDEX_MAX_OBJECTS, and its churn, still
+ * milliseconds a time, is timed over a hundredth of the operations.
+ *
+ * Usage: slottable_bench [objects [operations]]
+ */
+
+#include <Y/util/slottable.h>
+#include <Y/util/index.h>
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define INDEX_MAX_OBJECTS 10000
+
+struct BenchObject
+{
+  uint32_t oid;
+};
+
+static int
+keyFunction (const void *key_v, const void *obj_v)
+{
+  uint32_t key = *(const uint32_t *)key_v;
+  const struct BenchObject *obj = obj_v;
+  return key < obj -> oid ? -1 : key > obj -> oid ? 1 : 0;
+}
+
+static int
+comparisonFunction (const void *obj1_v, const void *obj2_v)
+{
+  const struct BenchObject *obj1 = obj1_v;
+  const struct BenchObject *obj2 = obj2_v;
+  return obj1 -> oid < obj2 -> oid ? -1 : obj1 -> oid > obj2 -> oid ? 1 : 0;
+}
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+int
+main (int argc, char **argv)
+{
+  int objects = argc > 1 ? atoi (argv[1]) : 100000;
+  int operations = argc > 2 ? atoi (argv[2]) : 100000;
+  int indexObjects = MIN(objects, INDEX_MAX_OBJECTS);
+  int indexChurnOperations = MAX(operations / 100, 1);
+  struct BenchObject *objs = ymalloc (objects * sizeof (struct BenchObject));
+  int *picks = ymalloc (operations * sizeof (int));
+  uint32_t nextID = 1;
+  int misses = 0;
+
+  srandom (1);
+  for (int i = 0; i < operations; ++i)
+    picks[i] = random () % objects;
+
+  /* The Index */
+  struct Index *index = indexCreate (keyFunction, comparisonFunction);
+  for (int i = 0; i < indexObjects; ++i)
+    {
+      objs[i].oid = nextID++;
+      indexAdd (index, &objs[i]);
+    }
+
+  double start = now ();
+  for (int i = 0; i < operations; ++i)
+    {
+      struct BenchObject *obj = &objs[picks[i] % indexObjects];
+      if (indexFind (index, &obj -> oid) != obj)
+        misses++;
+    }
+  double indexFinds = now () - start;
+
+  start = now ();
+  for (int i = 0; i < indexChurnOperations; ++i)
+    {
+      struct BenchObject *obj = &objs[picks[i] % indexObjects];
+      indexRemove (index, &obj -> oid);
+      obj -> oid = nextID++;
+      indexAdd (index, obj);
+    }
+  double indexChurn = now () - start;
+  indexDestroy (index, NULL);
+
+  /* The SlotTable */
+  struct SlotTable *table = slottableCreate ();
+  for (int i = 0; i < objects; ++i)
+    objs[i].oid = slottableAdd (table, &objs[i]);
+
+  start = now ();
+  for (int i = 0; i < operations; ++i)
+    if (slottableFind (table, objs[picks[i]].oid) != &objs[picks[i]])
+      misses++;
+  double tableFinds = now () - start;
+
+  start = now ();
+  for (int i = 0; i < operations; ++i)
+    {
+      struct BenchObject *obj = &objs[picks[i]];
+      slottableRemove (table, obj -> oid);
+      obj -> oid = slottableAdd (table, obj);
+    }
+  double tableChurn = now () - start;
+  slottableDestroy (table, NULL);
+
+  printf ("%d operations\n", operations);
+  printf ("  Index:     %6d objects   find %7.1f ns   destroy+create %10.1f ns\n",
+          indexObjects, indexFinds * 1e9 / operations,
+          indexChurn * 1e9 / indexChurnOperations);
+  printf ("  SlotTable: %6d objects   find %7.1f ns   destroy+create %10.1f ns\n",
+          objects, tableFinds * 1e9 / operations, tableChurn * 1e9 / operations);
+  if (misses)
+    printf ("  (%d lookups found the wrong object!)\n", misses);
+
+  yfree (picks);
+  yfree (objs);
+  return misses != 0;
+}
+
+/* arch-tag: 7f3a1d96-b5c2-4e08-a9d4-61e0b8c2f75a
+ */
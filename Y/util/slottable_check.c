@@ -0,0 +1,118 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/util/slottable.h>
+#include <Y/util/yutil.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+const char *checkName;
+const char *checkModule;
+
+#define FUNCTIONALITY_NUM_CHECK 5000
+
+static int slottable_check_destroyed;
+
+static void
+slottable_check_destructor (void *obj)
+{
+  slottable_check_destroyed++;
+}
+
+static int
+slottable_check_functionality (void)
+{
+  static int objs[FUNCTIONALITY_NUM_CHECK];
+  static uint32_t ids[FUNCTIONALITY_NUM_CHECK];
+  struct SlotTable *table;
+  int i;
+
+  checkModule = "functionality";
+
+  table = slottableCreate ();
+  CHECK_THAT ( table != NULL );
+  CHECK_THAT ( slottableCount (table) == 0 );
+  CHECK_THAT ( slottableFind (table, 0) == NULL );
+  CHECK_THAT ( slottableFind (table, 1) == NULL );
+
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    {
+      ids[i] = slottableAdd (table, &objs[i]);
+      CHECK_THAT ( ids[i] != 0 );
+    }
+  CHECK_THAT ( slottableCount (table) == FUNCTIONALITY_NUM_CHECK );
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    CHECK_THAT ( slottableFind (table, ids[i]) == &objs[i] );
+
+  /* Remove every third one; a second remove is a no-op */
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; i+=3)
+    {
+      CHECK_THAT ( slottableRemove (table, ids[i]) == &objs[i] );
+      CHECK_THAT ( slottableRemove (table, ids[i]) == NULL );
+      CHECK_THAT ( slottableFind (table, ids[i]) == NULL );
+    }
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    CHECK_THAT ( slottableFind (table, ids[i]) == (i % 3 ? &objs[i] : NULL) );
+
+  /* Freed slots are reused, under new ids, and the old ones stay dead */
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; i+=3)
+    {
+      uint32_t id = slottableAdd (table, &objs[i]);
+      CHECK_THAT ( id != ids[i] );
+      CHECK_THAT ( slottableFind (table, ids[i]) == NULL );
+      ids[i] = id;
+    }
+  CHECK_THAT ( slottableCount (table) == FUNCTIONALITY_NUM_CHECK );
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    CHECK_THAT ( slottableFind (table, ids[i]) == &objs[i] );
+
+  /* Ids beyond the table, and a slot recycled many times over */
+  CHECK_THAT ( slottableFind (table, 0xfffff) == NULL );
+  CHECK_THAT ( slottableRemove (table, 0xfffff) == NULL );
+  uint32_t first = slottableAdd (table, &objs[0]);
+  slottableRemove (table, first);
+  for (i=0; i<10000; ++i)
+    {
+      uint32_t id = slottableAdd (table, &objs[0]);
+      CHECK_THAT ( id != 0 );
+      CHECK_THAT ( slottableFind (table, id) == &objs[0] );
+      CHECK_THAT ( slottableRemove (table, id) == &objs[0] );
+    }
+
+  slottable_check_destroyed = 0;
+  slottableDestroy (table, slottable_check_destructor);
+  CHECK_THAT ( slottable_check_destroyed == FUNCTIONALITY_NUM_CHECK );
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "SlotTable";
+  failed = slottable_check_functionality () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 0e5c93b7-48a2-4d6f-b1e8-7a2c9f4d06b1
+ */
@@ -0,0 +1,294 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/util/spatialindex.h>
+#include <Y/util/yhash.h>
+#include <Y/util/yutil.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* must be a power of two */
+#define SPATIALINDEX_BUCKETS 256
+
+struct SpatialIndexEntry
+{
+  void *obj;
+  struct Rectangle rect;
+  int64_t depth;
+};
+
+struct SpatialIndexBucket
+{
+  struct SpatialIndexEntry **entries;
+  int count;
+  int allocated;
+};
+
+struct SpatialIndex
+{
+  int32_t cellSize;
+  struct SpatialIndexBucket buckets[SPATIALINDEX_BUCKETS];
+  YHashTable *objects;
+  int count;
+
+  /* depths handed out so far at the top and the bottom */
+  int64_t top, bottom;
+};
+
+static inline int32_t
+spatialindexCell (const struct SpatialIndex *self, int32_t v)
+{
+  /* rounds towards minus infinity, so cells don't straddle zero */
+  if (v >= 0)
+    return v / self -> cellSize;
+  else
+    return -((-(int64_t)v + self -> cellSize - 1) / self -> cellSize);
+}
+
+static inline struct SpatialIndexBucket *
+spatialindexBucket (struct SpatialIndex *self, int32_t cx, int32_t cy)
+{
+  uint32_t h = (uint32_t)cx * 73856093u ^ (uint32_t)cy * 19349663u;
+  h ^= h >> 16;
+  return &self -> buckets[h & (SPATIALINDEX_BUCKETS - 1)];
+}
+
+struct SpatialIndex *
+spatialindexCreate (int32_t cellSize)
+{
+  struct SpatialIndex *self = ymalloc (sizeof (struct SpatialIndex));
+  self -> cellSize = cellSize > 0 ? cellSize : SPATIALINDEX_DEFAULT_CELL_SIZE;
+  for (int i = 0; i < SPATIALINDEX_BUCKETS; ++i)
+    {
+      self -> buckets[i].entries = NULL;
+      self -> buckets[i].count = 0;
+      self -> buckets[i].allocated = 0;
+    }
+  self -> objects = y_hash_table_new_full (y_direct_hash, y_direct_equal,
+                                           NULL, yfree);
+  self -> count = 0;
+  self -> top = 0;
+  self -> bottom = 0;
+  return self;
+}
+
+void
+spatialindexDestroy (struct SpatialIndex *self)
+{
+  if (self == NULL)
+    return;
+  for (int i = 0; i < SPATIALINDEX_BUCKETS; ++i)
+    yfree (self -> buckets[i].entries);
+  y_hash_table_destroy (self -> objects);
+  yfree (self);
+}
+
+/* Buckets are kept sorted topmost first, so that queries come out in
+ * order. Depths are unique, so this also finds the entry itself. */
+static int
+spatialindexBucketFind (const struct SpatialIndexBucket *bucket, int64_t depth)
+{
+  int lo = 0, hi = bucket -> count;
+  while (lo < hi)
+    {
+      int mid = (lo + hi) / 2;
+      if (bucket -> entries[mid] -> depth > depth)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+static void
+spatialindexBucketAdd (struct SpatialIndexBucket *bucket,
+                       struct SpatialIndexEntry *entry)
+{
+  int i = spatialindexBucketFind (bucket, entry -> depth);
+
+  /* an earlier cell hashed to the same bucket */
+  if (i < bucket -> count && bucket -> entries[i] == entry)
+    return;
+
+  if (bucket -> count == bucket -> allocated)
+    {
+      int allocated = bucket -> allocated ? bucket -> allocated * 2 : 4;
+      struct SpatialIndexEntry **entries;
+      entries = ymalloc (allocated * sizeof (struct SpatialIndexEntry *));
+      if (bucket -> entries != NULL)
+        {
+          memcpy (entries, bucket -> entries,
+                  bucket -> count * sizeof (struct SpatialIndexEntry *));
+          yfree (bucket -> entries);
+        }
+      bucket -> entries = entries;
+      bucket -> allocated = allocated;
+    }
+  memmove (&bucket -> entries[i + 1], &bucket -> entries[i],
+           (bucket -> count - i) * sizeof (struct SpatialIndexEntry *));
+  bucket -> entries[i] = entry;
+  bucket -> count++;
+}
+
+static void
+spatialindexBucketRemove (struct SpatialIndexBucket *bucket,
+                          struct SpatialIndexEntry *entry)
+{
+  int i = spatialindexBucketFind (bucket, entry -> depth);
+  if (i == bucket -> count || bucket -> entries[i] != entry)
+    return;
+  bucket -> count--;
+  memmove (&bucket -> entries[i], &bucket -> entries[i + 1],
+           (bucket -> count - i) * sizeof (struct SpatialIndexEntry *));
+}
+
+/* calls fn on every bucket the entry's rectangle touches */
+static void
+spatialindexForEachBucket (struct SpatialIndex *self,
+                           struct SpatialIndexEntry *entry,
+                           void (*fn)(struct SpatialIndexBucket *,
+                                      struct SpatialIndexEntry *))
+{
+  const struct Rectangle *r = &entry -> rect;
+  if (r -> w <= 0 || r -> h <= 0)
+    return;
+
+  int32_t cx0 = spatialindexCell (self, r -> x);
+  int32_t cy0 = spatialindexCell (self, r -> y);
+  int32_t cx1 = spatialindexCell (self, r -> x + r -> w - 1);
+  int32_t cy1 = spatialindexCell (self, r -> y + r -> h - 1);
+
+  if ((int64_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) >= SPATIALINDEX_BUCKETS)
+    {
+      /* it would reach every bucket anyway */
+      for (int i = 0; i < SPATIALINDEX_BUCKETS; ++i)
+        fn (&self -> buckets[i], entry);
+      return;
+    }
+
+  for (int32_t cy = cy0; cy <= cy1; ++cy)
+    for (int32_t cx = cx0; cx <= cx1; ++cx)
+      fn (spatialindexBucket (self, cx, cy), entry);
+}
+
+void
+spatialindexAdd (struct SpatialIndex *self, void *obj, const struct Rectangle *rect)
+{
+  struct SpatialIndexEntry *entry = y_hash_table_lookup (self -> objects, obj);
+  if (entry != NULL)
+    {
+      spatialindexMove (self, obj, rect);
+      spatialindexRaise (self, obj);
+      return;
+    }
+
+  entry = ymalloc (sizeof (struct SpatialIndexEntry));
+  entry -> obj = obj;
+  entry -> rect = *rect;
+  entry -> depth = ++self -> top;
+  y_hash_table_insert (self -> objects, obj, entry);
+  self -> count++;
+  spatialindexForEachBucket (self, entry, spatialindexBucketAdd);
+}
+
+void
+spatialindexMove (struct SpatialIndex *self, void *obj, const struct Rectangle *rect)
+{
+  struct SpatialIndexEntry *entry = y_hash_table_lookup (self -> objects, obj);
+  if (entry == NULL)
+    return;
+  if (entry -> rect.x == rect -> x && entry -> rect.y == rect -> y
+      && entry -> rect.w == rect -> w && entry -> rect.h == rect -> h)
+    return;
+  spatialindexForEachBucket (self, entry, spatialindexBucketRemove);
+  entry -> rect = *rect;
+  spatialindexForEachBucket (self, entry, spatialindexBucketAdd);
+}
+
+void
+spatialindexRemove (struct SpatialIndex *self, void *obj)
+{
+  struct SpatialIndexEntry *entry = y_hash_table_lookup (self -> objects, obj);
+  if (entry == NULL)
+    return;
+  spatialindexForEachBucket (self, entry, spatialindexBucketRemove);
+  y_hash_table_remove (self -> objects, obj);
+  self -> count--;
+}
+
+void
+spatialindexRaise (struct SpatialIndex *self, void *obj)
+{
+  struct SpatialIndexEntry *entry = y_hash_table_lookup (self -> objects, obj);
+  if (entry == NULL || entry -> depth == self -> top)
+    return;
+  spatialindexForEachBucket (self, entry, spatialindexBucketRemove);
+  entry -> depth = ++self -> top;
+  spatialindexForEachBucket (self, entry, spatialindexBucketAdd);
+}
+
+void
+spatialindexLower (struct SpatialIndex *self, void *obj)
+{
+  struct SpatialIndexEntry *entry = y_hash_table_lookup (self -> objects, obj);
+  if (entry == NULL || entry -> depth == self -> bottom)
+    return;
+  spatialindexForEachBucket (self, entry, spatialindexBucketRemove);
+  entry -> depth = --self -> bottom;
+  spatialindexForEachBucket (self, entry, spatialindexBucketAdd);
+}
+
+int
+spatialindexCount (const struct SpatialIndex *self)
+{
+  return self -> count;
+}
+
+void *
+spatialindexHit (struct SpatialIndex *self, int32_t x, int32_t y, const void *below)
+{
+  struct SpatialIndexBucket *bucket;
+  bucket = spatialindexBucket (self, spatialindexCell (self, x),
+                               spatialindexCell (self, y));
+
+  /* the bucket is in stacking order already */
+  int i = 0;
+  if (below != NULL)
+    {
+      const struct SpatialIndexEntry *entry;
+      entry = y_hash_table_lookup (self -> objects, below);
+      if (entry == NULL)
+        return NULL;
+      i = spatialindexBucketFind (bucket, entry -> depth - 1);
+    }
+
+  for (; i < bucket -> count; ++i)
+    {
+      const struct SpatialIndexEntry *entry = bucket -> entries[i];
+      const struct Rectangle *r = &entry -> rect;
+      if (x >= r -> x && x < r -> x + r -> w
+          && y >= r -> y && y < r -> y + r -> h)
+        return entry -> obj;
+    }
+  return NULL;
+}
+
+/* arch-tag: a27f4c90-5b1e-4d38-8e06-c1d9b3f5e742
+ */
@@ -0,0 +1,71 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_UTIL_SPATIALINDEX_H
+#define Y_UTIL_SPATIALINDEX_H
+
+#include <Y/util/rectangle.h>
+
+#include <inttypes.h>
+
+/*
+ *  Finds which of a set of stacked rectangles cover a point.
+ *
+ *  Space is cut into square cells, and each cell is hashed into one of
+ *  a fixed number of buckets listing the objects that touch it, so a
+ *  query only looks at the few objects near the point instead of all
+ *  of them. Each object also has a depth, so the answer comes back in
+ *  stacking order.
+ *
+ *  The index holds pointers only; the objects are never dereferenced.
+ */
+struct SpatialIndex;
+
+#define SPATIALINDEX_DEFAULT_CELL_SIZE 128
+
+/* cellSize is the side of a cell in pixels; 0 means the default */
+struct SpatialIndex *spatialindexCreate  (int32_t cellSize);
+void                 spatialindexDestroy (struct SpatialIndex *);
+
+/* adds obj on top of the others */
+void spatialindexAdd    (struct SpatialIndex *, void *obj, const struct Rectangle *);
+void spatialindexRemove (struct SpatialIndex *, void *obj);
+
+/* changes the rectangle of obj; objects not in the index are ignored */
+void spatialindexMove   (struct SpatialIndex *, void *obj, const struct Rectangle *);
+
+/* moves obj above or below all the others */
+void spatialindexRaise  (struct SpatialIndex *, void *obj);
+void spatialindexLower  (struct SpatialIndex *, void *obj);
+
+int  spatialindexCount  (const struct SpatialIndex *);
+
+/* returns the topmost object whose rectangle contains (x, y) and which
+ * is below the object given, or below none if it is NULL; so
+ *
+ *   for (o = spatialindexHit (i, x, y, NULL); o; o = spatialindexHit (i, x, y, o))
+ *
+ * visits every object under the point, top to bottom. The index may be
+ * changed between calls.
+ */
+void *spatialindexHit (struct SpatialIndex *, int32_t x, int32_t y, const void *below);
+
+#endif
+
+/* arch-tag: 3d5c71a2-e0b8-4f96-8a1d-69c2f47b0e15
+ */
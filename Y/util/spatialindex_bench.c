@@ -0,0 +1,186 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Pointer hit-test benchmark
+ *
+ * Scatters windows over a 1920x1200 desktop and reports the cost of
+ * finding the topmost window under random pointer positions, against
+ * the number of windows: first by walking a ZOrder from the top as
+ * desktopPointerMotion used to, then with a SpatialIndex. The cost of
+ * moving a window in the index is reported as well.
+ *
+ * Usage: spatialindex_bench [queries]
+ */
+
+#include <Y/util/spatialindex.h>
+#include <Y/util/zorder.h>
+#include <Y/util/rectangle.h>
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define DESKTOP_W 1920
+#define DESKTOP_H 1200
+
+struct BenchWindow
+{
+  int id;
+  struct Rectangle rect;
+};
+
+static int
+keyFunction (const void *key_v, const void *obj_v)
+{
+  int key = *(const int *)key_v;
+  const struct BenchWindow *obj = obj_v;
+  return key < obj -> id ? -1 : key > obj -> id ? 1 : 0;
+}
+
+static int
+comparisonFunction (const void *obj1_v, const void *obj2_v)
+{
+  const struct BenchWindow *obj1 = obj1_v;
+  const struct BenchWindow *obj2 = obj2_v;
+  return obj1 -> id < obj2 -> id ? -1 : obj1 -> id > obj2 -> id ? 1 : 0;
+}
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void
+randomRectangle (struct Rectangle *r)
+{
+  r -> w = 200 + random () % 600;
+  r -> h = 150 + random () % 450;
+  r -> x = random () % (DESKTOP_W - r -> w / 2);
+  r -> y = random () % (DESKTOP_H - r -> h / 2);
+}
+
+/* The same test as widget_contains_point_local, copy of the rectangle
+ * and all */
+static struct BenchWindow *
+linearHit (struct ZOrder *zorder, int32_t x, int32_t y)
+{
+  struct BenchWindow *hit = NULL;
+  struct ZOrderIterator *iterator = zorderGetTopIterator (zorder);
+  while (zorderiteratorHasValue (iterator))
+    {
+      struct BenchWindow *win = zorderiteratorGet (iterator);
+      struct Rectangle *rect = rectangleDuplicate (&win -> rect);
+      bool in = x > rect -> x && x < rect -> x + rect -> w
+        && y > rect -> y && y < rect -> y + rect -> h;
+      rectangleDestroy (rect);
+      if (in)
+        {
+          hit = win;
+          break;
+        }
+      zorderiteratorMoveDown (iterator);
+    }
+  zorderiteratorDestroy (iterator);
+  return hit;
+}
+
+static struct BenchWindow *
+indexHit (struct SpatialIndex *index, int32_t x, int32_t y)
+{
+  struct BenchWindow *win = spatialindexHit (index, x, y, NULL);
+  while (win != NULL)
+    {
+      if (x > win -> rect.x && x < win -> rect.x + win -> rect.w
+          && y > win -> rect.y && y < win -> rect.y + win -> rect.h)
+        return win;
+      win = spatialindexHit (index, x, y, win);
+    }
+  return NULL;
+}
+
+static void
+run (int windows, int queries)
+{
+  struct BenchWindow *wins = ymalloc (windows * sizeof (struct BenchWindow));
+  struct ZOrder *zorder = zorderCreate (keyFunction, comparisonFunction);
+  struct SpatialIndex *index = spatialindexCreate (0);
+  int32_t *points = ymalloc (2 * queries * sizeof (int32_t));
+
+  for (int i = 0; i < windows; ++i)
+    {
+      wins[i].id = i;
+      randomRectangle (&wins[i].rect);
+      zorderAddAtTop (zorder, &wins[i]);
+      spatialindexAdd (index, &wins[i], &wins[i].rect);
+    }
+  for (int i = 0; i < queries; ++i)
+    {
+      points[2 * i] = random () % DESKTOP_W;
+      points[2 * i + 1] = random () % DESKTOP_H;
+    }
+
+  int mismatches = 0;
+  double start = now ();
+  for (int i = 0; i < queries; ++i)
+    if (linearHit (zorder, points[2 * i], points[2 * i + 1]) == NULL)
+      mismatches++;
+  double linear = now () - start;
+
+  start = now ();
+  for (int i = 0; i < queries; ++i)
+    if (indexHit (index, points[2 * i], points[2 * i + 1]) == NULL)
+      mismatches--;
+  double indexed = now () - start;
+
+  /* drag a window around, as a move per motion event would */
+  struct Rectangle r = wins[0].rect;
+  start = now ();
+  for (int i = 0; i < queries; ++i)
+    {
+      r.x = points[2 * i] - r.w / 2;
+      r.y = points[2 * i + 1] - 10;
+      spatialindexMove (index, &wins[0], &r);
+    }
+  double moves = now () - start;
+
+  printf ("%6d windows: linear %9.1f ns/hit   indexed %7.1f ns/hit   move %7.1f ns%s\n",
+          windows, linear * 1e9 / queries, indexed * 1e9 / queries,
+          moves * 1e9 / queries, mismatches ? "   (results differ!)" : "");
+
+  spatialindexDestroy (index);
+  zorderDestroy (zorder, NULL);
+  yfree (points);
+  yfree (wins);
+}
+
+int
+main (int argc, char **argv)
+{
+  int queries = argc > 1 ? atoi (argv[1]) : 200000;
+  srandom (1);
+  for (int windows = 1; windows <= 1024; windows *= 4)
+    run (windows, queries);
+  return 0;
+}
+
+/* arch-tag: e4a91b6f-28d3-4c05-9f7a-b36d0c1e85f2
+ */
@@ -0,0 +1,220 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/util/spatialindex.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+const char *checkName;
+const char *checkModule;
+
+#define OBJECTS 40
+#define RANDOM_NUM_CHECK 4000
+
+/* The objects, kept in stacking order (bottom first) to check against */
+struct spatialindex_check_Model
+{
+  int order[OBJECTS];
+  int count;
+  struct Rectangle rects[OBJECTS];
+  bool present[OBJECTS];
+};
+
+static int objects[OBJECTS];
+
+static void
+spatialindex_check_unstack (struct spatialindex_check_Model *m, int o)
+{
+  for (int i = 0; i < m -> count; ++i)
+    if (m -> order[i] == o)
+      {
+        memmove (&m -> order[i], &m -> order[i + 1],
+                 (m -> count - i - 1) * sizeof (int));
+        m -> count--;
+        return;
+      }
+}
+
+static int
+spatialindex_check_query (struct SpatialIndex *index,
+                          struct spatialindex_check_Model *m,
+                          int32_t x, int32_t y)
+{
+  void *hit = spatialindexHit (index, x, y, NULL);
+
+  for (int i = m -> count - 1; i >= 0; --i)
+    {
+      const struct Rectangle *r = &m -> rects[m -> order[i]];
+      if (x < r -> x || x >= r -> x + r -> w || y < r -> y || y >= r -> y + r -> h)
+        continue;
+      CHECK_THAT ( hit == &objects[m -> order[i]] );
+      hit = spatialindexHit (index, x, y, hit);
+    }
+  CHECK_THAT ( hit == NULL );
+  return 0;
+}
+
+static int
+spatialindex_check_functionality (void)
+{
+  struct SpatialIndex *index;
+  struct Rectangle r;
+
+  checkModule = "functionality";
+
+  index = spatialindexCreate (16);
+  CHECK_THAT ( spatialindexCount (index) == 0 );
+  CHECK_THAT ( spatialindexHit (index, 5, 5, NULL) == NULL );
+
+  r = (struct Rectangle){ 0, 0, 100, 100 };
+  spatialindexAdd (index, &objects[0], &r);
+  r = (struct Rectangle){ 50, 50, 100, 100 };
+  spatialindexAdd (index, &objects[1], &r);
+  CHECK_THAT ( spatialindexCount (index) == 2 );
+
+  /* later objects go on top */
+  CHECK_THAT ( spatialindexHit (index, 60, 60, NULL) == &objects[1] );
+  CHECK_THAT ( spatialindexHit (index, 60, 60, &objects[1]) == &objects[0] );
+  CHECK_THAT ( spatialindexHit (index, 60, 60, &objects[0]) == NULL );
+
+  spatialindexRaise (index, &objects[0]);
+  CHECK_THAT ( spatialindexHit (index, 60, 60, NULL) == &objects[0] );
+  CHECK_THAT ( spatialindexHit (index, 60, 60, &objects[0]) == &objects[1] );
+
+  spatialindexLower (index, &objects[0]);
+  CHECK_THAT ( spatialindexHit (index, 60, 60, NULL) == &objects[1] );
+
+  /* rectangles are half open */
+  CHECK_THAT ( spatialindexHit (index, 100, 10, NULL) == NULL );
+  CHECK_THAT ( spatialindexHit (index, 99, 10, NULL) == &objects[0] );
+
+  /* negative coordinates, and moving */
+  r = (struct Rectangle){ -40, -40, 20, 20 };
+  spatialindexMove (index, &objects[1], &r);
+  CHECK_THAT ( spatialindexHit (index, -21, -40, NULL) == &objects[1] );
+  CHECK_THAT ( spatialindexHit (index, -21, -40, &objects[1]) == NULL );
+  CHECK_THAT ( spatialindexHit (index, 60, 60, NULL) == &objects[0] );
+  CHECK_THAT ( spatialindexHit (index, 60, 60, &objects[0]) == NULL );
+
+  spatialindexRemove (index, &objects[0]);
+  CHECK_THAT ( spatialindexHit (index, 60, 60, NULL) == NULL );
+  CHECK_THAT ( spatialindexCount (index) == 1 );
+
+  /* moving something that isn't there doesn't add it */
+  spatialindexMove (index, &objects[0], &r);
+  CHECK_THAT ( spatialindexCount (index) == 1 );
+
+  spatialindexDestroy (index);
+  return 0;
+}
+
+static int
+spatialindex_check_random (void)
+{
+  struct spatialindex_check_Model m;
+  struct SpatialIndex *index;
+
+  checkModule = "random";
+
+  srandom (time (NULL));
+
+  memset (&m, 0, sizeof (m));
+  /* small cells, so that large objects span every bucket */
+  index = spatialindexCreate (8);
+
+  for (int i = 0; i < RANDOM_NUM_CHECK; ++i)
+    {
+      int o = random () % OBJECTS;
+      struct Rectangle r;
+      switch (random () % 6)
+        {
+        case 0:
+        case 1:
+          r.x = random () % 400 - 100;
+          r.y = random () % 400 - 100;
+          r.w = random () % 300;
+          r.h = random () % 300;
+          if (m.present[o])
+            {
+              spatialindexMove (index, &objects[o], &r);
+              m.rects[o] = r;
+            }
+          else
+            {
+              spatialindexAdd (index, &objects[o], &r);
+              m.rects[o] = r;
+              m.order[m.count++] = o;
+              m.present[o] = true;
+            }
+          break;
+        case 2:
+          spatialindexRemove (index, &objects[o]);
+          spatialindex_check_unstack (&m, o);
+          m.present[o] = false;
+          break;
+        case 3:
+          spatialindexRaise (index, &objects[o]);
+          if (m.present[o])
+            {
+              spatialindex_check_unstack (&m, o);
+              m.order[m.count++] = o;
+            }
+          break;
+        case 4:
+          spatialindexLower (index, &objects[o]);
+          if (m.present[o])
+            {
+              spatialindex_check_unstack (&m, o);
+              memmove (&m.order[1], &m.order[0], m.count * sizeof (int));
+              m.order[0] = o;
+              m.count++;
+            }
+          break;
+        case 5:
+          break;
+        }
+
+      CHECK_THAT ( spatialindexCount (index) == m.count );
+      for (int j = 0; j < 8; ++j)
+        CHECK_THAT ( spatialindex_check_query (index, &m,
+                                               random () % 500 - 120,
+                                               random () % 500 - 120) == 0 );
+    }
+
+  spatialindexDestroy (index);
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "SpatialIndex";
+  failed = spatialindex_check_functionality () ? 1 : failed;
+  failed = spatialindex_check_random () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 5b0e8c3d-7a21-4f96-b4d8-0e9a1c6f3b27
+ */
@@ -0,0 +1,376 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include <Y/util/timerwheel.h>
+#include <Y/util/yutil.h>
+#include <string.h>
+#include <assert.h>
+
+/* Four levels of 64 slots. Level 0 holds timers due within the next
+ * 64 ticks, one tick per slot; each level above covers 64 times the
+ * range of the one below. When the current time crosses a slot
+ * boundary on a higher level, that slot's timers are "cascaded" down
+ * to the level below. Timers beyond the top level are parked in the
+ * furthest slot and re-filed each time it cascades.
+ */
+#define TW_LEVEL_BITS 6
+#define TW_SLOTS      (1 << TW_LEVEL_BITS)
+#define TW_SLOT_MASK  (TW_SLOTS - 1)
+#define TW_LEVELS     4
+
+/* Timers which have expired but not yet been collected */
+#define TW_READY      TW_LEVELS
+
+/* Timer ids are the entry index in the low bits and a generation count
+ * in the high bits, so stale ids are detected cheaply
+ */
+#define TW_INDEX_BITS 20
+#define TW_INDEX_MASK ((1 << TW_INDEX_BITS) - 1)
+#define TW_MAX_GENERATION ((1 << (31 - TW_INDEX_BITS)) - 1)
+
+#define TW_NONE UINT32_MAX
+
+struct TimerWheelEntry
+{
+  uint64_t expiry;
+  void *obj;
+  uint32_t next, prev;
+  uint16_t generation;
+  uint8_t level, slot;
+  bool inUse;
+};
+
+struct TimerWheelList
+{
+  uint32_t head, tail;
+};
+
+struct TimerWheel
+{
+  uint64_t current;
+  int count;
+
+  struct TimerWheelList slots[TW_LEVELS][TW_SLOTS];
+  uint64_t occupied[TW_LEVELS];
+  struct TimerWheelList ready;
+
+  struct TimerWheelEntry *entries;
+  uint32_t entriesAllocated;
+  uint32_t freeList;
+};
+
+static inline uint64_t
+rotateRight (uint64_t v, unsigned int n)
+{
+  n &= 63;
+  return n ? (v >> n) | (v << (64 - n)) : v;
+}
+
+static inline struct TimerWheelList *
+timerwheelListFor (struct TimerWheel *self, uint8_t level, uint8_t slot)
+{
+  return level == TW_READY ? &self -> ready : &self -> slots[level][slot];
+}
+
+static void
+timerwheelLink (struct TimerWheel *self, uint32_t index, uint8_t level, uint8_t slot)
+{
+  struct TimerWheelEntry *e = &self -> entries[index];
+  struct TimerWheelList *list = timerwheelListFor (self, level, slot);
+  e -> level = level;
+  e -> slot = slot;
+  e -> next = TW_NONE;
+  e -> prev = list -> tail;
+  if (list -> tail == TW_NONE)
+    list -> head = index;
+  else
+    self -> entries[list -> tail].next = index;
+  list -> tail = index;
+  if (level != TW_READY)
+    self -> occupied[level] |= (uint64_t)1 << slot;
+}
+
+static void
+timerwheelUnlink (struct TimerWheel *self, uint32_t index)
+{
+  struct TimerWheelEntry *e = &self -> entries[index];
+  struct TimerWheelList *list = timerwheelListFor (self, e -> level, e -> slot);
+  if (e -> prev == TW_NONE)
+    list -> head = e -> next;
+  else
+    self -> entries[e -> prev].next = e -> next;
+  if (e -> next == TW_NONE)
+    list -> tail = e -> prev;
+  else
+    self -> entries[e -> next].prev = e -> prev;
+  if (e -> level != TW_READY && list -> head == TW_NONE)
+    self -> occupied[e -> level] &= ~((uint64_t)1 << e -> slot);
+}
+
+/* File an entry in the right slot for its expiry relative to now */
+static void
+timerwheelPlace (struct TimerWheel *self, uint32_t index)
+{
+  uint64_t expiry = self -> entries[index].expiry;
+
+  if (expiry <= self -> current)
+    {
+      timerwheelLink (self, index, TW_READY, 0);
+      return;
+    }
+
+  uint64_t delta = expiry - self -> current;
+  for (int level = 0; level < TW_LEVELS; ++level)
+    {
+      if (delta < ((uint64_t)1 << (TW_LEVEL_BITS * (level + 1))))
+        {
+          uint8_t slot = (expiry >> (TW_LEVEL_BITS * level)) & TW_SLOT_MASK;
+          timerwheelLink (self, index, level, slot);
+          return;
+        }
+    }
+
+  /* Too far away: park it at the far end of the top level */
+  uint64_t parked = self -> current + ((uint64_t)1 << (TW_LEVEL_BITS * TW_LEVELS)) - 1;
+  uint8_t slot = (parked >> (TW_LEVEL_BITS * (TW_LEVELS - 1))) & TW_SLOT_MASK;
+  timerwheelLink (self, index, TW_LEVELS - 1, slot);
+}
+
+static void
+timerwheelCascade (struct TimerWheel *self, int level, uint8_t slot)
+{
+  struct TimerWheelList *list = &self -> slots[level][slot];
+  uint32_t index = list -> head;
+  list -> head = list -> tail = TW_NONE;
+  self -> occupied[level] &= ~((uint64_t)1 << slot);
+  while (index != TW_NONE)
+    {
+      uint32_t next = self -> entries[index].next;
+      timerwheelPlace (self, index);
+      index = next;
+    }
+}
+
+/* Move the current time on by one tick */
+static void
+timerwheelTick (struct TimerWheel *self)
+{
+  uint64_t t = ++self -> current;
+
+  /* Cascade from the highest level whose slot boundary we crossed, so
+   * that timers trickle all the way down in one go
+   */
+  int top = 0;
+  while (top < TW_LEVELS - 1
+         && ((t >> (TW_LEVEL_BITS * (top + 1))) << (TW_LEVEL_BITS * (top + 1))) == t)
+    top++;
+  for (int level = top; level > 0; --level)
+    timerwheelCascade (self, level, (t >> (TW_LEVEL_BITS * level)) & TW_SLOT_MASK);
+
+  /* Everything left in this level 0 slot is due now */
+  timerwheelCascade (self, 0, t & TW_SLOT_MASK);
+}
+
+struct TimerWheel *
+timerwheelCreate (uint64_t now)
+{
+  struct TimerWheel *self = ymalloc (sizeof (struct TimerWheel));
+  self -> current = now;
+  self -> count = 0;
+  for (int level = 0; level < TW_LEVELS; ++level)
+    {
+      for (int slot = 0; slot < TW_SLOTS; ++slot)
+        self -> slots[level][slot].head = self -> slots[level][slot].tail = TW_NONE;
+      self -> occupied[level] = 0;
+    }
+  self -> ready.head = self -> ready.tail = TW_NONE;
+  self -> entries = NULL;
+  self -> entriesAllocated = 0;
+  self -> freeList = TW_NONE;
+  return self;
+}
+
+void
+timerwheelDestroy (struct TimerWheel *self, void (*destructorFunction)(void *obj))
+{
+  if (destructorFunction)
+    for (uint32_t i = 0; i < self -> entriesAllocated; ++i)
+      if (self -> entries[i].inUse)
+        destructorFunction (self -> entries[i].obj);
+  yfree (self -> entries);
+  yfree (self);
+}
+
+static uint32_t
+timerwheelAllocateEntry (struct TimerWheel *self)
+{
+  if (self -> freeList == TW_NONE)
+    {
+      uint32_t oldSize = self -> entriesAllocated;
+      uint32_t newSize = oldSize ? oldSize * 2 : 64;
+      assert (newSize <= TW_INDEX_MASK + 1);
+      struct TimerWheelEntry *entries = ymalloc (sizeof (struct TimerWheelEntry) * newSize);
+      if (oldSize)
+        memcpy (entries, self -> entries, sizeof (struct TimerWheelEntry) * oldSize);
+      yfree (self -> entries);
+      self -> entries = entries;
+      self -> entriesAllocated = newSize;
+
+      /* Thread the new entries onto the free list, lowest first */
+      for (uint32_t i = newSize; i > oldSize; --i)
+        {
+          entries[i - 1].inUse = false;
+          entries[i - 1].generation = 1;
+          entries[i - 1].next = self -> freeList;
+          self -> freeList = i - 1;
+        }
+    }
+
+  uint32_t index = self -> freeList;
+  self -> freeList = self -> entries[index].next;
+  return index;
+}
+
+static void
+timerwheelFreeEntry (struct TimerWheel *self, uint32_t index)
+{
+  struct TimerWheelEntry *e = &self -> entries[index];
+  e -> inUse = false;
+  e -> obj = NULL;
+  e -> generation = e -> generation == TW_MAX_GENERATION ? 1 : e -> generation + 1;
+  e -> next = self -> freeList;
+  self -> freeList = index;
+  self -> count--;
+}
+
+int
+timerwheelAdd (struct TimerWheel *self, uint64_t expiry, void *obj)
+{
+  uint32_t index = timerwheelAllocateEntry (self);
+  struct TimerWheelEntry *e = &self -> entries[index];
+
+  /* Never expire before the next tick; this also stops a timer added
+   * from an expiry callback from firing in the same pass
+   */
+  if (expiry <= self -> current)
+    expiry = self -> current + 1;
+
+  e -> expiry = expiry;
+  e -> obj = obj;
+  e -> inUse = true;
+  self -> count++;
+  timerwheelPlace (self, index);
+
+  return (e -> generation << TW_INDEX_BITS) | index;
+}
+
+void *
+timerwheelCancel (struct TimerWheel *self, int id)
+{
+  if (id <= 0)
+    return NULL;
+
+  uint32_t index = id & TW_INDEX_MASK;
+  uint16_t generation = id >> TW_INDEX_BITS;
+  if (index >= self -> entriesAllocated)
+    return NULL;
+
+  struct TimerWheelEntry *e = &self -> entries[index];
+  if (!e -> inUse || e -> generation != generation)
+    return NULL;
+
+  void *obj = e -> obj;
+  timerwheelUnlink (self, index);
+  timerwheelFreeEntry (self, index);
+  return obj;
+}
+
+bool
+timerwheelNextExpiry (const struct TimerWheel *self, uint64_t *expiry)
+{
+  if (self -> count == 0)
+    return false;
+
+  if (self -> ready.head != TW_NONE)
+    {
+      *expiry = self -> current;
+      return true;
+    }
+
+  /* For each level, find the first occupied slot after the current
+   * position; the time that slot is reached is exact for level 0 and
+   * the cascade time (a lower bound) for the others
+   */
+  bool found = false;
+  uint64_t best = 0;
+  for (int level = 0; level < TW_LEVELS; ++level)
+    {
+      if (self -> occupied[level] == 0)
+        continue;
+      int shift = TW_LEVEL_BITS * level;
+      uint64_t block = self -> current >> shift;
+      uint64_t rotated = rotateRight (self -> occupied[level], (block + 1) & TW_SLOT_MASK);
+      uint64_t when = (block + __builtin_ctzll (rotated) + 1) << shift;
+      if (!found || when < best)
+        {
+          best = when;
+          found = true;
+        }
+    }
+
+  assert (found);
+  *expiry = best;
+  return true;
+}
+
+void *
+timerwheelExpire (struct TimerWheel *self, uint64_t now)
+{
+  while (self -> ready.head == TW_NONE && self -> current < now)
+    {
+      uint64_t next;
+      if (!timerwheelNextExpiry (self, &next) || next > now)
+        {
+          /* Nothing happens between here and now, so skip ahead */
+          self -> current = now;
+          break;
+        }
+      /* Skip the empty ticks before the next event */
+      if (next - 1 > self -> current)
+        self -> current = next - 1;
+      timerwheelTick (self);
+    }
+
+  uint32_t index = self -> ready.head;
+  if (index == TW_NONE)
+    return NULL;
+
+  void *obj = self -> entries[index].obj;
+  timerwheelUnlink (self, index);
+  timerwheelFreeEntry (self, index);
+  return obj;
+}
+
+int
+timerwheelCount (const struct TimerWheel *self)
+{
+  return self -> count;
+}
+
+/* arch-tag: 9b41c0e7-6f2d-4a83-b5e8-0c7d2a1f4e96
+ */
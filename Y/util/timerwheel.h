@@ -0,0 +1,75 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef Y_UTIL_TIMERWHEEL_H
+#define Y_UTIL_TIMERWHEEL_H
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/*
+ *  A hierarchical timer wheel.
+ *
+ *  Times are in ticks, which are whatever unit the caller chooses
+ *  (the control loop uses milliseconds on CLOCK_MONOTONIC). Adding and
+ *  cancelling are O(1); each timer is identified by a positive int
+ *  which stays unique until its slot has been reused many times over,
+ *  so cancelling a timer which has already fired is harmless.
+ */
+struct TimerWheel;
+
+/* creates a wheel whose current time is now */
+struct TimerWheel *timerwheelCreate  (uint64_t now);
+
+/*
+ *  Destroys a wheel
+ *   destructorFunction:  if non-null, this is called on all objects
+ *                        still pending
+ */
+void               timerwheelDestroy (struct TimerWheel *,
+                                      void (*destructorFunction)(void *obj));
+
+/* schedules obj to expire at the given tick (never earlier than one
+ * tick after the wheel's current time), and returns its id
+ */
+int                timerwheelAdd     (struct TimerWheel *, uint64_t expiry, void *obj);
+
+/* cancels a timer; returns its object, or NULL if the id is unknown
+ * or has already expired. DOES NOT free() THE OBJECT
+ */
+void *             timerwheelCancel  (struct TimerWheel *, int id);
+
+/* Stores in *expiry a time no later than the earliest pending timer,
+ * and returns false if nothing is pending. Timers far in the future
+ * may report an earlier time, at which point the wheel just needs to
+ * be advanced again.
+ */
+bool               timerwheelNextExpiry (const struct TimerWheel *, uint64_t *expiry);
+
+/* advances the wheel to now, and returns the next object which has
+ * expired (removing it from the wheel), or NULL when there are none
+ */
+void *             timerwheelExpire  (struct TimerWheel *, uint64_t now);
+
+/* returns the number of pending timers */
+int                timerwheelCount   (const struct TimerWheel *);
+
+#endif
+
+/* arch-tag: 3e8d1f55-27a6-4b0c-8f0e-d5c1a4b96e20
+ */
@@ -0,0 +1,141 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#define CHECK_STOP abort()
+#include <Y/util/check.h>
+
+#include <Y/util/timerwheel.h>
+#include <Y/util/yutil.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+const char *checkName;
+const char *checkModule;
+
+#define FUNCTIONALITY_NUM_CHECK 2000
+
+struct timerwheel_check_Functionality
+{
+  uint64_t expiry;
+  int id;
+  int fired;
+  int cancelled;
+};
+
+static int
+timerwheel_check_functionality (void)
+{
+  struct TimerWheel *wheel;
+  struct timerwheel_check_Functionality objs[FUNCTIONALITY_NUM_CHECK];
+  struct timerwheel_check_Functionality *obj;
+  uint64_t start = 1000, now, last;
+  int i;
+
+  checkModule = "functionality";
+
+  srandom (time (NULL));
+
+  wheel = timerwheelCreate (start);
+
+  CHECK_THAT ( wheel != NULL );
+  CHECK_THAT ( timerwheelCount (wheel) == 0 );
+  CHECK_THAT ( timerwheelExpire (wheel, start + 100) == NULL );
+  now = start + 100;
+
+  /* Spread the timers over every level, including beyond the top */
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    {
+      uint64_t range = (uint64_t)1 << (random () % 26);
+      objs[i].expiry = now + 1 + random () % range;
+      objs[i].fired = 0;
+      objs[i].cancelled = 0;
+      objs[i].id = timerwheelAdd (wheel, objs[i].expiry, &objs[i]);
+      CHECK_THAT ( objs[i].id > 0 );
+    }
+  CHECK_THAT ( timerwheelCount (wheel) == FUNCTIONALITY_NUM_CHECK );
+
+  /* Cancel every third one */
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; i+=3)
+    {
+      CHECK_THAT ( timerwheelCancel (wheel, objs[i].id) == &objs[i] );
+      objs[i].cancelled = 1;
+      /* A second cancel is a no-op */
+      CHECK_THAT ( timerwheelCancel (wheel, objs[i].id) == NULL );
+    }
+
+  /* Walk time forward in uneven steps; nothing may fire early or be
+   * left behind once its time has passed
+   */
+  last = 0;
+  while (timerwheelCount (wheel) > 0)
+    {
+      uint64_t next;
+      CHECK_THAT ( timerwheelNextExpiry (wheel, &next) );
+      CHECK_THAT ( next >= now );
+      now = next + random () % 50;
+      while ((obj = timerwheelExpire (wheel, now)) != NULL)
+        {
+          CHECK_THAT ( !obj -> cancelled );
+          CHECK_THAT ( !obj -> fired );
+          CHECK_THAT ( obj -> expiry <= now );
+          obj -> fired = 1;
+          /* Ids of fired timers are dead */
+          CHECK_THAT ( timerwheelCancel (wheel, obj -> id) == NULL );
+        }
+      for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+        if (!objs[i].cancelled && objs[i].expiry <= now)
+          CHECK_THAT ( objs[i].fired );
+      CHECK_THAT ( now > last );
+      last = now;
+    }
+
+  for (i=0; i<FUNCTIONALITY_NUM_CHECK; ++i)
+    CHECK_THAT ( objs[i].fired + objs[i].cancelled == 1 );
+
+  /* A timer added in the past fires on the next tick, not this one */
+  objs[0].id = timerwheelAdd (wheel, now - 10, &objs[0]);
+  CHECK_THAT ( timerwheelExpire (wheel, now) == NULL );
+  CHECK_THAT ( timerwheelExpire (wheel, now + 1) == &objs[0] );
+
+  /* Recycled slots hand out fresh ids */
+  int id1 = timerwheelAdd (wheel, now + 5, &objs[1]);
+  CHECK_THAT ( timerwheelCancel (wheel, id1) == &objs[1] );
+  int id2 = timerwheelAdd (wheel, now + 5, &objs[2]);
+  CHECK_THAT ( id1 != id2 );
+  CHECK_THAT ( timerwheelCancel (wheel, id1) == NULL );
+  CHECK_THAT ( timerwheelCount (wheel) == 1 );
+
+  timerwheelDestroy (wheel, NULL);
+
+  return 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  int failed = 0;
+  checkName = "TimerWheel";
+  failed = timerwheel_check_functionality () ? 1 : failed;
+  return failed;
+}
+
+/* arch-tag: 5d2a7c81-e4b9-4f36-8a10-b7e3c6d9f204
+ */
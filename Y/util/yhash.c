@@ -28,6 +28,7 @@
  * MT safe
  */
 #include <stdlib.h>
+#include <string.h>
 #include <Y/util/yprimes.h>
 #include <Y/util/yhash.h>
 #include <Y/util/yutil.h>
@@ -727,3 +728,24 @@ y_int_hash (yconstpointer v)
 {
   return *(const int32_t*) v;
 }
+
+bool
+y_str_equal (yconstpointer v1,
+	     yconstpointer v2)
+{
+  return strcmp ((const char *) v1, (const char *) v2) == 0;
+}
+
+/* The same as glib's g_str_hash */
+uint32_t
+y_str_hash (yconstpointer v)
+{
+  const signed char *p = v;
+  uint32_t h = *p;
+
+  if (h)
+    for (p += 1; *p != '\0'; p++)
+      h = (h << 5) - h + *p;
+
+  return h;
+}
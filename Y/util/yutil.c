@@ -79,16 +79,15 @@ ymalloc (size_t size_wanted)
 }
 
 /*
- * Right now this is just a wrapper around ymalloc,
- * I'm putting it in so as to not lose sight of where calloc
- * should be used instead of malloc. 
- * TODO: study ymalloc and design ycalloc better.
- * -DN
+ * Like calloc: the memory comes back zeroed, which callers such as the
+ * hash table's bucket array rely on.
  */
 void *
 ycalloc (size_t n, size_t el_size)
 {
-  return ymalloc (el_size * n);
+  void *buffer = ymalloc (el_size * n);
+  memset (buffer, 0, el_size * n);
+  return buffer;
 }
 
 void
@@ -25,16 +25,25 @@
 #include <Y/util/yutil.h>
 #include <Y/buffer/painter.h>
 #include <Y/buffer/buffer.h>
+#include <Y/buffer/imagebuffer.h>
 #include <Y/screen/screen.h>
+#include <Y/message/client.h>
 
 #include <Y/object/class.h>
 #include <Y/object/object_p.h>
 
 #include <Y/text/font.h>
+#include <Y/util/rectangle.h>
+#include <Y/util/log.h>
 
 #include <stdio.h>
 #include <ctype.h>
 #include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 struct Canvas
 {
@@ -42,6 +51,13 @@ struct Canvas
   Buffer *front, *back;
   struct Painter *painter;
   int resizing;
+
+  /* A client-supplied ARGB32 buffer, mapped from a shared memory
+   * descriptor; when set it is drawn instead of the front buffer
+   */
+  Buffer *shared;
+  uint8_t *sharedData;
+  size_t sharedSize;
 };
 
 static void canvasResize (struct Widget *);
@@ -73,6 +89,9 @@ CLASS_INIT(struct Canvas *this, VTable *vtable)
   this -> back = screen_get_new_buffer (64, 64, CAIRO_FORMAT_ARGB32); //create the back buffer
   this -> resizing = 0;
   this -> painter = buffer_get_painter (this -> back);
+  this -> shared = NULL;
+  this -> sharedData = NULL;
+  this -> sharedSize = 0;
 }
 
 
@@ -97,7 +116,10 @@ canvasRender (struct Widget *self_w, Renderer *renderer)
   int fw, fh, bw, bh;
   buffer_get_size (self -> front, &fw, &fh);
   buffer_get_size (self -> back, &bw, &bh);
-  renderer_render_buffer (renderer, self -> front, 0, 0);
+  if (self -> shared != NULL)
+    renderer_render_buffer (renderer, self -> shared, 0, 0);
+  else
+    renderer_render_buffer (renderer, self -> front, 0, 0);
 }
 
 static struct Canvas *
@@ -113,9 +135,12 @@ canvasCreate (void)
 /* METHOD
  * DESTROY :: () -> ()
  */
+static void canvasReleaseShared (struct Canvas *self);
+
 static void
 canvasDestroy (struct Canvas *self)
 {
+  canvasReleaseShared (self);
   painter_destroy (self -> painter);
   buffer_destroy (self -> front);
   buffer_destroy (self -> back);
@@ -355,5 +380,133 @@ canvasRequestSize (struct Canvas *self, int32_t reqWidth, int32_t reqHeight)
   widget_reconfigure (canvasToWidget (self));
 }
 
+static void
+canvasReleaseShared (struct Canvas *self)
+{
+  if (self -> shared == NULL)
+    return;
+  /* The buffer only borrows the mapping, so it must go first */
+  buffer_destroy (self -> shared);
+  munmap (self -> sharedData, self -> sharedSize);
+  self -> shared = NULL;
+  self -> sharedData = NULL;
+  self -> sharedSize = 0;
+}
+
+/* METHOD
+ * attachSharedBuffer :: (uint32, int32, int32, int32) -> ()
+ *
+ * Displays an ARGB32 image of the given width, height and stride
+ * (in bytes) straight out of a memory descriptor the client passed
+ * earlier with the given id. The descriptor must be sealed against
+ * shrinking where the system supports seals, so the client cannot
+ * truncate it from under us. Nothing is copied: the client draws into
+ * its mapping and calls damageSharedBuffer to have it redisplayed.
+ */
+static struct Tuple *
+canvasAttachSharedBuffer (struct Canvas *self, struct Client *from,
+                          uint32_t id, int32_t w, int32_t h, int32_t stride)
+{
+  int fd = clientTakeFileDescriptor (from, id);
+  if (fd < 0)
+    return tupleBuildError (tb_string ("No such file descriptor"));
+
+  if (w <= 0 || h <= 0 || stride < w * 4 || stride % 4 != 0
+      || (size_t)stride * (size_t)h > INT32_MAX)
+    {
+      close (fd);
+      return tupleBuildError (tb_string ("Bad buffer geometry"));
+    }
+  size_t size = (size_t)stride * (size_t)h;
+
+  struct stat st;
+  if (fstat (fd, &st) < 0 || st.st_size < 0 || (size_t)st.st_size < size)
+    {
+      close (fd);
+      return tupleBuildError (tb_string ("Buffer too small"));
+    }
+
+#ifdef F_GET_SEALS
+  int seals = fcntl (fd, F_GET_SEALS);
+  if (seals < 0 || !(seals & F_SEAL_SHRINK))
+    {
+      close (fd);
+      return tupleBuildError (tb_string ("Buffer is not sealed against shrinking"));
+    }
+#endif
+
+  uint8_t *data = mmap (NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (data == MAP_FAILED)
+    {
+      Y_WARN ("Failed to map shared canvas buffer: %s", strerror (errno));
+      return tupleBuildError (tb_string ("Cannot map buffer"));
+    }
+
+  canvasReleaseShared (self);
+  self -> shared = (Buffer *)image_buffer_create_from_data (CAIRO_FORMAT_ARGB32,
+                                                            w, h, stride, data);
+  self -> sharedData = data;
+  self -> sharedSize = size;
+  widget_rerender (canvasToWidget (self), NULL);
+  return NULL;
+}
+
+/* METHOD
+ * damageSharedBuffer :: (...) -> ()
+ *
+ * Takes (x, y, w, h) quadruples of int32 in buffer co-ordinates; with
+ * none, the whole canvas is redisplayed.
+ */
+static void
+canvasCDamageSharedBuffer (struct Canvas *self, const struct Tuple *args)
+{
+  if (self -> shared == NULL)
+    return;
+
+  struct Rectangle bounds = { 0, 0, self -> widget.w, self -> widget.h };
+  int32_t bw, bh;
+  buffer_get_size (self -> shared, &bw, &bh);
+  if (bw < bounds.w)
+    bounds.w = bw;
+  if (bh < bounds.h)
+    bounds.h = bh;
+
+  if (args -> count < 4)
+    {
+      widget_rerender (canvasToWidget (self), NULL);
+      return;
+    }
+
+  for (uint32_t i = 0; i + 3 < args -> count; i += 4)
+    {
+      if (args->list[i + 0].type != t_int32
+          || args->list[i + 1].type != t_int32
+          || args->list[i + 2].type != t_int32
+          || args->list[i + 3].type != t_int32)
+        continue;
+      struct Rectangle r = { args->list[i + 0].int32, args->list[i + 1].int32,
+                             args->list[i + 2].int32, args->list[i + 3].int32 };
+      struct Rectangle clipped;
+      if (!rectangleIntersect (&clipped, &r, &bounds))
+        continue;
+      widget_rerender (canvasToWidget (self),
+                       rectangleCreate (clipped.x, clipped.y,
+                                        clipped.w, clipped.h));
+    }
+}
+
+/* METHOD
+ * detachSharedBuffer :: () -> ()
+ */
+static void
+canvasDetachSharedBuffer (struct Canvas *self)
+{
+  if (self -> shared == NULL)
+    return;
+  canvasReleaseShared (self);
+  widget_rerender (canvasToWidget (self), NULL);
+}
+
 /* arch-tag: 47bb0c50-39ce-4ff0-aca8-138b0ce5922f
  */
@@ -39,15 +39,33 @@
 #include <Y/text/font.h>
 
 #include <Y/util/zorder.h>
+#include <Y/util/spatialindex.h>
+
+#include <Y/util/region.h>
 
 #include <stdio.h>
+#include <string.h>
+
+/* What of each window is left to draw once those above it are drawn */
+struct DesktopVisibility
+{
+  struct Widget *widget;
+  struct Region visible;
+};
 
 struct Desktop
 {
   struct Widget widget;
   struct ZOrder *windows;
+  /* the same windows, for finding which are under the pointer */
+  struct SpatialIndex *hits;
   struct Widget *pointerWidget;
   Buffer *background;
+
+  /* scratch space for desktopRender, kept to save reallocating */
+  struct DesktopVisibility *visibility;
+  int visibilityAllocated;
+  struct Region uncovered, opaque;
 };
 
 static int desktopPointerMotion (struct Widget *, int32_t, int32_t, int32_t, int32_t);
@@ -55,6 +73,7 @@ static int desktopPointerButton (struct Widget *, int32_t, int32_t, uint32_t, bo
                                 
 static void desktopRender (struct Widget *, Renderer *);
 static void desktopResize (struct Widget *);
+static void desktopChildMoved (struct Widget *, struct Widget *);
 
 DEFINE_CLASS(Desktop);
 #include "Desktop.yc"
@@ -68,7 +87,8 @@ static struct WidgetTable desktopTable =
   pointerMotion: desktopPointerMotion,
   pointerButton: desktopPointerButton,
   render:        desktopRender,
-  resize:        desktopResize
+  resize:        desktopResize,
+  childMoved:    desktopChildMoved
 };
 
 static inline struct Desktop *
@@ -126,9 +146,15 @@ CLASS_INIT(struct Desktop *this, VTable *vtable)
   this -> widget.h = 1;
 
   this -> windows = zorderCreate (windowsKeyFunction, windowsComparisonFunction);
+  this -> hits = spatialindexCreate (0);
 
   this -> pointerWidget = NULL;
 
+  this -> visibility = NULL;
+  this -> visibilityAllocated = 0;
+  regionInitialise (&this -> uncovered);
+  regionInitialise (&this -> opaque);
+
   //get the path to the dsy_logo
   const char filename[] = "dsy_logo.png";
   size_t l = strlen (yImageDir);
@@ -157,7 +183,13 @@ static void
 desktopDestroy (struct Desktop *self)
 {
   zorderDestroy (self -> windows, NULL);
+  spatialindexDestroy (self -> hits);
   buffer_destroy (self -> background);
+  for (int i = 0; i < self -> visibilityAllocated; ++i)
+    regionFinalise (&self -> visibility[i].visible);
+  yfree (self -> visibility);
+  regionFinalise (&self -> uncovered);
+  regionFinalise (&self -> opaque);
   objectFinalise (desktop_to_object (self));
   yfree (self);
 }
@@ -178,14 +210,10 @@ int
 desktopPointerMotion (struct Widget *self_w, int32_t x, int32_t y, int32_t dx, int32_t dy)
 {
   struct Desktop *self = castBack (self_w);
-  struct ZOrderIterator *iterator; 
-  iterator = zorderGetTopIterator (self -> windows);
-  while (zorderiteratorHasValue (iterator)) 
+  for (struct Widget *widget = spatialindexHit (self -> hits, x, y, NULL);
+       widget != NULL;
+       widget = spatialindexHit (self -> hits, x, y, widget))
     {
-      struct Widget *widget = zorderiteratorGet (iterator);
-      int wx, wy;
-      widget_get_position_local (widget, &wx, &wy);
-
       if (widget_contains_point_local (widget, x, y))
         {
           if (widget != self -> pointerWidget)
@@ -196,14 +224,9 @@ desktopPointerMotion (struct Widget *self_w, int32_t x, int32_t y, int32_t dx, i
               self -> pointerWidget =  widget;
             }
           if (widget_pointer_motion (widget, x, y, dx, dy))
-            {
-              zorderiteratorDestroy (iterator);
-              return 1;
-            }
+            return 1;
         }
-      zorderiteratorMoveDown (iterator);
     }
-  zorderiteratorDestroy (iterator);
  
   if (self -> pointerWidget != NULL)
     {
@@ -218,35 +241,34 @@ int
 desktopPointerButton (struct Widget *self_w, int32_t x, int32_t y, uint32_t b, bool pressed)
 {
   struct Desktop *self = castBack (self_w);
-  struct ZOrderIterator *iterator; 
-  iterator = zorderGetTopIterator (self -> windows);
-  while (zorderiteratorHasValue (iterator)) 
+  for (struct Widget *widget = spatialindexHit (self -> hits, x, y, NULL);
+       widget != NULL;
+       widget = spatialindexHit (self -> hits, x, y, widget))
     {
-      struct Widget *widget = zorderiteratorGet (iterator);
-      int wx, wy;
-      widget_get_position_local (widget, &wx, &wy);
-      if (widget_contains_point_local (widget, x, y))
-        {
-          if (widget_pointer_button (widget, x, y, b, pressed))
-            {
-              zorderiteratorDestroy (iterator);
-              return 1;
-            }
-        }
-      zorderiteratorMoveDown (iterator);
+      if (widget_contains_point_local (widget, x, y)
+          && widget_pointer_button (widget, x, y, b, pressed))
+        return 1;
     }
-  zorderiteratorDestroy (iterator);
-  
 
   return 1;
 }
 
-void
-desktopRender (struct Widget *self_w, Renderer *renderer)
+static void
+desktopRenderWindow (struct Widget *widget, Renderer *renderer)
 {
-  struct Desktop *self = castBack (self_w);
-  struct ZOrderIterator *iter;
+  struct Rectangle *widgetRectangle = widget_get_rectangle (widget);
+  if (renderer_enter (renderer, widgetRectangle,
+                     widgetRectangle->x, widgetRectangle->y))
+    {
+      widget_render (widget, renderer);
+      renderer_leave (renderer);
+    }
+  rectangleDestroy (widgetRectangle);
+}
 
+static void
+desktopRenderBackground (struct Desktop *self, Renderer *renderer)
+{
   /* This should be in paint?
    */
   renderer_draw_filled_rectangle (renderer, 0xFF404080,
@@ -254,25 +276,90 @@ desktopRender (struct Widget *self_w, Renderer *renderer)
                                self -> widget.w, self -> widget.h);
   //render the background image..
   renderer_render_buffer (renderer, self->background, 0, 0);
+}
 
-  /* render the windows */
-  iter = zorderGetBottomIterator (self -> windows);
+static struct DesktopVisibility *
+desktopVisibilitySlot (struct Desktop *self, int i)
+{
+  if (i == self -> visibilityAllocated)
+    {
+      int newSize = self -> visibilityAllocated ? self -> visibilityAllocated * 2 : 16;
+      struct DesktopVisibility *v = ymalloc (sizeof (struct DesktopVisibility) * newSize);
+      if (self -> visibilityAllocated)
+        memcpy (v, self -> visibility,
+                sizeof (struct DesktopVisibility) * self -> visibilityAllocated);
+      for (int j = self -> visibilityAllocated; j < newSize; ++j)
+        regionInitialise (&v[j].visible);
+      yfree (self -> visibility);
+      self -> visibility = v;
+      self -> visibilityAllocated = newSize;
+    }
+  return &self -> visibility[i];
+}
+
+void
+desktopRender (struct Widget *self_w, Renderer *renderer)
+{
+  struct Desktop *self = castBack (self_w);
+  const struct Region *damage = renderer_get_clip_region (renderer);
+  struct ZOrderIterator *iter;
+  int ox, oy, count = 0;
 
+  if (damage == NULL)
+    {
+      /* No region to work with, so just paint everything bottom up */
+      desktopRenderBackground (self, renderer);
+      iter = zorderGetBottomIterator (self -> windows);
+      while (zorderiteratorHasValue (iter))
+        {
+          desktopRenderWindow (zorderiteratorGet (iter), renderer);
+          zorderiteratorMoveUp (iter);
+        }
+      zorderiteratorDestroy (iter);
+      return;
+    }
+
+  /* Work top down, taking what each window covers opaquely away from
+   * what the windows below it (and the background) need to draw
+   */
+  renderer_get_origin (renderer, &ox, &oy);
+  regionCopy (&self -> uncovered, damage);
+  iter = zorderGetTopIterator (self -> windows);
   while (zorderiteratorHasValue (iter))
     {
       struct Widget *widget = zorderiteratorGet (iter);
-      struct Rectangle *widgetRectangle = widget_get_rectangle (widget);
-      if (renderer_enter (renderer, widgetRectangle,
-                         widgetRectangle->x, widgetRectangle->y))
+      struct DesktopVisibility *v = desktopVisibilitySlot (self, count++);
+      struct Rectangle bounds = { widget -> x + ox, widget -> y + oy,
+                                  widget -> w, widget -> h };
+      v -> widget = widget;
+      regionCopy (&v -> visible, &self -> uncovered);
+      regionIntersectRectangle (&v -> visible, &bounds);
+      if (!regionIsEmpty (&v -> visible))
         {
-          widget_render (widget, renderer);
-          renderer_leave (renderer);
+          widget_get_opaque_region (widget, &self -> opaque);
+          regionTranslate (&self -> opaque, bounds.x, bounds.y);
+          regionSubtract (&self -> uncovered, &self -> uncovered, &self -> opaque);
         }
-      rectangleDestroy (widgetRectangle);
-      zorderiteratorMoveUp (iter);
+      zorderiteratorMoveDown (iter);
     }
   zorderiteratorDestroy (iter);
 
+  /* Then paint bottom up, each through its own visible region */
+  if (!regionIsEmpty (&self -> uncovered))
+    {
+      renderer_set_clip_region (renderer, &self -> uncovered);
+      desktopRenderBackground (self, renderer);
+    }
+  for (int i = count - 1; i >= 0; --i)
+    {
+      struct DesktopVisibility *v = &self -> visibility[i];
+      if (regionIsEmpty (&v -> visible))
+        continue;
+      renderer_set_clip_region (renderer, &v -> visible);
+      desktopRenderWindow (v -> widget, renderer);
+    }
+
+  renderer_set_clip_region (renderer, damage);
 }
 
 void
@@ -318,10 +405,21 @@ desktopResize (struct Widget *self_w)
   zorderiteratorDestroy (iter);
 }
 
+static void
+desktopChildMoved (struct Widget *self_w, struct Widget *child)
+{
+  struct Desktop *self = castBack (self_w);
+  spatialindexMove (self -> hits, child,
+                    &(struct Rectangle){ child -> x, child -> y, child -> w, child -> h });
+}
+
 void
 desktopAddWindow (struct Desktop *self, struct Window *win)
 {
+  struct Widget *widget = windowToWidget (win);
   zorderAddAtTop (self -> windows, win);
+  spatialindexAdd (self -> hits, widget,
+                   &(struct Rectangle){ widget -> x, widget -> y, widget -> w, widget -> h });
   widget_set_container (windowToWidget (win), desktopToWidget (self));
   wmSelectWindow (win);
   widget_repaint (desktopToWidget (self),
@@ -337,6 +435,7 @@ desktopRaiseWindow (struct Desktop *self, struct Window *win)
   if (top != NULL && objectGetID (top) != id)
     {
       zorderMoveToTop (self -> windows, &id);
+      spatialindexRaise (self -> hits, windowToWidget (win));
       widget_repaint (desktopToWidget (self),
                         widget_get_rectangle (windowToWidget (win)));
     }
@@ -348,6 +447,7 @@ desktopRemoveWindow (struct Desktop *self, struct Window *win)
 {
   int id = objectGetID (window_to_object (win));
   zorderRemove (self -> windows, &id);
+  spatialindexRemove (self -> hits, windowToWidget (win));
   if (self -> pointerWidget == windowToWidget (win))
     self -> pointerWidget = NULL;
   struct Window *w = zorderGetTop (self -> windows);
@@ -367,6 +467,7 @@ desktopCycleWindows (struct Desktop *self, int direction)
       if (win == NULL)
         return;
       zorderMoveToBottom (self -> windows, win);
+      spatialindexLower (self -> hits, windowToWidget (win));
       widget_rerender (windowToWidget (win), NULL);
     }
   else
@@ -375,6 +476,7 @@ desktopCycleWindows (struct Desktop *self, int direction)
       if (win == NULL)
         return;
       zorderMoveToTop (self -> windows, win);
+      spatialindexRaise (self -> hits, windowToWidget (win));
       widget_rerender (windowToWidget (win), NULL);
     }
   win = zorderGetTop (self -> windows);
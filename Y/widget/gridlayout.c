@@ -42,6 +42,13 @@ struct GridLayout
   uint32_t *rowHeights, *colWidths;
   struct llist *items;
   struct Widget *pointerWidget;
+
+  /* the topmost item in each cell, rows by cols, for hit-testing; if
+   * items overlap or don't fit their cells exactly, the cells can't be
+   * trusted and the items are searched instead */
+  struct GridItem **cells;
+  bool cellsValid;
+  bool cellsOverlap;
 };
 
 struct GridItem
@@ -58,6 +65,7 @@ static int gridlayoutPointerMotion (struct Widget *, int32_t, int32_t, int32_t,
 static int gridlayoutPointerButton (struct Widget *, int32_t, int32_t, uint32_t, bool);
 static void gridlayoutPointerEnter (struct Widget *, int32_t, int32_t);
 static void gridlayoutPointerLeave (struct Widget *);
+static void gridlayoutChildMoved (struct Widget *, struct Widget *);
 
 static void gridlayoutFitChildren (struct GridLayout *self);
 
@@ -77,7 +85,8 @@ static struct WidgetTable gridlayoutTable =
   pointerMotion: gridlayoutPointerMotion,
   pointerButton: gridlayoutPointerButton,
   pointerEnter:  gridlayoutPointerEnter,
-  pointerLeave:  gridlayoutPointerLeave
+  pointerLeave:  gridlayoutPointerLeave,
+  childMoved:    gridlayoutChildMoved
 };
 
 void
@@ -90,6 +99,9 @@ CLASS_INIT(struct GridLayout *this, VTable *vtable)
   this -> colWidths = NULL;
   this -> items = new_llist ();
   this -> pointerWidget = NULL;
+  this -> cells = NULL;
+  this -> cellsValid = false;
+  this -> cellsOverlap = false;
 }
 
 
@@ -121,6 +133,7 @@ gridlayoutUnpack (struct Widget *self_w, struct Widget *w)
         {
           llist_node_delete (node);
           yfree (item);
+          self -> cellsValid = false;
           widget_set_container (w, NULL);
           return;
         }
@@ -176,6 +189,7 @@ gridlayoutDestroy (struct GridLayout *self)
   objectFinalise (gridlayout_to_object (self));
   yfree(self->rowHeights);
   yfree(self->colWidths);
+  yfree (self->cells);
   yfree (self);
 }
 
@@ -220,6 +234,7 @@ gridlayoutResizeGrid (struct GridLayout *self, uint32_t cols, uint32_t rows)
   yfree (self -> colWidths);
   self -> rowHeights = ymalloc (sizeof (int) * self -> rows);
   self -> colWidths  = ymalloc (sizeof (int) * self -> cols);
+  self -> cellsValid = false;
 
   gridlayoutFitChildren (self);
 }
@@ -301,6 +316,7 @@ gridlayoutAddWidget (struct GridLayout *self, struct Object *obj, uint32_t col,
   item -> rowspan = rowspan;
 
   llist_add_tail (self -> items, item);
+  self -> cellsValid = false;
 
   if (item -> col + item -> colspan > self -> cols ||
       item -> row + item -> rowspan > self -> rows)
@@ -334,6 +350,7 @@ gridlayoutRemoveWidget (struct GridLayout *self, struct Object *obj)
         {
           llist_node_delete (node);
           yfree (item);
+          self -> cellsValid = false;
           break;
         }
     }
@@ -403,6 +420,86 @@ gridlayoutResize (struct Widget *self_w)
   gridlayoutFitChildren (self);
 }
 
+static void
+gridlayoutChildMoved (struct Widget *self_w, struct Widget *child)
+{
+  struct GridLayout *self = castBack (self_w);
+  self -> cellsValid = false;
+}
+
+static void
+gridlayoutIndexCells (struct GridLayout *self)
+{
+  yfree (self -> cells);
+  self -> cells = NULL;
+  self -> cellsOverlap = false;
+  self -> cellsValid = true;
+  if (self -> rows == 0 || self -> cols == 0)
+    return;
+
+  self -> cells = ycalloc (self -> rows * self -> cols, sizeof (struct GridItem *));
+
+  /* later items are on top, so they overwrite earlier ones */
+  for (struct llist_node *node = llist_head (self->items);
+       node != NULL;
+       node = llist_node_next (node))
+    {
+      struct GridItem *item = llist_node_data (node);
+      struct Widget *w = item -> widget;
+      if (w -> x != colWidth (self, 0, item -> col)
+          || w -> y != rowHeight (self, 0, item -> row)
+          || w -> w != colWidth (self, item -> col, item -> colspan)
+          || w -> h != rowHeight (self, item -> row, item -> rowspan))
+        self -> cellsOverlap = true;
+      for (uint32_t r = item -> row; r < item -> row + item -> rowspan; ++r)
+        for (uint32_t c = item -> col; c < item -> col + item -> colspan; ++c)
+          {
+            if (self -> cells[r * self -> cols + c] != NULL)
+              self -> cellsOverlap = true;
+            self -> cells[r * self -> cols + c] = item;
+          }
+    }
+}
+
+/* finds the topmost item containing the point, in local coordinates */
+static struct GridItem *
+gridlayoutItemAt (struct GridLayout *self, int32_t x, int32_t y)
+{
+  if (!self -> cellsValid)
+    gridlayoutIndexCells (self);
+
+  if (self -> cellsOverlap)
+    {
+      /* iterate backwards, so items that appear on top get served first */
+      for (struct llist_node *node = llist_tail (self->items);
+           node != NULL;
+           node = llist_node_prev (node))
+        {
+          struct GridItem *item = llist_node_data (node);
+          if (widget_contains_point_local (item -> widget, x, y))
+            return item;
+        }
+      return NULL;
+    }
+
+  if (x < 0 || y < 0)
+    return NULL;
+  uint32_t col = 0, row = 0;
+  for (int32_t edge = 0; col < self -> cols; ++col)
+    if ((edge += self -> colWidths[col]) > x)
+      break;
+  for (int32_t edge = 0; row < self -> rows; ++row)
+    if ((edge += self -> rowHeights[row]) > y)
+      break;
+  if (col == self -> cols || row == self -> rows)
+    return NULL;
+
+  struct GridItem *item = self -> cells[row * self -> cols + col];
+  if (item != NULL && widget_contains_point_local (item -> widget, x, y))
+    return item;
+  return NULL;
+}
+
 int
 gridlayoutPointerMotion (struct Widget *self_w, int32_t x, int32_t y, int32_t dx, int32_t dy)
 {
@@ -415,27 +512,19 @@ gridlayoutPointerMotion (struct Widget *self_w, int32_t x, int32_t y, int32_t dx
   rectangleDestroy (r);
 
 
-  /* iterate backwards, so items that appear on top get served first */
-  for (struct llist_node *node = llist_tail (self->items);
-       node != NULL;
-       node = llist_node_prev (node))
+  struct GridItem *item = gridlayoutItemAt (self, x, y);
+  if (item != NULL)
     {
-      struct GridItem *item = llist_node_data (node);
-      //      int32_t lx = x - item -> widget -> x;
-      //      int32_t ly = y - item -> widget -> y;
-      if (widget_contains_point_local (item -> widget, x, y))
+      if (self -> pointerWidget != item -> widget)
         {
-          if (self -> pointerWidget != item -> widget)
-            {
-              if (self -> pointerWidget != NULL)
-                widget_pointer_leave (self -> pointerWidget);
-              self -> pointerWidget = item -> widget;
-
-              widget_pointer_enter (item -> widget, x, y);
-            }
-          widget_pointer_motion (item -> widget, x, y, dx, dy);
-          return 1;
+          if (self -> pointerWidget != NULL)
+            widget_pointer_leave (self -> pointerWidget);
+          self -> pointerWidget = item -> widget;
+
+          widget_pointer_enter (item -> widget, x, y);
         }
+      widget_pointer_motion (item -> widget, x, y, dx, dy);
+      return 1;
     }
 
   if (self -> pointerWidget != NULL)
@@ -457,15 +546,20 @@ gridlayoutPointerButton (struct Widget *self_w, int32_t x, int32_t y, uint32_t b
   y -= r->y;
   rectangleDestroy (r);
 
-  /* iterate backwards, so items that appear on top get served first */
+  struct GridItem *top = gridlayoutItemAt (self, x, y);
+  if (top != NULL && widget_pointer_button (top -> widget, x, y, b, p))
+    return 1;
+  if (!self -> cellsOverlap)
+    return 0;
+
+  /* offer it to any overlapped items underneath */
   for (struct llist_node *node = llist_tail (self->items);
        node != NULL;
        node = llist_node_prev (node))
     {
       struct GridItem *item = llist_node_data (node);
-      //      int32_t lx = x - item -> widget -> x;
-      //      int32_t ly = y - item -> widget -> y;
-      if (widget_contains_point_local (item -> widget, x, y)
+      if (item != top
+          && widget_contains_point_local (item -> widget, x, y)
           && widget_pointer_button (item -> widget, x, y, b, p))
         return 1;
     }
@@ -484,22 +578,12 @@ gridlayoutPointerEnter (struct Widget *self_w, int32_t x, int32_t y)
   rectangleDestroy (r);
  
 
-  /* iterate backwards, so items that appear on top get served first */
-  for (struct llist_node *node = llist_tail (self->items);
-       node != NULL;
-       node = llist_node_prev (node))
+  struct GridItem *item = gridlayoutItemAt (self, x, y);
+  if (item != NULL)
     {
-      struct GridItem *item = llist_node_data (node);
-      //      int32_t lx = x - item -> widget -> x;
-      //      int32_t ly = y - item -> widget -> y;
-      if (widget_contains_point_local (item -> widget, x, y))
-        {
-          self -> pointerWidget = item -> widget;
-          widget_pointer_enter (item -> widget, x, y);
-          return;
-        }
+      self -> pointerWidget = item -> widget;
+      widget_pointer_enter (item -> widget, x, y);
     }
-  return;
 }
 
 void
@@ -19,6 +19,7 @@
 #include <Y/object/class.h>
 #include <Y/widget/widget_p.h>
 #include <Y/screen/screen.h>
+#include <Y/trace/tracering.h>
 #include <stdlib.h>
 #include <Y/object/class.h>
 
@@ -249,12 +250,21 @@ widget_get_window (struct Widget *self)
     return NULL;
 }
 
+static void
+widgetChildMoved (struct Widget *self)
+{
+  struct Widget *container = self -> container;
+  if (container != NULL && container -> tab -> childMoved != NULL)
+    container -> tab -> childMoved (container, self);
+}
+
 void
 widget_move (struct Widget *self, int32_t x, int32_t y)
 {
   widget_rerender (self, NULL);
   self -> x = x;
   self -> y = y;
+  widgetChildMoved (self);
   widget_rerender (self, NULL);
 }
 
@@ -264,7 +274,10 @@ widget_reconfigure (struct Widget *self)
   if (self == NULL)
     return;
   if (self -> tab -> reconfigure != NULL)
-    self -> tab -> reconfigure (self);
+    {
+      TRACE_SPAN (treLayout, objectGetID (widget_to_object (self)), 0);
+      self -> tab -> reconfigure (self);
+    }
   else
     widget_reconfigure (self -> container);
 }
@@ -288,7 +301,11 @@ widget_resize (struct Widget *self, int32_t w, int32_t h)
   if (self -> maxHeight != -1 && self -> h > self -> maxHeight)
     self -> h = self -> maxHeight;
   if (self -> tab -> resize != NULL)
-    self -> tab -> resize (self);
+    {
+      TRACE_SPAN (treLayout, objectGetID (widget_to_object (self)), 0);
+      self -> tab -> resize (self);
+    }
+  widgetChildMoved (self);
   widget_rerender (self, NULL);
 }
 
@@ -316,10 +333,19 @@ widget_render (struct Widget *self, Renderer *renderer)
     self -> tab -> render (self, renderer);
 }
 
+void
+widget_get_opaque_region (struct Widget *self, struct Region *region)
+{
+  regionClear (region);
+  if (self != NULL && self -> tab -> getOpaqueRegion != NULL)
+    self -> tab -> getOpaqueRegion (self, region);
+}
+
 void
 widget_paint (struct Widget *self, struct Painter *painter)
 {
   if (self != NULL && self -> tab -> paint != NULL) {
+    TRACE_SPAN (trePaint, objectGetID (widget_to_object (self)), 0);
     painter_save_state(painter);
     painter_set_origin_local (painter, self -> x, self -> y);
     self -> tab -> paint (self, painter);
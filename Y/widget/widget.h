@@ -39,6 +39,7 @@ enum WidgetState
 #include <Y/y.h>
 #include <Y/const.h>
 #include <Y/util/rectangle.h>
+#include <Y/util/region.h>
 #include <Y/screen/renderer.h>
 #include <Y/buffer/painter.h>
 #include <Y/input/pointer.h>
@@ -73,6 +74,10 @@ void   widget_set_container  (struct Widget *, struct Widget *);
 void   widget_unpack        (struct Widget *, struct Widget *);
 
 void   widget_render        (struct Widget *, Renderer *);
+/* Sets REGION to the part of the widget, in its own co-ordinates,
+ * that it is sure to render fully opaque; by default, none of it
+ */
+void   widget_get_opaque_region (struct Widget *, struct Region *);
 void   widget_paint         (struct Widget *, struct Painter *);
 void   widget_repaint       (struct Widget *, struct Rectangle *);
 void   widget_rerender      (struct Widget *, struct Rectangle *);
@@ -34,11 +34,14 @@ struct WidgetTable
   void            (*unpack)       (struct Widget *, struct Widget *);
 
   void            (*render)       (struct Widget *, Renderer *);
+  void            (*getOpaqueRegion)(struct Widget *, struct Region *);
   void            (*paint)        (struct Widget *, struct Painter *);
   void            (*repaint)      (struct Widget *, struct Rectangle *);
 
   void            (*reconfigure)  (struct Widget *);
   void            (*resize)       (struct Widget *);
+  /* called on a container when one of its children moves or resizes */
+  void            (*childMoved)   (struct Widget *, struct Widget *);
 
   int             (*pointerMotion)(struct Widget *, int32_t, int32_t, int32_t, int32_t);
   int             (*pointerButton)(struct Widget *, int32_t, int32_t, uint32_t, bool);
@@ -21,6 +21,7 @@
 
 #include <Y/util/yutil.h>
 #include <Y/util/llist.h>
+#include <Y/util/region.h>
 #include <Y/buffer/buffer.h>
 #include <Y/buffer/painter.h>
 #include <Y/screen/screen.h>
@@ -46,7 +47,7 @@ struct Window
   int pointerInChild : 1;
   int storeX, storeY, storeW, storeH;
   int dragging, dragX, dragY;
-  struct llist *invalidRectangles;
+  struct Region invalid;
 };
 
 enum WindowAnchor
@@ -64,6 +65,7 @@ static void windowPointerEnter (struct Widget *, int32_t x, int32_t y);
 static void windowPointerLeave (struct Widget *);
 static struct Window *windowGetWindow (struct Widget *);
 static void windowRender (struct Widget *, Renderer *);
+static void windowGetOpaqueRegion (struct Widget *, struct Region *);
 static void windowUnpack (struct Widget *, struct Widget *);
 static void windowPaint (struct Widget *, struct Painter *);
 static void windowRepaint (struct Widget *, struct Rectangle *rect);
@@ -91,6 +93,7 @@ static struct WidgetTable windowTable =
   pointerEnter:  windowPointerEnter,
   pointerLeave:  windowPointerLeave,
   render:        windowRender,
+  getOpaqueRegion: windowGetOpaqueRegion,
   paint:         windowPaint,
   repaint:       windowRepaint,
   reconfigure:   windowReconfigure,
@@ -110,7 +113,7 @@ CLASS_INIT (struct Window *this, VTable *vtable)
   this -> sizeState = WINDOW_SIZE_NORMAL;
   this -> pointerInChild = 0;
   this -> dragging = 0;
-  this -> invalidRectangles = new_llist ();
+  regionInitialise (&this -> invalid);
   this -> buffer = screen_get_new_buffer (this -> widget.w, this -> widget.h,
                                           CAIRO_FORMAT_ARGB32); //create the buffer
 
@@ -164,8 +167,8 @@ static void
 windowRepaint (struct Widget *self_w, struct Rectangle *rect)
 {
   struct Window *self = castBack (self_w);
-  llist_add_tail (self -> invalidRectangles, rect);
-  widget_rerender (windowToWidget (self), rectangleDuplicate (rect));
+  regionUnionRectangle (&self -> invalid, rect);
+  widget_rerender (windowToWidget (self), rect);
 }
 
 /* PROPERTY HOOK
@@ -195,7 +198,7 @@ windowDestroy (struct Window *self)
   wmUnregisterWindow (self);
   if (self -> child != NULL)
     widget_set_container (self -> child, NULL);
-  llist_destroy (self -> invalidRectangles, rectangleDestroy);
+  regionFinalise (&self -> invalid);
   buffer_destroy (self->buffer);
   widgetFinalise (windowToWidget (self));
   objectFinalise (window_to_object (self));
@@ -504,25 +507,30 @@ windowShow (struct Window *self)
     }
 }
 
+/* METHOD
+ * move :: (int32, int32) -> ()
+ */
+void
+windowMove (struct Window *self, int32_t x, int32_t y)
+{
+  widget_move (windowToWidget (self), x, y);
+}
+
 void
 windowRender (struct Widget *self_w, Renderer *renderer)
 {
   struct Window *self = castBack (self_w);
-  struct llist_node *node;
-  rectanglelistUnionOverlaps (self -> invalidRectangles);
-  node = llist_head (self->invalidRectangles);
-  while (node != NULL)
+  int count;
+  const struct Rectangle *rects = regionGetRectangles (&self -> invalid, &count);
+  for (int i = 0; i < count; ++i)
     {
-      struct llist_node *next_node = llist_node_next (node);
-      struct Rectangle *rect = llist_node_data (node);
+      struct Rectangle rect = rects[i];
       struct Painter *painter = buffer_get_painter (self->buffer);
-      painter_clip_buffer (painter, rect);
+      painter_clip_buffer (painter, &rect);
       windowPaint (self_w, painter);
       painter_destroy (painter);
-      llist_node_delete (node);
-      rectangleDestroy (rect);
-      node = next_node;
     }
+  regionClear (&self -> invalid);
 
   renderer_render_buffer (renderer, self->buffer, 0, 0);
 
@@ -538,6 +546,15 @@ windowRender (struct Widget *self_w, Renderer *renderer)
     }
 }
 
+static void
+windowGetOpaqueRegion (struct Widget *self_w, struct Region *region)
+{
+  struct Window *self = castBack (self_w);
+  struct Rectangle bounds = { 0, 0, self_w -> w, self_w -> h };
+  themeWindowGetOpaqueRegion (self, region);
+  regionIntersectRectangle (region, &bounds);
+}
+
 void
 windowReconfigure (struct Widget *self_w)
 {
@@ -63,6 +63,7 @@ void            windowRestoreGeometry (struct Window *);
 void windowSetChild    (struct Window *, struct Object *);
 void windowSetFocussed (struct Window *, struct Object *);
 void windowShow        (struct Window *);
+void windowMove        (struct Window *, int32_t x, int32_t y);
 
 #endif /* Y_WIDGET_WINDOW_H */
 
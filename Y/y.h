@@ -31,6 +31,9 @@ extern const char *yConfigDir;
 extern const char *yDataDir;
 extern const char *yImageDir;
 extern const char *yPointerImageDir;
+extern const char *yDumpDir;
+
+char *yDumpPath (const char *name);
 
 #endif
 
@@ -450,6 +450,31 @@ sub make_type
     map {make_value $_} @_;
   }
 
+my %signature_codes = (string => 's',
+                       uint32 => 'u',
+                       int32 => 'i',
+                       object => 'o',
+                       any => 'a',
+                       '...' => '*',
+                      );
+
+# The compiled form of a type, for tupleMatchSignature
+sub make_signature
+  {
+    return join '', map {$signature_codes{$_} or die "Type '$_' can't be in a signature"} @{$_[0]};
+  }
+
+# Whether a function is handed pointers into its argument tuple: the
+# tuple itself, a string's data or a list. Those must get a copy of
+# their own, as they would have from tupleStaticCast
+sub borrows_args
+  {
+    my $function = shift;
+    return 1 if $function->{arg_convention} eq 'tuple';
+    return 0 unless $function->{arg_convention} eq 'direct';
+    return scalar grep {$_ eq 'string' or $_ eq '...'} @{$function->{args}};
+  }
+
 #
 # This is responsible for making the file ${class}.ych
 # It makes the initializer available to subclasses.
@@ -634,12 +659,9 @@ _Y__$function->{function}__function_wrapper(struct Client *from, const struct Tu
 END
       }
 
+    # The arguments have already been matched and cast
     $value .= <<"END";
 {
-  struct Tuple *cast_args = tupleStaticCast(args, type->args);
-  if (!cast_args)
-    return tupleBuildError(tb_string("Type mismatch in arguments"));
-
 END
 
     my @args;
@@ -658,7 +680,7 @@ END
       }
     elsif ($function->{arg_convention} eq 'tuple')
       {
-        push @args, 'cast_args';
+        push @args, 'args';
       }
     elsif ($function->{arg_convention} eq 'direct')
       {
@@ -668,21 +690,21 @@ END
             if ($arg eq '...')
               {
                 $value .= <<"END";
-  struct Tuple tail_args = {.error = cast_args->error,
-                            .count = cast_args->count - $i,
-                            .list  = cast_args->list + $i};
+  struct Tuple tail_args = {.error = args->error,
+                            .count = args->count - $i,
+                            .list  = args->list + $i};
 END
                 push @args, "&tail_args";
                 last;
               }
             elsif ($arg eq 'string')
               {
-                push @args, "cast_args->list[$i].string.len";
-                push @args, "cast_args->list[$i].string.data";
+                push @args, "args->list[$i].string.len";
+                push @args, "args->list[$i].string.data";
               }
             else
               {
-                push @args, "cast_args->list[$i]" . $typemap{$arg}{selector};
+                push @args, "args->list[$i]" . $typemap{$arg}{selector};
               }
           }
       }
@@ -707,10 +729,6 @@ END
   ${result_assign}$function->{function}(${args});
 END
 
-    $value .= <<"END";
-  tupleDestroy(cast_args);
-END
-
     if ($function->{result_convention} eq 'void')
       {
         $value .= <<"END";
@@ -727,6 +745,10 @@ END
   if (result && result->error)
     return result;
 
+  /* Usually it's already what was declared */
+  if (tupleMatchSignature(result, "${\make_signature($function->{result})}"))
+    return result;
+
   struct Tuple *cast_result = tupleStaticCast(result, type->result);
   tupleDestroy(result);
 
@@ -769,6 +791,56 @@ sub make_method
         $value .= make_function_wrapper($instance, $class, $function);
       }
 
+    foreach my $function (@functions)
+      {
+        $value .= <<"END";
+static struct TupleType _Y__$function->{function}__args_type =
+  {
+END
+        $value .= make_tuple_type($function->{args});
+        $value .= <<"END";
+  };
+
+static struct TupleType _Y__$function->{function}__result_type =
+  {
+END
+        $value .= make_tuple_type($function->{result});
+        $value .= <<"END";
+  };
+
+END
+      }
+
+    my $function_count = scalar @functions;
+
+    $value .= <<"END";
+static struct MethodTypes _Y__${class}__${method}__types =
+  {
+    .count = $function_count,
+    .list =
+    (struct MethodType []){
+END
+    foreach my $function (@functions)
+      {
+        $value .= <<"END";
+      {
+        .args = \&_Y__$function->{function}__args_type,
+        .result = \&_Y__$function->{function}__result_type,
+        .data = \&_Y__$function->{function}__function_wrapper
+      },
+END
+      }
+    $value .= <<"END";
+      {
+        .args = NULL,
+        .result = NULL,
+        .data = NULL
+      }
+    }
+  };
+
+END
+
     if ($instance)
       {
         $value .= <<"END";
@@ -786,74 +858,98 @@ _Y__${class}__${method}__class_wrapper(struct Client *from, const struct Tuple *
 END
       }
 
-    foreach my $function (@functions)
-      {
-        $value .= <<"END";
-  struct TupleType $function->{function}_args_type =
-    {
+    $value .= <<"END";
+  const struct MethodType *type = NULL;
+  struct Tuple *cast_args = NULL;
 END
-        $value .= make_tuple_type($function->{args});
-        $value .= <<"END";
-    };
 
-  struct TupleType $function->{function}_result_type =
-    {
-END
-        $value .= make_tuple_type($function->{result});
+    # The arguments usually have exactly the declared types, and can be
+    # used as they are. With one signature, object ids can also be
+    # looked up without making a new tuple; with more, only a perfect
+    # match is certain to be the one tupleMatchType would pick, and a
+    # list never is. An any matches whatever follows it as well, so it
+    # can take calls meant for a later signature: methods with several
+    # signatures and an any anywhere leave it all to tupleMatchType
+    my @signatures = map {make_signature($_->{args})} @functions;
+    if ($function_count == 1 && $signatures[0] =~ /^[^*]*o[^*]*$/)
+      {
+        my $signature = $signatures[0];
+        my $count = length $signature;
+        my $copy = borrows_args($functions[0]) ? "\n      args = cast_args = tupleDup(args);" : "";
         $value .= <<"END";
-    };
+  struct Value values[$count];
+  const struct Tuple resolved = {.count = $count, .list = values};
 
+  if (tupleResolveSignature(args, "$signature", values))
+    {
+      type = \&_Y__${class}__${method}__types.list[0];
+      args = \&resolved;$copy
+    }
 END
       }
-
-    my $function_count = scalar @functions;
-
-    $value .= <<"END";
-  struct MethodTypes types =
+    elsif ($function_count == 1 || !grep {/a/} @signatures)
+      {
+        my $else = "";
+        foreach my $i (0..$function_count - 1)
+          {
+            my $signature = $signatures[$i];
+            next if $function_count > 1 && $signature =~ /\*/;
+            if (borrows_args($functions[$i]))
+              {
+                $value .= <<"END";
+  ${else}if (tupleMatchSignature(args, "$signature"))
     {
-      .count = $function_count,
-      .list =
-      (struct MethodType []){
+      type = \&_Y__${class}__${method}__types.list[$i];
+      args = cast_args = tupleDup(args);
+    }
 END
-    foreach my $function (@functions)
-      {
-        $value .= <<"END";
-        {
-          .args = \&$function->{function}_args_type,
-          .result = \&$function->{function}_result_type,
-          .data = \&_Y__$function->{function}__function_wrapper
-        },
+              }
+            else
+              {
+                $value .= <<"END";
+  ${else}if (tupleMatchSignature(args, "$signature"))
+    type = \&_Y__${class}__${method}__types.list[$i];
 END
+              }
+            $else = "else ";
+          }
       }
+
     $value .= <<"END";
-        {
-          .args = NULL,
-          .result = NULL,
-          .data = NULL
-        }
-      }
-    };
 
-  const struct MethodType *type = tupleMatchType(args, &types);
   if (!type)
-    return tupleBuildError(tb_string("No match found for argument type"));
+    {
+      type = tupleMatchType(args, \&_Y__${class}__${method}__types);
+      if (!type)
+        return tupleBuildError(tb_string("No match found for argument type"));
+
+      cast_args = tupleStaticCast(args, type->args);
+      if (!cast_args)
+        return tupleBuildError(tb_string("Type mismatch in arguments"));
+      args = cast_args;
+    }
 
 END
     if ($instance)
       {
         $value .= <<"END";
   instanceFunctionWrapper *wrapper = type->data;
-  return (*wrapper)(obj, from, args, type);
+  struct Tuple *result = (*wrapper)(obj, from, args, type);
 END
       }
     else
       {
         $value .= <<"END";
   classFunctionWrapper *wrapper = type->data;
-  return (*wrapper)(from, args, type);
+  struct Tuple *result = (*wrapper)(from, args, type);
 END
       }
 
+    $value .= <<"END";
+  tupleDestroy(cast_args);
+  return result;
+END
+
     $value .= <<"END";
 }
 
@@ -945,16 +1041,19 @@ sub make_property_wrapper
     my $object = "${lcclass}_to_object(obj)";
 
     my $value = <<"END";
+/* set when the class is created */
+static uint32_t _Y__${class}__${prop}__property_id;
+
 static bool
 _Y__${class}__${prop}__check_property(struct $class *obj)
 {
-  return objectGetProperty($object, "${prop}") != NULL;
+  return objectGetPropertyByID($object, _Y__${class}__${prop}__property_id) != NULL;
 }
 
 static $typename
 _Y__${class}__${prop}__get_property(struct $class *obj)
 {
-  return objectGetProperty($object, "${prop}")${selector};
+  return objectGetPropertyByID($object, _Y__${class}__${prop}__property_id)${selector};
 }
 
 static bool
@@ -996,7 +1095,7 @@ END
     $value .= <<"END"
     }
   };
-  return objectSetProperty($object, "${prop}", &v);
+  return objectSetPropertyByID($object, _Y__${class}__${prop}__property_id, &v);
 }
 
 END
@@ -1097,7 +1196,8 @@ END
         my $hook = $ycd->properties->{$prop}{hook} ? "&_Y__${ycd}__${prop}__property_hook_wrapper" : "NULL";
 
         print $fh <<"END";
-  classAddProperty(CLASS($ycd), "$prop", $typename, $hook);
+  _Y__${ycd}__${prop}__property_id =
+    classAddProperty(CLASS($ycd), "$prop", $typename, $hook);
 END
       }
 
@@ -16,15 +16,129 @@
  *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
  */
 
+/* yctl Class [args...]  invokes a class method and prints its result
+ * yctl top [interval]    shows the server's performance counters,
+ *                        refreshed every interval milliseconds
+ */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
 #include <Y/c++.h>
 
+#include <algorithm>
+#include <map>
 #include <string>
 #include <vector>
 
+/* Calls per class listed by top */
+#define TOP_CLASSES 10
+
+static Y::Performance::Counters latestSample;
+static bool sampled = false;
+
+static void
+onSample (const Y::Performance::Counters &counters)
+{
+  latestSample = counters;
+  sampled = true;
+}
+
+static bool
+byRate (const std::pair<std::string, double> &a, const std::pair<std::string, double> &b)
+{
+  return a.second > b.second;
+}
+
+/* Counters wrap at 2^32, so the unsigned difference is right as long
+ * as they are sampled often enough */
+static double
+rate (std::map<std::string, uint32_t> &last, const std::string &name,
+      uint32_t value, double seconds)
+{
+  std::map<std::string, uint32_t>::iterator i = last.find (name);
+  double r = (i == last.end () || seconds <= 0) ? 0 : (uint32_t)(value - i->second) / seconds;
+  last[name] = value;
+  return r;
+}
+
+static void
+render (Y::Connection &y, Y::Performance &perf, uint32_t interval,
+        std::map<std::string, uint32_t> &lastCounters,
+        std::map<std::string, uint32_t> &lastCalls)
+{
+  double seconds = interval / 1000.0;
+
+  printf ("\033[H\033[2J");
+  printf ("Y server performance, every %u ms\n\n", interval);
+
+  printf ("%-16s %12s %12s\n", "counter", "total", "per second");
+  for (Y::Performance::Counters::const_iterator i = latestSample.begin ();
+       i != latestSample.end (); ++i)
+    printf ("%-16s %12u %12.1f\n", i->first.c_str (), i->second,
+            rate (lastCounters, i->first, i->second, seconds));
+
+  Y::Performance::Histograms histograms = perf.histograms ();
+  printf ("\n%-16s %10s %8s %8s %8s %8s %8s\n",
+          "histogram", "samples", "mean", "p50", "p90", "p99", "max");
+  for (Y::Performance::Histograms::const_iterator i = histograms.begin ();
+       i != histograms.end (); ++i)
+    printf ("%-16s %10u %8u %8u %8u %8u %8u\n", i->name.c_str (), i->count,
+            i->mean, i->p50, i->p90, i->p99, i->max);
+
+  Y::Performance::Counters classes = perf.classes ();
+  std::vector<std::pair<std::string, double> > rates;
+  for (Y::Performance::Counters::const_iterator i = classes.begin ();
+       i != classes.end (); ++i)
+    rates.push_back (std::make_pair (i->first, rate (lastCalls, i->first, i->second, seconds)));
+  std::sort (rates.begin (), rates.end (), byRate);
+  if (rates.size () > TOP_CLASSES)
+    rates.resize (TOP_CLASSES);
+  printf ("\n%-16s %12s %12s\n", "class", "calls", "per second");
+  for (size_t i = 0; i < rates.size (); ++i)
+    printf ("%-16s %12u %12.1f\n", rates[i].first.c_str (),
+            lastCalls[rates[i].first], rates[i].second);
+
+  /* Seven values per client; see Client.statistics */
+  Y::Reply *rep = y.findClass ("Client")->invokeMethod ("statistics", true);
+  const Y::Message::Members &clients = rep->tuple ();
+  printf ("\n%-8s %10s %12s %10s %10s %10s %10s\n", "client", "queued", "bytes",
+          "flushes", "syscalls", "deferred", "max lag");
+  for (size_t i = 0; i + 7 <= clients.size (); i += 7)
+    printf ("%-8u %10u %12u %10u %10u %10u %10u\n", clients[i].uint32 (),
+            clients[i + 1].uint32 (), clients[i + 2].uint32 (), clients[i + 3].uint32 (),
+            clients[i + 4].uint32 (), clients[i + 5].uint32 (), clients[i + 6].uint32 ());
+  delete rep;
+
+  fflush (stdout);
+}
+
+/* Runs until interrupted */
+static int
+top (Y::Connection &y, uint32_t interval)
+{
+  std::map<std::string, uint32_t> lastCounters, lastCalls;
+  Y::Performance perf (&y);
+
+  perf.sample.connect (sigc::ptr_fun (onSample));
+  perf.setInterval (interval);
+
+  for (;;)
+    {
+      y.poll (100);
+      /* rendering makes calls of its own, so it waits until the
+       * sample's despatch is over */
+      if (sampled)
+        {
+          sampled = false;
+          render (y, perf, interval, lastCounters, lastCalls);
+        }
+    }
+
+  return EXIT_SUCCESS;
+}
+
 int
 main (int argc, char **argv)
 {
@@ -33,6 +147,17 @@ main (int argc, char **argv)
 
   Y::Connection y;
 
+  if (strcmp (argv[1], "top") == 0)
+    {
+      int interval = argc > 2 ? atoi (argv[2]) : 1000;
+      if (argc > 3 || interval <= 0)
+        {
+          std::cerr << "Usage: yctl top [interval in ms]" << std::endl;
+          return EXIT_FAILURE;
+        }
+      return top (y, interval);
+    }
+
   Y::Class *c = y.findClass(argv[1]);
 
   Y::Message::Members v;
@@ -0,0 +1,303 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Synthetic load for the server in $YDISPLAY.
+ *
+ * Each client is a thread with its own connection, which builds a
+ * window holding a label and a canvas in a grid layout, then picks
+ * operations from the mix until the time is up:
+ *
+ *   props    set the label's text
+ *   lines    draw a burst of lines on the canvas and swap its buffers
+ *   moves    move the window somewhere else on the screen
+ *   signals  subscribe to the canvas' resize signal and drop it again
+ *
+ * Every operation ends with a Canvas.reset call, and its latency runs
+ * until that reply comes back, so it covers the server handling all
+ * of it. Results are printed one line per operation as key=value
+ * pairs, for scripts to pick up.
+ *
+ * Usage: yload [--clients n] [--duration seconds] [--rate ops/s]
+ *              [--lines n] [--mix props=4,lines=2,moves=1,signals=1]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <Y/c++/connection.h>
+#include <Y/c++/window.h>
+#include <Y/c++/label.h>
+#include <Y/c++/gridlayout.h>
+#include <Y/c++/canvas.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+enum Operation
+  {
+    opProps,
+    opLines,
+    opMoves,
+    opSignals,
+    opCount
+  };
+
+static const char *operationNames[opCount] = {"props", "lines", "moves", "signals"};
+
+static int clientCount = 50;
+static int duration = 10;
+static int rate = 0;
+static int lineCount = 100;
+static int weights[opCount] = {4, 2, 1, 1};
+static int totalWeight = 8;
+
+static pthread_barrier_t startBarrier;
+
+struct ClientResult
+{
+  std::vector<uint32_t> latencies[opCount];
+};
+
+static uint64_t
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+static enum Operation
+pickOperation (unsigned int *seed)
+{
+  int r = rand_r (seed) % totalWeight;
+  for (int op = 0; op < opCount; ++op)
+    {
+      r -= weights[op];
+      if (r < 0)
+        return (enum Operation)op;
+    }
+  return opProps;
+}
+
+static void *
+clientMain (void *data)
+{
+  ClientResult *result = (ClientResult *)data;
+  unsigned int seed = (unsigned int)(uintptr_t)result ^ time (NULL);
+  uint32_t width, height;
+
+  Y::Connection y;
+  Y::Window window (&y, "yload");
+  Y::GridLayout grid (&y);
+  Y::Label label (&y, "yload");
+  Y::Canvas canvas (&y);
+
+  canvas.requestSize (200, 150);
+  grid.addWidget (&label, 0, 0);
+  grid.addWidget (&canvas, 0, 1);
+  window.setChild (&grid);
+  window.show ();
+  window.move (rand_r (&seed) % 600, rand_r (&seed) % 400);
+  canvas.reset (width, height);
+
+  pthread_barrier_wait (&startBarrier);
+
+  uint64_t next = now ();
+  uint64_t stop = next + (uint64_t)duration * 1000000;
+  for (unsigned long n = 0; now () < stop; ++n)
+    {
+      if (rate > 0)
+        {
+          next += 1000000 / rate;
+          uint64_t t = now ();
+          if (next > t)
+            usleep (next - t);
+        }
+
+      enum Operation op = pickOperation (&seed);
+      uint64_t start = now ();
+      switch (op)
+        {
+        case opProps:
+          {
+            std::ostringstream text;
+            text << "yload " << n;
+            label.setText (text.str ());
+          }
+          break;
+        case opLines:
+          {
+            Y::Canvas::Lines lines;
+            for (int i = 0; i < lineCount; ++i)
+              lines.push_back (Y::Canvas::Line (rand_r (&seed) % 200, rand_r (&seed) % 150,
+                                                rand_r (&seed) % 41 - 20, rand_r (&seed) % 41 - 20));
+            canvas.drawLines (lines);
+            canvas.swapBuffers ();
+          }
+          break;
+        case opMoves:
+          window.move (rand_r (&seed) % 600, rand_r (&seed) % 400);
+          break;
+        case opSignals:
+          canvas.subscribeSignal ("resize");
+          canvas.unsubscribeSignal ("resize");
+          break;
+        default:
+          break;
+        }
+      canvas.reset (width, height);
+      result->latencies[op].push_back (now () - start);
+    }
+
+  return NULL;
+}
+
+static uint32_t
+percentile (const std::vector<uint32_t> &sorted, double p)
+{
+  if (sorted.empty ())
+    return 0;
+  return sorted[(size_t)((sorted.size () - 1) * p)];
+}
+
+static void
+report (const char *name, std::vector<uint32_t> &latencies, double seconds)
+{
+  std::sort (latencies.begin (), latencies.end ());
+  printf ("op=%s clients=%d count=%lu rate=%.1f p50=%u p90=%u p99=%u p999=%u max=%u\n",
+          name, clientCount, (unsigned long)latencies.size (),
+          latencies.size () / seconds,
+          percentile (latencies, 0.5), percentile (latencies, 0.9),
+          percentile (latencies, 0.99), percentile (latencies, 0.999),
+          latencies.empty () ? 0 : latencies.back ());
+}
+
+/* parses "props=4,lines=2,..."; operations left out get no weight */
+static bool
+parseMix (const char *mix)
+{
+  std::istringstream in (mix);
+  std::string item;
+
+  for (int op = 0; op < opCount; ++op)
+    weights[op] = 0;
+  totalWeight = 0;
+
+  while (std::getline (in, item, ','))
+    {
+      size_t eq = item.find ('=');
+      int op;
+      for (op = 0; op < opCount; ++op)
+        if (item.compare (0, eq, operationNames[op]) == 0)
+          break;
+      if (eq == std::string::npos || op == opCount)
+        return false;
+      weights[op] = atoi (item.c_str () + eq + 1);
+      if (weights[op] < 0)
+        return false;
+      totalWeight += weights[op];
+    }
+  return totalWeight > 0;
+}
+
+int
+main (int argc, char **argv)
+{
+  static struct option const longopts[] =
+    {
+      {"clients", required_argument, NULL, 'c'},
+      {"duration", required_argument, NULL, 'd'},
+      {"rate", required_argument, NULL, 'r'},
+      {"lines", required_argument, NULL, 'l'},
+      {"mix", required_argument, NULL, 'm'},
+      {NULL, no_argument, NULL, 0}
+    };
+  bool usage = false;
+  int optc;
+
+  while ((optc = getopt_long (argc, argv, "c:d:r:l:m:", longopts, NULL)) != -1)
+    {
+      switch (optc)
+        {
+        case 'c':
+          clientCount = atoi (optarg);
+          break;
+        case 'd':
+          duration = atoi (optarg);
+          break;
+        case 'r':
+          rate = atoi (optarg);
+          break;
+        case 'l':
+          lineCount = atoi (optarg);
+          break;
+        case 'm':
+          usage = usage || !parseMix (optarg);
+          break;
+        default:
+          usage = true;
+          break;
+        }
+    }
+  if (usage || optind != argc || clientCount <= 0 || duration <= 0)
+    {
+      std::cerr << "Usage: yload [--clients n] [--duration seconds] [--rate ops/s]" << std::endl
+                << "             [--lines n] [--mix props=4,lines=2,moves=1,signals=1]" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  std::vector<ClientResult> results (clientCount);
+  std::vector<pthread_t> threads (clientCount);
+
+  /* everyone starts together, once all the windows are up */
+  pthread_barrier_init (&startBarrier, NULL, clientCount + 1);
+  for (int i = 0; i < clientCount; ++i)
+    pthread_create (&threads[i], NULL, clientMain, &results[i]);
+  pthread_barrier_wait (&startBarrier);
+
+  uint64_t start = now ();
+  for (int i = 0; i < clientCount; ++i)
+    pthread_join (threads[i], NULL);
+  double seconds = (now () - start) / 1e6;
+
+  std::vector<uint32_t> all;
+  for (int op = 0; op < opCount; ++op)
+    {
+      std::vector<uint32_t> latencies;
+      for (int i = 0; i < clientCount; ++i)
+        latencies.insert (latencies.end (), results[i].latencies[op].begin (),
+                          results[i].latencies[op].end ());
+      all.insert (all.end (), latencies.begin (), latencies.end ());
+      if (weights[op] > 0)
+        report (operationNames[op], latencies, seconds);
+    }
+  report ("all", all, seconds);
+
+  pthread_barrier_destroy (&startBarrier);
+  return EXIT_SUCCESS;
+}
+
+/* arch-tag: 1d7f3a95-c2e8-4b60-9a14-8e5b7d2c6f31
+ */
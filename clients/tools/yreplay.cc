@@ -0,0 +1,467 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Plays a log written by "Y --record" back against the server in
+ * $YDISPLAY, opening a connection for each client in the log, and
+ * reports message throughput, reply latencies and the frames drawn
+ * meanwhile.
+ *
+ * Object ids in the log are the ones the recording server handed
+ * out, so replay against a freshly started server with the same
+ * configuration. Descriptors passed to the server (shared buffers)
+ * are not in the log, and calls which used them will fail.
+ *
+ * Usage: yreplay [--paced] [--speed factor] [--timeout seconds] log
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <getopt.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <Y/c++/connection.h>
+#include <Y/c++/class.h>
+#include <Y/c++/reply.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+
+struct Record
+{
+  uint64_t time;
+  uint32_t client;
+  int event;
+  std::string body;
+};
+
+struct ReplayClient
+{
+  int control_fd;
+  int fd;
+  bool closing;
+  std::string inbound;
+  std::string outbound;
+  /* send times of calls still waiting for their reply, by seq */
+  std::map<uint32_t, uint64_t> waiting;
+};
+
+static std::map<uint32_t, ReplayClient> clients;
+static std::vector<uint64_t> latencies;
+static uint64_t messagesSent = 0;
+static uint64_t messagesReceived = 0;
+
+static uint64_t
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return (uint64_t)t.tv_sec * 1000000 + t.tv_nsec / 1000;
+}
+
+static uint32_t
+getUint32 (const char *p)
+{
+  uint32_t v;
+  memcpy (&v, p, sizeof(v));
+  return ntohl(v);
+}
+
+static bool
+readLog (const char *filename, std::vector<Record> &records)
+{
+  std::ifstream in (filename, std::ios::binary);
+  char magic[4];
+  char version[4];
+
+  if (!in.read (magic, 4) || memcmp (magic, YRECORD_MAGIC, 4) != 0
+      || !in.read (version, 4) || getUint32 (version) != YRECORD_VERSION)
+    {
+      std::cerr << filename << ": not a Y record log" << std::endl;
+      return false;
+    }
+
+  char header[YRECORD_HEADER_SIZE];
+  while (in.read (header, sizeof(header)))
+    {
+      Record r;
+      r.time = ((uint64_t)getUint32 (header) << 32) | getUint32 (header + 4);
+      r.client = getUint32 (header + 8);
+      r.event = (unsigned char)header[12];
+      r.body.resize (getUint32 (header + 13));
+      if (r.body.size () > 0 && !in.read (&r.body[0], r.body.size ()))
+        {
+          std::cerr << filename << ": truncated, replaying what is there" << std::endl;
+          break;
+        }
+      records.push_back (r);
+    }
+  return true;
+}
+
+/* Connects to the server the way libYc++ does: authenticate on the
+ * control socket, and receive the descriptor for channel 0
+ */
+static void
+connectClient (const char *path, ReplayClient &c)
+{
+  struct sockaddr_un sockaddr;
+  sockaddr.sun_family = AF_UNIX;
+  strncpy (sockaddr.sun_path, path, 100);
+  int control_fd = socket (PF_UNIX, SOCK_STREAM, 0);
+  if (connect (control_fd, (struct sockaddr *)&sockaddr, sizeof (sockaddr)) != 0)
+    {
+      std::cerr << "Failed to connect to Y Server: " << strerror(errno) << std::endl;
+      exit (EXIT_FAILURE);
+    }
+
+  {
+    uint32_t msg_type = ucmtAuthenticate;
+    uint32_t msg_len = 0;
+    struct iovec iov[] = {{&msg_len, sizeof(msg_len)}, {&msg_type, sizeof(msg_type)}};
+
+    struct ucred creds;
+    creds.uid = geteuid();
+    creds.gid = getegid();
+    creds.pid = getpid();
+    char buf[CMSG_SPACE(sizeof creds)];
+    struct msghdr msg = {0, 0,
+                         iov, 2,
+                         buf, sizeof(buf),
+                         0};
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_CREDENTIALS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(creds));
+    memcpy(CMSG_DATA(cmsg), &creds, sizeof(creds));
+    msg.msg_controllen = cmsg->cmsg_len;
+
+    if (sendmsg(control_fd, &msg, 0) == -1)
+      {
+        std::cerr << "Failed to authenticate with Y server: " << strerror(errno) << std::endl;
+        exit (EXIT_FAILURE);
+      }
+  }
+
+  uint32_t msg_len;
+  uint32_t msg_type;
+  uint32_t channel_id;
+  struct iovec iov[] = {{&msg_len, sizeof(msg_len)}, {&msg_type, sizeof(msg_type)}, {&channel_id, sizeof(channel_id)}};
+  char cmsgbuf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg = {NULL, 0,
+                       iov, 3,
+                       cmsgbuf, sizeof(cmsgbuf),
+                       0};
+  ssize_t len = recvmsg(control_fd, &msg, 0);
+  struct cmsghdr *cmsg = len > 0 ? CMSG_FIRSTHDR(&msg) : NULL;
+  if (cmsg == NULL || msg_type != ucmtNewChannel || channel_id != 0
+      || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+    {
+      std::cerr << "Bad reply from Y server during connection setup" << std::endl;
+      exit (EXIT_FAILURE);
+    }
+
+  c.control_fd = control_fd;
+  memcpy (&c.fd, CMSG_DATA(cmsg), sizeof(c.fd));
+  fcntl (c.fd, F_SETFL, fcntl (c.fd, F_GETFL) | O_NONBLOCK);
+}
+
+static void
+disconnectClient (ReplayClient &c)
+{
+  close (c.fd);
+  close (c.control_fd);
+  c.fd = -1;
+  c.control_fd = -1;
+}
+
+/* picks complete messages out of what the server has sent */
+static void
+receiveMessages (ReplayClient &c, uint64_t t)
+{
+  size_t pos = 0;
+  while (c.inbound.size () - pos >= 4)
+    {
+      uint32_t len = getUint32 (c.inbound.data () + pos);
+      if (c.inbound.size () - pos - 4 < len)
+        break;
+      const char *body = c.inbound.data () + pos + 4;
+      messagesReceived++;
+      /* body: seq, to, from, op, id, meta, ... */
+      if (len >= 16 && getUint32 (body + 12) != YMO_EVENT)
+        {
+          std::map<uint32_t, uint64_t>::iterator i = c.waiting.find (getUint32 (body));
+          if (i != c.waiting.end ())
+            {
+              latencies.push_back (t - i->second);
+              c.waiting.erase (i);
+            }
+        }
+      pos += 4 + len;
+    }
+  c.inbound.erase (0, pos);
+}
+
+/* moves data in both directions for up to timeout milliseconds, or
+ * until something happens */
+static void
+pump (int timeout)
+{
+  std::vector<struct pollfd> fds;
+  std::vector<uint32_t> ids;
+  for (std::map<uint32_t, ReplayClient>::iterator i = clients.begin (); i != clients.end (); i++)
+    {
+      if (i->second.fd < 0)
+        continue;
+      struct pollfd p = {i->second.fd, POLLIN, 0};
+      if (!i->second.outbound.empty ())
+        p.events |= POLLOUT;
+      fds.push_back (p);
+      ids.push_back (i->first);
+    }
+
+  if (poll (fds.empty () ? NULL : &fds[0], fds.size (), timeout) <= 0)
+    return;
+
+  uint64_t t = now ();
+  for (size_t n = 0; n < fds.size (); ++n)
+    {
+      ReplayClient &c = clients[ids[n]];
+      if (fds[n].revents & POLLOUT)
+        {
+          ssize_t w = write (c.fd, c.outbound.data (), c.outbound.size ());
+          if (w > 0)
+            c.outbound.erase (0, w);
+        }
+      if (fds[n].revents & (POLLIN | POLLHUP | POLLERR))
+        {
+          char buffer[65536];
+          ssize_t r = read (c.fd, buffer, sizeof(buffer));
+          if (r > 0)
+            {
+              c.inbound.append (buffer, r);
+              receiveMessages (c, t);
+            }
+          else if (r == 0 || errno != EAGAIN)
+            {
+              disconnectClient (c);
+              c.waiting.clear ();
+            }
+        }
+      if (c.closing && c.fd >= 0 && c.outbound.empty () && c.waiting.empty ())
+        disconnectClient (c);
+    }
+}
+
+static ReplayClient &
+findClient (uint32_t id, const char *path)
+{
+  std::map<uint32_t, ReplayClient>::iterator i = clients.find (id);
+  if (i != clients.end () && i->second.fd >= 0)
+    return i->second;
+  ReplayClient &c = clients[id];
+  connectClient (path, c);
+  c.closing = false;
+  c.inbound.clear ();
+  c.outbound.clear ();
+  c.waiting.clear ();
+  return c;
+}
+
+static bool
+pending (void)
+{
+  for (std::map<uint32_t, ReplayClient>::iterator i = clients.begin (); i != clients.end (); i++)
+    if (i->second.fd >= 0 && (!i->second.outbound.empty () || !i->second.waiting.empty ()))
+      return true;
+  return false;
+}
+
+/* Sums Screen.statistics over the viewports: frames drawn, the time
+ * spent on them and the longest, in microseconds */
+static void
+frameStatistics (Y::Connection &y, uint64_t &frames, uint64_t &total, uint32_t &longest)
+{
+  Y::Message::Members v;
+  v.push_back ("statistics");
+  Y::Reply *rep = y.findClass ("Screen")->invokeMethod (v, true);
+  const Y::Message::Members &stats = rep->tuple ();
+  frames = total = longest = 0;
+  for (size_t i = 0; i + 6 <= stats.size (); i += 6)
+    {
+      frames += stats[i + 1].uint32 ();
+      total += (uint64_t)stats[i + 1].uint32 () * stats[i + 5].uint32 ();
+      longest = std::max (longest, stats[i + 4].uint32 ());
+    }
+  delete rep;
+}
+
+static uint64_t
+percentile (const std::vector<uint64_t> &sorted, int p)
+{
+  if (sorted.empty ())
+    return 0;
+  return sorted[(sorted.size () - 1) * p / 100];
+}
+
+int
+main (int argc, char **argv)
+{
+  static struct option const longopts[] =
+    {
+      {"paced", no_argument, NULL, 'p'},
+      {"speed", required_argument, NULL, 's'},
+      {"timeout", required_argument, NULL, 't'},
+      {NULL, no_argument, NULL, 0}
+    };
+  bool paced = false;
+  double speed = 1.0;
+  int timeout = 10;
+  int optc;
+
+  while ((optc = getopt_long (argc, argv, "ps:t:", longopts, NULL)) != -1)
+    {
+      switch (optc)
+        {
+        case 'p':
+          paced = true;
+          break;
+        case 's':
+          paced = true;
+          speed = atof (optarg);
+          break;
+        case 't':
+          timeout = atoi (optarg);
+          break;
+        default:
+          optind = argc;
+          break;
+        }
+    }
+  if (optind != argc - 1 || speed <= 0)
+    {
+      std::cerr << "Usage: yreplay [--paced] [--speed factor] [--timeout seconds] log" << std::endl;
+      return EXIT_FAILURE;
+    }
+
+  std::vector<Record> records;
+  if (!readLog (argv[optind], records))
+    return EXIT_FAILURE;
+
+  const char *display = getenv ("YDISPLAY");
+  if (display == NULL || strncmp (display, "unix:", 5) != 0)
+    {
+      std::cerr << "YDISPLAY is not set to a unix socket" << std::endl;
+      return EXIT_FAILURE;
+    }
+  const char *path = display + 5;
+
+  Y::Connection y;
+  uint64_t framesBefore, totalBefore, framesAfter, totalAfter;
+  uint32_t longest;
+  frameStatistics (y, framesBefore, totalBefore, longest);
+
+  uint64_t start = now ();
+  for (std::vector<Record>::iterator r = records.begin (); r != records.end (); r++)
+    {
+      if (paced)
+        {
+          uint64_t due = start + (uint64_t)(r->time / speed);
+          for (uint64_t t = now (); t < due; t = now ())
+            pump ((due - t + 999) / 1000);
+        }
+
+      switch (r->event)
+        {
+        case yreConnect:
+          findClient (r->client, path);
+          break;
+        case yreDisconnect:
+          if (clients.count (r->client))
+            clients[r->client].closing = true;
+          break;
+        case yreInbound:
+          {
+            ReplayClient &c = findClient (r->client, path);
+            uint32_t len = htonl(r->body.size ());
+            c.outbound.append ((const char *)&len, sizeof(len));
+            c.outbound.append (r->body);
+            /* body: seq, to, from, op, id, meta, ... */
+            if (r->body.size () >= 24 && (getUint32 (r->body.data () + 20) & 0x01)
+                && getUint32 (r->body.data ()) != 0)
+              c.waiting[getUint32 (r->body.data ())] = now ();
+            messagesSent++;
+          }
+          break;
+        default:
+          /* what the server sent; this run's replies are measured
+           * instead */
+          break;
+        }
+      pump (0);
+    }
+
+  uint64_t deadline = now () + (uint64_t)timeout * 1000000;
+  while (pending () && now () < deadline)
+    pump (10);
+  uint64_t elapsed = now () - start;
+
+  size_t unanswered = 0;
+  for (std::map<uint32_t, ReplayClient>::iterator i = clients.begin (); i != clients.end (); i++)
+    {
+      unanswered += i->second.waiting.size ();
+      if (i->second.fd >= 0)
+        disconnectClient (i->second);
+    }
+
+  frameStatistics (y, framesAfter, totalAfter, longest);
+
+  std::sort (latencies.begin (), latencies.end ());
+  double seconds = elapsed / 1e6;
+
+  printf ("%s replay of %s: %lu clients\n", paced ? "paced" : "fast", argv[optind],
+          (unsigned long)clients.size ());
+  printf ("messages:  %lu sent, %lu received in %.3f s (%.0f sent/s)\n",
+          (unsigned long)messagesSent, (unsigned long)messagesReceived, seconds,
+          seconds > 0 ? messagesSent / seconds : 0.0);
+  printf ("replies:   %lu, %lu unanswered\n",
+          (unsigned long)latencies.size (), (unsigned long)unanswered);
+  printf ("latency:   p50 %lu us, p90 %lu us, p99 %lu us, max %lu us\n",
+          (unsigned long)percentile (latencies, 50), (unsigned long)percentile (latencies, 90),
+          (unsigned long)percentile (latencies, 99),
+          (unsigned long)(latencies.empty () ? 0 : latencies.back ()));
+  uint64_t frames = framesAfter - framesBefore;
+  printf ("frames:    %lu, mean %lu us, longest since server start %lu us\n",
+          (unsigned long)frames,
+          (unsigned long)(frames ? (totalAfter - totalBefore) / frames : 0),
+          (unsigned long)longest);
+
+  return unanswered ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* arch-tag: 4e8b2d61-7a3c-4f95-b0d8-5c1e9a7f3264
+ */
@@ -36,6 +36,7 @@
 #include <Y/c++/label.h>
 #include <Y/c++/console.h>
 #include <Y/c++/gridlayout.h>
+#include <Y/c++/performance.h>
 
 
 #include <Y/c++/objects/ybutton.h>
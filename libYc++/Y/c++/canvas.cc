@@ -122,5 +122,19 @@ Y::Canvas::drawLines (Y::Canvas::Lines lines)
   invokeMethod (v, false);
 }
 
+/** \brief Displays pixels straight from shared memory
+ *
+ * fd should be a memfd holding height rows of stride bytes of ARGB32
+ * pixels, sealed with F_SEAL_SHRINK. The server maps it rather than
+ * copying it, so after drawing into it call damageSharedBuffer with
+ * the changed rectangles. The descriptor may be closed afterwards.
+ */
+void
+Y::Canvas::shareBuffer (int fd, int32_t width, int32_t height, int32_t stride)
+{
+  uint32_t id = y->passFileDescriptor (fd);
+  attachSharedBuffer (id, width, height, stride);
+}
+
 /* arch-tag: 68c6c4a6-b5a4-40b1-9ba1-fdf272b6e55a
  */
@@ -67,6 +67,8 @@ namespace Y
     void drawLine (Line l) {drawLine(l.x, l.y, l.dx, l.dy);}
     void drawLines (Lines lines);
 
+    void shareBuffer (int fd, int32_t width, int32_t height, int32_t stride);
+
     /** Signalled when the size of the canvas changes
      */
     sigc::signal<void> resize;
@@ -63,7 +63,9 @@ Y::Class::instantiate (const Y::Message::Members& params)
 Y::Reply*
 Y::Class::invokeMethod (const Y::Message::Members& params, bool expectReturn)
 {
-  Message req(0, 0, id(), YMO_INVOKE_CLASS_METHOD, expectReturn ? 0x01 : 0x00, params);
+  Y::Message::Members v = params;
+  y->resolveMethod(v);
+  Message req(0, 0, id(), YMO_INVOKE_CLASS_METHOD, expectReturn ? 0x01 : 0x00, v);
 
   return y->sendMessage (&req);
 }
@@ -54,6 +54,7 @@ Y::Connection::Connection ()
 {
   /* Initialise the privates */
   server_fd = -1;
+  next_passed_fd = 1;
   debug_io = false;
   debug_messages = false;
   pollfd_list = NULL;
@@ -70,8 +71,10 @@ Y::Connection::Connection ()
   pthread_mutex_init(&replies_mutex, NULL);
   pthread_mutex_init(&objects_mutex, NULL);
   pthread_mutex_init(&classes_mutex, NULL);
+  pthread_mutex_init(&methods_mutex, NULL);
   pthread_mutex_init(&messages_mutex, NULL);
   pthread_mutex_init(&dispatch_mutex, NULL);
+  pthread_mutex_init(&control_mutex, NULL);
   pthread_cond_init(&dispatch_cond, NULL);
   pthread_cond_init(&state_cond, NULL);
   state = none;
@@ -70,6 +70,11 @@ namespace Y
 
     Class *findClass (std::string className);
 
+    /* Swaps the method name at the front of params for the server's id
+     * for it, once the server has said what that is; the first call
+     * with each name asks, and goes by name meanwhile */
+    void resolveMethod (Message::Members& params);
+
     Reply *sendMessage (const Message *);
 
     void registerFD (int fd, int mask, void *data, void (*call)(int, int, void *));
@@ -78,6 +83,8 @@ namespace Y
 
     void detachReply (uint32_t seq);
 
+    uint32_t passFileDescriptor (int fd);
+
     void createdObject (Object *obj);
     Object *findObject (uint32_t oid);
     void destroyObject (uint32_t oid);
@@ -135,6 +142,10 @@ namespace Y
     std::map<std::string, Class*> classes;
     pthread_mutex_t classes_mutex;
 
+    std::map<std::string, uint32_t> methods;
+    std::map<std::string, Reply*> methodReplies;
+    pthread_mutex_t methods_mutex;
+
     void processMessage (Message *);
 
     class FDHandler
@@ -194,6 +205,9 @@ namespace Y
     int control_fd;
     int server_fd;
 
+    uint32_t next_passed_fd;
+    pthread_mutex_t control_mutex;
+
     /* When state is none:
      *
      *  run() changes to running
@@ -19,6 +19,7 @@
 #include <Y/c++/connection.h>
 #include <Y/c++/class.h>
 #include <Y/c++/object.h>
+#include <Y/c++/reply.h>
 
 #include "thread_support.h"
 
@@ -44,6 +45,60 @@ Y::Connection::findClass (std::string className)
   return c;
 }
 
+void
+Y::Connection::resolveMethod (Y::Message::Members& params)
+{
+  if (params.empty() || !params[0].isstring())
+    return;
+
+  std::string name = params[0].string();
+  uint32_t id = 0;
+  bool asked = true;
+  int oldtype;
+  lock_mutex(methods_mutex, oldtype);
+  std::map<std::string, uint32_t>::iterator i = methods.find(name);
+  if (i != methods.end())
+    id = i->second;
+  else
+    {
+      std::map<std::string, Reply *>::iterator r = methodReplies.find(name);
+      if (r == methodReplies.end())
+        asked = false;
+      else if (r->second->hasTuple())
+        {
+          /* A name the server doesn't know stays a name, so that the
+           * error it sends back still says which method was wanted */
+          if (r->second->op() == YMO_FIND_METHOD)
+            id = r->second->id();
+          methods[name] = id;
+          delete r->second;
+          methodReplies.erase(r);
+        }
+    }
+  unlock_mutex(oldtype);
+
+  if (!asked)
+    {
+      Y::Message::Members v;
+      v.push_back(name);
+      Message req(0, 0, 0, YMO_FIND_METHOD, 0, v);
+      Reply *reply = sendMessage(&req);
+
+      lock_mutex(methods_mutex, oldtype);
+      if (methodReplies.find(name) == methodReplies.end()
+          && methods.find(name) == methods.end())
+        {
+          methodReplies[name] = reply;
+          reply = NULL;
+        }
+      unlock_mutex(oldtype);
+      delete reply;
+    }
+
+  if (id != 0)
+    params[0] = Y::Message::Member(id);
+}
+
 void
 Y::Connection::createdObject (Object *obj)
 {
@@ -133,5 +133,44 @@ Y::Connection::unixInitialise (const char *display)
   }
 }
 
+/** \brief Hands a file descriptor to the server
+ *
+ * The descriptor is duplicated into the server, so the caller still
+ * owns (and may close) fd afterwards. Returns the id which server
+ * methods taking a descriptor expect, such as
+ * Canvas::attachSharedBuffer.
+ */
+uint32_t
+Y::Connection::passFileDescriptor (int fd)
+{
+  pthread_mutex_lock(&control_mutex);
+  uint32_t id = next_passed_fd++;
+
+  uint32_t msg_type = ucmtPassFileDescriptor;
+  uint32_t msg_len = sizeof(id);
+  struct iovec iov[] = {{&msg_len, sizeof(msg_len)}, {&msg_type, sizeof(msg_type)}, {&id, sizeof(id)}};
+
+  char buf[CMSG_SPACE(sizeof fd)];
+  struct msghdr msg = {0, 0,
+                       iov, 3,
+                       buf, sizeof(buf),
+                       0};
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(fd));
+  memcpy(CMSG_DATA(cmsg), &fd, sizeof(fd));
+  msg.msg_controllen = cmsg->cmsg_len;
+
+  ssize_t len = sendmsg(control_fd, &msg, 0);
+  pthread_mutex_unlock(&control_mutex);
+  if (len == -1)
+    {
+      std::cerr << "Failed to pass file descriptor to Y server: " << strerror(errno) << std::endl;
+      abort();
+    }
+  return id;
+}
+
 /* arch-tag: c5315195-82c1-4c90-ba8c-d3dd4ec0bcad
  */
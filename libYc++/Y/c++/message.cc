@@ -230,6 +230,7 @@ Y::Message::expectReply() const
       return false;
       /* Messages that expect a reply */
     case YMO_FIND_CLASS:
+    case YMO_FIND_METHOD:
       return true;
       /* Messages that might do either, so we need to peek inside them */
     case YMO_INVOKE_CLASS_METHOD:
@@ -265,6 +266,9 @@ operator<< (std::ostream& strm, enum YMessageOperation op)
     case YMO_INVOKE_INSTANCE_METHOD:
       strm << "YMO_INVOKE_INSTANCE_METHOD";
       break;
+    case YMO_FIND_METHOD:
+      strm << "YMO_FIND_METHOD";
+      break;
     default:
       strm << (int)op;
       break;
@@ -74,10 +74,18 @@ Y::Object::subscribeSignal (const std::string &name)
   invokeMethod("subscribeSignal", name, false);
 }
 
+void
+Y::Object::unsubscribeSignal (const std::string &name)
+{
+  invokeMethod("unsubscribeSignal", name, false);
+}
+
 Y::Reply*
 Y::Object::invokeMethod (const Y::Message::Members& params, bool expectReturn)
 {
-  Message req(0, 0, id(), YMO_INVOKE_INSTANCE_METHOD, expectReturn ? 0x01 : 0x00, params);
+  Y::Message::Members v = params;
+  y->resolveMethod(v);
+  Message req(0, 0, id(), YMO_INVOKE_INSTANCE_METHOD, expectReturn ? 0x01 : 0x00, v);
 
   return y->sendMessage (&req);
 }
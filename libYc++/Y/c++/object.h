@@ -81,6 +81,7 @@ namespace Y
     uint32_t id () throw(Y::error);
 
     void subscribeSignal (const std::string &name);
+    void unsubscribeSignal (const std::string &name);
 
     /* \todo Y::Object::parent shouldn't be public */
     Object *parent;
@@ -0,0 +1,103 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#pragma implementation
+
+#include <Y/c++/performance.h>
+#include <Y/c++/class.h>
+#include <Y/c++/reply.h>
+
+#include <string>
+
+static Y::Performance::Counters
+toCounters (const Y::Message::Members &params, size_t first)
+{
+  Y::Performance::Counters ret;
+  for (size_t i = first; i + 1 < params.size (); i += 2)
+    ret.push_back (std::make_pair (params[i].string (), params[i + 1].uint32 ()));
+  return ret;
+}
+
+Y::Performance::Performance (Y::Connection *y) : Y::ServerObject::Performance(y)
+{
+  subscribeSignal ("sample");
+}
+
+Y::Performance::~Performance ()
+{
+}
+
+bool
+Y::Performance::onEvent (const std::string &name, const Y::Message::Members& params)
+{
+  if (name == "sample")
+    {
+      sample (toCounters (params, 0));
+      return true;
+    }
+  return false;
+}
+
+Y::Performance::Counters
+Y::Performance::counters ()
+{
+  Y::Reply *rep = c ()->invokeMethod ("counters", true);
+  Counters ret = toCounters (rep->tuple (), 0);
+  delete rep;
+  return ret;
+}
+
+Y::Performance::Histograms
+Y::Performance::histograms ()
+{
+  Y::Reply *rep = c ()->invokeMethod ("histograms", true);
+  const Y::Message::Members &params = rep->tuple ();
+  Histograms ret;
+  for (size_t i = 0; i + 7 <= params.size (); i += 7)
+    {
+      Histogram h;
+      h.name = params[i].string ();
+      h.count = params[i + 1].uint32 ();
+      h.mean = params[i + 2].uint32 ();
+      h.p50 = params[i + 3].uint32 ();
+      h.p90 = params[i + 4].uint32 ();
+      h.p99 = params[i + 5].uint32 ();
+      h.max = params[i + 6].uint32 ();
+      ret.push_back (h);
+    }
+  delete rep;
+  return ret;
+}
+
+Y::Performance::Counters
+Y::Performance::classes ()
+{
+  Y::Reply *rep = c ()->invokeMethod ("classes", true);
+  Counters ret = toCounters (rep->tuple (), 0);
+  delete rep;
+  return ret;
+}
+
+void
+Y::Performance::reset ()
+{
+  c ()->invokeMethod ("reset", false);
+}
+
+/* arch-tag: 4f91b7c3-2d6e-4a08-b5e2-9c1d7a3f8e65
+ */
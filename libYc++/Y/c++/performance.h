@@ -0,0 +1,82 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#pragma interface
+
+#ifndef Y_CPP_PERFORMANCE_H
+#define Y_CPP_PERFORMANCE_H
+
+#include <Y/c++/connection.h>
+#include <Y/c++/object.h>
+#include <stdint.h>
+#include <sigc++/sigc++.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <Y/c++/Performance.yh>
+
+namespace Y
+{
+  /** \brief Server performance counters
+   * \ingroup remote
+   *
+   * While one of these exists, the server sends it a sample of its
+   * counters every interval milliseconds (a second, unless changed
+   * with setInterval). Histograms and per-class method call counts
+   * are fetched on demand.
+   */
+  class Performance : public Y::ServerObject::Performance
+  {
+  public:
+    /** Name and value pairs. Values are modulo 2^32, so rates should
+     * be worked out from the difference between two samples
+     */
+    typedef std::vector<std::pair<std::string, uint32_t> > Counters;
+
+    /** Summary of one histogram; the percentiles are upper bounds */
+    struct Histogram
+    {
+      std::string name;
+      uint32_t count, mean, p50, p90, p99, max;
+    };
+    typedef std::vector<Histogram> Histograms;
+
+    Performance (Y::Connection *y);
+    virtual ~Performance ();
+
+    Counters counters ();
+    Histograms histograms ();
+    /** Method calls so far, by class name */
+    Counters classes ();
+    void reset ();
+
+    /** Signalled every interval with the current counters
+     */
+    sigc::signal<void, const Counters &> sample;
+
+  protected:
+    virtual bool onEvent (const std::string &, const Y::Message::Members&);
+  };
+}
+
+#endif
+
+/* arch-tag: 0e6a4d21-b8c3-4f97-9d15-3a7c2f8e6b40
+ */
@@ -34,43 +34,81 @@
 #include <Y/util/yutil.h>
 
 #define  EVENT_FILE_BASE "/dev/input/event"
+#define  EVDEV_MAX_DEVICES 16
+
+/* Events taken from a device per read() */
+#define  EVDEV_READ_EVENTS 64
+
+/* Relative motion is added up until the device marks the end of a
+ * report with EV_SYN, then handed on in one go
+ */
+struct EvDevDevice
+{
+  int fd;
+  int dx, dy;
+};
 
 struct EvDevInputDriverData
 {
-  struct input_event cur;
-  ssize_t bytes_read;
   struct Module *module;
-  int fds[16];
+  struct EvDevDevice devices[EVDEV_MAX_DEVICES];
 };
 
 static void
-evdevDespatch (struct EvDevInputDriverData *data)
+evdevFlushMotion (struct EvDevDevice *device)
+{
+  if (device->dx != 0 || device->dy != 0)
+    pointerQueueMotion (device->dx, device->dy);
+  device->dx = 0;
+  device->dy = 0;
+}
+
+static void
+evdevButton (struct EvDevDevice *device, int button, int pressed)
+{
+  /* the click lands where the motion before it got to */
+  evdevFlushMotion (device);
+  pointerButtonChange (button, pressed);
+}
+
+static void
+evdevDespatch (struct EvDevDevice *device, const struct input_event *ev)
 {
-  switch (data->cur.type)
+  switch (ev->type)
     {
+      case EV_SYN:
+        if (ev->code == SYN_DROPPED)
+          {
+            /* the rest of this report is lost */
+            device->dx = 0;
+            device->dy = 0;
+          }
+        else
+          evdevFlushMotion (device);
+        break;
       case EV_REL:
-        switch (data->cur.code)
+        switch (ev->code)
           {
-             case REL_X:  pointerMovePosition (data->cur.value, 0); break;
-             case REL_Y:  pointerMovePosition (0, data->cur.value); break;
+             case REL_X:  device->dx += ev->value; break;
+             case REL_Y:  device->dy += ev->value; break;
              default:     ;
           }
         break;
       case EV_KEY:
-        switch (data->cur.code)
+        switch (ev->code)
           {
-             case BTN_LEFT:    pointerButtonChange (0, data->cur.value); break;
-             case BTN_MIDDLE:  pointerButtonChange (1, data->cur.value); break;
-             case BTN_RIGHT:   pointerButtonChange (2, data->cur.value); break;
-             case BTN_SIDE:    pointerButtonChange (3, data->cur.value); break;
-             case BTN_EXTRA:   pointerButtonChange (4, data->cur.value); break;
-             case BTN_FORWARD: pointerButtonChange (5, data->cur.value); break;
-             case BTN_BACK:    pointerButtonChange (6, data->cur.value); break;
+             case BTN_LEFT:    evdevButton (device, 0, ev->value); break;
+             case BTN_MIDDLE:  evdevButton (device, 1, ev->value); break;
+             case BTN_RIGHT:   evdevButton (device, 2, ev->value); break;
+             case BTN_SIDE:    evdevButton (device, 3, ev->value); break;
+             case BTN_EXTRA:   evdevButton (device, 4, ev->value); break;
+             case BTN_FORWARD: evdevButton (device, 5, ev->value); break;
+             case BTN_BACK:    evdevButton (device, 6, ev->value); break;
              default:
-               if (data->cur.value == 0)
-                 ykbKeyUp(data->cur.code);
+               if (ev->value == 0)
+                 ykbKeyUp(ev->code);
                else
-                 ykbKeyDown(data->cur.code);
+                 ykbKeyDown(ev->code);
                break;
           }
         break;
@@ -79,24 +117,28 @@ evdevDespatch (struct EvDevInputDriverData *data)
 }
 
 static void
-evdevDataReady (int fd, int causeMask, void *data_v)
+evdevDataReady (int fd, int causeMask, void *device_v)
 {
-  struct EvDevInputDriverData *data = data_v;
+  struct EvDevDevice *device = device_v;
+  struct input_event events[EVDEV_READ_EVENTS];
   ssize_t r;
 
-  r = read (fd, &(data -> cur) + data -> bytes_read, sizeof(struct input_event));
-  if (r < 0)
+  /* The kernel only hands over whole events */
+  do
     {
-      Y_ERROR ("EvDev: Error Reading: %s", strerror (errno));
-      return;
-    }
+      r = read (fd, events, sizeof (events));
+      if (r < 0)
+        {
+          if (errno != EAGAIN && errno != EINTR)
+            Y_ERROR ("EvDev: Error Reading: %s", strerror (errno));
+          return;
+        }
 
-  data -> bytes_read += r;
-  if (data -> bytes_read == sizeof(struct input_event))
-    {
-      evdevDespatch (data);
-      data -> bytes_read = 0;
-    } 
+      size_t count = r / sizeof (struct input_event);
+      for (size_t i = 0; i < count; ++i)
+        evdevDespatch (device, &events[i]);
+    }
+  while (r == sizeof (events));
 }
 
 int
@@ -112,18 +154,21 @@ initialise (struct Module *module, const struct Tuple *args)
 
   data = ymalloc (sizeof (struct EvDevInputDriverData));
   module -> data = data;
-  data -> bytes_read = 0;
   data -> module = module;
 
-  for(i=0; i<16; ++i)
+  for(i=0; i<EVDEV_MAX_DEVICES; ++i)
     {
       sprintf (buffer, "%s%d", EVENT_FILE_BASE, i);
       fd = open (buffer, O_RDONLY|O_NONBLOCK|O_NOCTTY);
-      data -> fds[i] = fd;
+      data -> devices[i].fd = fd;
+      data -> devices[i].dx = 0;
+      data -> devices[i].dy = 0;
       if (fd > 0)
         {
            controlRegisterFileDescriptor (fd, CONTROL_WATCH_READ,
-                                          data, evdevDataReady);
+                                          &(data -> devices[i]), evdevDataReady);
+           /* input goes ahead of clients' messages */
+           controlSetFileDescriptorUrgent (fd, true);
         }
     }
 
@@ -136,11 +181,11 @@ finalise (struct Module *self)
 {
   int i;
   struct EvDevInputDriverData *data = self -> data;
-  for (i=0; i<16; ++i)
-    if (data -> fds[i] > 0)
+  for (i=0; i<EVDEV_MAX_DEVICES; ++i)
+    if (data -> devices[i].fd > 0)
       {
-        controlUnregisterFileDescriptor (data -> fds[i]);
-        close (data -> fds[i]);
+        controlUnregisterFileDescriptor (data -> devices[i].fd);
+        close (data -> devices[i].fd);
       }
   yfree (self -> data);
   return 0;
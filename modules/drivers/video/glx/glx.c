@@ -323,7 +323,7 @@ glx_event_probe (void *data_v)
           case MotionNotify:
             {
               XMotionEvent *mev = &xev.xmotion;
-              pointerSetPosition (mev->x, mev->y);
+              pointerQueuePosition (mev->x, mev->y);
             }
           break;
           case ConfigureNotify:
@@ -636,6 +636,7 @@ initialise (struct Module *module, const struct Tuple *args)
   videodriver->special = glx_special;
   videodriver->beginUpdates = glx_begin_updates;
   videodriver->endUpdates = glx_end_updates;
+  videodriver->setUpdateRegion = NULL;
   videodriver->blit = glx_blit;
   videodriver->getRenderer = glx_get_renderer;
   videodriver->get_buffer = glx_get_buffer;
@@ -0,0 +1,452 @@
+/************************************************************************
+ *   Copyright (C) Mark Thomas <markbt@efaref.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* A video driver with no display: the screen is drawn into memory and
+ * nothing else happens to it. It lets the server's whole render path
+ * run, and be timed, on machines without an X server. Frames can be
+ * written out on request through the driver's special calls:
+ *
+ *   "statistics"          -> frames, pixels presented, total and
+ *                            longest frame time in microseconds; the
+ *                            pixel and total time counters are 64 bit
+ *                            and come as two uint32s, high word first
+ *   "resetStatistics"
+ *   "dumpPNG", filename   -> writes the framebuffer as a PNG
+ *   "dumpRaw", filename   -> writes the framebuffer as rows of ARGB32
+ *
+ * The dumps' file names are plain names, put in the configured dump
+ * directory.
+ *
+ * Module arguments: a size such as "1024x768", and "memfd" to keep the
+ * framebuffer in an anonymous file, which other processes can map
+ * through /proc/<pid>/fd.
+ */
+
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <Y/y.h>
+#include <Y/modules/videodriver_interface.h>
+#include <Y/modules/module_interface.h>
+#include <Y/buffer/imagebuffer.h>
+#include <Y/screen/viewport.h>
+#include <Y/screen/screen.h>
+#include <Y/screen/cairorenderer.h>
+#include <Y/util/yutil.h>
+#include <Y/util/region.h>
+
+#define NULL_DEFAULT_WIDTH 800
+#define NULL_DEFAULT_HEIGHT 600
+
+typedef struct
+{
+  int width, height;
+  struct VideoResolution resolutions[4];
+  struct Viewport *viewport;
+
+  /* the framebuffer; with memfd it is a mapping of fd, otherwise the
+   * ImageBuffer owns its memory */
+  ImageBuffer *framebuffer;
+  bool use_memfd;
+  int fd;
+  uint8_t *mapping;
+  size_t mapping_size;
+
+  /* what this update has drawn */
+  struct Region update;
+  bool update_set;
+  struct timespec update_start;
+
+  uint64_t frames;
+  uint64_t presented_pixels;
+  uint64_t total_microseconds;
+  uint64_t max_microseconds;
+} NullVideoDriverData;
+
+static const char *null_resolution_names[] =
+  { "640x480", "800x600", "1024x768", "1280x1024" };
+
+static bool
+null_parse_size (const char *s, int *w, int *h)
+{
+  char end;
+  return sscanf (s, "%dx%d%c", w, h, &end) == 2 && *w > 0 && *h > 0;
+}
+
+static void
+null_release_framebuffer (NullVideoDriverData *driver)
+{
+  if (driver->framebuffer)
+    buffer_destroy ((Buffer *)driver->framebuffer);
+  driver->framebuffer = NULL;
+  if (driver->mapping)
+    munmap (driver->mapping, driver->mapping_size);
+  driver->mapping = NULL;
+  if (driver->fd >= 0)
+    close (driver->fd);
+  driver->fd = -1;
+}
+
+/* maps a memfd of size bytes, or returns NULL if we can't */
+static uint8_t *
+null_map_memfd (NullVideoDriverData *driver, size_t size)
+{
+#ifdef MFD_CLOEXEC
+  void *p;
+
+  driver->fd = memfd_create ("Y-framebuffer", MFD_CLOEXEC);
+  if (driver->fd < 0)
+    return NULL;
+  if (ftruncate (driver->fd, size) < 0
+      || (p = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    driver->fd, 0)) == MAP_FAILED)
+    {
+      close (driver->fd);
+      driver->fd = -1;
+      return NULL;
+    }
+  driver->mapping_size = size;
+  return p;
+#else
+  return NULL;
+#endif
+}
+
+static void
+null_allocate_framebuffer (NullVideoDriverData *driver)
+{
+  uint32_t stride = driver->width * 4;
+
+  null_release_framebuffer (driver);
+
+  if (driver->use_memfd)
+    {
+      driver->mapping = null_map_memfd (driver, (size_t)stride * driver->height);
+      if (driver->mapping)
+        {
+          driver->framebuffer = image_buffer_create_from_data (CAIRO_FORMAT_ARGB32,
+                                  driver->width, driver->height, stride,
+                                  driver->mapping);
+          return;
+        }
+      Y_WARN ("null: no memfd for the framebuffer, using local memory");
+    }
+
+  driver->framebuffer = image_buffer_create (CAIRO_FORMAT_ARGB32,
+                                             driver->width, driver->height);
+}
+
+static void
+null_get_pixel_dimensions (struct VideoDriver *self, int *x, int *y)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  *x = driver->width;
+  *y = driver->height;
+}
+
+static const char *
+null_get_name (struct VideoDriver *self)
+{
+  return self->module->name;
+}
+
+static struct llist *
+null_get_resolutions (struct VideoDriver *self)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  struct llist *resolutions = new_llist ();
+  for (int i = 0; i < 4; ++i)
+    llist_add_tail (resolutions, &driver->resolutions[i]);
+  return resolutions;
+}
+
+static void
+null_set_resolution (struct VideoDriver *self, const char *name)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  int w, h;
+
+  if (!null_parse_size (name, &w, &h))
+    {
+      Y_WARN ("null: bad resolution \"%s\"", name);
+      return;
+    }
+  if (w == driver->width && h == driver->height)
+    return;
+
+  driver->width = w;
+  driver->height = h;
+  null_allocate_framebuffer (driver);
+  viewportSetSize (driver->viewport, w, h);
+}
+
+static void
+null_blit (struct VideoDriver *self, uint32_t *data,
+           int x, int y, int w, int h, int stepping)
+{
+}
+
+/* writes the framebuffer out as rows of native-endian ARGB32 */
+static bool
+null_dump_raw (NullVideoDriverData *driver, const char *filename)
+{
+  uint8_t *pixels = image_buffer_get_pixel_data (driver->framebuffer);
+  uint32_t stride = image_buffer_get_stride_bytes (driver->framebuffer);
+  FILE *f = fopen (filename, "wb");
+  bool ok = true;
+
+  if (f == NULL)
+    return false;
+  cairo_surface_flush (buffer_get_cairo_surface ((Buffer *)driver->framebuffer));
+  for (int y = 0; y < driver->height && ok; ++y)
+    ok = fwrite (pixels + y * stride, 4, driver->width, f) == (size_t)driver->width;
+  return fclose (f) == 0 && ok;
+}
+
+static bool
+null_dump_png (NullVideoDriverData *driver, const char *filename)
+{
+#ifdef CAIRO_HAS_PNG_FUNCTIONS
+  cairo_surface_t *surface = buffer_get_cairo_surface ((Buffer *)driver->framebuffer);
+  return cairo_surface_write_to_png (surface, filename) == CAIRO_STATUS_SUCCESS;
+#else
+  return false;
+#endif
+}
+
+static struct Tuple *
+null_special (struct VideoDriver *self, const struct Tuple *args)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  const char *command;
+
+  if (args->count < 1 || args->list[0].type != t_string)
+    return NULL;
+  command = args->list[0].string.data;
+
+  if (args->count == 1 && strcmp (command, "statistics") == 0)
+    return tupleBuild (tb_uint32 (driver->frames),
+                       tb_uint32 (driver->presented_pixels >> 32),
+                       tb_uint32 (driver->presented_pixels),
+                       tb_uint32 (driver->total_microseconds >> 32),
+                       tb_uint32 (driver->total_microseconds),
+                       tb_uint32 (driver->max_microseconds));
+
+  if (args->count == 1 && strcmp (command, "resetStatistics") == 0)
+    {
+      driver->frames = 0;
+      driver->presented_pixels = 0;
+      driver->total_microseconds = 0;
+      driver->max_microseconds = 0;
+      return tupleBuild ();
+    }
+
+  if (args->count == 2 && args->list[1].type == t_string)
+    {
+      bool (*dump) (NullVideoDriverData *, const char *);
+      char *filename;
+      bool ok;
+      if (strcmp (command, "dumpPNG") == 0)
+        dump = null_dump_png;
+      else if (strcmp (command, "dumpRaw") == 0)
+        dump = null_dump_raw;
+      else
+        return NULL;
+      filename = yDumpPath (args->list[1].string.data);
+      if (filename == NULL)
+        return tupleBuildError (tb_string ("not a file name in the dump directory"));
+      ok = dump (driver, filename);
+      yfree (filename);
+      if (!ok)
+        return tupleBuildError (tb_string ("could not write the frame"));
+      return tupleBuild ();
+    }
+
+  return NULL;
+}
+
+static void
+null_begin_updates (struct VideoDriver *self)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  regionClear (&driver->update);
+  driver->update_set = false;
+  clock_gettime (CLOCK_MONOTONIC, &driver->update_start);
+}
+
+static void
+null_set_update_region (struct VideoDriver *self, const struct Region *region)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  regionCopy (&driver->update, region);
+  driver->update_set = true;
+}
+
+static void
+null_end_updates (struct VideoDriver *self)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  struct Rectangle screen = { 0, 0, driver->width, driver->height };
+  const struct Rectangle *rects;
+  struct timespec end;
+  uint64_t elapsed;
+  int count;
+
+  /* drawing is finished once cairo has let go of the memory */
+  cairo_surface_flush (buffer_get_cairo_surface ((Buffer *)driver->framebuffer));
+
+  clock_gettime (CLOCK_MONOTONIC, &end);
+  elapsed = (uint64_t)(end.tv_sec - driver->update_start.tv_sec) * 1000000
+    + (end.tv_nsec - driver->update_start.tv_nsec) / 1000;
+
+  regionIntersectRectangle (&driver->update, &screen);
+  rects = regionGetRectangles (&driver->update, &count);
+  for (int i = 0; i < count; ++i)
+    driver->presented_pixels += (uint64_t)rects[i].w * rects[i].h;
+
+  driver->frames++;
+  driver->total_microseconds += elapsed;
+  if (elapsed > driver->max_microseconds)
+    driver->max_microseconds = elapsed;
+}
+
+static Renderer *
+null_get_renderer (struct VideoDriver *self, const struct Rectangle *rect)
+{
+  NullVideoDriverData *driver = (NullVideoDriverData *)self->d;
+  if (!driver->update_set)
+    regionUnionRectangle (&driver->update, rect);
+  /* no "hardware pointer": the server draws it, as it would on a
+   * framebuffer */
+  return cairo_renderer_get_renderer (cairo_renderer_create (rect,
+           buffer_get_cairo_surface ((Buffer *)driver->framebuffer)));
+}
+
+static Buffer *
+null_get_buffer (struct VideoDriver *self, cairo_format_t buffer_format,
+                 uint w, uint h)
+{
+  return (Buffer *)image_buffer_create (buffer_format, w, h);
+}
+
+/* looks through the module arguments, which come either straight from
+ * Module.load or as a list from the config file */
+static void
+null_parse_options (NullVideoDriverData *driver, const struct Tuple *args)
+{
+  if (args == NULL)
+    return;
+  for (uint32_t i = 0; i < args->count; ++i)
+    {
+      const struct Value *v = &args->list[i];
+      int w, h;
+      if (v->type == t_list)
+        null_parse_options (driver, v->tuple);
+      else if (v->type != t_string)
+        continue;
+      else if (strcmp (v->string.data, "memfd") == 0)
+        driver->use_memfd = true;
+      else if (null_parse_size (v->string.data, &w, &h))
+        {
+          driver->width = w;
+          driver->height = h;
+        }
+      else
+        Y_WARN ("null: unknown option \"%s\"", v->string.data);
+    }
+}
+
+int
+initialise (struct Module *module, const struct Tuple *args)
+{
+  struct VideoDriver *videodriver;
+  NullVideoDriverData *driver;
+
+  driver = ymalloc (sizeof (NullVideoDriverData));
+  videodriver = ymalloc (sizeof (struct VideoDriver));
+  memset (videodriver, 0, sizeof (struct VideoDriver));
+  videodriver->d = driver;
+  videodriver->module = module;
+
+  driver->width = NULL_DEFAULT_WIDTH;
+  driver->height = NULL_DEFAULT_HEIGHT;
+  driver->use_memfd = false;
+  null_parse_options (driver, args);
+
+  for (int i = 0; i < 4; ++i)
+    driver->resolutions[i].name = ystrdup (null_resolution_names[i]);
+
+  driver->framebuffer = NULL;
+  driver->fd = -1;
+  driver->mapping = NULL;
+  null_allocate_framebuffer (driver);
+
+  regionInitialise (&driver->update);
+  driver->update_set = false;
+  driver->frames = 0;
+  driver->presented_pixels = 0;
+  driver->total_microseconds = 0;
+  driver->max_microseconds = 0;
+
+  videodriver->getPixelDimensions = null_get_pixel_dimensions;
+  videodriver->getName = null_get_name;
+  videodriver->getResolutions = null_get_resolutions;
+  videodriver->setResolution = null_set_resolution;
+  videodriver->setPointer = NULL;
+  videodriver->special = null_special;
+  videodriver->beginUpdates = null_begin_updates;
+  videodriver->endUpdates = null_end_updates;
+  videodriver->setUpdateRegion = null_set_update_region;
+  videodriver->blit = null_blit;
+  videodriver->getRenderer = null_get_renderer;
+  videodriver->get_buffer = null_get_buffer;
+
+  static char moduleName[] = "Null Video Driver";
+  module->name = moduleName;
+  module->data = videodriver;
+
+  driver->viewport = viewportCreate (videodriver);
+  screenRegisterViewport (driver->viewport);
+
+  return 0;
+}
+
+int
+finalise (struct Module *module)
+{
+  struct VideoDriver *videodriver = module->data;
+  NullVideoDriverData *driver = videodriver->d;
+
+  screenUnregisterViewport (driver->viewport);
+  viewportDestroy (driver->viewport);
+
+  null_release_framebuffer (driver);
+  regionFinalise (&driver->update);
+  for (int i = 0; i < 4; ++i)
+    yfree (driver->resolutions[i].name);
+  yfree (driver);
+  yfree (videodriver);
+  return 0;
+}
+
+/* arch-tag: 3b1e6f42-8d0c-4a79-b5e2-6c9f1d4a8e07
+ */
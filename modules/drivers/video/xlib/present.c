@@ -0,0 +1,66 @@
+/************************************************************************
+ *   Copyright (C) Simon Persson <simpster@users.sourceforge.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#include "present.h"
+#include <Y/util/yutil.h>
+
+#define XLIB_PRESENT_STACK_RECTANGLES 64
+
+uint64_t
+xlib_present_region (Display *dpy, GC gc, Drawable src, Drawable dst,
+                     const struct Region *region)
+{
+  XRectangle stack[XLIB_PRESENT_STACK_RECTANGLES];
+  XRectangle *clip = stack;
+  const struct Rectangle *rects;
+  const struct Rectangle *extents;
+  uint64_t pixels = 0;
+  int count;
+
+  if (regionIsEmpty (region))
+    return 0;
+
+  rects = regionGetRectangles (region, &count);
+  extents = regionGetExtents (region);
+
+  if (count > XLIB_PRESENT_STACK_RECTANGLES)
+    clip = ymalloc (count * sizeof (XRectangle));
+
+  for (int i = 0; i < count; ++i)
+    {
+      clip[i].x = rects[i].x;
+      clip[i].y = rects[i].y;
+      clip[i].width = rects[i].w;
+      clip[i].height = rects[i].h;
+      pixels += (uint64_t)rects[i].w * rects[i].h;
+    }
+
+  /* regions are kept in y-x bands already, which lets the server take
+   * the rectangles as they are */
+  XSetClipRectangles (dpy, gc, 0, 0, clip, count, YXBanded);
+  XCopyArea (dpy, src, dst, gc, extents->x, extents->y, extents->w, extents->h,
+             extents->x, extents->y);
+  XSetClipMask (dpy, gc, None);
+
+  if (clip != stack)
+    yfree (clip);
+  return pixels;
+}
+
+/* arch-tag: 7d21f0b8-36ae-4c5e-b9d4-e18a5c0f6b37
+ */
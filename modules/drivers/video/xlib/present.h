@@ -0,0 +1,36 @@
+/************************************************************************
+ *   Copyright (C) Simon Persson <simpster@users.sourceforge.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+#ifndef XLIB_PRESENT_H
+#define XLIB_PRESENT_H
+
+#include <Y/util/region.h>
+#include <X11/Xlib.h>
+#include <stdint.h>
+
+/* Copies the part of src covered by region onto dst, at the same
+ * position, in a single clipped XCopyArea. The clip is left cleared on
+ * the GC. Returns the number of pixels copied.
+ */
+uint64_t xlib_present_region (Display *dpy, GC gc, Drawable src, Drawable dst,
+                              const struct Region *region);
+
+#endif
+
+/* arch-tag: 0c7e5a92-4f1b-4d36-a8e3-92b6d1f07c4a
+ */
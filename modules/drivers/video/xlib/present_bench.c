@@ -0,0 +1,192 @@
+/************************************************************************
+ *   Copyright (C) Simon Persson <simpster@users.sourceforge.net>
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation; either version 2 of the License, or
+ *   (at your option) any later version.
+ *
+ *   This program is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with this program; if not, write to the Free Software
+ *   Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA
+ */
+
+/* Present benchmark
+ *
+ * Opens a 1920x1200 window on $DISPLAY (Xvfb will do) and times getting
+ * a frame from the back buffer to the window for a few typical updates:
+ * copying the whole buffer, as end_updates used to, against copying
+ * just the damaged region. It then times getting client pixels to the
+ * server, through XPutImage and through a shared memory pixmap.
+ *
+ * Usage: present_bench [frames]
+ */
+
+#include "present.h"
+#include <Y/util/yutil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#define SCREEN_W 1920
+#define SCREEN_H 1200
+
+static double
+now (void)
+{
+  struct timespec t;
+  clock_gettime (CLOCK_MONOTONIC, &t);
+  return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static void
+scenario (Display *dpy, Window win, Pixmap back, GC gc, const char *name,
+          const struct Rectangle *rects, int count, int frames)
+{
+  struct Region region;
+  uint64_t pixels = 0;
+
+  regionInitialise (&region);
+  for (int i = 0; i < count; ++i)
+    regionUnionRectangle (&region, &rects[i]);
+
+  XSync (dpy, False);
+  double start = now ();
+  for (int i = 0; i < frames; ++i)
+    {
+      XCopyArea (dpy, back, win, gc, 0, 0, SCREEN_W, SCREEN_H, 0, 0);
+      XSync (dpy, False);
+    }
+  double full = now () - start;
+
+  start = now ();
+  for (int i = 0; i < frames; ++i)
+    {
+      pixels = xlib_present_region (dpy, gc, back, win, &region);
+      XSync (dpy, False);
+    }
+  double damaged = now () - start;
+
+  printf ("%-12s full %8.1f us/frame %9d bytes   region %8.1f us/frame %9llu bytes\n",
+          name, full * 1e6 / frames, SCREEN_W * SCREEN_H * 4,
+          damaged * 1e6 / frames, (unsigned long long)pixels * 4);
+
+  regionFinalise (&region);
+}
+
+static void
+upload (Display *dpy, Window win, GC gc, int frames)
+{
+  int scr = DefaultScreen (dpy);
+  int depth = DefaultDepth (dpy, scr);
+  Visual *visual = DefaultVisual (dpy, scr);
+  size_t size = SCREEN_W * SCREEN_H * 4;
+  char *data = ymalloc (size);
+  XImage *image;
+
+  memset (data, 0x80, size);
+  image = XCreateImage (dpy, visual, depth, ZPixmap, 0, data,
+                        SCREEN_W, SCREEN_H, 32, SCREEN_W * 4);
+
+  XSync (dpy, False);
+  double start = now ();
+  for (int i = 0; i < frames; ++i)
+    {
+      data[i % size]++;
+      XPutImage (dpy, win, gc, image, 0, 0, 0, 0, SCREEN_W, SCREEN_H);
+      XSync (dpy, False);
+    }
+  double put = now () - start;
+  printf ("%-12s XPutImage %8.1f us/frame\n", "upload", put * 1e6 / frames);
+
+  image->data = NULL;
+  XDestroyImage (image);
+  yfree (data);
+
+  Bool pixmaps;
+  int major, minor;
+  if (!XShmQueryExtension (dpy) || !XShmQueryVersion (dpy, &major, &minor, &pixmaps)
+      || !pixmaps)
+    {
+      printf ("%-12s no shared pixmaps on this server\n", "upload");
+      return;
+    }
+
+  XShmSegmentInfo shm;
+  shm.shmid = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+  shm.shmaddr = shmat (shm.shmid, NULL, 0);
+  shmctl (shm.shmid, IPC_RMID, NULL);
+  shm.readOnly = True;
+  XShmAttach (dpy, &shm);
+  Pixmap pixmap = XShmCreatePixmap (dpy, win, shm.shmaddr, &shm,
+                                    SCREEN_W, SCREEN_H, depth);
+  memset (shm.shmaddr, 0x80, size);
+
+  XSync (dpy, False);
+  start = now ();
+  for (int i = 0; i < frames; ++i)
+    {
+      shm.shmaddr[i % size]++;
+      XCopyArea (dpy, pixmap, win, gc, 0, 0, SCREEN_W, SCREEN_H, 0, 0);
+      XSync (dpy, False);
+    }
+  double shared = now () - start;
+  printf ("%-12s shm pixmap %7.1f us/frame\n", "upload", shared * 1e6 / frames);
+
+  XFreePixmap (dpy, pixmap);
+  XShmDetach (dpy, &shm);
+  XSync (dpy, False);
+  shmdt (shm.shmaddr);
+}
+
+int
+main (int argc, char **argv)
+{
+  int frames = argc > 1 ? atoi (argv[1]) : 200;
+  Display *dpy = XOpenDisplay (NULL);
+  if (dpy == NULL)
+    {
+      fprintf (stderr, "present_bench: can't open display\n");
+      return 1;
+    }
+
+  int scr = DefaultScreen (dpy);
+  Window win = XCreateSimpleWindow (dpy, RootWindow (dpy, scr), 0, 0,
+                                    SCREEN_W, SCREEN_H, 0, 0, 0);
+  Pixmap back = XCreatePixmap (dpy, win, SCREEN_W, SCREEN_H, DefaultDepth (dpy, scr));
+  GC gc = XCreateGC (dpy, win, 0, NULL);
+  XMapWindow (dpy, win);
+  XFillRectangle (dpy, back, gc, 0, 0, SCREEN_W, SCREEN_H);
+
+  struct Rectangle cursor[] = { { 400, 300, 2, 16 } };
+  struct Rectangle text[] = { { 40, 600, 900, 16 } };
+  /* a 600x400 window dragged 10 pixels: where it was and where it is */
+  struct Rectangle drag[] = { { 300, 200, 600, 400 }, { 310, 205, 600, 400 } };
+  struct Rectangle full[] = { { 0, 0, SCREEN_W, SCREEN_H } };
+
+  scenario (dpy, win, back, gc, "cursor", cursor, 1, frames);
+  scenario (dpy, win, back, gc, "text line", text, 1, frames);
+  scenario (dpy, win, back, gc, "window drag", drag, 2, frames);
+  scenario (dpy, win, back, gc, "full screen", full, 1, frames);
+  upload (dpy, win, gc, frames);
+
+  XFreeGC (dpy, gc);
+  XFreePixmap (dpy, back);
+  XDestroyWindow (dpy, win);
+  XCloseDisplay (dpy);
+  return 0;
+}
+
+/* arch-tag: 0c5b93e2-8f4d-4a17-b6e1-52d7a9f3c8e4
+ */
@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <Y/setup.h>
 #include <Y/modules/videodriver_interface.h>
 #include <Y/modules/module_interface.h>
 #include <Y/main/control.h>
@@ -31,11 +32,19 @@
 #include <Y/input/pointer.h>
 #include <Y/input/ykb.h>
 #include <Y/util/yutil.h>
+#include <Y/util/region.h>
 #include <X11/Xlib.h>
 #include <X11/Xutil.h>
+#ifdef HAVE_XSHM
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#endif
 #include <cairo-xlib.h>
 #include <cairo-xlib-xrender.h>
 
+#include "present.h"
+
 #define XLIB_EVENT_POLL_INTERVAL 20
 
 typedef struct
@@ -50,6 +59,16 @@ typedef struct
   int width, height;
   cairo_surface_t *surface;
   struct Viewport *viewport;
+
+  /* what this update has drawn, to be copied to the window at the end */
+  GC present_gc;
+  struct Region update;
+  bool update_set;
+  uint64_t frames;
+  uint64_t presented_pixels;
+
+  /* whether buffers live in MIT-SHM shared pixmaps */
+  bool use_shm;
 } XlibVideoDriverData;
 
 typedef struct
@@ -62,6 +81,19 @@ typedef struct
   int hblocksize;
   int vblocksize;
   bool resizing;
+
+  /* For buffers in shared memory: painters draw into an image surface
+   * over the segment, and the X server reads the same memory through a
+   * shared pixmap, so the pixels never cross the socket. If the
+   * segment couldn't be had, data is plain memory and the image is
+   * uploaded as usual. */
+#ifdef HAVE_XSHM
+  XShmSegmentInfo shm;
+#endif
+  bool shared;
+  uint8_t *data;
+  int capacity_w, capacity_h;
+  cairo_surface_t *pixmap_surface;
 } XlibBuffer;
 
 /******* XlibBuffer implementation follows **********/
@@ -213,6 +245,275 @@ xlib_buffer_create (cairo_format_t buffer_format, uint w, uint h, Display *dpy)
 }
 
 
+/******* XlibBuffer in shared memory follows **********/
+
+#ifdef HAVE_XSHM
+
+static bool xlib_shm_error_seen;
+
+static int
+xlib_shm_error_handler (Display *dpy, XErrorEvent *ev)
+{
+  xlib_shm_error_seen = true;
+  return 0;
+}
+
+/* Attaches a segment, catching the error the server sends back if it
+ * can't reach it (e.g. over the network) */
+static bool
+xlib_shm_attach (Display *dpy, XShmSegmentInfo *shm)
+{
+  int (*old) (Display *, XErrorEvent *);
+  XSync (dpy, False);
+  xlib_shm_error_seen = false;
+  old = XSetErrorHandler (xlib_shm_error_handler);
+  XShmAttach (dpy, shm);
+  XSync (dpy, False);
+  XSetErrorHandler (old);
+  return !xlib_shm_error_seen;
+}
+
+/* returns whether the server can share pixmaps with us */
+static bool
+xlib_shm_probe (Display *dpy)
+{
+  int major, minor;
+  Bool pixmaps;
+  XShmSegmentInfo shm;
+
+  if (!XShmQueryExtension (dpy)
+      || !XShmQueryVersion (dpy, &major, &minor, &pixmaps)
+      || !pixmaps || XShmPixmapFormat (dpy) != ZPixmap)
+    return false;
+
+  shm.shmid = shmget (IPC_PRIVATE, 4096, IPC_CREAT | 0600);
+  if (shm.shmid < 0)
+    return false;
+  shm.shmaddr = shmat (shm.shmid, NULL, 0);
+  shmctl (shm.shmid, IPC_RMID, NULL);
+  if (shm.shmaddr == (char *)-1)
+    return false;
+  shm.readOnly = True;
+
+  bool ok = xlib_shm_attach (dpy, &shm);
+  if (ok)
+    XShmDetach (dpy, &shm);
+  XSync (dpy, False);
+  shmdt (shm.shmaddr);
+  return ok;
+}
+
+static void
+xlib_shm_release (XlibBuffer *buf)
+{
+  if (buf->pixmap_surface)
+    cairo_surface_destroy (buf->pixmap_surface);
+  buf->pixmap_surface = NULL;
+  if (buf->shared)
+    {
+      XShmDetach (buf->dpy, &buf->shm);
+      XFreePixmap (buf->dpy, buf->pixmap);
+      XSync (buf->dpy, False);
+      shmdt (buf->shm.shmaddr);
+    }
+  else
+    yfree (buf->data);
+  buf->shared = false;
+  buf->data = NULL;
+  buf->pixmap = None;
+}
+
+/* sets up storage of w by h pixels, copying what fits of the old */
+static void
+xlib_shm_allocate (XlibBuffer *buf, int w, int h, bool keep)
+{
+  XlibBuffer old = *buf;
+  size_t stride = w * 4;
+  size_t size = stride * h;
+
+  if (size == 0)
+    size = 4;
+
+  buf->shared = false;
+  buf->shm.shmid = shmget (IPC_PRIVATE, size, IPC_CREAT | 0600);
+  if (buf->shm.shmid >= 0)
+    {
+      buf->shm.shmaddr = shmat (buf->shm.shmid, NULL, 0);
+      /* goes away by itself once both sides have detached */
+      shmctl (buf->shm.shmid, IPC_RMID, NULL);
+      buf->shm.readOnly = True;
+      if (buf->shm.shmaddr != (char *)-1)
+        {
+          if (xlib_shm_attach (buf->dpy, &buf->shm))
+            buf->shared = true;
+          else
+            shmdt (buf->shm.shmaddr);
+        }
+    }
+
+  if (buf->shared)
+    {
+      buf->data = (uint8_t *)buf->shm.shmaddr;
+      buf->pixmap = XShmCreatePixmap (buf->dpy, DefaultRootWindow (buf->dpy),
+                                      buf->shm.shmaddr, &buf->shm,
+                                      w > 0 ? w : 1, h > 0 ? h : 1, buf->depth);
+    }
+  else
+    {
+      Y_WARN ("xlib: no shared memory for a %dx%d buffer, using local memory", w, h);
+      buf->data = ymalloc (size);
+      buf->pixmap = None;
+    }
+  buf->capacity_w = w;
+  buf->capacity_h = h;
+
+  if (keep && old.data != NULL)
+    {
+      int rows = old.capacity_h < h ? old.capacity_h : h;
+      int bytes = (old.capacity_w < w ? old.capacity_w : w) * 4;
+      for (int y = 0; y < rows; ++y)
+        memcpy (buf->data + y * stride, old.data + y * old.capacity_w * 4, bytes);
+    }
+
+  if (old.data != NULL)
+    xlib_shm_release (&old);
+}
+
+/* (re)creates the surfaces over the storage, w by h of it */
+static void
+xlib_shm_make_surfaces (XlibBuffer *buf, int w, int h)
+{
+  buf->buffer.surface = cairo_image_surface_create_for_data (buf->data,
+                          buf->buffer.format, w, h, buf->capacity_w * 4);
+  if (buf->shared)
+    buf->pixmap_surface = cairo_xlib_surface_create_with_xrender_format (buf->dpy,
+                            buf->pixmap, DefaultScreenOfDisplay (buf->dpy),
+                            buf->xrender_format, w, h);
+}
+
+static void
+xlib_shm_drop_surfaces (XlibBuffer *buf)
+{
+  buffer_destroy_all_painters (&buf->buffer);
+  cairo_surface_destroy (buf->buffer.surface);
+  buf->buffer.surface = NULL;
+  if (buf->pixmap_surface)
+    cairo_surface_destroy (buf->pixmap_surface);
+  buf->pixmap_surface = NULL;
+}
+
+static void
+xlib_shm_buffer_destroy (Buffer *self)
+{
+  XlibBuffer *buf = (XlibBuffer *)self;
+  if (self)
+  {
+    buffer_finalise (self);
+    cairo_surface_destroy (buf->buffer.surface);
+    xlib_shm_release (buf);
+    yfree (buf);
+  }
+}
+
+static void
+xlib_shm_buffer_set_size (Buffer *self, int w, int h)
+{
+  if (self->width == w && self->height == h)
+    return; //no change
+
+  XlibBuffer *buf = (XlibBuffer *)self;
+
+  xlib_shm_drop_surfaces (buf);
+
+  if (buf->resizing)
+    {
+      int new_w = (1 + w / buf->hblocksize) * buf->hblocksize;
+      int new_h = (1 + h / buf->vblocksize) * buf->vblocksize;
+      if (new_w != buf->capacity_w || new_h != buf->capacity_h)
+        xlib_shm_allocate (buf, new_w, new_h, false);
+    }
+  else
+    xlib_shm_allocate (buf, w, h, false);
+
+  xlib_shm_make_surfaces (buf, w, h);
+
+  self->width = w;
+  self->height = h;
+}
+
+static void
+xlib_shm_buffer_begin_resize (Buffer *self, int w, int h)
+{
+  XlibBuffer *buf = (XlibBuffer *)self;
+  xlib_shm_drop_surfaces (buf);
+  xlib_shm_allocate (buf, w, h, true);
+  xlib_shm_make_surfaces (buf, w, h);
+  buf->resizing = true;
+  buf->hblocksize = w;
+  buf->vblocksize = h;
+}
+
+static void
+xlib_shm_buffer_end_resize (Buffer *self)
+{
+  XlibBuffer *buf = (XlibBuffer *)self;
+  xlib_shm_drop_surfaces (buf);
+  xlib_shm_allocate (buf, self->width, self->height, true);
+  xlib_shm_make_surfaces (buf, self->width, self->height);
+  buf->resizing = false;
+}
+
+static cairo_surface_t *
+xlib_shm_buffer_get_source_surface (Buffer *self)
+{
+  XlibBuffer *buf = (XlibBuffer *)self;
+  /* the server reads the memory directly, so anything cairo has
+   * pending must be in it first */
+  cairo_surface_flush (self->surface);
+  if (buf->pixmap_surface)
+    return buf->pixmap_surface;
+  return self->surface;
+}
+
+static BufferClass xlib_shm_buffer_class =
+{
+    name:               "XlibShmBuffer",
+    destroy:            xlib_shm_buffer_destroy,
+    set_size:           xlib_shm_buffer_set_size,
+    begin_resize:       xlib_shm_buffer_begin_resize,
+    end_resize:         xlib_shm_buffer_end_resize,
+    get_source_surface: xlib_shm_buffer_get_source_surface
+};
+
+static XlibBuffer *
+xlib_shm_buffer_create (cairo_format_t buffer_format, uint w, uint h, Display *dpy)
+{
+  XlibBuffer *buf = ymalloc (sizeof (XlibBuffer));
+
+  buffer_init (&buf->buffer, &xlib_shm_buffer_class, buffer_format);
+  buf->dpy = dpy;
+  buf->hblocksize = 0;
+  buf->vblocksize = 0;
+  buf->xrender_format = xlib_render_format (dpy, buffer_format);
+  buf->depth = buffer_get_depth (buffer_format);
+  buf->resizing = false;
+  buf->shared = false;
+  buf->data = NULL;
+  buf->pixmap = None;
+  buf->pixmap_surface = NULL;
+
+  xlib_shm_allocate (buf, 1, 1, false);
+  xlib_shm_make_surfaces (buf, 1, 1);
+  buf->buffer.width = 1;
+  buf->buffer.height = 1;
+
+  buffer_set_size (&buf->buffer, w, h);
+  return buf;
+}
+
+#endif /* HAVE_XSHM */
+
+
 /******* Xlib video driver implementation follows **********/
 
 /* Check to see if this is a repeated key.
@@ -279,7 +580,7 @@ xlib_event_probe (void *data_v)
           case MotionNotify:
             {
               XMotionEvent *mev = &xev.xmotion;
-              pointerSetPosition (mev->x, mev->y);
+              pointerQueuePosition (mev->x, mev->y);
             }
           break;
           case ConfigureNotify:
@@ -357,20 +658,46 @@ xlib_blit (struct VideoDriver *self, uint32_t *data,
 static struct Tuple *
 xlib_special (struct VideoDriver *self, const struct Tuple *args)
 {
+  XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
+  if (args->count == 1 && args->list[0].type == t_string
+      && strcmp (args->list[0].string.data, "presentStatistics") == 0)
+    {
+      /* frames presented, and the average bytes copied for each */
+      uint64_t frames = driver->frames ? driver->frames : 1;
+      return tupleBuild (tb_uint32 (driver->frames),
+                         tb_uint32 (driver->presented_pixels * 4 / frames));
+    }
   return NULL;
 }
 
 static void
 xlib_begin_updates (struct VideoDriver *self)
 {
+  XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
+  regionClear (&driver->update);
+  driver->update_set = false;
+}
+
+static void
+xlib_set_update_region (struct VideoDriver *self, const struct Region *region)
+{
+  XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
+  regionCopy (&driver->update, region);
+  driver->update_set = true;
 }
 
 static void
 xlib_end_updates (struct VideoDriver *self)
 {
   XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
-  XCopyArea (driver->dpy, driver->buffer, driver->win, DefaultGC (driver->dpy, driver->scr),
-             0, 0, driver->width, driver->height, 0, 0);
+  struct Rectangle window = { 0, 0, driver->width, driver->height };
+
+  /* only what was drawn needs to reach the window */
+  regionIntersectRectangle (&driver->update, &window);
+  driver->presented_pixels += xlib_present_region (driver->dpy, driver->present_gc,
+                                                   driver->buffer, driver->win,
+                                                   &driver->update);
+  driver->frames++;
   XFlush (driver->dpy);
 }
 
@@ -378,6 +705,9 @@ static Renderer *
 xlib_get_renderer (struct VideoDriver *self, const struct Rectangle *rect)
 {
   XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
+  /* with no region from the viewport, present what we're asked to draw */
+  if (!driver->update_set)
+    regionUnionRectangle (&driver->update, rect);
   Renderer *renderer = cairo_renderer_get_renderer (cairo_renderer_create (rect, driver->surface));
   renderer_set_option (renderer, "hardware pointer", "yes");
   return renderer;
@@ -388,9 +718,34 @@ xlib_get_buffer (struct VideoDriver *self, cairo_format_t buffer_format,
                  uint w, uint h)
 {
   XlibVideoDriverData *driver = (XlibVideoDriverData *)self->d;
+#ifdef HAVE_XSHM
+  /* shared pixmaps have the server's layout, which matches cairo's for
+   * 32 bit pixels only */
+  if (driver->use_shm && (buffer_format == CAIRO_FORMAT_ARGB32
+                          || buffer_format == CAIRO_FORMAT_RGB24))
+    return (Buffer *)xlib_shm_buffer_create (buffer_format, w, h, driver->dpy);
+#endif
   return (Buffer *)xlib_buffer_create (buffer_format, w, h, driver->dpy);
 }
 
+/* looks for a word among the module arguments, which come either
+ * straight from Module.load or as a list from the config file */
+static bool
+xlib_has_option (const struct Tuple *args, const char *option)
+{
+  if (args == NULL)
+    return false;
+  for (uint32_t i = 0; i < args->count; ++i)
+    {
+      const struct Value *v = &args->list[i];
+      if (v->type == t_string && strcmp (v->string.data, option) == 0)
+        return true;
+      if (v->type == t_list && xlib_has_option (v->tuple, option))
+        return true;
+    }
+  return false;
+}
+
 int
 initialise (struct Module *module, const struct Tuple *args)
 {
@@ -440,6 +795,24 @@ initialise (struct Module *module, const struct Tuple *args)
   driver->surface = cairo_xlib_surface_create (dpy, driver->buffer,
                                                DefaultVisual (driver->dpy, driver->scr),
                                                driver->width, driver->height);
+
+  driver->present_gc = XCreateGC (dpy, driver->win, 0, NULL);
+  regionInitialise (&driver->update);
+  driver->update_set = false;
+  driver->frames = 0;
+  driver->presented_pixels = 0;
+
+  driver->use_shm = false;
+  if (xlib_has_option (args, "shm"))
+    {
+#ifdef HAVE_XSHM
+      driver->use_shm = xlib_shm_probe (dpy);
+      if (!driver->use_shm)
+        Y_WARN ("xlib: the server can't share pixmaps, not using shm");
+#else
+      Y_WARN ("xlib: built without MIT-SHM support, not using shm");
+#endif
+    }
   
   videodriver->getPixelDimensions = xlib_get_pixel_dimensions;
   videodriver->getName = xlib_get_name;
@@ -449,6 +822,7 @@ initialise (struct Module *module, const struct Tuple *args)
   videodriver->special = xlib_special;
   videodriver->beginUpdates = xlib_begin_updates;
   videodriver->endUpdates = xlib_end_updates;
+  videodriver->setUpdateRegion = xlib_set_update_region;
   videodriver->blit = xlib_blit;
   videodriver->getRenderer = xlib_get_renderer;
   videodriver->get_buffer = xlib_get_buffer;
@@ -478,6 +852,8 @@ finalise (struct Module *module)
   controlCancelTimerDelay (driver->polling_ID);
 
   cairo_surface_destroy (driver->surface);
+  XFreeGC (driver->dpy, driver->present_gc);
+  regionFinalise (&driver->update);
   XFreePixmap (driver->dpy, driver->buffer);
   XDestroyWindow (driver->dpy, driver->win);
   XCloseDisplay (driver->dpy);
@@ -46,7 +46,8 @@ static struct Theme default_theme =
   windowPointerMotion: default_window_pointer_motion,
   windowPointerButton: default_window_pointer_button,
   windowReconfigure:   default_window_reconfigure,
-  windowResize:        default_window_resize
+  windowResize:        default_window_resize,
+  windowGetOpaqueRegion: default_window_get_opaque_region
 
 };
 
@@ -258,6 +258,22 @@ default_window_paint (struct Window *window, struct Painter *painter)
     }
 }
 
+/*
+ * The title bar is translucent, but the body is filled with a solid
+ * colour; only its rounded corners and edge might let anything show
+ * through.
+ */
+void
+default_window_get_opaque_region (struct Window *window, struct Region *region)
+{
+  struct Rectangle *rect = widget_get_rectangle (windowToWidget (window));
+  int inset = (int)(edge_offset + window_radius + window_edge_width + 0.999);
+  struct Rectangle body = { inset, title_height + inset,
+                            rect->w - 2 * inset, rect->h - title_height - 2 * inset };
+  regionUnionRectangle (region, &body);
+  rectangleDestroy (rect);
+}
+
 int
 default_window_get_region (struct Window *window, int32_t x_pos, int32_t y_pos)
 {
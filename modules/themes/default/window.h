@@ -30,5 +30,6 @@ int  default_window_pointer_button (struct Window *, int32_t, int32_t, uint32_t,
 void default_window_reconfigure (struct Window *, int32_t *, int32_t *, int32_t *, int32_t *,
                              int32_t *, int32_t *);
 void default_window_resize (struct Window *);
+void default_window_get_opaque_region (struct Window *, struct Region *);
 
 #endif